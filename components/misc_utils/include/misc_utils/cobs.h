@@ -0,0 +1,100 @@
+#ifndef MISC_UTILS_COBS_H
+#define MISC_UTILS_COBS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace micromouse::cobs
+{
+
+/**
+ * Consistent Overhead Byte Stuffing: encodes any bytes without zeros, so a zero can delimit the frames of a stream.
+ * A reader that starts in the middle of the stream (or loses bytes) resynchronizes at the next zero.
+ *
+ * Every run of up to 254 non-zero bytes becomes a code byte (the run's length + 1) followed by the run, and the code
+ * byte of a run that's shorter than 254 bytes stands for a zero after it (except at the end of the data).
+ */
+
+/**
+ * @brief The longest encoding of `size` bytes (without the delimiter).
+ */
+constexpr std::size_t max_encoded_size(std::size_t size) noexcept
+{
+    return size + size / 254 + 1;
+}
+
+/**
+ * @brief Encode `data` into `out` (at least `max_encoded_size(data.size())` bytes), without the delimiter.
+ *
+ * @return The encoded size.
+ */
+constexpr std::size_t encode(std::span<const std::uint8_t> data, std::span<std::uint8_t> out) noexcept
+{
+    std::size_t code_pos = 0;
+    std::size_t out_pos = 1;
+    std::uint8_t code = 1;
+    for (std::size_t i = 0; i < data.size(); i++)
+    {
+        const auto byte = data[i];
+        if (byte != 0)
+        {
+            out[out_pos++] = byte;
+            code++;
+        }
+        if (byte == 0 || code == 0xff)
+        {
+            out[code_pos] = code;
+            code = 1;
+            code_pos = out_pos;
+            // A full run at the end of the data doesn't need another code byte.
+            if (byte == 0 || i + 1 < data.size())
+            {
+                out_pos++;
+            }
+        }
+    }
+    if (code_pos < out_pos)
+    {
+        out[code_pos] = code;
+    }
+    return out_pos;
+}
+
+/**
+ * @brief Decode a frame (without the delimiter) into `out` (at least `frame.size()` bytes).
+ *
+ * @return The decoded size, or `std::nullopt` if the frame is malformed (has a zero, or a run that ends after it).
+ */
+constexpr std::optional<std::size_t> decode(std::span<const std::uint8_t> frame, std::span<std::uint8_t> out) noexcept
+{
+    std::size_t in_pos = 0;
+    std::size_t out_pos = 0;
+    while (in_pos < frame.size())
+    {
+        const auto code = frame[in_pos++];
+        if (code == 0 || code - 1U > frame.size() - in_pos)
+        {
+            return std::nullopt;
+        }
+        const auto run = frame.subspan(in_pos, code - 1U);
+        if (std::ranges::find(run, 0) != run.end())
+        {
+            return std::nullopt;
+        }
+        std::ranges::copy(run, out.subspan(out_pos).begin());
+        in_pos += run.size();
+        out_pos += run.size();
+        if (code != 0xff && in_pos < frame.size())
+        {
+            out[out_pos++] = 0;
+        }
+    }
+    return out_pos;
+}
+
+}  // namespace micromouse::cobs
+
+#endif  // MISC_UTILS_COBS_H
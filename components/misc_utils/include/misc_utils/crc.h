@@ -0,0 +1,30 @@
+#ifndef MISC_UTILS_CRC_H
+#define MISC_UTILS_CRC_H
+
+#include <cstdint>
+#include <span>
+
+namespace micromouse
+{
+
+/**
+ * @brief CRC-16/CCITT-FALSE.
+ *
+ * @param crc The CRC of the preceding data, to continue it.
+ */
+constexpr std::uint16_t crc16(std::span<const std::uint8_t> data, std::uint16_t crc = 0xffff) noexcept
+{
+    for (const auto byte : data)
+    {
+        crc ^= static_cast<std::uint16_t>(byte << 8);
+        for (auto bit = 0; bit < 8; bit++)
+        {
+            crc = static_cast<std::uint16_t>(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+}  // namespace micromouse
+
+#endif  // MISC_UTILS_CRC_H
@@ -0,0 +1,219 @@
+#ifndef MISC_UTILS_FAST_MATH_H
+#define MISC_UTILS_FAST_MATH_H
+
+#include "angle.h"
+#include "physical_size.h"
+
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <numbers>
+
+/**
+ * @brief Polynomial approximations of the elementary functions used by the control loop.
+ *
+ * All functions are branch-light, division-free (except `atan2`, which needs a single division) and `constexpr`.
+ * The error bounds below are the maximum absolute errors measured against `long double` libm over the documented
+ * domain (see `fast_math_test.cc`):
+ *
+ * | Function        | Domain            | Max error         |
+ * |-----------------|-------------------|-------------------|
+ * | `sin`, `cos`    | |x| <= 1e4        | 1.5e-6 (abs.)     |
+ * | `sincos`        | |x| <= 1e4        | 1.5e-6 (abs.)     |
+ * | `atan2`         | any finite y, x   | 1e-6 rad (abs.)   |
+ * | `rsqrt`         | x > 0, normal     | 5e-6 (rel.)       |
+ * | `sqrt`, `hypot` | x >= 0, normal    | 5e-6 (rel.)       |
+ *
+ * The functions live in the `fast` namespace on purpose, so they are never picked up by ADL instead of the `std`
+ * versions and every use site is explicit.
+ */
+namespace micromouse::fast
+{
+
+struct SinCos
+{
+    float sin;
+    float cos;
+};
+
+namespace detail
+{
+
+inline constexpr auto pi = std::numbers::pi_v<float>;
+inline constexpr auto half_pi = pi / 2;
+inline constexpr auto inv_two_pi = 1 / (2 * pi);
+// 2 * pi split in two (Cody-Waite) so `k * two_pi_hi` is exact for the supported range of `k`.
+inline constexpr auto two_pi_hi = 6.28125f;
+inline constexpr auto two_pi_lo = 1.9353071795864769e-3f;
+
+/**
+ * @brief Reduce an angle to [-pi, pi].
+ */
+constexpr float wrap(float x) noexcept
+{
+    const auto k = static_cast<float>(static_cast<std::int32_t>(x * inv_two_pi + (x < 0.0f ? -0.5f : 0.5f)));
+    return (x - k * two_pi_hi) - k * two_pi_lo;
+}
+
+/**
+ * @brief sin(x) for x in [-pi/2, pi/2] (Chebyshev fit of degree 7).
+ */
+constexpr float sin_poly(float x) noexcept
+{
+    const auto x2 = x * x;
+    return x * (0.999999237f + x2 * (-0.166656765f + x2 * (8.31319141e-3f + x2 * -1.85225393e-4f)));
+}
+
+/**
+ * @brief cos(x) for x in [-pi/2, pi/2] (Chebyshev fit of degree 8).
+ */
+constexpr float cos_poly(float x) noexcept
+{
+    const auto x2 = x * x;
+    return 0.999999953f
+         + x2 * (-0.499999048f + x2 * (4.16635732e-2f + x2 * (-1.38536295e-3f + x2 * 2.31524167e-5f)));
+}
+
+/**
+ * @brief atan(z) for z in [0, 1] (Chebyshev fit of degree 13).
+ */
+constexpr float atan_poly(float z) noexcept
+{
+    const auto z2 = z * z;
+    auto p = 7.64835393e-3f;
+    p = p * z2 - 3.63604309e-2f;
+    p = p * z2 + 8.3126453e-2f;
+    p = p * z2 - 0.134478641f;
+    p = p * z2 + 0.198720403f;
+    p = p * z2 - 0.33325678f;
+    p = p * z2 + 0.999999226f;
+    return z * p;
+}
+
+/**
+ * @brief sin and cos of an angle that is already in [-pi, pi].
+ *
+ * Folds the angle into [-pi/2, pi/2] using sin(pi - x) = sin(x) and cos(pi - x) = -cos(x).
+ */
+constexpr SinCos sincos_wrapped(float x) noexcept
+{
+    if (x > half_pi)
+    {
+        const auto y = pi - x;
+        return {sin_poly(y), -cos_poly(y)};
+    }
+    if (x < -half_pi)
+    {
+        const auto y = -pi - x;
+        return {sin_poly(y), -cos_poly(y)};
+    }
+    return {sin_poly(x), cos_poly(x)};
+}
+
+}  // namespace detail
+
+template <typename T>
+    requires requires (T a) { a * a; }
+constexpr auto square(const T &x) noexcept(noexcept(x * x))
+{
+    return x * x;
+}
+
+constexpr SinCos sincos(float x) noexcept
+{
+    return detail::sincos_wrapped(detail::wrap(x));
+}
+
+/**
+ * @brief `Angle` is always in [-pi, pi), so the range reduction can be skipped.
+ */
+constexpr SinCos sincos(const Angle &angle) noexcept
+{
+    return detail::sincos_wrapped(angle.get());
+}
+
+constexpr float sin(float x) noexcept
+{
+    return sincos(x).sin;
+}
+
+constexpr float sin(const Angle &angle) noexcept
+{
+    return sincos(angle).sin;
+}
+
+constexpr float cos(float x) noexcept
+{
+    return sincos(x).cos;
+}
+
+constexpr float cos(const Angle &angle) noexcept
+{
+    return sincos(angle).cos;
+}
+
+constexpr Angle atan2(float y, float x) noexcept
+{
+    const auto abs_x = x < 0.0f ? -x : x;
+    const auto abs_y = y < 0.0f ? -y : y;
+    const auto steep = abs_y > abs_x;
+    const auto max = steep ? abs_y : abs_x;
+    if (max == 0.0f)
+    {
+        return Angle{0.0f};
+    }
+
+    auto res = detail::atan_poly((steep ? abs_x : abs_y) / max);
+    if (steep)
+    {
+        res = detail::half_pi - res;
+    }
+    if (x < 0.0f)
+    {
+        res = detail::pi - res;
+    }
+    return Angle{y < 0.0f ? -res : res};
+}
+
+/**
+ * @brief 1 / sqrt(x) using the bit-level initial guess followed by two Newton-Raphson iterations.
+ *
+ * @param x Must be a positive normal number.
+ */
+constexpr float rsqrt(float x) noexcept
+{
+    auto y = std::bit_cast<float>(0x5f37'5a86U - (std::bit_cast<std::uint32_t>(x) >> 1));
+    const auto half_x = 0.5f * x;
+    y *= 1.5f - half_x * y * y;
+    y *= 1.5f - half_x * y * y;
+    return y;
+}
+
+constexpr float sqrt(float x) noexcept
+{
+    return x > 0.0f ? x * rsqrt(x) : 0.0f;
+}
+
+constexpr float hypot(float x, float y) noexcept
+{
+    return sqrt(x * x + y * y);
+}
+
+template <std::floating_point Rep, UnitSpec Units, RatioSpec Ratio>
+constexpr auto hypot(const PhysicalSize<Rep, Units, Ratio> &x, const PhysicalSize<Rep, Units, Ratio> &y) noexcept
+{
+    return PhysicalSize<Rep, Units, Ratio>(hypot(x.count(), y.count()));
+}
+
+/**
+ * @brief The angle of the vector (x, y). Both sizes must share the same units, so the ratio cancels out.
+ */
+template <std::floating_point Rep, UnitSpec Units, RatioSpec Ratio>
+constexpr Angle atan2(const PhysicalSize<Rep, Units, Ratio> &y, const PhysicalSize<Rep, Units, Ratio> &x) noexcept
+{
+    return atan2(y.count(), x.count());
+}
+
+}  // namespace micromouse::fast
+
+#endif  // MISC_UTILS_FAST_MATH_H
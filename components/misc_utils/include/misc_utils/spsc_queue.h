@@ -0,0 +1,115 @@
+#ifndef MISC_UTILS_SPSC_QUEUE_H
+#define MISC_UTILS_SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+
+namespace micromouse
+{
+
+/**
+ * @brief A bounded single producer, single consumer FIFO queue that never blocks either side.
+ *
+ * Unlike `TripleBuffer`, every value is kept (until the queue is full), so it's for streams where each value matters
+ * (wall updates, waypoints) rather than for the latest state of something.
+ *
+ * The values live in a ring buffer. The producer only writes the tail index and the consumer only writes the head
+ * index, so pushing and popping are a few loads and a single release store each (wait-free), and a full queue
+ * rejects the value instead of waiting for room. Each side also caches the other side's index, so it only touches the
+ * shared cache line when the cached index says the queue looks full (or empty).
+ *
+ * Exactly one task may call the producer's function (`push`) and exactly one (maybe other) task may call the
+ * consumer's (`pop`). `size` and `empty` may be called by either, and are exact for the caller's own side.
+ *
+ * @tparam T The type of the values.
+ * @tparam Capacity The maximal number of values in the queue (a power of 2).
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(std::has_single_bit(Capacity), "The capacity must be a power of 2");
+
+public:
+    constexpr SpscQueue() noexcept = default;
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue(SpscQueue &&) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+    SpscQueue &operator=(SpscQueue &&) = delete;
+    ~SpscQueue() noexcept = default;
+
+    static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    /**
+     * @brief Producer: add a value at the end of the queue.
+     *
+     * @return Whether there was room for it (if not, the queue is unchanged).
+     */
+    bool push(const T &value) noexcept
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head == Capacity)
+        {
+            // Acquire: the consumer is done with the slots it released.
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == Capacity)
+            {
+                return false;
+            }
+        }
+        m_slots[tail % Capacity] = value;
+        m_tail.store(tail + 1, std::memory_order_release);  // The value is written before it's published.
+        return true;
+    }
+
+    /**
+     * @brief Consumer: remove the value at the front of the queue.
+     *
+     * @return The value, if the queue wasn't empty.
+     */
+    std::optional<T> pop() noexcept
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail)
+        {
+            // Acquire: the values up to the tail are written.
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+            {
+                return std::nullopt;
+            }
+        }
+        std::optional<T> value{m_slots[head % Capacity]};
+        m_head.store(head + 1, std::memory_order_release);  // The slot is read before it's released.
+        return value;
+    }
+
+    /**
+     * @brief The number of values in the queue.
+     */
+    std::size_t size() const noexcept
+    {
+        // The head first: the tail is never behind a head that was read before it.
+        const auto head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    static_assert(std::atomic<std::size_t>::is_always_lock_free);
+
+    // The indices only grow (and wrap around together), so `tail - head` is always the number of values.
+    std::array<T, Capacity> m_slots{};
+    alignas(64) std::atomic<std::size_t> m_head{0};  // Written by the consumer
+    std::size_t m_cached_tail = 0;                   // Only used by the consumer
+    alignas(64) std::atomic<std::size_t> m_tail{0};  // Written by the producer
+    std::size_t m_cached_head = 0;                   // Only used by the producer
+};
+
+}  // namespace micromouse
+
+#endif  // MISC_UTILS_SPSC_QUEUE_H
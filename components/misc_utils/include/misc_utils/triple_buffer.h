@@ -0,0 +1,115 @@
+#ifndef MISC_UTILS_TRIPLE_BUFFER_H
+#define MISC_UTILS_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+namespace micromouse
+{
+
+/**
+ * @brief A single producer, single consumer channel for the latest value of something (a sensor frame, a command, a
+ * state snapshot), that never blocks either side.
+ *
+ * There are three buffers: the producer writes into one, the consumer reads from another, and the third holds the
+ * latest published value. Publishing and taking both swap a buffer with the middle one in a single atomic exchange,
+ * so neither side ever waits for the other (wait-free) and the consumer never sees a torn value, whatever the size of
+ * `T` and however the tasks are scheduled. Values that are published faster than they are taken are dropped (only the
+ * latest one is kept).
+ *
+ * Unlike a seqlock, the consumer never retries and the buffers are never read while they're written, so it's also
+ * race-free for ThreadSanitizer and works for any copyable `T`.
+ *
+ * Exactly one task may call the producer's functions (`write_buffer`, `publish` and `write`) and exactly one (maybe
+ * other) task may call the consumer's (`update`, `read` and `take`).
+ *
+ * @tparam T The type of the values.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    constexpr TripleBuffer() noexcept = default;
+
+    /**
+     * @param initial The initial value of every buffer (not published).
+     */
+    explicit constexpr TripleBuffer(const T &initial) noexcept : m_buffers{initial, initial, initial} {}
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer(TripleBuffer &&) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(TripleBuffer &&) = delete;
+    ~TripleBuffer() noexcept = default;
+
+    /**
+     * @brief Producer: the buffer to write the next value into (it holds an older value).
+     */
+    constexpr T &write_buffer() noexcept { return m_buffers[m_write]; }
+
+    /**
+     * @brief Producer: publish the write buffer's value, and get a new write buffer.
+     */
+    void publish() noexcept
+    {
+        // Release: the value is written before it's published. Acquire: the consumer is done with the buffer it gave.
+        m_write = m_middle.exchange(m_write | fresh, std::memory_order_acq_rel) & index_mask;
+    }
+
+    /**
+     * @brief Producer: publish a value.
+     */
+    void write(const T &value) noexcept
+    {
+        write_buffer() = value;
+        publish();
+    }
+
+    /**
+     * @brief Consumer: switch to the latest published value, if there is a new one.
+     *
+     * @return Whether there was a new value.
+     */
+    bool update() noexcept
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & fresh) == 0)
+        {
+            return false;
+        }
+        m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    /**
+     * @brief Consumer: the value from the last `update` (or the initial value).
+     */
+    constexpr const T &read() const noexcept { return m_buffers[m_read]; }
+
+    /**
+     * @brief Consumer: the latest published value, if there is a new one since the last time.
+     */
+    std::optional<T> take() noexcept
+    {
+        if (!update())
+        {
+            return std::nullopt;
+        }
+        return read();
+    }
+
+private:
+    static constexpr std::uint8_t index_mask = 0x3;
+    static constexpr std::uint8_t fresh = 0x4;  // The middle buffer wasn't taken yet.
+    static_assert(std::atomic<std::uint8_t>::is_always_lock_free);
+
+    std::array<T, 3> m_buffers{};
+    std::uint8_t m_write = 0;               // Only used by the producer
+    std::atomic<std::uint8_t> m_middle{1};  // The index of the middle buffer, and `fresh`
+    std::uint8_t m_read = 2;                // Only used by the consumer
+};
+
+}  // namespace micromouse
+
+#endif  // MISC_UTILS_TRIPLE_BUFFER_H
@@ -0,0 +1,219 @@
+#ifndef MISC_UTILS_WORK_STEALING_POOL_H
+#define MISC_UTILS_WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace micromouse
+{
+
+/**
+ * @brief A fixed set of worker threads that run independent tasks, with a deque of tasks per worker.
+ *
+ * A worker runs the newest task of its own deque (the one whose data is still in its cache), and when its deque is
+ * empty it steals the oldest task of another worker's deque, so the work spreads over all the workers even when the
+ * tasks take very different times (e.g. simulated runs that crash early and runs that time out) or are all submitted
+ * by one task. Tasks submitted from outside the pool are dealt to the workers' deques round robin.
+ *
+ * Every deque is guarded by its own mutex. That's cheap enough for tasks of a millisecond or more (the pool is meant
+ * for coarse jobs like whole simulations), and the workers only contend on a deque while stealing from it. The count
+ * of queued tasks is atomic, so the pool's mutex is only taken to put an idle worker to sleep and to wake it up (and
+ * by `wait`), not by every submit and take.
+ *
+ * The pool is for the host tools (the firmware's tasks are pinned FreeRTOS tasks).
+ */
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @param threads The number of workers (all the cores by default).
+     */
+    explicit WorkStealingPool(std::size_t threads = default_threads())
+    {
+        threads = std::max<std::size_t>(threads, 1);
+        for (std::size_t i = 0; i < threads; i++)
+        {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+        m_workers.reserve(threads);
+        for (std::size_t i = 0; i < threads; i++)
+        {
+            m_workers.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool(WorkStealingPool &&) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(WorkStealingPool &&) = delete;
+
+    /**
+     * @brief Finish the submitted tasks and stop the workers.
+     */
+    ~WorkStealingPool() noexcept
+    {
+        wait();
+        {
+            std::lock_guard lock{m_mutex};
+            m_stop = true;
+        }
+        m_work_available.notify_all();
+        for (auto &worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    static std::size_t default_threads() noexcept { return std::max(std::thread::hardware_concurrency(), 1U); }
+
+    // The deques are all there before the first worker starts (unlike the workers).
+    std::size_t size() const noexcept { return m_queues.size(); }
+
+    /**
+     * @brief Queue a task. A task submitted by a task of this pool goes to its worker's own deque (so that worker runs
+     * it next, unless another one steals it first).
+     */
+    void submit(Task task)
+    {
+        const auto index = t_pool == this ? t_worker : m_next_queue.fetch_add(1, std::memory_order_relaxed) % size();
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        // Counted before it's queued, so it can't be taken (and uncounted) first.
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::lock_guard queue_lock{m_queues[index]->mutex};
+            m_queues[index]->tasks.push_back(std::move(task));
+        }
+        // Either this sees the worker that's going to sleep, or that worker sees the task (both are sequentially
+        // consistent, see `work`). Taking the mutex orders the wake-up after the worker's check of `m_queued`.
+        if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+        {
+            {
+                std::lock_guard lock{m_mutex};
+            }
+            m_work_available.notify_one();
+        }
+    }
+
+    /**
+     * @brief Wait until every submitted task (including the tasks that they submitted) is done.
+     * Must not be called from a task.
+     */
+    void wait()
+    {
+        std::unique_lock lock{m_mutex};
+        m_done.wait(lock, [this] { return m_pending.load(std::memory_order_acquire) == 0; });
+    }
+
+    /**
+     * @brief Run `f(i)` for every i in [0, count) on the workers, and wait for all of them (see `wait`).
+     */
+    template <typename F>
+    void parallel_for(std::size_t count, F &&f)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            submit([&f, i] { f(i); });
+        }
+        wait();
+    }
+
+    /**
+     * @brief The number of tasks that ran on another worker than the one they were queued for.
+     */
+    std::size_t steals() const noexcept { return m_steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::optional<Task> take(std::size_t worker)
+    {
+        {
+            auto &own = *m_queues[worker];
+            std::lock_guard lock{own.mutex};
+            if (!own.tasks.empty())
+            {
+                auto task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+        for (std::size_t i = 1; i < size(); i++)
+        {
+            auto &victim = *m_queues[(worker + i) % size()];
+            std::lock_guard lock{victim.mutex};
+            if (!victim.tasks.empty())
+            {
+                auto task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                m_steals.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void work(std::size_t worker)
+    {
+        t_pool = this;
+        t_worker = worker;
+        while (true)
+        {
+            if (auto task = take(worker))
+            {
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                (*task)();
+                if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard lock{m_mutex};
+                    m_done.notify_all();
+                }
+                continue;
+            }
+
+            // Sleep only while the deques are empty. A task that another worker takes first wakes this one for nothing.
+            std::unique_lock lock{m_mutex};
+            m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+            m_work_available.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_seq_cst) > 0; });
+            m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+            if (m_stop && m_queued.load(std::memory_order_relaxed) == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    static inline thread_local const WorkStealingPool *t_pool = nullptr;  // The pool of the current worker
+    static inline thread_local std::size_t t_worker = 0;
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<std::size_t> m_next_queue{0};  // For the tasks submitted from outside the pool
+    std::atomic<std::size_t> m_pending{0};     // Submitted and not done yet
+    std::atomic<std::size_t> m_steals{0};
+    std::atomic<std::size_t> m_queued{0};      // Tasks in the deques (and about to be)
+    std::atomic<std::size_t> m_sleeping{0};    // Workers waiting for `m_work_available` (or about to)
+    std::mutex m_mutex;                        // Only for the condition variables (and `m_stop`)
+    std::condition_variable m_work_available;
+    std::condition_variable m_done;
+    bool m_stop = false;  // Guarded by `m_mutex`
+};
+
+}  // namespace micromouse
+
+#endif  // MISC_UTILS_WORK_STEALING_POOL_H
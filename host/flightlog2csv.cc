@@ -0,0 +1,116 @@
+// Decodes the robot's flight log (see main/flight_log.h) into CSV.
+// Usage:
+//   flightlog2csv flightlog.bin > flightlog.csv
+// Reads a copy of the `flightlog` partition, e.g. from
+//   parttool.py --port /dev/ttyUSB0 read_partition --partition-name flightlog --output flightlog.bin
+// The reader's statistics are printed to stderr.
+
+#include "flight_log.h"
+
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace micromouse;
+
+struct FloatColumn
+{
+    const char *name;
+    float flight_log::Record::*field;
+};
+
+// The records' floats, in the CSV's order. The header and the rows are both printed from this table.
+static constexpr std::array float_columns{
+    FloatColumn{"left_velocity", &flight_log::Record::left_velocity},
+    FloatColumn{"right_velocity", &flight_log::Record::right_velocity},
+    FloatColumn{"process_noise_scale", &flight_log::Record::process_noise_scale},
+    FloatColumn{"prior_x", &flight_log::Record::prior_x},
+    FloatColumn{"prior_y", &flight_log::Record::prior_y},
+    FloatColumn{"prior_theta", &flight_log::Record::prior_theta},
+    FloatColumn{"x", &flight_log::Record::x},
+    FloatColumn{"y", &flight_log::Record::y},
+    FloatColumn{"theta", &flight_log::Record::theta},
+    FloatColumn{"x_variance", &flight_log::Record::x_variance},
+    FloatColumn{"y_variance", &flight_log::Record::y_variance},
+    FloatColumn{"theta_variance", &flight_log::Record::theta_variance},
+    FloatColumn{"innovation", &flight_log::Record::innovation},
+    FloatColumn{"left_wanted_velocity", &flight_log::Record::left_wanted_velocity},
+    FloatColumn{"right_wanted_velocity", &flight_log::Record::right_wanted_velocity},
+    FloatColumn{"left_output", &flight_log::Record::left_output},
+    FloatColumn{"right_output", &flight_log::Record::right_output},
+};
+// Every float between the ticks and the flags has a column (a new field must get one too).
+static_assert(
+    offsetof(flight_log::Record, flags) - offsetof(flight_log::Record, left_velocity)
+    == float_columns.size() * sizeof(float)
+);
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "Usage: %s flightlog.bin\n", argv[0]);
+        return 2;
+    }
+    auto *const input = std::fopen(argv[1], "rb");
+    if (input == nullptr)
+    {
+        std::perror(argv[1]);
+        return 1;
+    }
+    std::vector<std::uint8_t> image;
+    std::uint8_t buffer[4096];
+    while (const auto size = std::fread(buffer, 1, sizeof(buffer), input))
+    {
+        image.insert(image.end(), buffer, buffer + size);
+    }
+    std::fclose(input);
+
+    std::printf("block,time_us");
+    for (std::size_t i = 0; i < flight_log::sensor_count; i++)
+    {
+        std::printf(",distance%zu_mm", i);
+    }
+    std::printf(",fresh_sensors,healthy_sensors,left_ticks,right_ticks");
+    for (const auto &column : float_columns)
+    {
+        std::printf(",%s", column.name);
+    }
+    std::printf(",flags\n");
+    const auto stats = flight_log::read(
+        image,
+        [](const flight_log::Record &r, std::uint32_t block)
+        {
+            std::printf("%" PRIu32 ",%" PRIu32, block, r.time);
+            for (const auto distance : r.distances)
+            {
+                std::printf(",%u", static_cast<unsigned>(distance));
+            }
+            std::printf(
+                ",0x%02x,0x%02x,%" PRId32 ",%" PRId32,
+                static_cast<unsigned>(r.fresh),
+                static_cast<unsigned>(r.healthy),
+                r.left_ticks,
+                r.right_ticks
+            );
+            for (const auto &column : float_columns)
+            {
+                std::printf(",%.9g", r.*column.field);  // %.9g keeps every float exact.
+            }
+            std::printf(",0x%" PRIx32 "\n", r.flags);
+        }
+    );
+
+    std::fprintf(
+        stderr,
+        "%" PRIu32 " records in %" PRIu32 " blocks, %" PRIu32 " dropped records, %" PRIu32 " bad blocks\n",
+        stats.records,
+        stats.blocks,
+        stats.dropped,
+        stats.bad_blocks
+    );
+    return 0;
+}
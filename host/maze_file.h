@@ -0,0 +1,60 @@
+// The maze files of the host tools (see simulate.cc and sweep.cc): 8x8 mazes drawn like the ones in main/temp_map.h.
+#ifndef HOST_MAZE_FILE_H
+#define HOST_MAZE_FILE_H
+
+#include <maze_solver/cell.h>
+#include <maze_solver/maze.h>
+
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace micromouse
+{
+
+/**
+ * @brief Parse an ASCII drawing of a maze: a line of walls above every row of cells (`+---+` for a wall and `+   +`
+ * for none) and a line of walls between the cells (`|` for a wall).
+ */
+inline std::optional<Maze<>> load_maze(const char *path)
+{
+    std::ifstream file{path};
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        lines.push_back(line);
+    }
+    static constexpr auto rows = Maze<>::height();
+    static constexpr auto columns = Maze<>::width();
+    if (lines.size() < 2 * rows + 1)
+    {
+        return std::nullopt;
+    }
+    const auto at = [&](std::size_t line, std::size_t column)
+    { return column < lines[line].size() ? lines[line][column] : ' '; };
+
+    std::array<std::array<Walls, columns>, rows> walls{};
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        for (std::size_t col = 0; col < columns; col++)
+        {
+            auto &cell = walls[row][col];
+            cell |= at(2 * row, 4 * col + 2) == '-' ? Walls::North : empty_walls;
+            cell |= at(2 * row + 2, 4 * col + 2) == '-' ? Walls::South : empty_walls;
+            cell |= at(2 * row + 1, 4 * col) == '|' ? Walls::West : empty_walls;
+            cell |= at(2 * row + 1, 4 * col + 4) == '|' ? Walls::East : empty_walls;
+        }
+    }
+    return Maze<>{walls};
+}
+
+}  // namespace micromouse
+
+#endif  // HOST_MAZE_FILE_H
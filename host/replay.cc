@@ -0,0 +1,249 @@
+// Replays the robot's flight log (see main/flight_log.h) through the pose estimator (see main/flight_replay.h).
+// Usage:
+//   replay run flightlog.bin [period_us] > replay.csv
+//   replay diff old.csv new.csv
+// `run` prints the replayed poses next to the recorded ones, with the replay's speed and its deviation from the
+// recorded poses on stderr. The period defaults to CONFIG_PID_LOOP_PERIOD's default and must match the firmware's.
+// `diff` compares two replays of the same log (e.g. by the replay tool of two versions of the code) and exits with 1
+// if they differ.
+
+#include "flight_log.h"
+#include "flight_replay.h"
+#include "temp_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace micromouse;
+
+static constexpr float default_period = 5000.0f;  // [us]
+
+static int run(const char *path, float period_us)
+{
+    auto *const input = std::fopen(path, "rb");
+    if (input == nullptr)
+    {
+        std::perror(path);
+        return 1;
+    }
+    std::vector<std::uint8_t> image;
+    std::uint8_t buffer[4096];
+    while (const auto size = std::fread(buffer, 1, sizeof(buffer), input))
+    {
+        image.insert(image.end(), buffer, buffer + size);
+    }
+    std::fclose(input);
+
+    std::vector<flight_log::Record> records;
+    const auto stats =
+        flight_log::read(image, [&](const flight_log::Record &r, std::uint32_t) { records.push_back(r); });
+    std::fprintf(
+        stderr,
+        "%" PRIu32 " records in %" PRIu32 " blocks, %" PRIu32 " dropped records, %" PRIu32 " bad blocks\n",
+        stats.records,
+        stats.blocks,
+        stats.dropped,
+        stats.bad_blocks
+    );
+    if (stats.dropped > 0 || stats.bad_blocks > 0)
+    {
+        std::fprintf(stderr, "Warning: the log has gaps, the replay restarts from the recorded pose after them\n");
+    }
+
+    // Replay first and print later, to time the replay alone.
+    FlightReplay replay{maze_map, std::chrono::duration<float, std::micro>{period_us}};
+    std::vector<std::optional<FlightReplay::Output>> outputs;  // Nothing for the warmup frames
+    outputs.reserve(records.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &record : records)
+    {
+        outputs.push_back(replay(record));
+    }
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+
+    std::printf(
+        "time_us,update,x,y,theta,x_variance,y_variance,theta_variance,innovation,"
+        "recorded_x,recorded_y,recorded_theta\n"
+    );
+    float max_error[3]{};
+    std::size_t ticks = 0;
+    for (std::size_t i = 0; i < records.size(); i++)
+    {
+        if (!outputs[i])
+        {
+            continue;
+        }
+        ticks++;
+        const auto &r = records[i];
+        const auto &out = *outputs[i];
+        const float replayed[]{out.pos.x->count(), out.pos.y->count(), out.pos.theta.get()};
+        const float recorded[]{r.x, r.y, r.theta};
+        for (std::size_t j = 0; j < 3; j++)
+        {
+            max_error[j] = std::max(max_error[j], std::abs(replayed[j] - recorded[j]));
+        }
+        // %.9g keeps every float exact.
+        std::printf(
+            "%" PRIu32 ",%s,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+            out.time,
+            enum2str(out.update),
+            replayed[0],
+            replayed[1],
+            replayed[2],
+            out.variance[0],
+            out.variance[1],
+            out.variance[2],
+            out.innovation,
+            recorded[0],
+            recorded[1],
+            recorded[2]
+        );
+    }
+
+    const auto simulated = static_cast<double>(ticks) * period_us / 1e6;
+    std::fprintf(
+        stderr,
+        "Replayed %.3f s in %.3f s (%.0fx real time)\n"
+        "Max deviation from the recorded pose: x %.9g m, y %.9g m, theta %.9g rad\n",
+        simulated,
+        wall_time.count(),
+        wall_time.count() > 0 ? simulated / wall_time.count() : 0.0,
+        max_error[0],
+        max_error[1],
+        max_error[2]
+    );
+    return 0;
+}
+
+static std::vector<std::string_view> split(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    while (true)
+    {
+        const auto comma = line.find(',');
+        fields.push_back(line.substr(0, comma));
+        if (comma == std::string_view::npos)
+        {
+            return fields;
+        }
+        line.remove_prefix(comma + 1);
+    }
+}
+
+static int diff(const char *old_path, const char *new_path)
+{
+    std::ifstream old_file{old_path};
+    std::ifstream new_file{new_path};
+    if (!old_file || !new_file)
+    {
+        std::perror(!old_file ? old_path : new_path);
+        return 2;
+    }
+    std::string old_line;
+    std::string new_line;
+    if (!std::getline(old_file, old_line) || !std::getline(new_file, new_line) || old_line != new_line)
+    {
+        std::fprintf(stderr, "The replays have different columns\n");
+        return 2;
+    }
+    const auto columns = split(old_line);
+    std::vector<std::string> names{columns.begin(), columns.end()};
+    std::vector<double> max_difference(names.size());
+    std::vector<std::uint32_t> differences(names.size());
+    std::size_t rows = 0;
+    std::size_t first_row = 0;  // 1-based, 0 if none
+    std::string first_time;
+    while (true)
+    {
+        const bool has_old = static_cast<bool>(std::getline(old_file, old_line));
+        const bool has_new = static_cast<bool>(std::getline(new_file, new_line));
+        if (has_old != has_new)
+        {
+            std::fprintf(stderr, "The replays have different lengths\n");
+            return 1;
+        }
+        if (!has_old)
+        {
+            break;
+        }
+        rows++;
+        const auto old_fields = split(old_line);
+        const auto new_fields = split(new_line);
+        if (old_fields.size() != names.size() || new_fields.size() != names.size())
+        {
+            std::fprintf(stderr, "Malformed row %zu\n", rows);
+            return 2;
+        }
+        for (std::size_t i = 0; i < names.size(); i++)
+        {
+            if (old_fields[i] == new_fields[i])
+            {
+                continue;
+            }
+            differences[i]++;
+            // Numeric columns also get the size of the difference.
+            const std::string old_field{old_fields[i]};
+            const std::string new_field{new_fields[i]};
+            char *old_end;
+            char *new_end;
+            const auto old_value = std::strtod(old_field.c_str(), &old_end);
+            const auto new_value = std::strtod(new_field.c_str(), &new_end);
+            if (*old_end == '\0' && *new_end == '\0')
+            {
+                max_difference[i] = std::max(max_difference[i], std::abs(new_value - old_value));
+            }
+            if (first_row == 0)
+            {
+                first_row = rows;
+                first_time = old_fields[0];
+            }
+        }
+    }
+
+    if (first_row == 0)
+    {
+        std::fprintf(stderr, "%zu rows, identical\n", rows);
+        return 0;
+    }
+    std::printf(
+        "%zu rows, first difference in row %zu (%s %s)\n",
+        rows,
+        first_row,
+        names[0].c_str(),
+        first_time.c_str()
+    );
+    std::printf("column,differing_rows,max_difference\n");
+    for (std::size_t i = 0; i < names.size(); i++)
+    {
+        if (differences[i] > 0)
+        {
+            std::printf("%s,%" PRIu32 ",%.9g\n", names[i].c_str(), differences[i], max_difference[i]);
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && argc <= 4 && std::strcmp(argv[1], "run") == 0)
+    {
+        return run(argv[2], argc == 4 ? std::strtof(argv[3], nullptr) : default_period);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "diff") == 0)
+    {
+        return diff(argv[2], argv[3]);
+    }
+    std::fprintf(stderr, "Usage:\n  %s run flightlog.bin [period_us]\n  %s diff old.csv new.csv\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,144 @@
+// Drives the firmware's control loop through mazes in a closed loop simulation (see main/simulator.h).
+// Usage:
+//   simulate [-m waypoints|pure-pursuit|stanley|all] [-s seeds] [maze.txt ...] > results.csv
+// Runs every maze (the built-in 8x8 maze when none is given) in the given control mode (all of them by default) with
+// every seed from 1 to `seeds` (1 by default), and prints a CSV line per run. The totals, with the speed of the
+// simulation, are printed to stderr. Exits with 1 if any run didn't finish (touching a wall fails a run).
+// A maze file is an 8x8 maze drawn like the ones in main/temp_map.h:
+//   +---+---+ ...
+//   |       | ...
+//   +   +---+ ...
+
+#include "maze_file.h"
+#include "simulator.h"
+
+#include <maze_solver/maze.h>
+#include <maze_solver/maze_samples/small_8x8.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace micromouse;
+
+int main(int argc, char *argv[])
+{
+    std::vector<ControlMode> modes{ControlMode::Waypoints, ControlMode::PurePursuit, ControlMode::Stanley};
+    std::uint32_t seeds = 1;
+    std::vector<std::pair<std::string, Maze<>>> inputs;
+    for (auto i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            const std::string_view mode{argv[++i]};
+            if (mode == "waypoints")
+            {
+                modes = {ControlMode::Waypoints};
+            }
+            else if (mode == "pure-pursuit")
+            {
+                modes = {ControlMode::PurePursuit};
+            }
+            else if (mode == "stanley")
+            {
+                modes = {ControlMode::Stanley};
+            }
+            else if (mode != "all")
+            {
+                std::fprintf(stderr, "Unknown control mode: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            seeds = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argv[i][0] == '-')
+        {
+            std::fprintf(
+                stderr,
+                "Usage: %s [-m waypoints|pure-pursuit|stanley|all] [-s seeds] [maze.txt ...]\n",
+                argv[0]
+            );
+            return 2;
+        }
+        else if (const auto maze = load_maze(argv[i]))
+        {
+            inputs.emplace_back(argv[i], *maze);
+        }
+        else
+        {
+            std::fprintf(stderr, "Can't read an 8x8 maze from %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (inputs.empty())
+    {
+        inputs.emplace_back("small_8x8", mazes::small_8x8);
+    }
+
+    std::printf(
+        "maze,mode,seed,finished,lap_time_s,max_tracking_error_m,rms_tracking_error_m,max_estimation_error_m,"
+        "min_clearance_m\n"
+    );
+    std::uint32_t runs = 0;
+    std::uint32_t failures = 0;
+    double simulated = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &[name, maze] : inputs)
+    {
+        const auto route = sim::shortest_route(maze);
+        if (!route)
+        {
+            std::fprintf(stderr, "%s: the center can't be reached\n", name.c_str());
+            failures++;
+            continue;
+        }
+        const auto walls = sim::maze_segments(maze);
+        for (const auto mode : modes)
+        {
+            for (std::uint32_t seed = 1; seed <= seeds; seed++)
+            {
+                auto config = sim::default_config;
+                config.control_mode = mode;
+                config.seed = seed;
+                sim::Simulator simulator{walls, *route, config};
+                const auto result = simulator.run();
+                runs++;
+                failures += result.finished ? 0 : 1;
+                simulated += result.lap_time.count();
+                std::printf(
+                    "%s,%s,%" PRIu32 ",%d,%.3f,%.4f,%.4f,%.4f,%.4f\n",
+                    name.c_str(),
+                    to_string(mode),
+                    seed,
+                    result.finished,
+                    result.lap_time.count(),
+                    result.max_tracking_error.count(),
+                    result.rms_tracking_error.count(),
+                    result.max_estimation_error.count(),
+                    result.min_clearance.count()
+                );
+            }
+        }
+    }
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+
+    std::fprintf(
+        stderr,
+        "%" PRIu32 " runs, %" PRIu32 " didn't finish. Simulated %.1f s in %.2f s (%.0fx real time)\n",
+        runs,
+        failures,
+        simulated,
+        wall_time.count(),
+        wall_time.count() > 0 ? simulated / wall_time.count() : 0.0
+    );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+// Searches the control loop's gains and the EKF's noise in the closed loop simulation (see main/sweep.h).
+// Usage:
+//   sweep [-g | -r count | -c generations] [-p name=min:max[:levels][:log] ...] [-m waypoints|pure-pursuit|stanley]
+//         [-s seeds] [-d motor_spread] [-e max_tracking_error] [-w min_clearance] [-j threads] [-n top] [maze.txt ...]
+//         > ranking.csv
+// Every candidate is run on every maze (the built-in 8x8 maze when none is given, see maze_file.h) with every seed
+// from 1 to `seeds` (2 by default), each with the nominal motors and with each motor weaker by `motor_spread` (0.1 by
+// default). A candidate is feasible if it finishes every run within the constraints (`sweep::default_constraints`
+// unless -e and -w, in meters, override them).
+// The strategies are:
+//   -g: The grid of the ranges' levels.
+//   -r: `count` random candidates (100 by default), and the defaults.
+//   -c: CMA-ES for `generations` generations (20 by default, the default strategy), starting from the defaults.
+// The ranges are the defaults of `sweep::default_space`, and -p overrides a parameter's range (`name=value` fixes
+// it). The `top` candidates (10 by default), best first, are printed as CSV. The totals, with the speed of the runs,
+// are printed to stderr. Exits with 1 if no candidate is feasible.
+
+#include "maze_file.h"
+#include "sweep.h"
+
+#include <maze_solver/maze_samples/small_8x8.h>
+#include <misc_utils/work_stealing_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace micromouse;
+
+/**
+ * @brief Parse `name=min:max[:levels][:log]` or `name=value` into the space.
+ */
+static bool parse_range(std::string_view arg, sweep::Space &space)
+{
+    const auto equals = arg.find('=');
+    if (equals == std::string_view::npos)
+    {
+        return false;
+    }
+    const auto name = arg.substr(0, equals);
+    std::size_t index = 0;
+    while (index < sweep::parameter_count && name != sweep::enum2str(static_cast<sweep::Parameter>(index)))
+    {
+        index++;
+    }
+    if (index == sweep::parameter_count)
+    {
+        return false;
+    }
+
+    const std::string fields{arg.substr(equals + 1)};
+    char *end;
+    const auto min = std::strtof(fields.c_str(), &end);
+    if (end == fields.c_str())
+    {
+        return false;
+    }
+    sweep::Range range{.min = min, .max = min, .log = false};
+    if (*end == ':')
+    {
+        range.max = std::strtof(end + 1, &end);
+    }
+    if (*end == ':')
+    {
+        range.levels = std::strtoul(end + 1, &end, 10);
+    }
+    if (std::strcmp(end, ":log") == 0)
+    {
+        range.log = true;
+        end += 4;
+    }
+    if (*end != '\0' || range.max < range.min || (range.log && range.min <= 0.0f))
+    {
+        return false;
+    }
+    space.ranges[index] = range;
+    if (range.fixed())
+    {
+        space.base[index] = range.min;
+    }
+    else
+    {
+        space.base[index] = std::clamp(space.base[index], range.min, range.max);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    enum class Strategy
+    {
+        Grid,
+        Random,
+        Cmaes,
+    };
+    auto base = sim::default_config;
+    auto space = sweep::default_space(sweep::candidate(base));
+    Strategy strategy = Strategy::Cmaes;
+    std::size_t count = 0;  // Of random candidates or CMA-ES generations, 0 for the default
+    std::uint32_t seeds = 2;
+    float motor_spread = 0.1f;
+    auto constraints = sweep::default_constraints;
+    std::size_t threads = WorkStealingPool::default_threads();
+    std::size_t top = 10;
+    std::vector<sweep::Track> tracks;
+
+    const auto usage = [&]
+    {
+        std::fprintf(
+            stderr,
+            "Usage: %s [-g | -r count | -c generations] [-p name=min:max[:levels][:log] ...]\n"
+            "       [-m waypoints|pure-pursuit|stanley] [-s seeds] [-d motor_spread] [-e max_tracking_error]\n"
+            "       [-w min_clearance] [-j threads] [-n top] [maze.txt ...]\n",
+            argv[0]
+        );
+        return 2;
+    };
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string_view arg{argv[i]};
+        const auto has_value = i + 1 < argc;
+        if (arg == "-g")
+        {
+            strategy = Strategy::Grid;
+        }
+        else if ((arg == "-r" || arg == "-c") && has_value)
+        {
+            strategy = arg == "-r" ? Strategy::Random : Strategy::Cmaes;
+            count = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "-p" && has_value)
+        {
+            if (!parse_range(argv[++i], space))
+            {
+                std::fprintf(stderr, "Bad parameter range: %s\n", argv[i]);
+                return usage();
+            }
+        }
+        else if (arg == "-m" && has_value)
+        {
+            const std::string_view mode{argv[++i]};
+            if (mode == "waypoints")
+            {
+                base.control_mode = ControlMode::Waypoints;
+            }
+            else if (mode == "pure-pursuit")
+            {
+                base.control_mode = ControlMode::PurePursuit;
+            }
+            else if (mode == "stanley")
+            {
+                base.control_mode = ControlMode::Stanley;
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown control mode: %s\n", argv[i]);
+                return usage();
+            }
+        }
+        else if (arg == "-s" && has_value)
+        {
+            seeds = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "-d" && has_value)
+        {
+            motor_spread = std::strtof(argv[++i], nullptr);
+        }
+        else if (arg == "-e" && has_value)
+        {
+            constraints.max_tracking_error = meters{std::strtof(argv[++i], nullptr)};
+        }
+        else if (arg == "-w" && has_value)
+        {
+            constraints.min_clearance = meters{std::strtof(argv[++i], nullptr)};
+        }
+        else if (arg == "-j" && has_value)
+        {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "-n" && has_value)
+        {
+            top = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg.starts_with('-'))
+        {
+            return usage();
+        }
+        else
+        {
+            const auto maze = load_maze(argv[i]);
+            auto track = maze ? sweep::make_track(argv[i], *maze) : std::nullopt;
+            if (!track)
+            {
+                std::fprintf(stderr, "Can't read an 8x8 maze whose center can be reached from %s\n", argv[i]);
+                return 2;
+            }
+            tracks.push_back(std::move(*track));
+        }
+    }
+    if (tracks.empty())
+    {
+        tracks.push_back(*sweep::make_track("small_8x8", mazes::small_8x8));
+    }
+
+    const auto scenarios = sweep::robustness_scenarios(base, std::max<std::uint32_t>(seeds, 1), motor_spread);
+    WorkStealingPool pool{threads};
+    sweep::Evaluator evaluate{tracks, scenarios, constraints, pool};
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<sweep::Evaluation> evaluations;
+    switch (strategy)
+    {
+    case Strategy::Grid:
+        evaluations = evaluate(sweep::grid(space));
+        break;
+    case Strategy::Random:
+    {
+        auto candidates = sweep::random_candidates(space, count > 0 ? count : 100, 1);
+        candidates.insert(candidates.begin(), space.base);
+        evaluations = evaluate(candidates);
+        break;
+    }
+    case Strategy::Cmaes:
+        evaluations = sweep::cma_es(evaluate, space, count > 0 ? count : 20, 0, 1);
+        break;
+    }
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+    sweep::rank(evaluations);
+
+    std::printf("rank,feasible,cost,worst_lap_time_s,mean_lap_time_s,max_tracking_error_m,min_clearance_m,failures");
+    for (std::size_t i = 0; i < sweep::parameter_count; i++)
+    {
+        std::printf(",%s", sweep::enum2str(static_cast<sweep::Parameter>(i)));
+    }
+    std::printf("\n");
+    for (std::size_t rank = 0; rank < std::min(top, evaluations.size()); rank++)
+    {
+        const auto &e = evaluations[rank];
+        std::printf(
+            "%zu,%d,%.4f,%.3f,%.3f,%.4f,%.4f,%" PRIu32,
+            rank + 1,
+            e.feasible,
+            e.cost,
+            e.worst_lap_time.count(),
+            e.mean_lap_time.count(),
+            e.max_tracking_error.count(),
+            e.min_clearance.count(),
+            e.failures
+        );
+        for (const auto value : e.candidate)
+        {
+            std::printf(",%.6g", value);
+        }
+        std::printf("\n");
+    }
+
+    const auto feasible = std::ranges::count_if(evaluations, &sweep::Evaluation::feasible);
+    const auto runs = static_cast<double>(evaluate.runs());
+    const auto simulated = static_cast<double>(evaluate.simulated().count());
+    std::fprintf(
+        stderr,
+        "%zu candidates (%td feasible), %.0f runs on %zu threads in %.2f s (%.0f runs/s, %.0fx real time)\n",
+        evaluations.size(),
+        feasible,
+        runs,
+        pool.size(),
+        wall_time.count(),
+        wall_time.count() > 0 ? runs / wall_time.count() : 0.0,
+        wall_time.count() > 0 ? simulated / wall_time.count() : 0.0
+    );
+    return feasible > 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// Decodes the robot's binary telemetry (see main/telemetry.h) into CSV.
+// Usage:
+//   telemetry2csv [capture] > telemetry.csv
+// Reads the capture of the serial port (e.g. `cat /dev/ttyUSB0 > capture`) from the file, or from stdin without one.
+// The log lines in the capture are skipped, and the decoder's statistics are printed to stderr.
+
+#include "telemetry.h"
+
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+
+using namespace micromouse;
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2)
+    {
+        std::fprintf(stderr, "Usage: %s [capture]\n", argv[0]);
+        return 2;
+    }
+    auto *const input = argc == 2 ? std::fopen(argv[1], "rb") : stdin;
+    if (input == nullptr)
+    {
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    std::printf(
+        "sequence,time_us,target_x,target_y,target_theta,x,y,theta,left_velocity,left_wanted_velocity,left_output,"
+        "right_velocity,right_wanted_velocity,right_output,innovation,cycle_time_us,healthy_sensors"
+    );
+    for (std::size_t i = 0; i < telemetry::sensor_count; i++)
+    {
+        std::printf(",rate%zu_hz", i);
+    }
+    std::printf("\n");
+    telemetry::Decoder decoder{
+        [](const telemetry::Record &r, std::uint16_t sequence)
+        {
+            // %.9g keeps every float exact.
+            std::printf(
+                "%u,%" PRIu32 ",%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%" PRIu32
+                ",0x%02" PRIx32,
+                static_cast<unsigned>(sequence),
+                r.time,
+                r.target_x,
+                r.target_y,
+                r.target_theta,
+                r.x,
+                r.y,
+                r.theta,
+                r.left_velocity,
+                r.left_wanted_velocity,
+                r.left_output,
+                r.right_velocity,
+                r.right_wanted_velocity,
+                r.right_output,
+                r.innovation,
+                r.cycle_time,
+                r.flags
+            );
+            for (const auto rate : r.sensor_rates)
+            {
+                std::printf(",%.9g", rate);
+            }
+            std::printf("\n");
+        }
+    };
+    std::array<std::uint8_t, 4096> buffer;
+    while (const auto size = std::fread(buffer.data(), 1, buffer.size(), input))
+    {
+        decoder.feed(std::span{buffer}.first(size));
+    }
+    if (input != stdin)
+    {
+        std::fclose(input);
+    }
+
+    const auto &stats = decoder.stats();
+    std::fprintf(
+        stderr,
+        "%" PRIu32 " records in %" PRIu32 " frames, %" PRIu32 " lost frames, %" PRIu32 " bad frames (or log lines)\n",
+        stats.records,
+        stats.frames,
+        stats.lost_batches,
+        stats.bad_frames
+    );
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <maze_solver/direction.h>
 #include <misc_utils/physical_size.h>
 
+#include "planner.h"
 #include "position.h"
 #include "temp_map.h"
 
@@ -51,27 +52,64 @@ constexpr Position convert(std::size_t row, std::size_t col, Direction heading)
     return translate_pos<true>(row, col, heading);
 }
 
+/**
+ * @brief Where the robot stops to turn in place from one heading to another, still facing the first. The wheels' axle
+ * is `center_offset` behind the body's center, so turning in place swings the body: pivoting halfway between the
+ * positions that center it before and after the turn keeps it within half the offset of the center both times.
+ */
+constexpr Position pivot(std::size_t row, std::size_t col, Direction from, Direction to) noexcept
+{
+    const auto before = translate_pos<true>(row, col, from);
+    const auto after = translate_pos<true>(row, col, to);
+    return Position{
+        XCoord{(*before.x + *after.x) / 2.0f},
+        YCoord{(*before.y + *after.y) / 2.0f},
+        before.theta,
+    };
+}
+
+/**
+ * @brief The same position as `pivot`, after turning in place to the new heading.
+ */
 constexpr Position turn(std::size_t row, std::size_t col, Direction from, Direction to) noexcept
 {
-    auto res = translate_pos<true>(row, col, from);
+    auto res = pivot(row, col, from, to);
     res.theta = to_radians<Angle>(to);
     return res;
 }
 
 inline constexpr std::array positions{
     convert(7, 0, Direction::East),  // Start point
-    convert(7, 2, Direction::East),  turn(7, 2, Direction::East, Direction::North),
-    convert(4, 2, Direction::North), turn(4, 2, Direction::North, Direction::West),
-    convert(4, 0, Direction::West),  turn(4, 0, Direction::West, Direction::North),
-    convert(3, 0, Direction::North), turn(3, 0, Direction::North, Direction::East),
-    convert(3, 2, Direction::East),  turn(3, 2, Direction::East, Direction::North),
-    convert(0, 2, Direction::North), turn(0, 2, Direction::North, Direction::East),
-    convert(0, 5, Direction::East),  turn(0, 5, Direction::East, Direction::South),
-    convert(2, 5, Direction::South), turn(2, 5, Direction::South, Direction::West),
-    convert(2, 4, Direction::West),  turn(2, 4, Direction::West, Direction::South),
+    pivot(7, 2, Direction::East, Direction::North), turn(7, 2, Direction::East, Direction::North),
+    pivot(4, 2, Direction::North, Direction::West), turn(4, 2, Direction::North, Direction::West),
+    pivot(4, 0, Direction::West, Direction::North), turn(4, 0, Direction::West, Direction::North),
+    pivot(3, 0, Direction::North, Direction::East), turn(3, 0, Direction::North, Direction::East),
+    pivot(3, 2, Direction::East, Direction::North), turn(3, 2, Direction::East, Direction::North),
+    pivot(0, 2, Direction::North, Direction::East), turn(0, 2, Direction::North, Direction::East),
+    pivot(0, 5, Direction::East, Direction::South), turn(0, 5, Direction::East, Direction::South),
+    pivot(2, 5, Direction::South, Direction::West), turn(2, 5, Direction::South, Direction::West),
+    pivot(2, 4, Direction::West, Direction::South), turn(2, 4, Direction::West, Direction::South),
     convert(3, 4, Direction::South),  // Goal
 };
 
+/**
+ * @brief The same route as a polyline for following it as one continuous path (see `Path`): the start, the centers of
+ * the cells where it turns and the goal.
+ */
+inline constexpr std::array waypoints{
+    positions.front(),
+    translate_pos(7, 2, Direction::East),
+    translate_pos(4, 2, Direction::North),
+    translate_pos(4, 0, Direction::West),
+    translate_pos(3, 0, Direction::North),
+    translate_pos(3, 2, Direction::East),
+    translate_pos(0, 2, Direction::North),
+    translate_pos(0, 5, Direction::East),
+    translate_pos(2, 5, Direction::South),
+    translate_pos(2, 4, Direction::West),
+    positions.back(),
+};
+
 class AlgorithmApi
 {
 public:
@@ -89,6 +127,11 @@ public:
         }
     }
 
+    /**
+     * @brief The route is fixed, so the walls never change it.
+     */
+    constexpr bool update_walls(const WallUpdate &) noexcept { return false; }
+
 private:
     std::uint32_t m_pos_index = 0;
 };
@@ -1,12 +1,27 @@
 #ifndef MAIN_AVERAGE_FILTER_H
 #define MAIN_AVERAGE_FILTER_H
 
+#include <algorithm>
 #include <array>
+#include <concepts>
+#include <cstddef>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
 template <typename T>
 concept unqualified_arithmetic = std::is_arithmetic_v<T> && !std::is_const_v<T> && !std::is_volatile_v<T>;
 
+/**
+ * @brief A filter that can be a stage of a `filter_pipeline`: `filter(value)` takes a sample and returns the filter's
+ * new output, and `filter.value()` is the latest output.
+ */
+template <typename F, typename T>
+concept filter_stage = requires(F filter, const F const_filter, T value) {
+    filter(value);
+    { const_filter.value() } -> std::convertible_to<std::remove_cvref_t<decltype(filter(value))>>;
+};
+
 template <unqualified_arithmetic T, std::size_t N, unqualified_arithmetic AvgType = T>
 class avg_filter
 {
@@ -14,7 +29,10 @@ class avg_filter
 
 public:
     constexpr avg_filter() noexcept = default;
-    explicit constexpr avg_filter(T value) noexcept : m_sum{static_cast<AvgType>(value) * N} { m_history.fill(value); }
+    explicit constexpr avg_filter(T value) noexcept : m_sum{static_cast<AvgType>(static_cast<AvgType>(value) * N)}
+    {
+        m_history.fill(value);
+    }
     // TODO: allow more complex history
     constexpr avg_filter(const avg_filter &) noexcept = default;
     constexpr avg_filter(avg_filter &&) noexcept = default;
@@ -43,10 +61,360 @@ public:
 
     constexpr AvgType avg() const noexcept { return m_sum / N; }
 
+    // As a `filter_stage`:
+    constexpr AvgType operator()(T value) noexcept
+    {
+        update(value);
+        return avg();
+    }
+    constexpr AvgType value() const noexcept { return avg(); }
+
 private:
     std::array<T, N> m_history{};
     std::size_t m_i{0};
     AvgType m_sum{};
 };
 
+/**
+ * @brief The median of the last N samples, in O(log N) per sample.
+ *
+ * The window is kept in an indexed double heap (like Härdle and Steiger's algorithm): a max-heap of the samples below
+ * the median and a min-heap of the samples above it, around the median itself, with every sample's place in the
+ * heaps. A new sample replaces the oldest one in its place, and only moves up or down its heap (and across the
+ * median, if it has to).
+ *
+ * @tparam T The type of the samples.
+ * @tparam N The window size (odd, so the median is a sample). A window of 1 passes the samples through.
+ */
+template <unqualified_arithmetic T, std::size_t N>
+class median_filter
+{
+    static_assert(N % 2 == 1, "The window size must be odd");
+
+public:
+    /**
+     * @param value The initial value of the whole window.
+     */
+    explicit constexpr median_filter(T value = T{}) noexcept
+    {
+        m_data.fill(value);
+        // Alternate between the heaps: 0 is the median, 1, 2, 3... the min-heap and -1, -2, -3... the max-heap.
+        for (std::size_t i = 0; i < N; i++)
+        {
+            const auto pos = static_cast<int>((i + 1) / 2) * (i % 2 == 1 ? -1 : 1);
+            m_pos[i] = pos;
+            heap(pos) = i;
+        }
+    }
+
+    constexpr T operator()(T value) noexcept
+    {
+        if constexpr (N == 1)
+        {
+            m_data[0] = value;  // No heaps to keep
+            return value;
+        }
+        else
+        {
+            const auto pos = m_pos[m_oldest];
+            const auto old = std::exchange(m_data[m_oldest], value);
+            m_oldest = m_oldest + 1 == N ? 0 : m_oldest + 1;
+
+            if (pos > 0)  // In the min-heap
+            {
+                if (old < value)
+                {
+                    min_sort_down(pos * 2);
+                }
+                else if (min_sort_up(pos))
+                {
+                    max_sort_down(-1);
+                }
+            }
+            else if (pos < 0)  // In the max-heap
+            {
+                if (value < old)
+                {
+                    max_sort_down(pos * 2);
+                }
+                else if (max_sort_up(pos))
+                {
+                    min_sort_down(1);
+                }
+            }
+            else  // The median
+            {
+                max_sort_down(-1);
+                min_sort_down(1);
+            }
+            return this->value();
+        }
+    }
+
+    constexpr T value() const noexcept { return m_data[m_heap[half]]; }
+
+private:
+    static constexpr int half = N / 2;  // The size of each heap
+
+    constexpr std::size_t &heap(int pos) noexcept { return m_heap[static_cast<std::size_t>(pos + half)]; }
+    constexpr bool less(int i, int j) noexcept { return m_data[heap(i)] < m_data[heap(j)]; }
+
+    constexpr void exchange(int i, int j) noexcept
+    {
+        std::swap(heap(i), heap(j));
+        m_pos[heap(i)] = i;
+        m_pos[heap(j)] = j;
+    }
+
+    // Swap i and j if i < j.
+    constexpr bool compare_exchange(int i, int j) noexcept
+    {
+        if (!less(i, j))
+        {
+            return false;
+        }
+        exchange(i, j);
+        return true;
+    }
+
+    // Restore the min-heap below i / 2 (from i down).
+    constexpr void min_sort_down(int i) noexcept
+    {
+        for (; i <= half; i *= 2)
+        {
+            if (i > 1 && i < half && less(i + 1, i))
+            {
+                i++;
+            }
+            if (!compare_exchange(i, i / 2))
+            {
+                break;
+            }
+        }
+    }
+
+    // Restore the max-heap below i / 2 (from i down).
+    constexpr void max_sort_down(int i) noexcept
+    {
+        for (; i >= -half; i *= 2)
+        {
+            if (i < -1 && i > -half && less(i, i - 1))
+            {
+                i--;
+            }
+            if (!compare_exchange(i / 2, i))
+            {
+                break;
+            }
+        }
+    }
+
+    // Move i up the min-heap. Returns whether it became the median.
+    constexpr bool min_sort_up(int i) noexcept
+    {
+        while (i > 0 && compare_exchange(i, i / 2))
+        {
+            i /= 2;
+        }
+        return i == 0;
+    }
+
+    // Move i up the max-heap. Returns whether it became the median.
+    constexpr bool max_sort_up(int i) noexcept
+    {
+        while (i < 0 && compare_exchange(i / 2, i))
+        {
+            i /= 2;
+        }
+        return i == 0;
+    }
+
+    std::array<T, N> m_data{};            // The window, by age (cyclic)
+    std::array<int, N> m_pos{};           // The place of every sample in the heaps
+    std::array<std::size_t, N> m_heap{};  // The samples, by place (offset by `half`)
+    std::size_t m_oldest = 0;
+};
+
+/**
+ * @brief Replaces outliers with the median of the last N samples (a Hampel filter), and passes the rest through.
+ *
+ * A sample is an outlier when it's further from the window's median than `threshold` times the window's scale. The
+ * scale is the median absolute deviation, scaled to match the standard deviation of normally distributed samples.
+ * To keep the updates in O(log N), the deviations are taken from the median at the time each sample arrived (a
+ * running median of them) instead of all from the current median. The scale is at least `min_deviation`, so a
+ * constant window doesn't make every change an outlier.
+ *
+ * @tparam T The type of the samples.
+ * @tparam N The window size (odd).
+ */
+template <unqualified_arithmetic T, std::size_t N>
+class hampel_filter
+{
+public:
+    struct config
+    {
+        float threshold = 3.0f;  // Outliers are further than this many scales from the median.
+        T min_deviation{};       // A lower bound for the scale
+    };
+
+    // The median absolute deviation of normally distributed samples, in standard deviations
+    static constexpr float mad_scale = 1.4826f;
+
+    explicit constexpr hampel_filter(const config &conf, T value = T{}) noexcept
+        : m_config{conf}
+        , m_median{value}
+        , m_deviation{T{}}
+        , m_value{value}
+    {}
+
+    constexpr T operator()(T value) noexcept
+    {
+        const auto median = m_median(value);
+        const auto deviation = value < median ? median - value : value - median;
+        const auto mad = static_cast<float>(m_deviation(static_cast<T>(deviation)));
+        const auto scale = std::max(mad_scale * mad, static_cast<float>(m_config.min_deviation));
+        m_outlier = static_cast<float>(deviation) > m_config.threshold * scale;
+        m_value = m_outlier ? median : value;
+        return m_value;
+    }
+
+    constexpr T value() const noexcept { return m_value; }
+
+    /**
+     * @brief Whether the latest sample was an outlier.
+     */
+    constexpr bool outlier() const noexcept { return m_outlier; }
+
+private:
+    config m_config;
+    median_filter<T, N> m_median;
+    median_filter<T, N> m_deviation;
+    T m_value;
+    bool m_outlier = false;
+};
+
+/**
+ * @brief An exponential moving average: a first order low pass filter with O(1) memory.
+ *
+ * @tparam T The type of the output (and the arithmetic).
+ */
+template <std::floating_point T>
+class ema_filter
+{
+public:
+    struct config
+    {
+        T alpha;  // The weight of a new sample, in (0, 1]
+
+        /**
+         * @brief The weight for a time constant, when sampling every `dt` (in the same units).
+         */
+        static constexpr config for_time_constant(T dt, T time_constant) noexcept
+        {
+            return config{.alpha = dt / (time_constant + dt)};
+        }
+    };
+
+    explicit constexpr ema_filter(const config &conf, T value = T{}) noexcept : m_alpha{conf.alpha}, m_value{value} {}
+
+    constexpr T operator()(unqualified_arithmetic auto value) noexcept
+    {
+        m_value += m_alpha * (static_cast<T>(value) - m_value);
+        return m_value;
+    }
+
+    constexpr T value() const noexcept { return m_value; }
+
+private:
+    T m_alpha;
+    T m_value;
+};
+
+/**
+ * @brief Limits how much the output changes per sample (a slew rate limiter), separately up and down.
+ *
+ * @tparam T The type of the samples.
+ */
+template <unqualified_arithmetic T>
+class rate_limiter
+{
+public:
+    struct config
+    {
+        T max_rise;  // Per sample
+        T max_fall;  // Per sample (positive)
+    };
+
+    explicit constexpr rate_limiter(const config &conf, T value = T{}) noexcept : m_config{conf}, m_value{value} {}
+
+    constexpr T operator()(T value) noexcept
+    {
+        if (value > m_value)
+        {
+            m_value = value - m_value > m_config.max_rise ? static_cast<T>(m_value + m_config.max_rise) : value;
+        }
+        else
+        {
+            m_value = m_value - value > m_config.max_fall ? static_cast<T>(m_value - m_config.max_fall) : value;
+        }
+        return m_value;
+    }
+
+    constexpr T value() const noexcept { return m_value; }
+
+private:
+    config m_config;
+    T m_value;
+};
+
+/**
+ * @brief Runs every sample through a series of filters (`filter_stage`s), each taking the previous one's output.
+ *
+ * Every stage has a fixed size, so the whole pipeline does too, and it can be configured (and run) at compile time:
+ *
+ *     constexpr filter_pipeline distance_filter{
+ *         hampel_filter<std::uint16_t, 5>{{.threshold = 3.0f, .min_deviation = 5}},
+ *         ema_filter<float>{{.alpha = 0.5f}},
+ *     };
+ *
+ * @tparam Stages The filters, in order.
+ */
+template <typename... Stages>
+class filter_pipeline
+{
+    static_assert(sizeof...(Stages) > 0);
+
+public:
+    explicit constexpr filter_pipeline(Stages... stages) noexcept : m_stages{std::move(stages)...} {}
+
+    constexpr auto operator()(auto value) noexcept
+    {
+        return std::apply([&](auto &...stages) { return run(value, stages...); }, m_stages);
+    }
+
+    constexpr auto value() const noexcept { return std::get<sizeof...(Stages) - 1>(m_stages).value(); }
+
+    template <std::size_t I>
+    constexpr const auto &stage() const noexcept
+    {
+        return std::get<I>(m_stages);
+    }
+
+private:
+    static constexpr auto run(auto value, auto &stage, auto &...rest) noexcept
+    {
+        static_assert(filter_stage<std::remove_cvref_t<decltype(stage)>, decltype(value)>);
+        if constexpr (sizeof...(rest) == 0)
+        {
+            return stage(value);
+        }
+        else
+        {
+            return run(stage(value), rest...);
+        }
+    }
+
+    std::tuple<Stages...> m_stages;
+};
+
 #endif  // MAIN_AVERAGE_FILTER_H
@@ -0,0 +1,107 @@
+#include "calibration_storage.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <nvs.h>
+
+using micromouse::MotorModel;
+using micromouse::SpeedGainSchedule;
+
+static constexpr const char *nvs_namespace = "calibration";
+// Bump when one of the stored structs changes, so older values are ignored instead of misread.
+static constexpr std::uint32_t format_version = 2;
+
+namespace
+{
+
+template <typename T>
+struct Stored
+{
+    std::uint32_t version;
+    T value;
+};
+
+}  // namespace
+
+template <typename T>
+static std::optional<T> load(const char *key) noexcept
+{
+    nvs_handle_t handle;
+    if (nvs_open(nvs_namespace, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return std::nullopt;  // Nothing was stored yet
+    }
+    Stored<T> stored{};
+    std::size_t size = sizeof(stored);
+    const auto res = nvs_get_blob(handle, key, &stored, &size);
+    nvs_close(handle);
+    if (res != ESP_OK || size != sizeof(stored) || stored.version != format_version)
+    {
+        return std::nullopt;
+    }
+    return stored.value;
+}
+
+template <typename T>
+static bool store(const char *key, const T &value) noexcept
+{
+    nvs_handle_t handle;
+    auto res = nvs_open(nvs_namespace, NVS_READWRITE, &handle);
+    if (res == ESP_OK)
+    {
+        const Stored<T> stored{.version = format_version, .value = value};
+        res = nvs_set_blob(handle, key, &stored, sizeof(stored));
+        if (res == ESP_OK)
+        {
+            res = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (res != ESP_OK)
+    {
+        ESP_LOGE("calibration", "Failed to store %s: %s", key, esp_err_to_name(res));
+    }
+    return res == ESP_OK;
+}
+
+static const char *key(MotorID id) noexcept
+{
+    return id == LeftMotor ? "left_motor" : "right_motor";
+}
+
+static const char *key(TunedLoop loop) noexcept
+{
+    switch (loop)
+    {
+    case TunedLoop::LeftVelocity:
+        return "left_velocity";
+    case TunedLoop::RightVelocity:
+        return "right_velocity";
+    case TunedLoop::Heading:
+        return "heading";
+    }
+    return "unknown";
+}
+
+std::optional<MotorModel> load_motor_model(MotorID id) noexcept
+{
+    return load<MotorModel>(key(id));
+}
+
+bool store_motor_model(MotorID id, const MotorModel &model) noexcept
+{
+    return store(key(id), model);
+}
+
+std::optional<SpeedGainSchedule> load_gain_schedule(TunedLoop loop) noexcept
+{
+    return load<SpeedGainSchedule>(key(loop));
+}
+
+bool store_gain_schedule(TunedLoop loop, const SpeedGainSchedule &schedule) noexcept
+{
+    return store(key(loop), schedule);
+}
@@ -0,0 +1,52 @@
+#ifndef MAIN_CALIBRATION_STORAGE_H
+#define MAIN_CALIBRATION_STORAGE_H
+
+#include "gain_schedule.h"
+#include "motor.h"
+#include "motor_identification.h"
+
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Load a motor's identified model from the NVS (see `MotorIdentifier`).
+ *
+ * @param id The motor.
+ * @return The model, or nothing if it wasn't identified yet.
+ */
+std::optional<micromouse::MotorModel> load_motor_model(MotorID id) noexcept;
+
+/**
+ * @brief Store a motor's identified model in the NVS, replacing the previous one.
+ *
+ * @param id The motor.
+ * @param model The model.
+ * @return Whether the model was stored.
+ */
+bool store_motor_model(MotorID id, const micromouse::MotorModel &model) noexcept;
+
+enum class TunedLoop : std::uint8_t
+{
+    LeftVelocity,
+    RightVelocity,
+    Heading,
+};
+
+/**
+ * @brief Load a loop's auto-tuned gain schedule from the NVS (see `RelayTuner`).
+ *
+ * @param loop The loop.
+ * @return The schedule, or nothing if the loop wasn't tuned yet.
+ */
+std::optional<micromouse::SpeedGainSchedule> load_gain_schedule(TunedLoop loop) noexcept;
+
+/**
+ * @brief Store a loop's auto-tuned gain schedule in the NVS, replacing the previous one.
+ *
+ * @param loop The loop.
+ * @param schedule The schedule.
+ * @return Whether the schedule was stored.
+ */
+bool store_gain_schedule(TunedLoop loop, const micromouse::SpeedGainSchedule &schedule) noexcept;
+
+#endif  // MAIN_CALIBRATION_STORAGE_H
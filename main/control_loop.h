@@ -0,0 +1,700 @@
+#ifndef MAIN_CONTROL_LOOP_H
+#define MAIN_CONTROL_LOOP_H
+
+#include <maze_solver/cell.h>
+#include <maze_solver/direction.h>
+#include <misc_utils/angle.h>
+#include <misc_utils/fast_math.h>
+#include <misc_utils/physical_size.h>
+#include <misc_utils/value_range.h>
+
+#include "control_mailbox.h"
+#include "distance_sensor.h"
+#include "distance_sensor_model.h"
+#include "gain_schedule.h"
+#include "motion_model.h"
+#include "motor_specs.h"
+#include "path_tracker.h"
+#include "pid.h"
+#include "planner.h"
+#include "pose_estimator.h"
+#include "position.h"
+#include "segment.h"
+#include "slip_detector.h"
+#include "temp_map.h"
+#include "velocity_observer.h"
+#include "velocity_profile.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <numbers>
+#include <optional>
+#include <ratio>
+#include <span>
+#include <utility>
+
+namespace micromouse
+{
+
+/**
+ * The PID loop's hardware, as a compile-time interface (so the loop has no virtual calls): the firmware runs the loop
+ * with `Motor` and `DistanceSensors`, and the simulator (see simulator.h) with its models of them.
+ */
+template <typename T>
+concept ControlMotor = requires(T motor, float duty_cycle) {
+    // Sample the encoder (see `Motor::observe`).
+    { motor.observe() } -> std::convertible_to<VelocityObserver::State>;
+    // [ticks] Between `-MotorSpecs::bdc_mcpwm_duty_tick_max` and `MotorSpecs::bdc_mcpwm_duty_tick_max`.
+    motor.set_pwm(duty_cycle);
+};
+
+template <typename T>
+concept ControlSensors = requires(T sensors, const T &const_sensors) {
+    // The latest frame, if there's a new one (see `DistanceSensors::take_frame`).
+    { sensors.take_frame() } -> std::same_as<std::optional<DistanceSensors::Frame>>;
+    // The filtered readings, up to the last taken frame.
+    { const_sensors.readings() } -> std::same_as<DistanceSensors::Readings>;
+    { const_sensors.healthy() } -> std::convertible_to<std::bitset<DistanceSensors::sensor_count>>;
+};
+
+using MotorSpeed =
+    ConstrainedValue<ValueRange<float, -MotorSpecs::max_speed, MotorSpecs::max_speed, Mode::Closed>, false>;
+using PhysicalMotorSpeed = PhysicalSize<MotorSpeed, meters_per_second::units>;
+
+using MotorPid = Pid<float>;
+inline constexpr MotorPid::Limits motor_pid_limits{
+    .min_output = -MotorSpecs::bdc_mcpwm_duty_tick_max,
+    .max_output = MotorSpecs::bdc_mcpwm_duty_tick_max,
+    .min_integral = -MotorSpecs::bdc_mcpwm_duty_tick_max / 2,
+    .max_integral = MotorSpecs::bdc_mcpwm_duty_tick_max / 2,
+};
+
+constexpr MotorPid motor_pid(const PidGains &gains) noexcept
+{
+    return MotorPid{gains.kp, gains.ki, gains.kd, motor_pid_limits};
+}
+
+template <typename Motor>
+struct BasicMotorArgs
+{
+    Motor motor;
+    MotorPid linear_velocity_distance_pid;
+    MotorPid angular_velocity_angle_pid;
+    MotorPid velocity_pid;
+    // The PIDs' gains by speed (see `ControlLoop::step`)
+    SpeedGainSchedule linear_schedule;
+    SpeedGainSchedule angular_schedule;
+    SpeedGainSchedule velocity_schedule;
+    float distance_linear_Kv;
+    float distance_angular_Kv;
+    float velocity_Kv;
+    float velocity_Ka;
+    float Ks;
+    float output;
+    PhysicalMotorSpeed wanted_velocity;
+    float wanted_acceleration;  // [m/s^2] The last change of `wanted_velocity`
+    meters_per_second current_velocity;
+};
+
+/**
+ * @brief The controller's tunable parameters (see `ControlLoop::step`), the same for both motors.
+ */
+struct ControlGains
+{
+    PidGains distance;  // Linear velocity from the distance error
+    PidGains angle;     // Angular velocity from the angle error
+    PidGains velocity;  // Motor command from the velocity error
+    float distance_linear_Kv;
+    float distance_angular_Kv;
+    float velocity_Kv;
+    float velocity_Ka;
+    float Ks;
+};
+
+// Until the motors are identified and the loops are auto-tuned
+inline constexpr ControlGains default_control_gains{
+    .distance{.kp = 0.0005f, .ki = 0.0f, .kd = 0.005f},
+    .angle{.kp = 0.05f, .ki = 0.0f, .kd = 0.005f},
+    .velocity{.kp = 3.0f, .ki = 0.0f, .kd = 0.25f},
+    .distance_linear_Kv = 1.0f,
+    .distance_angular_Kv = 0.1f,
+    .velocity_Kv = 1.0f,
+    .velocity_Ka = 0.0f,
+    .Ks = 0.71f,
+};
+
+/**
+ * @brief Use `gains` at every speed (the schedules are flat).
+ */
+template <typename Motor>
+constexpr void apply_gains(BasicMotorArgs<Motor> &motor, const ControlGains &gains) noexcept
+{
+    motor.linear_velocity_distance_pid.set_gains(gains.distance.kp, gains.distance.ki, gains.distance.kd);
+    motor.angular_velocity_angle_pid.set_gains(gains.angle.kp, gains.angle.ki, gains.angle.kd);
+    motor.velocity_pid.set_gains(gains.velocity.kp, gains.velocity.ki, gains.velocity.kd);
+    motor.linear_schedule = SpeedGainSchedule::flat(gain_schedule_speeds, gains.distance);
+    motor.angular_schedule = SpeedGainSchedule::flat(gain_schedule_speeds, gains.angle);
+    motor.velocity_schedule = SpeedGainSchedule::flat(gain_schedule_speeds, gains.velocity);
+    motor.distance_linear_Kv = gains.distance_linear_Kv;
+    motor.distance_angular_Kv = gains.distance_angular_Kv;
+    motor.velocity_Kv = gains.velocity_Kv;
+    motor.velocity_Ka = gains.velocity_Ka;
+    motor.Ks = gains.Ks;
+}
+
+/**
+ * @brief The command for the motor's wanted velocity: the feed forward terms and the velocity PID (the second
+ * equation in `ControlLoop::step`).
+ *
+ * @param motor The motor, with its wanted and current velocities.
+ * @param wanted_acceleration The wanted velocity's rate of change [m/s^2].
+ * @return The command, in motor speed units.
+ */
+template <typename Motor>
+float motor_command(BasicMotorArgs<Motor> &motor, float wanted_acceleration) noexcept
+{
+    return std::copysign(motor.Ks, motor.wanted_velocity.count())
+         + motor.velocity_Kv * motor.wanted_velocity.count() + motor.velocity_Ka * wanted_acceleration
+         + motor.velocity_pid.calculate_pid(motor.wanted_velocity.count() - motor.current_velocity.count());
+}
+
+enum class ControlMode : std::uint8_t
+{
+    Waypoints,    // Drive to every target separately, stopping and turning in place between them.
+    PurePursuit,  // Follow the whole route as a continuous path (see `Path`).
+    Stanley,
+};
+
+inline const char *to_string(ControlMode mode) noexcept
+{
+    switch (mode)
+    {
+    case ControlMode::Waypoints:
+        return "waypoints";
+    case ControlMode::PurePursuit:
+        return "pure pursuit";
+    case ControlMode::Stanley:
+        return "Stanley";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief The PID loop's state. Once the PID loop runs, it's only accessed by the PID loop: the main loop sends it
+ * commands and reads its state through `mailbox`.
+ */
+template <typename Motor>
+struct BasicPidArgs
+{
+    BasicMotorArgs<Motor> left;
+    BasicMotorArgs<Motor> right;
+    Position target_pos;
+    Position pos;
+    VelocityProfile linear_profile;  // From the previous target to `target_pos`
+    std::uint32_t profile_ticks;     // PID loop iterations since the start of `linear_profile` (or of the path)
+    ControlMode control_mode;
+    PathTracker tracker;
+    ControlMailbox *mailbox;
+};
+
+inline constexpr MotionLimits linear_motion_limits{
+    .max_velocity = meters_per_second{max_controlled_speed},
+    .max_acceleration = MotorSpecs::max_acceleration,
+    .max_jerk = 100.0f,
+};
+
+inline constexpr SlipDetector::Config slip_detection{
+    .max_acceleration = MotorSpecs::max_acceleration,
+    .min_acceleration = 3.0f,
+    .response_time = SlipDetector::seconds{0.07f},
+    .acceleration_error = 4.0f,
+    .confirm_ticks = 3,
+    .innovation_gates = SlipDetector::chi_square_99,
+    .backoff = 0.8f,
+    .recovery = 0.5f,
+    .process_noise_scale = 10.0f,
+    .hold = SlipDetector::seconds{0.2f},
+};
+
+enum class PidStage : std::uint8_t
+{
+    Encoders,
+    MotionModel,  // The pose estimator's stages (see `PoseEstimator::Stage`)
+    Corridor,
+    RayCasting,
+    Ekf,
+    Tracking,
+    Control,
+    Total,
+    Count,
+};
+
+constexpr PidStage pid_stage(PoseEstimator::Stage stage) noexcept
+{
+    switch (stage)
+    {
+    case PoseEstimator::Stage::MotionModel:
+        return PidStage::MotionModel;
+    case PoseEstimator::Stage::Corridor:
+        return PidStage::Corridor;
+    case PoseEstimator::Stage::RayCasting:
+        return PidStage::RayCasting;
+    case PoseEstimator::Stage::Ekf:
+        return PidStage::Ekf;
+    }
+    return PidStage::Total;
+}
+
+/**
+ * @brief The PID loop: the pose estimation and the controller, for one pair of motors and set of distance sensors.
+ *
+ * @tparam Motor The motors' type (see `ControlMotor`).
+ */
+template <ControlMotor Motor>
+class ControlLoop
+{
+public:
+    using PidArgs = BasicPidArgs<Motor>;
+    using MotorArgs = BasicMotorArgs<Motor>;
+    using Period = std::chrono::duration<float, std::micro>;
+
+    // What a step used, for recording it (see `flight_log::Record`)
+    struct Tick
+    {
+        Position prior_pos;                          // The pose the step started from (after a reset)
+        std::optional<DistanceSensors::Frame> frame;  // The sensor frame the step took, if any
+    };
+
+    /**
+     * @param period The PID loop's period.
+     * @param path The whole route, for the path tracking modes.
+     * @param maze_map The walls to cast the sensor rays on.
+     */
+    ControlLoop(const Period &period, const Path &path, std::span<const Segment> maze_map) noexcept
+        : m_period{period}
+        , m_path{path}
+        , m_pose_estimator{maze_map}
+        , m_slip_detector{slip_detection}
+    {
+    }
+
+    /**
+     * @brief Calculate the control signal for each motor.
+     * Using those two equations:
+     * Vw = Kv1 * Vp + PID(dx - dp)
+     * Vm = Ks + Kv2 * Vw + Ka * dVw/dt + PID(Vw - Vc)
+     * Where:
+     * Vw - Wanted velocity.
+     * Kv1 - Wanted velocity factor.
+     * Vp - The velocity of the segment's jerk-limited velocity profile at the current time.
+     * dx - Distance error (current pos - wanted pos).
+     * dp - The distance left to drive according to the profile.
+     * Vm - Motor velocity output.
+     * Ks - Static motor velocity (the smallest velocity to drive the motor on ground).
+     * Kv2 - Motor velocity factor.
+     * Ka - Motor acceleration factor (Kv2 times the motor's time constant, when the motor was identified).
+     * Vc - Current motor velocity.
+     *
+     * The PIDs' gains are scheduled by speed (see `GainSchedule`): the distance and angle PIDs by Vp and the velocity
+     * PID by the wheel's Vw (from the previous iteration).
+     *
+     * The first equation uses a PID on the distance from where the velocity profile says we should be and adds the
+     * profile's velocity as a feed forward term.
+     * The second equation is to close the loop on the velocity value sent to the motor.
+     * It uses a PID on the velocity error and adds a feed forward term of the wanted velocity.
+     *
+     * Using the first equation, we calculate the linear and angular velocities, Vl and Va.
+     * Vl is calculated from the distance error while Va is calculated from the angle error (with a feed forward term
+     * of Kv1 * sqrt(2 * a * |dx|) * sign(dx) that assumes constant acceleration motion (trapezoid motion profile)).
+     * The angle error is composed of the error between current and wanted angle and the error between current angle
+     * and the driving direction needed to reach the destination.
+     * The left motor's wanted speed is Vl + Va and the right motor's wanted speed is Vl - Va.
+     * Now we can use the second equation to calculate the velocity of each motor.
+     *
+     * The left and right motors current velocities change the robot's position using the robot's differential drive
+     * motion model.
+     * When new data from the distance sensors arrive, we use a Kalman filter to fuse the data from the sensors and the
+     * predicted position from the motion model to get a new better estimated position. The sensors measure at
+     * different rates (see `SensorTimingPolicy`), so only the readings that are new in the frame are fused.
+     * While driving along a straight corridor, the side walls are used directly instead (see `corridor_update`).
+     *
+     * The acceleration limit (of Vw, and of the angular feed forward term) comes from the slip detector: it backs off
+     * when the wheels slip and grows back while they grip. While slipping, the EKF's process noise is inflated so the
+     * sensors correct the odometry's drift (see `SlipDetector`).
+     *
+     * In the path tracking modes the targets are ignored: the whole route is followed as one path, without stopping.
+     * Vp is the path's reference velocity and the distance error is how far behind the path's reference we are (along
+     * the path). Va comes from the path tracker (pure pursuit or Stanley) instead of the angle error.
+     *
+     * @param args The PID loop's state.
+     * @param sensors The distance sensors.
+     * @param on_stage Called with every stage as it ends (for profiling).
+     */
+    template <ControlSensors Sensors>
+    Tick step(PidArgs &args, Sensors &sensors, auto &&on_stage) noexcept
+    {
+        // Initialization:
+        using LinearMotorSpeed = ConstrainedValue<
+            ValueRange<float, MotorSpeed::range_type::low / 12.0f, MotorSpeed::range_type::high / 12.0f, Mode::Closed>,
+            false>;
+        using RotationalMotorSpeed = ConstrainedValue<
+            ValueRange<float, MotorSpeed::range_type::low / 16.0f, MotorSpeed::range_type::high / 16.0f, Mode::Closed>,
+            false>;
+
+        static_assert(
+            MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::low)
+            && MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::high)
+        );
+        static_assert(
+            MotorSpeed::range_type::contains(RotationalMotorSpeed::range_type::low)
+            && MotorSpeed::range_type::contains(RotationalMotorSpeed::range_type::high)
+        );
+        static_assert(
+            MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::low + RotationalMotorSpeed::range_type::low)
+            && MotorSpeed::range_type::contains(
+                LinearMotorSpeed::range_type::high + RotationalMotorSpeed::range_type::high
+            )
+        );
+
+        if (const auto update = args.mailbox->receive())
+        {
+            args.target_pos = update->target;
+            if (update->pose_reset)
+            {
+                args.pos = *update->pose_reset;
+            }
+            if (update->profile)
+            {
+                args.linear_profile = *update->profile;
+                args.profile_ticks = 0;
+            }
+        }
+
+        // Update pos:
+        const auto &left_state = args.left.motor.observe();
+        const auto &right_state = args.right.motor.observe();
+        args.left.current_velocity = left_state.velocity;
+        args.right.current_velocity = right_state.velocity;
+        // The wanted accelerations are from the previous iteration, which commanded the motors until now.
+        m_slip_detector.update(
+            {.encoder_acceleration = left_state.acceleration,
+             .commanded_acceleration = args.left.wanted_acceleration},
+            {.encoder_acceleration = right_state.acceleration,
+             .commanded_acceleration = args.right.wanted_acceleration},
+            m_period
+        );
+        m_pose_estimator.kalman_filter().set_process_noise_scale(m_slip_detector.process_noise_scale());
+        on_stage(PidStage::Encoders);
+        Tick tick{.prior_pos = args.pos, .frame = sensors.take_frame()};
+        const auto &frame = tick.frame;
+        const auto estimator_sensors = frame ? std::optional{PoseEstimator::Sensors{
+                                                   .readings = sensors.readings(),
+                                                   .fresh = frame->fresh,
+                                                   .healthy = frame->healthy,
+                                               }}
+                                             : std::nullopt;
+        const auto estimate = m_pose_estimator.step(
+            args.pos,
+            args.left.current_velocity,
+            args.right.current_velocity,
+            m_period,
+            estimator_sensors ? &*estimator_sensors : nullptr,
+            [&](PoseEstimator::Stage stage) { on_stage(pid_stage(stage)); }
+        );
+        args.pos = estimate.pos;
+        if (estimate.update == PoseEstimator::Update::Ekf)
+        {
+            m_slip_detector.check_innovation(
+                m_pose_estimator.kalman_filter().normalized_innovation(),
+                estimate.fused.count()
+            );
+        }
+
+        // Calculate error
+        const auto x_err = unit_cast<millimeters>((args.target_pos.x - args.pos.x).get());
+        const auto y_err = unit_cast<millimeters>((args.target_pos.y - args.pos.y).get());
+        const auto [sin_theta, cos_theta] = fast::sincos(args.pos.theta);
+        const auto dist_sign = std::copysign(1.0f, x_err.count() * cos_theta + y_err.count() * sin_theta);
+        const auto dist_err = dist_sign * fast::hypot(x_err, y_err).count();
+        // Head for the target, and turn to its heading once close to it. Holding its heading on the way would leave a
+        // lateral offset (like the one turning in place leaves) uncorrected.
+        const auto angle_err = [&]()
+        {
+            if (dist_err > (50_mm).count())
+            {
+                return static_cast<float>(fast::atan2(y_err, x_err) - args.pos.theta);
+            }
+            else
+            {
+                return static_cast<float>(args.target_pos.theta - args.pos.theta);
+            }
+        }();
+
+        const auto follow_path = args.control_mode != ControlMode::Waypoints;
+        const auto steering =
+            follow_path
+                ? args.tracker.update(args.pos, (args.left.current_velocity + args.right.current_velocity) / 2)
+                : Steering{};
+        on_stage(PidStage::Tracking);
+
+        // Calculate wanted velocity from distance and angle errors:
+        struct Reference
+        {
+            meters_per_second velocity;
+            float distance_err;  // [mm] How far behind the reference we are.
+        };
+        const auto time = profile_time(args.profile_ticks++);
+        const auto reference = [&]() -> Reference
+        {
+            if (follow_path)
+            {
+                const auto sample = m_path.sample(time);
+                return {sample.velocity, unit_cast<millimeters>(sample.distance - steering.progress).count()};
+            }
+            const auto sample = args.linear_profile.sample(time);
+            const auto profile_left = unit_cast<millimeters>(args.linear_profile.distance() - sample.position);
+            return {sample.velocity, dist_err - profile_left.count()};
+        }();
+        for (auto *motor : {&args.left, &args.right})
+        {
+            motor->linear_schedule.apply(motor->linear_velocity_distance_pid, reference.velocity.count());
+            motor->angular_schedule.apply(motor->angular_velocity_angle_pid, reference.velocity.count());
+            motor->velocity_schedule.apply(motor->velocity_pid, motor->wanted_velocity.count().get());
+        }
+        const auto calc_wanted_linear_velocity = [&](MotorPid &pid, float kv)
+        { return meters_per_second{kv * reference.velocity.count() + pid.calculate_pid(reference.distance_err)}; };
+        const auto max_acceleration = m_slip_detector.acceleration_limit();
+        const auto calc_wanted_velocity = [&](MotorPid &pid, float err, float kv)
+        {
+            // Use PID on the error and add a feed forward term which assumes constant acceleration motion (trapezoid
+            // motion profile).
+            return meters_per_second{
+                std::copysign(kv, err) * fast::sqrt(2 * max_acceleration * std::abs(err)) + pid.calculate_pid(err)
+            };
+        };
+        const auto limit_velocity = [&](float new_velocity, float last_velocity)
+        {
+            const auto max_velocity_change =
+                max_acceleration * duration_cast<std::chrono::duration<float>>(m_period).count();
+            return PhysicalMotorSpeed{
+                std::clamp(new_velocity, last_velocity - max_velocity_change, last_velocity + max_velocity_change)
+            };
+        };
+        const auto calc_motor_velocity = [&](MotorArgs &motor, bool left, float angle_err)
+        {
+            const LinearMotorSpeed wanted_linear_velocity{
+                calc_wanted_linear_velocity(motor.linear_velocity_distance_pid, motor.distance_linear_Kv).count()
+            };
+            const RotationalMotorSpeed wanted_angular_velocity{
+                follow_path
+                    ? steering.angular_velocity * distance_between_wheels.count() / 2
+                    : calc_wanted_velocity(motor.angular_velocity_angle_pid, angle_err, motor.distance_angular_Kv)
+                          .count()
+            };
+
+            const auto last_wanted_velocity = motor.wanted_velocity.count().get();
+            motor.wanted_velocity = limit_velocity(
+                left ? wanted_linear_velocity.get() + wanted_angular_velocity.get()
+                     : wanted_linear_velocity.get() - wanted_angular_velocity.get(),
+                last_wanted_velocity
+            );
+            motor.wanted_acceleration = (motor.wanted_velocity.count().get() - last_wanted_velocity)
+                                      / duration_cast<std::chrono::duration<float>>(m_period).count();
+            return motor_command(motor, motor.wanted_acceleration);
+        };
+        const MotorSpeed left_motor_velocity{calc_motor_velocity(args.left, true, angle_err)};
+        const MotorSpeed right_motor_velocity{calc_motor_velocity(args.right, false, angle_err)};
+
+        // Outputs:
+        args.left.output = MotorSpecs::bdc_mcpwm_duty_tick_max * left_motor_velocity / MotorSpecs::max_speed;
+        args.right.output = MotorSpecs::bdc_mcpwm_duty_tick_max * right_motor_velocity / MotorSpecs::max_speed;
+        args.left.motor.set_pwm(args.left.output);
+        args.right.motor.set_pwm(args.right.output);
+        args.mailbox->publish(state(args, sensors, reference.velocity, time));
+        on_stage(PidStage::Control);
+        return tick;
+    }
+
+    template <ControlSensors Sensors>
+    Tick step(PidArgs &args, Sensors &sensors) noexcept
+    {
+        return step(args, sensors, [](PidStage) {});
+    }
+
+    /**
+     * @brief The PID loop's state, for the main loop (see `ControlMailbox`).
+     *
+     * @param args The PID loop's arguments.
+     * @param sensors The distance sensors.
+     * @param reference_velocity The current reference velocity.
+     * @param time The time since the start of the current profile (or path).
+     */
+    template <ControlSensors Sensors>
+    ControlState state(
+        const PidArgs &args,
+        const Sensors &sensors,
+        meters_per_second reference_velocity,
+        VelocityProfile::seconds time
+    ) const noexcept
+    {
+        const auto wheel = [](const MotorArgs &motor)
+        {
+            return WheelState{
+                .velocity = motor.current_velocity,
+                .wanted_velocity = meters_per_second{motor.wanted_velocity.count().get()},
+                .output = motor.output,
+            };
+        };
+        return {
+            .pos = args.pos,
+            .target = args.target_pos,
+            .reference_velocity = reference_velocity,
+            .profile_time = time,
+            .progress = args.tracker.progress(),
+            .left = wheel(args.left),
+            .right = wheel(args.right),
+            .distances = sensors.readings(),
+            .healthy_sensors = sensors.healthy(),
+            .innovation = m_pose_estimator.kalman_filter().normalized_innovation(),
+        };
+    }
+
+    VelocityProfile::seconds profile_time(std::uint32_t ticks) const noexcept
+    {
+        return duration_cast<VelocityProfile::seconds>(m_period * ticks);
+    }
+
+    const Period &period() const noexcept { return m_period; }
+    PoseEstimator &pose_estimator() noexcept { return m_pose_estimator; }
+    const PoseEstimator &pose_estimator() const noexcept { return m_pose_estimator; }
+    const SlipDetector &slip_detector() const noexcept { return m_slip_detector; }
+
+    /**
+     * @brief Forget the slips of the previous run (see `SlipDetector::reset`), while the PID loop isn't running.
+     */
+    void restart() noexcept { m_slip_detector.reset(); }
+
+private:
+    Period m_period;
+    const Path &m_path;
+    PoseEstimator m_pose_estimator;
+    SlipDetector m_slip_detector;
+};
+
+// The main loop's:
+
+inline constexpr auto max_diff_distance = 20.0_mm;
+inline constexpr Angle max_diff_angle{std::numbers::pi_v<float> / 60};
+
+constexpr auto is_vertical(Direction d) noexcept
+{
+    return d == Direction::North || d == Direction::South;
+}
+
+/**
+ * @brief Finds the closest direction to the given angle by dividing the plane into quarters.
+ *
+ * @param angle angle to check.
+ * @return Closest direction.
+ */
+inline auto to_closest_direction(const Angle &angle) noexcept
+{
+    if (std::abs(angle) < std::numbers::pi_v<float> / 4)
+    {
+        return Direction::East;
+    }
+    else if (std::abs(angle) < 3 * std::numbers::pi_v<float> / 4)
+    {
+        return (angle.get() > 0) ? Direction::South : Direction::North;
+    }
+
+    return Direction::West;
+}
+
+/**
+ * @brief Whether the robot reached a waypoint: close enough to snap its pose to it (along the driving direction and
+ * in heading).
+ */
+inline bool reached_waypoint(const Position &waypoint, const Position &pos) noexcept
+{
+    const auto x_err = unit_cast<millimeters>((waypoint.x - pos.x).get());
+    const auto y_err = unit_cast<millimeters>((waypoint.y - pos.y).get());
+    const auto pos_angle_err = waypoint.theta - pos.theta;
+    const auto error = is_vertical(to_closest_direction(waypoint.theta)) ? y_err : x_err;
+    return std::abs(pos_angle_err.get()) <= max_diff_angle.get()
+        && millimeters{std::abs(error.count())} <= max_diff_distance;
+}
+
+/**
+ * @brief The profile from one waypoint to the next. The route turns in place at every target, so every segment ends
+ * at a standstill.
+ * The waypoints are reached a little early (see `reached_waypoint`), possibly before the previous profile slowed
+ * down, so the entry velocity is limited to one that still stops within the segment. Otherwise a short segment (like
+ * turning in place) would end at the entry velocity and keep driving at it.
+ */
+inline VelocityProfile segment_profile(
+    const Position &from,
+    const Position &to,
+    meters_per_second entry_velocity
+) noexcept
+{
+    const auto distance = fast::hypot((to.x - from.x).get(), (to.y - from.y).get());
+    return VelocityProfile::plan(
+        distance,
+        std::clamp(
+            entry_velocity,
+            meters_per_second{0.0f},
+            max_reachable_velocity(meters_per_second{0.0f}, distance, linear_motion_limits)
+        ),
+        meters_per_second{0.0f},
+        linear_motion_limits
+    );
+}
+
+/**
+ * @brief The walls of the robot's cell, as seen by the sensors that face the sides and the front. The walls that a
+ * failed sensor faces stay unknown.
+ *
+ * @param pos The robot's position (snapped to a waypoint).
+ * @param readings The distance sensors' readings at `pos`.
+ * @param healthy The sensors whose readings can be trusted.
+ */
+inline WallUpdate observe_walls(
+    const Position &pos,
+    const DistanceSensors::Readings &readings,
+    const std::bitset<DistanceSensors::sensor_count> &healthy
+) noexcept
+{
+    static constexpr std::array wall_sensors{0, 2, 4};
+    static constexpr meters wall_threshold{wall_length / 2};  // Nearer than the next cell
+
+    WallUpdate update{
+        .row = static_cast<std::uint8_t>(pos.y->count() / wall_length),
+        .col = static_cast<std::uint8_t>(pos.x->count() / wall_length),
+        .walls = empty_walls,
+        .known = empty_walls,
+    };
+    for (const auto i : wall_sensors)
+    {
+        if (!healthy.test(i))
+        {
+            continue;
+        }
+        const auto side = static_cast<Walls>(std::to_underlying(to_closest_direction(pos.theta + sensor_angles[i])));
+        update.known |= side;
+        if (readings[i] < wall_threshold)
+        {
+            update.walls |= side;
+        }
+    }
+    return update;
+}
+
+}  // namespace micromouse
+
+#endif  // MAIN_CONTROL_LOOP_H
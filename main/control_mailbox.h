@@ -0,0 +1,166 @@
+#ifndef MAIN_CONTROL_MAILBOX_H
+#define MAIN_CONTROL_MAILBOX_H
+
+#include <misc_utils/physical_size.h>
+#include <misc_utils/triple_buffer.h>
+
+#include "distance_sensor.h"
+#include "position.h"
+#include "velocity_profile.h"
+
+#include <bitset>
+#include <cstdint>
+#include <optional>
+
+namespace micromouse
+{
+
+/**
+ * @brief What the planner asks the controller to do.
+ *
+ * The pose reset and the profile are one-shot requests, so each one carries a version: the controller applies it once,
+ * when the version changes. The planner always sends its latest requests, so a command that is replaced by a newer
+ * one before the controller takes it doesn't lose them.
+ */
+struct ControlCommand
+{
+    Position target;
+    Position pose_reset;            // Snap the pose estimate here.
+    std::uint32_t pose_version;     // 0 until the first reset
+    VelocityProfile profile;        // Start following this profile from its beginning.
+    std::uint32_t profile_version;  // 0 until the first profile
+};
+
+/**
+ * @brief A wheel's part of `ControlState`.
+ */
+struct WheelState
+{
+    meters_per_second velocity;
+    meters_per_second wanted_velocity;
+    float output;
+};
+
+/**
+ * @brief A snapshot of the controller, published every period.
+ */
+struct ControlState
+{
+    Position pos;
+    Position target;
+    meters_per_second reference_velocity;   // The current profile's (or path's) velocity
+    VelocityProfile::seconds profile_time;  // Since the start of the current profile (or path)
+    meters progress;                        // Along the path (in the path tracking modes)
+    WheelState left;
+    WheelState right;
+    DistanceSensors::Readings distances;                         // The latest readings the controller took
+    std::bitset<DistanceSensors::sensor_count> healthy_sensors;  // The sensors whose readings can be trusted
+    float innovation;                                            // The EKF's latest normalized innovation squared
+};
+
+/**
+ * @brief Exchanges commands and state between the planner (the main loop) and the controller (`pid_loop`), which run
+ * in different tasks, without locks: each direction is a `TripleBuffer`, so neither side ever blocks the other and
+ * neither sees a half-written value.
+ *
+ * The planner's functions (`set_target`, `reset_pose`, `start_profile`, `send` and `state`) must all be called from
+ * one task, and the controller's (`receive` and `publish`) from one other task.
+ */
+class ControlMailbox
+{
+public:
+    /**
+     * @brief What changed since the controller's last `receive`.
+     */
+    struct Update
+    {
+        Position target;
+        std::optional<Position> pose_reset;
+        std::optional<VelocityProfile> profile;
+    };
+
+    /**
+     * @param initial The controller's initial state (also the initial target).
+     */
+    explicit ControlMailbox(const ControlState &initial) noexcept
+        : m_command{.target = initial.target,
+                    .pose_reset = initial.pos,
+                    .pose_version = 0,
+                    .profile{},
+                    .profile_version = 0}
+        , m_commands{m_command}
+        , m_states{initial}
+    {}
+
+    // Planner:
+
+    constexpr void set_target(const Position &target) noexcept { m_command.target = target; }
+
+    constexpr void reset_pose(const Position &pos) noexcept
+    {
+        m_command.pose_reset = pos;
+        m_command.pose_version++;
+    }
+
+    constexpr void start_profile(const VelocityProfile &profile) noexcept
+    {
+        m_command.profile = profile;
+        m_command.profile_version++;
+    }
+
+    /**
+     * @brief Send the target and the requests so far.
+     */
+    void send() noexcept { m_commands.write(m_command); }
+
+    /**
+     * @brief The controller's latest state.
+     */
+    const ControlState &state() noexcept
+    {
+        m_states.update();
+        return m_states.read();
+    }
+
+    // Controller:
+
+    /**
+     * @brief Take the planner's latest command, if there is a new one.
+     */
+    std::optional<Update> receive() noexcept
+    {
+        if (!m_commands.update())
+        {
+            return std::nullopt;
+        }
+        const auto &command = m_commands.read();
+        Update update{.target = command.target, .pose_reset{}, .profile{}};
+        if (command.pose_version != m_pose_version)
+        {
+            update.pose_reset = command.pose_reset;
+            m_pose_version = command.pose_version;
+        }
+        if (command.profile_version != m_profile_version)
+        {
+            update.profile = command.profile;
+            m_profile_version = command.profile_version;
+        }
+        return update;
+    }
+
+    void publish(const ControlState &state) noexcept { m_states.write(state); }
+
+private:
+    // Planner
+    ControlCommand m_command;
+    // Shared
+    TripleBuffer<ControlCommand> m_commands;
+    TripleBuffer<ControlState> m_states;
+    // Controller
+    std::uint32_t m_pose_version = 0;
+    std::uint32_t m_profile_version = 0;
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_CONTROL_MAILBOX_H
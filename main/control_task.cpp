@@ -0,0 +1,113 @@
+#include "control_task.h"
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+using micromouse::DeadlineStats;
+
+static constexpr std::uint32_t timer_resolution = 1'000'000;  // [Hz] A tick per microsecond.
+
+ControlTask::ControlTask(Callback callback, void *args, BaseType_t core) noexcept
+    : m_callback{callback}
+    , m_args{args}
+    , m_task{nullptr}
+    , m_timer{nullptr}
+    , m_running{false}
+    , m_stop_requested{false}
+    , m_stopped{xSemaphoreCreateBinary()}
+    , m_release_time{0}
+    , m_stats{DeadlineStats::Timestamp::zero()}
+{
+    ESP_ERROR_CHECK(m_stopped != nullptr ? ESP_OK : ESP_ERR_NO_MEM);
+    const gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = timer_resolution,
+        .intr_priority = 0,
+        .flags = {},
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &m_timer));
+    const gptimer_event_callbacks_t callbacks = {
+        .on_alarm = on_alarm,
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(m_timer, &callbacks, this));
+
+    const auto res = xTaskCreatePinnedToCore(run, "control", stack_size, this, priority, &m_task, core);
+    ESP_ERROR_CHECK(res == pdPASS ? ESP_OK : ESP_ERR_NO_MEM);
+}
+
+ControlTask::~ControlTask()
+{
+    stop();
+    vTaskDelete(m_task);
+    vSemaphoreDelete(m_stopped);
+    ESP_ERROR_CHECK(gptimer_del_timer(m_timer));
+}
+
+void ControlTask::start(const std::chrono::microseconds &period) noexcept
+{
+    stop();
+
+    m_stats = DeadlineStats{DeadlineStats::Timestamp{period.count()}};
+    const gptimer_alarm_config_t alarm_config = {
+        .alarm_count = static_cast<std::uint64_t>(period.count()),
+        .reload_count = 0,
+        .flags{.auto_reload_on_alarm = true},
+    };
+    // A stale timer event would run the callback as soon as the timer is enabled, early.
+    ulTaskNotifyValueClear(m_task, UINT32_MAX);
+    ESP_ERROR_CHECK(gptimer_set_raw_count(m_timer, 0));
+    ESP_ERROR_CHECK(gptimer_set_alarm_action(m_timer, &alarm_config));
+    ESP_ERROR_CHECK(gptimer_enable(m_timer));
+    ESP_ERROR_CHECK(gptimer_start(m_timer));
+    m_running = true;
+}
+
+void ControlTask::stop() noexcept
+{
+    if (m_running)
+    {
+        ESP_ERROR_CHECK(gptimer_stop(m_timer));
+        ESP_ERROR_CHECK(gptimer_disable(m_timer));
+        m_running = false;
+
+        // No more timer events, wake the task up to acknowledge once the current call returns.
+        m_stop_requested = true;
+        xTaskNotifyGive(m_task);
+        xSemaphoreTake(m_stopped, portMAX_DELAY);
+    }
+}
+
+bool IRAM_ATTR ControlTask::on_alarm(gptimer_handle_t, const gptimer_alarm_event_data_t *, void *self) noexcept
+{
+    auto &control_task = *static_cast<ControlTask *>(self);
+    BaseType_t task_woken = pdFALSE;
+    taskENTER_CRITICAL_ISR(&control_task.m_release_lock);
+    control_task.m_release_time = esp_timer_get_time();
+    taskEXIT_CRITICAL_ISR(&control_task.m_release_lock);
+    vTaskNotifyGiveFromISR(control_task.m_task, &task_woken);
+    // Switch to the control task as soon as the interrupt returns.
+    return task_woken == pdTRUE;
+}
+
+void ControlTask::run(void *self) noexcept
+{
+    auto &control_task = *static_cast<ControlTask *>(self);
+    while (true)
+    {
+        // Returns the number of notifications (timer events) since the last time.
+        const auto events = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (control_task.m_stop_requested.exchange(false))
+        {
+            xSemaphoreGive(control_task.m_stopped);
+            continue;
+        }
+        const DeadlineStats::Timestamp start{esp_timer_get_time()};
+        taskENTER_CRITICAL(&control_task.m_release_lock);
+        const DeadlineStats::Timestamp release{control_task.m_release_time};
+        taskEXIT_CRITICAL(&control_task.m_release_lock);
+        control_task.m_callback(control_task.m_args);
+        const DeadlineStats::Timestamp end{esp_timer_get_time()};
+        control_task.m_stats.record(release, start, end, events - 1);
+    }
+}
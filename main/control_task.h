@@ -0,0 +1,92 @@
+#ifndef MAIN_CONTROL_TASK_H
+#define MAIN_CONTROL_TASK_H
+
+#include "deadline_stats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <driver/gptimer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Runs a callback periodically in a dedicated task, instead of in the esp_timer task that is shared with every
+ * other timer callback (like `PeriodicCaller` does).
+ *
+ * The task is pinned to a single core at the highest priority and is released by a hardware (GPTimer) alarm
+ * interrupt, so its latency doesn't depend on the other tasks. Timer events that arrive while the callback is still
+ * running are coalesced into a single run (and counted as overruns) instead of piling up.
+ *
+ * The timing of every period is recorded in `stats()`.
+ */
+class ControlTask
+{
+public:
+    using Callback = void (*)(void *);
+
+    static constexpr UBaseType_t priority = configMAX_PRIORITIES - 1;
+    static constexpr std::uint32_t stack_size = 4096;
+
+    /**
+     * @brief Create the task (it waits for `start`).
+     *
+     * @param callback A function of type `void (void* arg)` to be called.
+     * @param args Pointer to opaque user-specific data.
+     * @param core The core to run on.
+     */
+    ControlTask(Callback callback, void *args, BaseType_t core) noexcept;
+    ~ControlTask();
+    ControlTask(const ControlTask &) noexcept = delete;
+    ControlTask(ControlTask &&) noexcept = delete;
+    ControlTask &operator=(const ControlTask &) noexcept = delete;
+    ControlTask &operator=(ControlTask &&) noexcept = delete;
+
+    /**
+     * @brief Start calling the callback every `period` (restarts the statistics).
+     *
+     * @param period timer period.
+     */
+    void start(const std::chrono::microseconds &period) noexcept;
+
+    template <typename Rep, typename Ratio>
+    auto start(const std::chrono::duration<Rep, Ratio> &period) noexcept
+    {
+        return start(duration_cast<std::chrono::microseconds>(period));
+    }
+
+    /**
+     * @brief Stop the timer, and wait for the current call of the callback (if any) to return. The task runs on
+     * another core, so without waiting a call that is still running could, e.g., override the motors that the caller
+     * just stopped.
+     * Must not be called from the callback.
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief The timing of the periods since the last `start`.
+     * Updated by the task without synchronization, so it's only consistent after `stop`.
+     */
+    const micromouse::DeadlineStats &stats() const noexcept { return m_stats; }
+
+private:
+    static bool on_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *event, void *self) noexcept;
+    static void run(void *self) noexcept;
+
+    Callback m_callback;
+    void *m_args;
+    TaskHandle_t m_task;
+    gptimer_handle_t m_timer;
+    bool m_running;
+    std::atomic<bool> m_stop_requested;  // Set by `stop`, acknowledged by the task through `m_stopped`
+    SemaphoreHandle_t m_stopped;
+    // [us] Written by the alarm interrupt before notifying the task. 64 bits don't load or store atomically on this
+    // core, so both sides take `m_release_lock`.
+    std::int64_t m_release_time;
+    portMUX_TYPE m_release_lock = portMUX_INITIALIZER_UNLOCKED;
+    micromouse::DeadlineStats m_stats;
+};
+
+#endif  // MAIN_CONTROL_TASK_H
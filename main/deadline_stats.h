@@ -0,0 +1,111 @@
+#ifndef MAIN_DEADLINE_STATS_H
+#define MAIN_DEADLINE_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace micromouse
+{
+
+/**
+ * @brief Timing statistics of a periodic task: how late it starts, how long it runs and whether it keeps up.
+ *
+ * Every period is recorded with three timestamps: the release (the timer event), the start and the end of the work.
+ * - Latency: from the release to the start (the time it takes the scheduler to switch to the task).
+ * - Jitter: how far the time between two consecutive starts is from the nominal period.
+ * - Execution time: from the start to the end. The max is the observed worst case execution time (WCET).
+ * - Response time: from the release to the end. Must be below the period.
+ * - Overruns: periods whose response time was longer than the period, or timer events that were missed completely.
+ * - Stalls: time the task can't run for reasons outside of it (see `record_stall`).
+ */
+class DeadlineStats
+{
+public:
+    using Timestamp = std::chrono::duration<std::int64_t, std::micro>;  // As returned by `esp_timer_get_time`
+
+    // The fraction of a period the task may use, leaving room for the other tasks on its core and for the cases that
+    // weren't observed.
+    static constexpr float max_utilization = 0.5f;
+
+    explicit constexpr DeadlineStats(Timestamp period) noexcept : m_period{period} {}
+
+    /**
+     * @brief Record a period.
+     *
+     * @param release When the timer fired.
+     * @param start When the work started.
+     * @param end When the work ended.
+     * @param missed Timer events that were missed before this one (because the previous period was still running).
+     */
+    constexpr void record(Timestamp release, Timestamp start, Timestamp end, std::uint32_t missed = 0) noexcept
+    {
+        if (m_count > 0)
+        {
+            const auto interval = start - m_last_start;
+            m_max_jitter = std::max(m_max_jitter, interval > m_period ? interval - m_period : m_period - interval);
+        }
+        m_last_start = start;
+        m_count++;
+
+        const auto execution = end - start;
+        m_total_execution += execution;
+        m_max_execution = std::max(m_max_execution, execution);
+        m_min_execution = std::min(m_min_execution, execution);
+        m_max_latency = std::max(m_max_latency, start - release);
+        m_max_response = std::max(m_max_response, end - release);
+        m_overruns += missed + (end - release > m_period ? 1 : 0);
+    }
+
+    /**
+     * @brief Record a stall that the task can't preempt, like a flash write (which disables the cache on both cores, so
+     * a task running from flash waits for it). A stall that hit a period is already in its response time, but the next
+     * one may hit the slowest period, so `fits` adds the longest stall to the worst response time.
+     */
+    constexpr void record_stall(Timestamp stall) noexcept { m_max_stall = std::max(m_max_stall, stall); }
+
+    constexpr void reset() noexcept { *this = DeadlineStats{m_period}; }
+
+    constexpr Timestamp period() const noexcept { return m_period; }
+    constexpr std::uint32_t count() const noexcept { return m_count; }
+    constexpr std::uint32_t overruns() const noexcept { return m_overruns; }
+    constexpr Timestamp max_jitter() const noexcept { return m_max_jitter; }
+    constexpr Timestamp max_latency() const noexcept { return m_max_latency; }
+    constexpr Timestamp max_response() const noexcept { return m_max_response; }
+    constexpr Timestamp wcet() const noexcept { return m_max_execution; }
+    constexpr Timestamp max_stall() const noexcept { return m_max_stall; }
+    constexpr Timestamp min_execution() const noexcept { return m_count > 0 ? m_min_execution : Timestamp::zero(); }
+    constexpr Timestamp mean_execution() const noexcept
+    {
+        return m_count > 0 ? m_total_execution / m_count : Timestamp::zero();
+    }
+
+    /**
+     * @brief Whether the task can run at a (possibly shorter) `period`, judging by what was observed so far.
+     * The work per period doesn't depend on the period, so the worst response time (with the longest stall) must fit
+     * in `max_utilization` of the new period, and there must have been no overruns at the current one.
+     */
+    constexpr bool fits(Timestamp period) const noexcept
+    {
+        return m_count > 0 && m_overruns == 0
+            && static_cast<float>((m_max_response + m_max_stall).count())
+                   <= max_utilization * static_cast<float>(period.count());
+    }
+
+private:
+    Timestamp m_period;
+    std::uint32_t m_count = 0;
+    std::uint32_t m_overruns = 0;
+    Timestamp m_last_start = Timestamp::zero();
+    Timestamp m_max_jitter = Timestamp::zero();
+    Timestamp m_max_latency = Timestamp::zero();
+    Timestamp m_max_response = Timestamp::zero();
+    Timestamp m_max_execution = Timestamp::zero();
+    Timestamp m_min_execution = Timestamp::max();
+    Timestamp m_total_execution = Timestamp::zero();
+    Timestamp m_max_stall = Timestamp::zero();
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_DEADLINE_STATS_H
@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <cstring>
 #include <inttypes.h>
+#include <optional>
 #include <type_traits>
 #include <utility>
 
@@ -87,6 +88,19 @@ struct OnResume : detail::ActionWrapperBase<F>
     OnResume(F &&action) : detail::ActionWrapperBase<F>{std::move(action)} {}
 };
 
+/**
+ * @brief Read a single character from the input if there is one (without waiting for it).
+ */
+inline std::optional<char> read_key() noexcept
+{
+    char c;
+    if (read(STDIN_FILENO, &c, 1) == 1)
+    {
+        return c;
+    }
+    return std::nullopt;
+}
+
 inline void halt() noexcept
 {
     ESP_LOGI("input", "Halt! Waiting for input...");
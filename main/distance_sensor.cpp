@@ -1,164 +1,265 @@
 #include "distance_sensor.h"
 
-#include <misc_utils/angle.h>
+#include <misc_utils/triple_buffer.h>
 
-#include "led_loop_utils.h"
+#include <sdkconfig.h>
 
-#include <Eigen/Dense>
-
-#include <limits>
-#include <numbers>
-#include <ranges>
+#include <algorithm>
+#include <cstddef>
 
 #include <Arduino.h>
 #include <SparkFun_I2C_Mux_Arduino_Library.h>
 #include <SparkFun_VL53L1X.h>
+#include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 using namespace micromouse;
 
-static constexpr auto max_sensor_range = 0.15_m /* 1.3_m / 4 */;
-static constexpr auto max_predict_range = max_sensor_range /* 3.0_m */;
+using Acquisition = SensorAcquisition<QWIICMUX, SFEVL53L1X, DistanceSensors::sensor_count>;
 
-// Sensors disposition relative to the center of rotation in meters.
-static constexpr std::array sensor_disposition{
-    std::pair(XCoord{62.0e-3f}, YCoord{54.0e-3f}),
-    std::pair(XCoord{90.0e-3f}, YCoord{40.0e-3f}),
-    std::pair(XCoord{94.0e-3f}, YCoord{0.0f}),
-    std::pair(XCoord{92.0e-3f}, YCoord{-39.0e-3f}),
-    std::pair(XCoord{67.0e-3f}, YCoord{-54.0e-3f}),
-};
-static_assert(sensor_disposition.size() == DistanceSensors::sensor_count);
-
-// Sensor angles relative to the robot in radians.
-static constexpr std::array sensor_angles{
-    Angle{std::numbers::pi_v<float> / 2},
-    Angle{0.703765f /* std::numbers::pi_v<float> / 4 */},
-    Angle{0.0f},
-    Angle{-0.649649f /* std::numbers::pi_v<float> / 4 */},
-    Angle{-std::numbers::pi_v<float> / 2},
+// A sensor fails after 5 idle periods without a reading, 2 s of identical readings of a target (at 50 Hz - closer than
+// the short distance mode's 1.3 m) or 10 I2C errors in a row. The acquisition task re-initializes it after 100 ms,
+// backing off up to every 2 s.
+static constexpr Acquisition::Health::Config sensor_health{
+    .timeout = Acquisition::Timestamp{500'000},
+    .max_repeats = 100,
+    .no_target = 1'300,
+    .max_errors = 10,
+    .retry_interval = Acquisition::Timestamp{100'000},
+    .max_retry_interval = Acquisition::Timestamp{2'000'000},
 };
-static_assert(sensor_angles.size() == DistanceSensors::sensor_count);
 
-DistanceSensors &DistanceSensors::get_instance() noexcept
+static QWIICMUX mux;
+static SFEVL53L1X current_distance_sensor;
+static Acquisition acquisition{mux, current_distance_sensor, DistanceSensors::ports, sensor_health};
+// The bus the sensors are on, for re-initializing them
+static TwoWire *i2c_bus = nullptr;
+
+// The latest frame, from the acquisition task to `take_frame`.
+static TripleBuffer<DistanceSensors::Frame> frames;
+// The latest timings, from `set_timings` to the acquisition task.
+static TripleBuffer<DistanceSensors::Timings> requested_timings;
+// The sensors' timings, as programmed. Only used by the acquisition task, once it runs.
+static DistanceSensors::Timings sensor_timings;
+// The update rates, from the acquisition task to `take_rates`.
+static TripleBuffer<DistanceSensors::Rates> rates;
+static constexpr Acquisition::Timestamp rates_interval{1'000'000};
+
+static constexpr UBaseType_t acquisition_priority = 5;  // Above the main loop, below the control task
+static constexpr std::uint32_t acquisition_stack_size = 4096;
+
+static Acquisition::Timestamp now() noexcept
 {
-    static QWIICMUX mux;
-    static SFEVL53L1X current_distance_sensor;
-    static constinit DistanceSensors instance(mux, current_distance_sensor);
-    return instance;
+    return Acquisition::Timestamp{esp_timer_get_time()};
 }
 
-void DistanceSensors::init(TwoWire &i2c, Vl53l1cdTimingBudget timing_budget) noexcept
+/**
+ * @brief Program the sensor that the mux is connected to.
+ * The sensor is stopped while it's reprogrammed, so the measurement in progress is lost.
+ */
+static void configure(SFEVL53L1X &sensor, const SensorTiming &timing) noexcept
 {
-    if (!m_mux.begin(QWIIC_MUX_DEFAULT_ADDRESS, i2c))
+    sensor.stopRanging();
+    if (timing.long_range)
+    {
+        sensor.setDistanceModeLong();
+    }
+    else
     {
-        led::infinite_loop([] { ESP_LOGE("sensor", "Mux failed to begin. Please check wiring. Freezing..."); });
+        sensor.setDistanceModeShort();
     }
+    sensor.setTimingBudgetInMs(timing.budget);
+    // Intermeasurement period must be >= timing budget. Default = 100 ms.
+    sensor.setIntermeasurementPeriod(std::max(timing.period, timing.budget));
+    sensor.startRanging();
+}
 
-    for (auto &&sensor : m_sensors)
+/**
+ * @brief Reprogram the sensors whose timing changed. A sensor that the mux fails to connect keeps its timing until
+ * the next request.
+ */
+static void apply_timings(const DistanceSensors::Timings &timings) noexcept
+{
+    for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
     {
-        m_mux.setPort(sensor.port);
-        if (m_current_distance_sensor.begin(i2c) != 0)  // Begin returns 0 on a good init
+        if (timings[i] != sensor_timings[i]
+            && acquisition.with_sensor(i, [&](SFEVL53L1X &sensor) { configure(sensor, timings[i]); }))
         {
-            led::infinite_loop(
-                [&]
-                {
-                    ESP_LOGE(
-                        "sensor",
-                        "Sensor at port %d failed to begin. Please check wiring. Freezing...",
-                        sensor.port
-                    );
-                }
-            );
+            sensor_timings[i] = timings[i];
         }
+    }
+    acquisition.set_pacing(SensorTimingPolicy<DistanceSensors::sensor_count>::pacing(sensor_timings));
+}
 
-        m_current_distance_sensor.setDistanceModeShort();
-        m_current_distance_sensor.setTimingBudgetInMs(timing_budget);
-        // Intermeasurement period must be >= timing budget. Default = 100 ms.
-        m_current_distance_sensor.setIntermeasurementPeriod(timing_budget);
-        m_current_distance_sensor.startRanging();  // Start only once (and never call stop)
-
-        ESP_LOGI("sensor", "Sensor at port %d is online!", sensor.port);
+/**
+ * @brief Begin the sensor that the mux is connected to and program its timing.
+ *
+ * @return Whether the sensor began.
+ */
+static bool start_sensor(SFEVL53L1X &sensor, const SensorTiming &timing) noexcept
+{
+    if (sensor.begin(*i2c_bus) != 0)  // Begin returns 0 on a good init
+    {
+        return false;
     }
+    configure(sensor, timing);
+    return true;
 }
 
-std::array<meters, DistanceSensors::sensor_count> DistanceSensors::read_all()
+/**
+ * @brief Re-initialize the failed sensors that are due for it, and log the sensors that failed or recovered.
+ */
+static void monitor_health() noexcept
 {
-    static constinit std::array<meters, DistanceSensors::sensor_count> measurements;
-    for (std::size_t i = 0; i < sensor_count; i++)
+    static auto healthy = acquisition.health().healthy();
+    acquisition.recover(now(), [](SFEVL53L1X &sensor, std::size_t i) { return start_sensor(sensor, sensor_timings[i]); });
+    const auto current = acquisition.health().healthy();
+    for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
     {
-        m_mux.setPort(m_sensors[i].port);
-        while (!m_current_distance_sensor.checkForDataReady())
+        if (healthy.test(i) && !current.test(i))
         {
-            delay(1);
+            ESP_LOGW(
+                "sensor",
+                "Sensor at port %d failed (%s), continuing without it",
+                DistanceSensors::ports[i],
+                enum2str(acquisition.health().fault(i))
+            );
+        }
+        else if (!healthy.test(i) && current.test(i))
+        {
+            ESP_LOGI("sensor", "Sensor at port %d recovered", DistanceSensors::ports[i]);
         }
-
-        // Get the result of the measurement from the sensor:
-        m_sensors[i].distance = m_current_distance_sensor.getDistance();
-        m_current_distance_sensor.clearInterrupt();
-        measurements[i] = m_sensors[i].get_distance();
     }
+    healthy = current;
+}
 
-    return measurements;
+/**
+ * @brief Poll the sensors every millisecond (a FreeRTOS tick) and publish the complete frames, apply the requested
+ * timings and re-initialize failed sensors between polls and publish the update rates every `rates_interval`.
+ * The sensors' interrupt pins aren't connected, so there are no data ready interrupts to wait for.
+ */
+static void acquisition_loop(void *) noexcept
+{
+    auto rates_start = now();
+    auto rates_readings = acquisition.stats().readings;
+    while (true)
+    {
+        if (const auto timings = requested_timings.take())
+        {
+            apply_timings(*timings);
+        }
+        monitor_health();
+        if (const auto frame = acquisition.poll(now()))
+        {
+            frames.write(*frame);
+        }
+        if (const auto elapsed = now() - rates_start; elapsed >= rates_interval)
+        {
+            const auto &readings = acquisition.stats().readings;
+            auto &sensor_rates = rates.write_buffer();
+            for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+            {
+                sensor_rates[i] = static_cast<float>(readings[i] - rates_readings[i]) * 1e6f / elapsed.count();
+            }
+            rates.publish();
+            rates_start += elapsed;
+            rates_readings = readings;
+        }
+        vTaskDelay(1);
+    }
 }
 
-static auto predict_distance(const Position &pos, std::size_t sensor_index, const std::span<const Segment> &maze_map)
-    noexcept
+DistanceSensors &DistanceSensors::get_instance() noexcept
 {
-    const auto ray_x = pos.x.get() + sensor_disposition[sensor_index].first.get() * std::cos(pos.theta)
-                     - sensor_disposition[sensor_index].second.get() * std::sin(pos.theta);
-    const auto ray_y = pos.y.get() + sensor_disposition[sensor_index].first.get() * std::sin(pos.theta)
-                     + sensor_disposition[sensor_index].second.get() * std::cos(pos.theta);
-    const auto sensor_angle = pos.theta + sensor_angles[sensor_index];
-    const Segment sensor_ray{
-        Eigen::Vector2f{ray_x.count(), ray_y.count()},
-        Eigen::Vector2f{
-            (ray_x + max_predict_range * std::cos(sensor_angle)).count(),
-            (ray_y + max_predict_range * std::sin(sensor_angle)).count(),
-        },
-    };
-
-    auto make_result = [&](const auto &wall)
-    { return std::pair<meters, const Segment &>(sensor_ray.intersection_distance(wall), wall); };
-
-    auto all_distances = maze_map | std::views::transform(make_result);
-    return *std::ranges::min_element(all_distances, [](const auto &a, const auto &b) { return a.first < b.first; });
+    static constinit DistanceSensors instance(mux, current_distance_sensor);
+    return instance;
 }
 
-std::pair<DistanceSensors::Measurements, DistanceSensors::Jacobian> DistanceSensors::predict(
-    const Position &pos,
-    const std::span<const Segment> &maze_map
-) noexcept
+void DistanceSensors::init(TwoWire &i2c, Vl53l1cdTimingBudget timing_budget) noexcept
 {
-    Measurements error = Measurements::Zero();
-    Jacobian jacobian = Jacobian::Zero();
+    i2c_bus = &i2c;
+    if (!m_mux.begin(QWIIC_MUX_DEFAULT_ADDRESS, i2c))
+    {
+        // The mux only remembers the bus, so the sensors are still retried in the background.
+        ESP_LOGE("sensor", "Mux failed to begin. Please check wiring. Continuing without the sensors...");
+    }
+
+    const SensorTiming initial_timing{.budget = timing_budget, .period = timing_budget, .long_range = false};
+    sensor_timings.fill(initial_timing);
     for (std::size_t i = 0; i < sensor_count; i++)
     {
-        const auto measured = m_sensors[i].get_distance();
-        if (measured > max_sensor_range)
+        const auto port = ports[i];
+        if (!m_mux.setPort(port) || !start_sensor(m_current_distance_sensor, initial_timing))
         {
+            ESP_LOGE(
+                "sensor",
+                "Sensor at port %d failed to begin. Please check wiring. Continuing without it...",
+                port
+            );
+            acquisition.fail(i, SensorFault::InitFailed, now());
             continue;
         }
 
-        const auto [distance, wall] = predict_distance(pos, i, maze_map);
-        if (distance > max_predict_range)
+        ESP_LOGI("sensor", "Sensor at port %d is online!", port);
+    }
+}
+
+std::optional<DistanceSensors::Frame> DistanceSensors::read_all() noexcept
+{
+    auto frame = acquisition.poll(now());
+    while (!frame)
+    {
+        if (acquisition.health().healthy().none())
         {
-            continue;
+            return std::nullopt;
         }
+        delay(1);
+        frame = acquisition.poll(now());
+    }
+    update(*frame);
+    return frame;
+}
+
+void DistanceSensors::start_acquisition() noexcept
+{
+    const auto res = xTaskCreatePinnedToCore(
+        acquisition_loop,
+        "sensors",
+        acquisition_stack_size,
+        nullptr,
+        acquisition_priority,
+        nullptr,
+        CONFIG_SENSOR_TASK_CORE
+    );
+    ESP_ERROR_CHECK(res == pdPASS ? ESP_OK : ESP_ERR_NO_MEM);
+}
 
-        const auto wall_coefficients = wall.line().coeffs();
-        const auto A = wall_coefficients.x();
-        const auto B = wall_coefficients.y();
-        const auto C = wall_coefficients.z();
-        const auto theta = pos.theta + sensor_angles[i];
-        const auto denominator = A * std::cos(theta) + B * std::sin(theta);
-
-        error(i) = (measured - distance).count();
-        jacobian(i, 0) = -A / denominator;  // Partial derivative w.r.t. x
-        jacobian(i, 1) = -B / denominator;  // Partial derivative w.r.t. y
-        jacobian(i, 2) = (A * pos.x->count() + B * pos.y->count() + C) * (B * std::cos(theta) - A * std::sin(theta))
-                       / std::pow(denominator, 2);  // Partial derivative w.r.t. theta
+std::optional<DistanceSensors::Frame> DistanceSensors::take_frame() noexcept
+{
+    if (!frames.update())
+    {
+        return std::nullopt;
     }
+    update(frames.read());
+    return frames.read();
+}
+
+void DistanceSensors::set_timings(const Timings &timings) noexcept
+{
+    requested_timings.write(timings);
+}
 
-    return std::pair(error, jacobian);
+std::optional<DistanceSensors::Rates> DistanceSensors::take_rates() noexcept
+{
+    return rates.take();
+}
+
+DistanceSensors::Readings DistanceSensors::update(const Frame &frame) noexcept
+{
+    m_healthy = frame.healthy;
+    m_filters.update(frame);
+    return m_filters.readings();
 }
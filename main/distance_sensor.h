@@ -6,10 +6,15 @@
 #include "average_filter.h"
 #include "position.h"
 #include "segment.h"
+#include "sensor_acquisition.h"
+#include "sensor_timing.h"
 
 #include <Eigen/Core>
 
 #include <array>
+#include <bitset>
+#include <cstdint>
+#include <optional>
 #include <span>
 #include <vector>
 
@@ -32,9 +37,60 @@ class DistanceSensors
 {
 public:
     static constexpr auto sensor_count = 5;
-    static constexpr auto avg_filter_size = 1;
+    // Every reading goes through a Hampel filter, which replaces outliers (like a reflection that reads far beyond the
+    // wall) with the median of the last `filter_window` readings.
+    static constexpr auto filter_window = 5;
+    using Filter = filter_pipeline<hampel_filter<std::uint16_t, filter_window>>;
+    static constexpr hampel_filter<std::uint16_t, filter_window>::config outlier_config{
+        .threshold = 3.0f,
+        .min_deviation = 10,  // [mm] Well above the sensors' noise at short range
+    };
+    using Readings = std::array<micromouse::meters, sensor_count>;
     using Measurements = Eigen::Vector<float, sensor_count>;
     using Jacobian = Eigen::Matrix<float, sensor_count, 3>;
+    using Frame = micromouse::SensorFrame<sensor_count>;
+    using Timings = micromouse::SensorTimingPolicy<sensor_count>::Timings;
+    using Rates = std::array<float, sensor_count>;  // [Hz]
+
+    static constexpr std::array<std::uint8_t, sensor_count> ports{1, 2, 3, 4, 5};  // On the mux
+
+    /**
+     * @brief Every sensor's `Filter`, fed with the fresh readings of each frame. Doesn't touch the hardware, so the
+     * host can replay recorded frames through it too.
+     */
+    class Filters
+    {
+    public:
+        constexpr void update(const Frame &frame) noexcept
+        {
+            for (std::size_t i = 0; i < sensor_count; i++)
+            {
+                if (frame.fresh.test(i))  // Stale readings would count twice in the filter's window.
+                {
+                    m_filters[i](frame.distances[i]);
+                }
+            }
+        }
+
+        constexpr Readings readings() const noexcept
+        {
+            Readings res;
+            for (std::size_t i = 0; i < sensor_count; i++)
+            {
+                res[i] = unit_cast<micromouse::meters>(micromouse::millimeters{m_filters[i].value()});
+            }
+            return res;
+        }
+
+    private:
+        std::array<Filter, sensor_count> m_filters{
+            Filter{hampel_filter<std::uint16_t, filter_window>{outlier_config}},
+            Filter{hampel_filter<std::uint16_t, filter_window>{outlier_config}},
+            Filter{hampel_filter<std::uint16_t, filter_window>{outlier_config}},
+            Filter{hampel_filter<std::uint16_t, filter_window>{outlier_config}},
+            Filter{hampel_filter<std::uint16_t, filter_window>{outlier_config}},
+        };
+    };
 
     DistanceSensors(const DistanceSensors &) = delete;
     DistanceSensors(DistanceSensors &&) = delete;
@@ -43,9 +99,62 @@ public:
     ~DistanceSensors() noexcept = default;
 
     static DistanceSensors &get_instance() noexcept;
+
+    /**
+     * @brief Begin the mux and the sensors. A sensor that fails to begin is left out (see `healthy`) and retried in
+     * the background once the acquisition starts.
+     */
     void init(TwoWire &i2c, Vl53l1cdTimingBudget timing_budget = VL53L1CD_TimingBudget_20ms) noexcept;
 
-    std::array<micromouse::meters, sensor_count> read_all() noexcept;
+    /**
+     * @brief Wait for a new measurement from every healthy sensor (blocking), and update the readings with it.
+     * Only before `start_acquisition`.
+     *
+     * @return The new frame, or nothing (right away) if every sensor failed.
+     */
+    std::optional<Frame> read_all() noexcept;
+
+    /**
+     * @brief Start reading the sensors in the background: a task polls them (see `SensorAcquisition`) and publishes a
+     * frame whenever all of them have a new measurement. The task also monitors the sensors' health: a sensor that
+     * times out, gets stuck or keeps failing on the bus is left out of the frames and re-initialized every once in a
+     * while until it recovers.
+     */
+    void start_acquisition() noexcept;
+
+    /**
+     * @brief Update the readings with the latest frame from the acquisition task, if there is a new one since the last
+     * call. Never blocks.
+     * The frames are handed over through a `TripleBuffer`, so this must always be called from the same task, and the
+     * readings must only be used by that task.
+     *
+     * @return The new frame.
+     */
+    std::optional<Frame> take_frame() noexcept;
+
+    /**
+     * @brief Reprogram the sensors whose timing changed. The acquisition task applies the latest timings before its
+     * next poll, and paces the frames by the fastest sensors (see `SensorTimingPolicy::pacing`). Never blocks.
+     * Must always be called from the same task.
+     */
+    void set_timings(const Timings &timings) noexcept;
+
+    /**
+     * @brief Every sensor's readings per second (over the last second), once a second. Never blocks.
+     * Must always be called from the same task.
+     */
+    std::optional<Rates> take_rates() noexcept;
+
+    /**
+     * @brief The latest (filtered) readings, without accessing the sensors.
+     * A failed sensor keeps its last reading, so check `healthy` before trusting it.
+     */
+    Readings readings() const noexcept;
+
+    /**
+     * @brief The sensors that weren't failed in the latest frame.
+     */
+    constexpr std::bitset<sensor_count> healthy() const noexcept { return m_healthy; }
 
     std::pair<Measurements, Jacobian> predict(
         const micromouse::Position &pos,
@@ -59,22 +168,12 @@ private:
     {
     }
 
-    struct Sensor
-    {
-        explicit constexpr Sensor(std::uint8_t port_number) noexcept : port{port_number} {}
-
-        constexpr auto get_distance() const noexcept
-        {
-            return unit_cast<micromouse::meters>(micromouse::millimeters{distance});
-        }
-
-        avg_filter<std::uint16_t, avg_filter_size, int> distance;
-        const std::uint8_t port;
-    };
+    Readings update(const Frame &frame) noexcept;
 
     QWIICMUX &m_mux;
     SFEVL53L1X &m_current_distance_sensor;
-    std::array<Sensor, sensor_count> m_sensors{Sensor{1}, Sensor{2}, Sensor{3}, Sensor{4}, Sensor{5}};
+    std::bitset<sensor_count> m_healthy{~0ULL};
+    Filters m_filters;
 };
 
 #endif  // MAIN_DISTANCE_SENSOR_H
@@ -0,0 +1,115 @@
+#include "distance_sensor_model.h"
+
+#include <misc_utils/fast_math.h>
+
+#include <Eigen/Dense>
+
+#include <ranges>
+
+namespace micromouse
+{
+
+static auto predict_distance(
+    const Position &pos,
+    std::size_t sensor_index,
+    const std::span<const Segment> &maze_map,
+    meters range = max_predict_range
+) noexcept
+{
+    const auto [sin_theta, cos_theta] = fast::sincos(pos.theta);
+    const auto ray_x = pos.x.get() + sensor_disposition[sensor_index].first.get() * cos_theta
+                     - sensor_disposition[sensor_index].second.get() * sin_theta;
+    const auto ray_y = pos.y.get() + sensor_disposition[sensor_index].first.get() * sin_theta
+                     + sensor_disposition[sensor_index].second.get() * cos_theta;
+    const auto [sin_sensor, cos_sensor] = fast::sincos(pos.theta + sensor_angles[sensor_index]);
+    const Segment sensor_ray{
+        Eigen::Vector2f{ray_x.count(), ray_y.count()},
+        Eigen::Vector2f{
+            (ray_x + range * cos_sensor).count(),
+            (ray_y + range * sin_sensor).count(),
+        },
+    };
+
+    auto make_result = [&](const auto &wall)
+    { return std::pair<meters, const Segment &>(sensor_ray.intersection_distance(wall), wall); };
+
+    auto all_distances = maze_map | std::views::transform(make_result);
+    return *std::ranges::min_element(all_distances, [](const auto &a, const auto &b) { return a.first < b.first; });
+}
+
+ReadingsPrediction predict_readings(
+    const Position &pos,
+    const DistanceSensors::Readings &readings,
+    const std::span<const Segment> &maze_map
+) noexcept
+{
+    ReadingsPrediction prediction{
+        .error = DistanceSensors::Measurements::Zero(),
+        .jacobian = DistanceSensors::Jacobian::Zero(),
+        .valid = {},
+    };
+    auto &error = prediction.error;
+    auto &jacobian = prediction.jacobian;
+    for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+    {
+        const auto measured = readings[i];
+        if (measured > max_sensor_range)
+        {
+            continue;
+        }
+
+        const auto [distance, wall] = predict_distance(pos, i, maze_map);
+        if (distance > max_predict_range)
+        {
+            continue;
+        }
+
+        const auto wall_coefficients = wall.line().coeffs();
+        const auto A = wall_coefficients.x();
+        const auto B = wall_coefficients.y();
+        const auto C = wall_coefficients.z();
+        const auto [sin_theta, cos_theta] = fast::sincos(pos.theta + sensor_angles[i]);
+        const auto denominator = A * cos_theta + B * sin_theta;
+
+        error(i) = (measured - distance).count();
+        jacobian(i, 0) = -A / denominator;  // Partial derivative w.r.t. x
+        jacobian(i, 1) = -B / denominator;  // Partial derivative w.r.t. y
+        jacobian(i, 2) = (A * pos.x->count() + B * pos.y->count() + C) * (B * cos_theta - A * sin_theta)
+                       / fast::square(denominator);  // Partial derivative w.r.t. theta
+        prediction.valid.set(i);
+    }
+
+    return prediction;
+}
+
+std::bitset<DistanceSensors::sensor_count> expected_walls(
+    const Position &pos,
+    const std::span<const Segment> &maze_map,
+    meters range
+) noexcept
+{
+    std::bitset<DistanceSensors::sensor_count> walls;
+    for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+    {
+        walls.set(i, predict_distance(pos, i, maze_map, range).first <= range);
+    }
+    return walls;
+}
+
+}  // namespace micromouse
+
+using namespace micromouse;
+
+DistanceSensors::Readings DistanceSensors::readings() const noexcept
+{
+    return m_filters.readings();
+}
+
+std::pair<DistanceSensors::Measurements, DistanceSensors::Jacobian> DistanceSensors::predict(
+    const Position &pos,
+    const std::span<const Segment> &maze_map
+) noexcept
+{
+    const auto prediction = predict_readings(pos, readings(), maze_map);
+    return {prediction.error, prediction.jacobian};
+}
@@ -0,0 +1,80 @@
+#ifndef MAIN_DISTANCE_SENSOR_MODEL_H
+#define MAIN_DISTANCE_SENSOR_MODEL_H
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "distance_sensor.h"
+#include "position.h"
+#include "segment.h"
+
+#include <array>
+#include <bitset>
+#include <numbers>
+#include <span>
+#include <utility>
+
+namespace micromouse
+{
+
+inline constexpr auto max_sensor_range = 0.15_m /* 1.3_m / 4 */;
+inline constexpr auto max_predict_range = max_sensor_range /* 3.0_m */;
+
+// Sensors disposition relative to the center of rotation in meters.
+inline constexpr std::array sensor_disposition{
+    std::pair(XCoord{62.0e-3f}, YCoord{54.0e-3f}),
+    std::pair(XCoord{90.0e-3f}, YCoord{40.0e-3f}),
+    std::pair(XCoord{94.0e-3f}, YCoord{0.0f}),
+    std::pair(XCoord{92.0e-3f}, YCoord{-39.0e-3f}),
+    std::pair(XCoord{67.0e-3f}, YCoord{-54.0e-3f}),
+};
+static_assert(sensor_disposition.size() == DistanceSensors::sensor_count);
+
+// Sensor angles relative to the robot in radians.
+inline constexpr std::array sensor_angles{
+    Angle{std::numbers::pi_v<float> / 2},
+    Angle{0.703765f /* std::numbers::pi_v<float> / 4 */},
+    Angle{0.0f},
+    Angle{-0.649649f /* std::numbers::pi_v<float> / 4 */},
+    Angle{-std::numbers::pi_v<float> / 2},
+};
+static_assert(sensor_angles.size() == DistanceSensors::sensor_count);
+
+/**
+ * @brief The readings expected at a position, compared with the actual ones (see `predict_readings`).
+ */
+struct ReadingsPrediction
+{
+    DistanceSensors::Measurements error;               // Each reading's, minus its prediction
+    DistanceSensors::Jacobian jacobian;                // Of the predictions with respect to the position vector
+    std::bitset<DistanceSensors::sensor_count> valid;  // The sensors with a valid reading and prediction
+};
+
+/**
+ * @brief Compare distance sensor readings with the readings expected at a position (by casting the sensor rays on the
+ * map).
+ *
+ * @param pos The position to predict the readings at.
+ * @param readings The actual sensor readings.
+ * @param maze_map The walls to cast the sensor rays on.
+ * @return The prediction. Sensors without a valid reading or prediction have zero error and a zero jacobian row, so
+ * they add nothing to an update (and aren't in its degrees of freedom).
+ */
+ReadingsPrediction predict_readings(
+    const Position &pos,
+    const DistanceSensors::Readings &readings,
+    const std::span<const Segment> &maze_map
+) noexcept;
+
+/**
+ * @brief The sensors that would see a wall of the map within `range`, at a position.
+ */
+std::bitset<DistanceSensors::sensor_count> expected_walls(
+    const Position &pos,
+    const std::span<const Segment> &maze_map,
+    meters range
+) noexcept;
+
+}  // namespace micromouse
+
+#endif  // MAIN_DISTANCE_SENSOR_MODEL_H
@@ -0,0 +1,342 @@
+#ifndef MAIN_FLIGHT_LOG_H
+#define MAIN_FLIGHT_LOG_H
+
+#include <misc_utils/crc.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+namespace micromouse::flight_log
+{
+
+inline constexpr std::size_t sensor_count = 5;
+
+/**
+ * @brief Everything the PID loop saw and did in one tick: the pose estimator's inputs and outputs (enough to replay it,
+ * see `FlightReplay`) and the controller's outputs.
+ *
+ * Like `telemetry::Record`, the layout has no padding and is the same on the ESP32 and on the host. Bump `version`
+ * when changing it.
+ */
+struct Record
+{
+    std::uint32_t time;                                 // [us] Since boot
+    std::array<std::uint16_t, sensor_count> distances;  // [mm] The latest sensor frame's (unfiltered)
+    std::uint8_t fresh;                                 // The readings that are new in this tick (bit per sensor)
+    std::uint8_t healthy;                               // The healthy sensors (bit per sensor)
+    std::int32_t left_ticks;                            // The encoders' counts
+    std::int32_t right_ticks;
+    float left_velocity;                                // [m/s] The motion model's input
+    float right_velocity;                               // [m/s]
+    float process_noise_scale;                          // The EKF's (see `KalmanFilter::set_process_noise_scale`)
+    float prior_x;                                      // [m] The pose the tick started from (after a reset)
+    float prior_y;                                      // [m]
+    float prior_theta;                                  // [rad]
+    float x;                                            // [m] The estimated pose
+    float y;                                            // [m]
+    float theta;                                        // [rad]
+    float x_variance;                                   // [m^2] The EKF's covariance diagonal
+    float y_variance;                                   // [m^2]
+    float theta_variance;                               // [rad^2]
+    float innovation;                                   // The EKF's latest normalized innovation squared
+    float left_wanted_velocity;                         // [m/s]
+    float right_wanted_velocity;                        // [m/s]
+    float left_output;                                  // [ticks] PWM duty
+    float right_output;                                 // [ticks] PWM duty
+    std::uint32_t flags;                                // `frame_flag`, `warmup_flag`
+};
+inline constexpr std::uint32_t frame_flag = 1U << 0;  // A sensor frame was taken in this tick.
+// Not a tick: a frame taken before the run to fill the sensors' filters (see `DistanceSensors::filter_window`). Only
+// the time and the frame are set.
+inline constexpr std::uint32_t warmup_flag = 1U << 1;
+static_assert(sizeof(Record) == 96);
+static_assert(std::is_trivially_copyable_v<Record>);
+static_assert(std::endian::native == std::endian::little);
+
+/**
+ * The log is a series of blocks, one per flash sector, written in order from the start of the partition until it's
+ * full or the run ends. The rest of the partition stays erased (all ones), which is where a reader stops.
+ *
+ * Each block is a header and up to `records_per_block` records (the last block of a run may be partial).
+ */
+struct BlockHeader
+{
+    std::uint32_t magic;
+    std::uint8_t version;
+    std::uint8_t record_size;
+    std::uint16_t count;     // Records in the block
+    std::uint32_t sequence;  // The block's index
+    std::uint16_t dropped;   // Records dropped right after this block's (saturates)
+    std::uint16_t crc;       // CRC-16 of the header before it and the records
+};
+static_assert(sizeof(BlockHeader) == 16);
+
+inline constexpr std::uint32_t magic = 0x4c464d4d;  // "MMFL"
+inline constexpr std::uint8_t version = 3;
+inline constexpr std::size_t block_size = 4096;  // The flash's sector (the erase unit)
+inline constexpr std::size_t write_size = 256;   // The flash's page (the program unit)
+inline constexpr std::size_t records_per_block = (block_size - sizeof(BlockHeader)) / sizeof(Record);
+static_assert(block_size % write_size == 0);
+
+using Block = std::array<std::uint8_t, block_size>;
+
+constexpr std::uint16_t block_crc(const Block &block, std::size_t count) noexcept
+{
+    const std::span data{block};
+    const auto crc = crc16(data.first(offsetof(BlockHeader, crc)));
+    return crc16(data.subspan(sizeof(BlockHeader), count * sizeof(Record)), crc);
+}
+
+/**
+ * @brief Records every tick into flash without blocking the tick.
+ *
+ * The records fill one block in RAM while the other block (if full) is written by a low-priority writer, a page at a
+ * time (see `write_some`). If the writer falls behind, both blocks are full and the new records are dropped (and
+ * counted in the full block's header) rather than waiting for the flash. Same when the log is full.
+ *
+ * `record` and `finish` must be called from one task at a time (e.g. the warmup's, then the PID loop's once it starts),
+ * and `write_some` from one (maybe other) task. `start` must be called before both (it erases the previous log).
+ *
+ * @tparam Storage The flash partition: `size()`, `read(offset, span)`, `write(offset, span)` and
+ * `erase(offset, size)` (the last three return whether they succeeded). Erases are block aligned and writes are page
+ * aligned.
+ */
+template <typename Storage>
+class Recorder
+{
+public:
+    struct Stats
+    {
+        std::uint32_t records;  // Recorded (in RAM)
+        std::uint32_t dropped;
+        std::uint32_t blocks;  // Written to the flash
+        std::uint32_t write_errors;
+    };
+
+    explicit Recorder(Storage &storage) noexcept : m_storage{storage} {}
+
+    /**
+     * @brief Erase the previous log (as far as it got) and start recording.
+     *
+     * @return Whether the erase succeeded (if not, nothing is recorded).
+     */
+    bool start() noexcept
+    {
+        m_capacity = m_storage.size() / block_size;
+        // The previous log ends at the first erased block. Erase one more, in case it was cut in the middle.
+        std::size_t used = 0;
+        BlockHeader header;
+        const std::span header_bytes{reinterpret_cast<std::uint8_t *>(&header), sizeof(header)};
+        while (used < m_capacity && m_storage.read(used * block_size, header_bytes) && header.magic != ~0U)
+        {
+            used++;
+        }
+        const auto erase = std::min(used + 1, m_capacity) * block_size;
+        if (erase > 0 && !m_storage.erase(0, erase))
+        {
+            return false;
+        }
+        m_started = true;
+        return true;
+    }
+
+    /**
+     * @brief Add a tick's record.
+     */
+    void record(const Record &record) noexcept
+    {
+        if (!m_started)
+        {
+            return;
+        }
+        // Once the last block is sealed, the log is full.
+        if ((m_count == records_per_block && !seal()) || m_sequence == m_capacity)
+        {
+            m_stats.dropped++;
+            m_dropped++;
+            return;
+        }
+        std::memcpy(&m_blocks[m_active][sizeof(BlockHeader) + m_count * sizeof(Record)], &record, sizeof(Record));
+        m_count++;
+        m_stats.records++;
+    }
+
+    /**
+     * @brief Hand the partial block to the writer, e.g. when the run ends (recording can continue after it).
+     *
+     * @return Whether there's nothing left for the writer to take (if not, call again after `write_some`).
+     */
+    bool finish() noexcept { return m_count == 0 || seal(); }
+
+    /**
+     * @brief Write the next page of the full block, if there is one.
+     *
+     * @return Whether there's more to write.
+     */
+    bool write_some() noexcept
+    {
+        if (!m_pending.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        auto &block = m_blocks[m_pending_index];
+        BlockHeader header;
+        std::memcpy(&header, block.data(), sizeof(header));
+        if (m_written == 0)
+        {
+            // Here rather than in `seal`, to keep the CRC out of the tick.
+            header.crc = block_crc(block, header.count);
+            std::memcpy(block.data(), &header, sizeof(header));
+        }
+        const auto size = sizeof(BlockHeader) + header.count * sizeof(Record);
+        if (!m_storage.write(
+                header.sequence * block_size + m_written,
+                std::span{block}.subspan(m_written, write_size)
+            ))
+        {
+            // Give up on the block (a reader won't accept it).
+            m_write_errors.fetch_add(1, std::memory_order_relaxed);
+            m_written = block_size;
+        }
+        else
+        {
+            m_written += write_size;
+        }
+        if (m_written < size)
+        {
+            return true;
+        }
+        m_written = 0;
+        m_written_blocks.fetch_add(1, std::memory_order_relaxed);
+        m_pending.store(false, std::memory_order_release);
+        return false;
+    }
+
+    /**
+     * @brief Whether every finished block was written.
+     */
+    bool flushed() const noexcept { return !m_pending.load(std::memory_order_acquire); }
+
+    /**
+     * @brief The statistics. `records` and `dropped` are exact for the recording task (or while it doesn't record).
+     */
+    Stats stats() const noexcept
+    {
+        auto stats = m_stats;
+        stats.blocks = m_written_blocks.load(std::memory_order_relaxed);
+        stats.write_errors = m_write_errors.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    /**
+     * @brief Hand the active block to the writer and switch to the other one.
+     *
+     * @return Whether the active block is empty now (if not, the writer is busy).
+     */
+    bool seal() noexcept
+    {
+        if (m_pending.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        const BlockHeader header{
+            .magic = magic,
+            .version = version,
+            .record_size = sizeof(Record),
+            .count = static_cast<std::uint16_t>(m_count),
+            .sequence = m_sequence++,
+            .dropped = static_cast<std::uint16_t>(std::min<std::uint32_t>(m_dropped, UINT16_MAX)),
+            .crc = 0,
+        };
+        auto &block = m_blocks[m_active];
+        std::memcpy(block.data(), &header, sizeof(header));
+        // The unused records stay erased (no need to program them).
+        std::fill(block.begin() + sizeof(header) + m_count * sizeof(Record), block.end(), 0xff);
+        m_pending_index = m_active;
+        m_pending.store(true, std::memory_order_release);
+        m_active ^= 1;
+        m_count = 0;
+        m_dropped = 0;
+        return true;
+    }
+
+    Storage &m_storage;
+    std::size_t m_capacity = 0;  // [blocks]
+    bool m_started = false;
+
+    alignas(4) std::array<Block, 2> m_blocks;
+
+    // The recording task's
+    std::size_t m_active = 0;
+    std::size_t m_count = 0;  // Records in the active block
+    std::uint32_t m_sequence = 0;
+    std::uint32_t m_dropped = 0;  // Since the last block
+    Stats m_stats{};
+
+    // The handoff
+    std::atomic<bool> m_pending = false;
+    std::size_t m_pending_index = 0;
+
+    // The writer's
+    std::size_t m_written = 0;  // Of the pending block
+    std::atomic<std::uint32_t> m_written_blocks = 0;
+    std::atomic<std::uint32_t> m_write_errors = 0;
+};
+
+struct ReadStats
+{
+    std::uint32_t blocks;
+    std::uint32_t records;
+    std::uint32_t dropped;     // As counted by the recorder (up to 65535 after each block)
+    std::uint32_t bad_blocks;  // The wrong version or record size, or a CRC mismatch
+};
+
+/**
+ * @brief Read a log from a copy of its partition.
+ *
+ * @param on_record Called with every record (in order) and its block's index.
+ */
+template <typename OnRecord>
+ReadStats read(std::span<const std::uint8_t> image, OnRecord &&on_record) noexcept
+{
+    ReadStats stats{};
+    Block block;
+    for (std::uint32_t i = 0; (i + 1) * block_size <= image.size(); i++)
+    {
+        std::memcpy(block.data(), &image[i * block_size], block_size);
+        BlockHeader header;
+        std::memcpy(&header, block.data(), sizeof(header));
+        if (header.magic != magic || header.sequence != i)
+        {
+            break;  // The end of the log
+        }
+        if (header.version != version || header.record_size != sizeof(Record) || header.count > records_per_block
+            || block_crc(block, header.count) != header.crc)
+        {
+            stats.bad_blocks++;
+            continue;
+        }
+        stats.blocks++;
+        stats.dropped += header.dropped;
+        for (std::size_t j = 0; j < header.count; j++)
+        {
+            Record record;
+            std::memcpy(&record, &block[sizeof(BlockHeader) + j * sizeof(Record)], sizeof(Record));
+            on_record(record, i);
+            stats.records++;
+        }
+    }
+    return stats;
+}
+
+}  // namespace micromouse::flight_log
+
+#endif  // MAIN_FLIGHT_LOG_H
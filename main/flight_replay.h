@@ -0,0 +1,147 @@
+#ifndef MAIN_FLIGHT_REPLAY_H
+#define MAIN_FLIGHT_REPLAY_H
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "distance_sensor.h"
+#include "flight_log.h"
+#include "pose_estimator.h"
+#include "position.h"
+#include "segment.h"
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+
+namespace micromouse
+{
+
+/**
+ * @brief Replays a flight log (see `flight_log::Record`) through the pose estimator, one record at a time.
+ *
+ * Feeds each tick's recorded inputs (the wheels' velocities, the EKF's process noise scale and the sensor frame) to
+ * the same `DistanceSensors::Filters` and `PoseEstimator` as the firmware, so replaying a log reproduces the recorded
+ * poses (up to the floating point differences between the ESP32 and the host, e.g. fused multiply-adds), and
+ * replaying it with other code shows what that code would have estimated. Nothing depends on the wall clock, so
+ * replaying the same log with the same code gives the same results, bit for bit.
+ *
+ * The pose is the replay's own, except where the firmware reset it (e.g. snapping to a waypoint): a record whose
+ * prior pose isn't the previous record's pose starts from the recorded prior pose.
+ *
+ * The log starts with the frames that filled the filters before the run (see `flight_log::warmup_flag`). They only
+ * go into the filters, and have no output.
+ */
+class FlightReplay
+{
+public:
+    struct Output
+    {
+        std::uint32_t time;  // [us] The record's
+        Position pos;
+        std::array<float, 3> variance;  // The EKF's covariance diagonal (x, y, theta)
+        float innovation;               // The EKF's latest normalized innovation squared
+        PoseEstimator::Update update;
+    };
+
+    /**
+     * @param maze_map The walls the firmware casts the sensor rays on.
+     * @param period The PID loop's period (the records don't have it). Converted from microseconds like the
+     * firmware's `pid_loop_period`, to get the same bits.
+     * @param corridor_gain The firmware's (see `PoseEstimator`).
+     */
+    FlightReplay(
+        std::span<const Segment> maze_map,
+        const seconds &period,
+        float corridor_gain = PoseEstimator::default_corridor_gain
+    ) noexcept
+        : m_pose_estimator{maze_map, corridor_gain}
+        , m_period{period}
+    {
+    }
+
+    /**
+     * @return The tick's estimate, or nothing for a warmup frame.
+     */
+    std::optional<Output> operator()(const flight_log::Record &record) noexcept
+    {
+        if (record.flags & flight_log::warmup_flag)
+        {
+            m_filters.update(frame(record));
+            return std::nullopt;
+        }
+        if (!m_previous || !same_pose(record, *m_previous))
+        {
+            m_pos = Position{
+                XCoord{meters{record.prior_x}},
+                YCoord{meters{record.prior_y}},
+                Angle{record.prior_theta},
+            };
+        }
+        m_previous = record;
+
+        auto &kalman_filter = m_pose_estimator.kalman_filter();
+        kalman_filter.set_process_noise_scale(record.process_noise_scale);
+        std::optional<PoseEstimator::Sensors> sensors;
+        if (record.flags & flight_log::frame_flag)
+        {
+            const auto tick_frame = frame(record);
+            m_filters.update(tick_frame);
+            sensors = PoseEstimator::Sensors{
+                .readings = m_filters.readings(),
+                .fresh = tick_frame.fresh,
+                .healthy = tick_frame.healthy,
+            };
+        }
+        const auto estimate = m_pose_estimator.step(
+            m_pos,
+            meters_per_second{record.left_velocity},
+            meters_per_second{record.right_velocity},
+            m_period,
+            sensors ? &*sensors : nullptr
+        );
+        m_pos = estimate.pos;
+
+        const auto variance = kalman_filter.covariance().diagonal();
+        return Output{
+            .time = record.time,
+            .pos = m_pos,
+            .variance{variance(0), variance(1), variance(2)},
+            .innovation = kalman_filter.normalized_innovation(),
+            .update = estimate.update,
+        };
+    }
+
+private:
+    static DistanceSensors::Frame frame(const flight_log::Record &record) noexcept
+    {
+        DistanceSensors::Frame frame{};
+        frame.distances = record.distances;
+        frame.fresh = record.fresh;
+        frame.healthy = record.healthy;
+        return frame;
+    }
+
+    /**
+     * @brief Whether the record's tick started from the previous tick's pose (bit for bit).
+     */
+    static bool same_pose(const flight_log::Record &record, const flight_log::Record &previous) noexcept
+    {
+        const float prior[]{record.prior_x, record.prior_y, record.prior_theta};
+        const float pos[]{previous.x, previous.y, previous.theta};
+        return std::memcmp(prior, pos, sizeof(prior)) == 0;
+    }
+
+    PoseEstimator m_pose_estimator;
+    DistanceSensors::Filters m_filters;
+    seconds m_period;
+    Position m_pos{};
+    std::optional<flight_log::Record> m_previous;
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_FLIGHT_REPLAY_H
@@ -0,0 +1,89 @@
+#ifndef MAIN_GAIN_SCHEDULE_H
+#define MAIN_GAIN_SCHEDULE_H
+
+#include "motor_specs.h"
+#include "pid.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace micromouse
+{
+
+/**
+ * @brief PID gains that depend on the speed: a small table of gains at increasing speeds, linearly interpolated
+ * between them and held beyond the ends.
+ *
+ * @tparam N The number of speeds in the table.
+ */
+template <std::size_t N>
+    requires(N > 0)
+struct GainSchedule
+{
+    std::array<float, N> speeds;  // [m/s] Increasing
+    std::array<PidGains, N> gains;
+
+    /**
+     * @brief The same gains at every speed.
+     */
+    static constexpr GainSchedule flat(const std::array<float, N> &speeds, const PidGains &gains) noexcept
+    {
+        GainSchedule schedule{.speeds = speeds, .gains{}};
+        schedule.gains.fill(gains);
+        return schedule;
+    }
+
+    /**
+     * @brief The gains at `speed` (in either direction).
+     */
+    constexpr PidGains at(float speed) const noexcept
+    {
+        speed = std::abs(speed);
+        if (speed <= speeds.front())
+        {
+            return gains.front();
+        }
+        for (std::size_t i = 1; i < N; i++)
+        {
+            if (speed < speeds[i])
+            {
+                const auto t = (speed - speeds[i - 1]) / (speeds[i] - speeds[i - 1]);
+                const auto &low = gains[i - 1];
+                const auto &high = gains[i];
+                return {
+                    .kp = std::lerp(low.kp, high.kp, t),
+                    .ki = std::lerp(low.ki, high.ki, t),
+                    .kd = std::lerp(low.kd, high.kd, t),
+                };
+            }
+        }
+        return gains.back();
+    }
+
+    /**
+     * @brief Set `pid`'s gains for `speed`, without a bump in its output.
+     */
+    template <typename T>
+    constexpr void apply(Pid<T> &pid, float speed) const noexcept
+    {
+        const auto scheduled = at(speed);
+        pid.set_gains_bumpless(scheduled.kp, scheduled.ki, scheduled.kd);
+    }
+};
+
+// The controller's speed cap (see `linear_motion_limits`), which the planned profiles and paths never exceed
+inline constexpr float max_controlled_speed = MotorSpecs::max_speed / 12;  // [m/s]
+
+// The speeds of the control loops' schedules, within the speeds the robot is driven at
+inline constexpr std::array gain_schedule_speeds{
+    max_controlled_speed / 4,
+    max_controlled_speed / 2,
+    max_controlled_speed,
+};  // [m/s]
+using SpeedGainSchedule = GainSchedule<gain_schedule_speeds.size()>;
+
+}  // namespace micromouse
+
+#endif  // MAIN_GAIN_SCHEDULE_H
@@ -1,17 +1,36 @@
 #include "kalman_filter.h"
 
+#include <misc_utils/fast_math.h>
+
 namespace micromouse
 {
 
 static const PosCov I = PosCov::Identity();
-const PosCov KalmanFilter::Q = 1e-2f * I;  // The covariance of the process noise.
-const MeasurementCov KalmanFilter::R = Eigen::DiagonalMatrix<float, DistanceSensors::sensor_count>(
-    0.6f,
-    1.0f,
-    0.6f,
-    1.0f,
-    0.6f
-);  // The covariance of the observation noise.
+
+void KalmanFilter::set_noise(const KalmanNoise &noise) noexcept
+{
+    m_noise = noise;
+    Q = Eigen::Map<const Eigen::Vector<float, pos_dimension>>{noise.process.data()}.asDiagonal();
+    R = Eigen::Map<const Eigen::Vector<float, DistanceSensors::sensor_count>>{noise.measurement.data()}.asDiagonal();
+}
+
+void KalmanFilter::predict(const PosJacobian &motion_jacobian) noexcept
+{
+    P = motion_jacobian * P * motion_jacobian.transpose() + m_process_noise_scale * Q;
+}
+
+void KalmanFilter::corridor_update(const PosJacobian &motion_jacobian, Angle axis, float gain) noexcept
+{
+    predict(motion_jacobian);
+
+    const auto [sin_axis, cos_axis] = fast::sincos(axis);
+    Eigen::Matrix<float, 2, pos_dimension> H;
+    H << -sin_axis, cos_axis, 0.0f, 0.0f, 0.0f, 1.0f;
+    const Eigen::Matrix<float, pos_dimension, 2> K = gain * H.transpose();
+    const Eigen::Vector2f corridor_noise{m_noise.corridor[0], m_noise.corridor[1]};
+    const PosCov I_KH = I - K * H;
+    P = I_KH * P * I_KH.transpose() + K * corridor_noise.asDiagonal() * K.transpose();
+}
 
 Position KalmanFilter::operator()(
     const Position &pos,
@@ -22,12 +41,14 @@ Position KalmanFilter::operator()(
 {
     // Predict (a priori) state and covariance estimate
     Eigen::Vector<float, pos_dimension> pos_vec{pos.x->count(), pos.y->count(), pos.theta.get()};
-    P = motion_jacobian * P * motion_jacobian.transpose() + Q;
+    predict(motion_jacobian);
 
     // Measurement update
     const JacobianT sensors_jacobian_T = sensors_jacobian.transpose();
     const MeasurementCov S = sensors_jacobian * P * sensors_jacobian_T + R;
-    const JacobianT K = P * sensors_jacobian_T * S.inverse();
+    const MeasurementCov S_inverse = S.inverse();
+    const JacobianT K = P * sensors_jacobian_T * S_inverse;
+    m_normalized_innovation = sensors_error.dot(S_inverse * sensors_error);
 
     // Update (a posteriori) state and covariance estimate
     P = (I - K * sensors_jacobian) * P;
@@ -7,6 +7,7 @@
 
 #include <Eigen/Dense>
 
+#include <array>
 #include <cmath>
 #include <vector>
 
@@ -17,9 +18,34 @@ using JacobianT = Eigen::Matrix<float, pos_dimension, DistanceSensors::sensor_co
 using PosCov = Eigen::Matrix<float, pos_dimension, pos_dimension>;
 using MeasurementCov = Eigen::Matrix<float, DistanceSensors::sensor_count, DistanceSensors::sensor_count>;
 
+/**
+ * @brief The (diagonal) covariances of the process and the observation noise.
+ */
+struct KalmanNoise
+{
+    std::array<float, pos_dimension> process;                       // x, y, theta
+    std::array<float, DistanceSensors::sensor_count> measurement;  // Per sensor
+    std::array<float, 2> corridor;                                 // Lateral position and heading
+};
+
+inline constexpr KalmanNoise default_kalman_noise{
+    .process{1e-2f, 1e-2f, 1e-2f},
+    .measurement{0.6f, 1.0f, 0.6f, 1.0f, 0.6f},
+    .corridor{1e-4f, 1e-3f},
+};
+
 class KalmanFilter
 {
 public:
+    explicit KalmanFilter(const KalmanNoise &noise = default_kalman_noise) noexcept { set_noise(noise); }
+
+    /**
+     * @brief Kalman filter predict step (covariance only, the position is predicted by the motion model).
+     *
+     * @param motion_jacobian The jacobian of the position with respect to the position vector.
+     */
+    void predict(const PosJacobian &motion_jacobian) noexcept;
+
     /**
      * @brief Kalman filter update.
      * @see https://en.wikipedia.org/wiki/Kalman_filter
@@ -40,13 +66,55 @@ public:
         const DistanceSensors::Jacobian &sensors_jacobian
     ) noexcept;
 
+    /**
+     * @brief Kalman filter predict step, followed by the covariance update of the corridor estimator (see
+     * `corridor_update` in wall_follower.h). The estimator corrects the lateral position across the corridor's axis
+     * and the heading with a fixed gain instead of the Kalman gain, so P = (I - K H) P (I - K H)^T + K R K^T (the
+     * Joseph form holds for any gain), with K = gain * H^T, where H selects the lateral position and the heading.
+     *
+     * @param motion_jacobian The jacobian of the position with respect to the position vector.
+     * @param axis The corridor's axis (see `corridor_axis`).
+     * @param gain The estimator's gain.
+     */
+    void corridor_update(const PosJacobian &motion_jacobian, Angle axis, float gain) noexcept;
+
+    /**
+     * @brief Scale the process noise of the following predictions, e.g. while the wheels slip and the motion model
+     * can't be trusted (see `SlipDetector`).
+     */
+    void set_process_noise_scale(float scale) noexcept { m_process_noise_scale = scale; }
+
+    float process_noise_scale() const noexcept { return m_process_noise_scale; }
+
+    /**
+     * @brief Replace the noise covariances (e.g. to tune them on the host, see `sweep`).
+     */
+    void set_noise(const KalmanNoise &noise) noexcept;
+
+    const KalmanNoise &noise() const noexcept { return m_noise; }
+
+    /**
+     * @brief The normalized innovation squared of the last update: e^T * S^-1 * e, where e is the sensors' error and S
+     * its covariance. Chi-square distributed (with a degree of freedom per fused reading, the others have no error)
+     * while the filter is consistent.
+     */
+    float normalized_innovation() const noexcept { return m_normalized_innovation; }
+
+    /**
+     * @brief The position's covariance (x, y, theta).
+     */
+    const PosCov &covariance() const noexcept { return P; }
+
 private:
     // Covariance
     PosCov P = PosCov::Identity();
+    float m_process_noise_scale = 1.0f;
+    float m_normalized_innovation = 0.0f;
 
     // Process and measurement noise
-    static const PosCov Q;
-    static const MeasurementCov R;
+    KalmanNoise m_noise;
+    PosCov Q;
+    MeasurementCov R;
 };
 
 }  // namespace micromouse
@@ -1,125 +1,291 @@
+#include <misc_utils/fast_math.h>
 #include <misc_utils/physical_size.h>
+#include <misc_utils/spsc_queue.h>
 
 #include "algorithm_api_mock.h"
+#include "calibration_storage.h"
+#include "control_loop.h"
+#include "control_mailbox.h"
+#include "control_task.h"
 #include "debug_utils.h"
 #include "distance_sensor.h"
-#include "kalman_filter.h"
+#include "distance_sensor_model.h"
+#include "flight_log.h"
+#include "gain_schedule.h"
 #include "motion_model.h"
 #include "motor.h"
+#include "motor_identification.h"
+#include "path_tracker.h"
 #include "periodic_caller.h"
-#include "pid_controller.h"
+#include "pid.h"
+#include "planner.h"
+#include "pose_estimator.h"
+#include "relay_tuner.h"
+#include "sensor_timing.h"
+#include "slip_detector.h"
+#include "stage_profiler.h"
+#include "telemetry.h"
 #include "temp_map.h"
+#include "velocity_profile.h"
+#include "wall_follower.h"
 #include <sdkconfig.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <inttypes.h>
 #include <numbers>
+#include <optional>
 #include <ratio>
+#include <span>
+#include <utility>
 
 #include <Arduino.h>
 #include <SparkFun_I2C_Mux_Arduino_Library.h>
 #include <SparkFun_VL53L1X.h>
 #include <Wire.h>
+#include <esp_err.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <esp_vfs_dev.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 using namespace micromouse;
 using namespace std::chrono_literals;
 
 static constexpr std::chrono::duration<float, std::micro> pid_loop_period{CONFIG_PID_LOOP_PERIOD};
 
-using MotorSpeed = ConstrainedValue<ValueRange<float, -Motor::max_speed, Motor::max_speed, Mode::Closed>, false>;
-using PhysicalMotorSpeed = PhysicalSize<MotorSpeed, meters_per_second::units>;
+using MotorArgs = BasicMotorArgs<Motor>;
+using PidArgs = BasicPidArgs<Motor>;
 
-template <PhysicalSizeType T>
-static T abs(const T &val) noexcept
+#if CONFIG_CONTROL_MODE_PURE_PURSUIT
+static constexpr auto default_control_mode = ControlMode::PurePursuit;
+#elif CONFIG_CONTROL_MODE_STANLEY
+static constexpr auto default_control_mode = ControlMode::Stanley;
+#else
+static constexpr auto default_control_mode = ControlMode::Waypoints;
+#endif
+
+// The whole route, for the path tracking modes
+static Path path;
+
+static ControlLoop<Motor> control_loop{pid_loop_period, path, maze_map};
+
+#if CONFIG_FLIGHT_RECORDER
+/**
+ * @brief The `flightlog` partition (see partitions.csv), for the flight recorder.
+ */
+struct FlightLogPartition
 {
-    return T{std::abs(val.count())};
-}
+    const esp_partition_t *partition;
+
+    std::size_t size() const noexcept { return partition->size; }
+
+    bool read(std::size_t offset, std::span<std::uint8_t> data) const noexcept
+    {
+        return esp_partition_read(partition, offset, data.data(), data.size()) == ESP_OK;
+    }
+
+    bool write(std::size_t offset, std::span<const std::uint8_t> data) const noexcept
+    {
+        return esp_partition_write(partition, offset, data.data(), data.size()) == ESP_OK;
+    }
+
+    bool erase(std::size_t offset, std::size_t size) const noexcept
+    {
+        return esp_partition_erase_range(partition, offset, size) == ESP_OK;
+    }
+};
+
+static FlightLogPartition flight_log_partition{};
+static flight_log::Recorder<FlightLogPartition> flight_recorder{flight_log_partition};
+static constexpr UBaseType_t flight_log_priority = 2;  // Above the main loop, to write as soon as a tick ends
+static constexpr std::uint32_t flight_log_stack_size = 4096;
+static constexpr auto flight_log_interval = pdMS_TO_TICKS(50);
+static TaskHandle_t flight_log_task = nullptr;
+static std::atomic<std::uint32_t> flight_log_max_stall = 0;  // [us] The longest page write
+static_assert(flight_log::sensor_count == DistanceSensors::sensor_count);
 
-static constexpr auto is_vertical(Direction d) noexcept
+/**
+ * @brief The PID loop's record for the flight log.
+ *
+ * @param args The PID loop's arguments.
+ * @param prior_pos The pose the iteration started from.
+ * @param frame The sensor frame taken in this iteration, if any.
+ */
+static flight_log::Record flight_record(
+    const PidArgs &args,
+    const Position &prior_pos,
+    const std::optional<DistanceSensors::Frame> &frame
+) noexcept
 {
-    return d == Direction::North || d == Direction::South;
+    // The latest frame's, to repeat in the iterations without one
+    static std::array<std::uint16_t, DistanceSensors::sensor_count> distances{};
+    static std::uint8_t healthy = 0;
+    if (frame)
+    {
+        distances = frame->distances;
+        healthy = static_cast<std::uint8_t>(frame->healthy.to_ulong());
+    }
+    const auto &kalman_filter = control_loop.pose_estimator().kalman_filter();
+    const auto variance = kalman_filter.covariance().diagonal();
+    return {
+        .time = static_cast<std::uint32_t>(esp_timer_get_time()),
+        .distances = distances,
+        .fresh = static_cast<std::uint8_t>(frame ? frame->fresh.to_ulong() : 0),
+        .healthy = healthy,
+        .left_ticks = args.left.motor.get_enc_ticks(),
+        .right_ticks = args.right.motor.get_enc_ticks(),
+        .left_velocity = args.left.current_velocity.count(),
+        .right_velocity = args.right.current_velocity.count(),
+        .process_noise_scale = kalman_filter.process_noise_scale(),
+        .prior_x = prior_pos.x->count(),
+        .prior_y = prior_pos.y->count(),
+        .prior_theta = prior_pos.theta.get(),
+        .x = args.pos.x->count(),
+        .y = args.pos.y->count(),
+        .theta = args.pos.theta.get(),
+        .x_variance = variance(0),
+        .y_variance = variance(1),
+        .theta_variance = variance(2),
+        .innovation = kalman_filter.normalized_innovation(),
+        .left_wanted_velocity = args.left.wanted_velocity.count().get(),
+        .right_wanted_velocity = args.right.wanted_velocity.count().get(),
+        .left_output = args.left.output,
+        .right_output = args.right.output,
+        .flags = frame ? flight_log::frame_flag : 0,
+    };
 }
 
 /**
- * @brief Finds the closest direction to the given angle by dividing the plane into quarters.
+ * @brief Write the flight log a page at a time, each right after a PID loop tick.
  *
- * @param angle angle to check.
- * @return Closest direction.
+ * Programming a page disables the flash cache on both cores (for about 0.5 ms, a few ms at worst), and the PID loop
+ * runs from flash, so a write stalls any tick that it overlaps. At 96 bytes per record and 200 Hz, that's 75 pages per
+ * second (the partition holds about 50 s). Writing right after a tick puts the stall in the tick's slack instead, and
+ * the longest one is added to the control task's `DeadlineStats` (see `print_deadline_stats`).
+ * While the PID loop is stopped there are no ticks, so the pages are written every `flight_log_interval`.
+ */
+/**
+ * @brief A warmup frame's record for the flight log (see `flight_log::warmup_flag`).
  */
-static auto to_closest_direction(const Angle &angle) noexcept
+static flight_log::Record flight_warmup_record(const DistanceSensors::Frame &frame) noexcept
+{
+    flight_log::Record record{};
+    record.time = static_cast<std::uint32_t>(esp_timer_get_time());
+    record.distances = frame.distances;
+    record.fresh = static_cast<std::uint8_t>(frame.fresh.to_ulong());
+    record.healthy = static_cast<std::uint8_t>(frame.healthy.to_ulong());
+    record.flags = flight_log::frame_flag | flight_log::warmup_flag;
+    return record;
+}
+
+static void flight_log_loop(void *) noexcept
 {
-    if (std::abs(angle) < std::numbers::pi_v<float> / 4)
+    const auto write_page = []
     {
-        return Direction::East;
-    }
-    else if (std::abs(angle) < 3 * std::numbers::pi_v<float> / 4)
+        const auto start = esp_timer_get_time();
+        const auto more = flight_recorder.write_some();
+        const auto stall = static_cast<std::uint32_t>(esp_timer_get_time() - start);
+        // The only writer
+        if (stall > flight_log_max_stall.load(std::memory_order_relaxed))
+        {
+            flight_log_max_stall.store(stall, std::memory_order_relaxed);
+        }
+        return more;
+    };
+    while (true)
     {
-        return (angle.get() > 0) ? Direction::South : Direction::North;
+        const auto ticked = ulTaskNotifyTake(pdTRUE, flight_log_interval) > 0;
+        if (flight_recorder.flushed())
+        {
+            continue;
+        }
+        // One page per tick keeps up (a tick's record is about a third of a page).
+        while (write_page() && !ticked)
+        {
+        }
     }
-
-    return Direction::West;
 }
 
-struct MotorArgs
+/**
+ * @brief Erase the previous flight log and start recording (if the partition exists). Blocks while erasing.
+ */
+static void start_flight_recorder() noexcept
 {
-    Motor motor;
-    PidController linear_velocity_distance_pid;
-    PidController angular_velocity_angle_pid;
-    PidController velocity_pid;
-    float distance_linear_Kv;
-    float distance_angular_Kv;
-    float velocity_Kv;
-    float Ks;
-    float output;
-    PhysicalMotorSpeed wanted_velocity;
-    meters_per_second current_velocity;
-};
+    flight_log_partition.partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "flightlog");
+    if (flight_log_partition.partition == nullptr)
+    {
+        std::printf("No flightlog partition, the flight recorder is off\n");
+        return;
+    }
+    std::printf("Erasing the previous flight log\n");
+    if (!flight_recorder.start())
+    {
+        std::printf("Failed to erase the flight log, the flight recorder is off\n");
+        return;
+    }
+    const auto res = xTaskCreatePinnedToCore(
+        flight_log_loop,
+        "flight_log",
+        flight_log_stack_size,
+        nullptr,
+        flight_log_priority,
+        &flight_log_task,
+        tskNO_AFFINITY
+    );
+    ESP_ERROR_CHECK(res == pdPASS ? ESP_OK : ESP_ERR_NO_MEM);
+}
 
-struct PidArgs
+/**
+ * @brief Write the rest of the flight log (while the PID loop is stopped) and print its statistics.
+ */
+static void flush_flight_log() noexcept
 {
-    MotorArgs left;
-    MotorArgs right;
-    Position target_pos;
-    Position pos;
-    bool sensors_available;
-};
+    while (!flight_recorder.finish() || !flight_recorder.flushed())
+    {
+        vTaskDelay(flight_log_interval);
+    }
+    const auto stats = flight_recorder.stats();
+    std::printf(
+        "Flight log: %" PRIu32 " records in %" PRIu32 " blocks, %" PRIu32 " dropped, %" PRIu32 " write errors, longest "
+        "page write = %" PRIu32 " us\n",
+        stats.records,
+        stats.blocks,
+        stats.dropped,
+        stats.write_errors,
+        flight_log_max_stall.load(std::memory_order_relaxed)
+    );
+}
+#endif
+
+#if CONFIG_STAGE_PROFILER
+static constexpr bool stage_profiler_enabled = true;
+#else
+static constexpr bool stage_profiler_enabled = false;
+#endif
 
-static KalmanFilter kalman_filter;
+// Where the PID loop's period goes, printed when halting. Costs nothing when disabled.
+static profiler::StageProfiler<PidStage, stage_profiler_enabled> pid_profiler{{
+    "encoders",
+    "motion model",
+    "corridor",
+    "ray casting",
+    "ekf",
+    "tracking",
+    "control",
+    "total",
+}};
 
 /**
- * @brief This function calculates the control signal for each motor.
- * Using those two equations:
- * Vw = Kv1 * sqrt(2 * a * |dx|) * sign(dx) + PID(dx)
- * Vm = Ks + Kv2 * Vw + PID(Vw - Vc)
- * Where:
- * Vw - Wanted velocity.
- * Kv1 - Wanted velocity factor.
- * a - Maximum motor acceleration.
- * dx - Distance error (current pos - wanted pos).
- * Vm - Motor velocity output.
- * Ks - Static motor velocity (the smallest velocity to drive the motor on ground).
- * Kv2 - Motor velocity factor.
- * Vc - Current motor velocity.
- *
- * The first equation uses a PID on the distance error we want to drive and adds a feed
- * forward term which assumes constant acceleration motion (trapezoid motion profile).
- * The second equation is to close the loop on the velocity value sent to the motor.
- * It uses a PID on the velocity error and adds a feed forward term of the wanted velocity.
- *
- * Using the first equation, we calculate the linear and angular velocities, Vl and Va.
- * Vl is calculated from the distance error while Va is calculated from the angle error.
- * The angle error is composed of the error between current and wanted angle and the error between current angle and the
- * driving direction needed to reach the destination.
- * The left motor's wanted speed is Vl + Va and the right motor's wanted speed is Vl - Va.
- * Now we can use the second equation to calculate the velocity of each motor.
- *
- * The left and right motors current velocities change the robot's position using the robot's differential drive motion
- * model.
- * When new data from the distance sensors arrive, we use a Kalman filter to fuse the data from the sensors and the
- * predicted position from the motion model to get a new better estimated position.
+ * @brief One iteration of the control loop (see `ControlLoop::step`), profiled and recorded.
  *
  * @param args A pointer to a `PidArgs` struct.
  */
@@ -127,142 +293,592 @@ static void pid_loop(void *args) noexcept
 {
     static auto &distance_sensors = DistanceSensors::get_instance();
 
-    // Initialization:
-    using LinearMotorSpeed = ConstrainedValue<
-        ValueRange<float, MotorSpeed::range_type::low / 12.0f, MotorSpeed::range_type::high / 12.0f, Mode::Closed>,
-        false>;
-    using RotationalMotorSpeed = ConstrainedValue<
-        ValueRange<float, MotorSpeed::range_type::low / 16.0f, MotorSpeed::range_type::high / 16.0f, Mode::Closed>,
-        false>;
-
-    static_assert(
-        MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::low)
-        && MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::high)
+    const auto total_scope = pid_profiler.scope(PidStage::Total);
+    auto stopwatch = pid_profiler.stopwatch();
+
+    PidArgs *pid_args = static_cast<PidArgs *>(args);
+    [[maybe_unused]] const auto tick =
+        control_loop.step(*pid_args, distance_sensors, [&](PidStage stage) { stopwatch.lap(stage); });
+#if CONFIG_FLIGHT_RECORDER
+    flight_recorder.record(flight_record(*pid_args, tick.prior_pos, tick.frame));
+    if (flight_log_task != nullptr)
+    {
+        xTaskNotifyGive(flight_log_task);  // The tick is done, the flash is free to write until the next one
+    }
+#endif
+}
+
+static void print_log(const ControlState &state, const std::chrono::milliseconds &cycle_time = 0ms) noexcept
+{
+    std::printf(
+        "WPos: [ %g  %g  %g ] Pos: [ %g  %g  %g ] L: Actual = %g Wanted = %g Output = %g R: Actual = %g Wanted = %g "
+        "Output = %g Cycle time: %lld\n",
+        state.target.x->count(),
+        state.target.y->count(),
+        state.target.theta.get(),
+        state.pos.x->count(),
+        state.pos.y->count(),
+        state.pos.theta.get(),
+        state.left.velocity.count(),
+        state.left.wanted_velocity.count(),
+        state.left.output,
+        state.right.velocity.count(),
+        state.right.wanted_velocity.count(),
+        state.right.output,
+        cycle_time.count()
     );
-    static_assert(
-        MotorSpeed::range_type::contains(RotationalMotorSpeed::range_type::low)
-        && MotorSpeed::range_type::contains(RotationalMotorSpeed::range_type::high)
+}
+
+#if !CONFIG_BINARY_TELEMETRY
+static void print_sensor_rates(const DistanceSensors::Rates &rates) noexcept
+{
+    std::printf("Sensor rates [Hz]:");
+    for (const auto rate : rates)
+    {
+        std::printf(" %.1f", rate);
+    }
+    std::printf("\n");
+}
+#endif
+
+#if CONFIG_BINARY_TELEMETRY
+// The main loop's records, for the telemetry task (5 seconds' worth)
+static SpscQueue<telemetry::Record, 256> telemetry_queue;
+static constexpr UBaseType_t telemetry_priority = 0;  // The idle task's, so it never delays anything else
+static constexpr std::uint32_t telemetry_stack_size = 4096;
+static constexpr auto telemetry_interval = pdMS_TO_TICKS(100);
+
+static_assert(telemetry::sensor_count == DistanceSensors::sensor_count);
+
+static telemetry::Record telemetry_record(
+    const ControlState &state,
+    std::chrono::milliseconds cycle_time,
+    const DistanceSensors::Rates &sensor_rates
+) noexcept
+{
+    return {
+        .time = static_cast<std::uint32_t>(esp_timer_get_time()),
+        .target_x = state.target.x->count(),
+        .target_y = state.target.y->count(),
+        .target_theta = state.target.theta.get(),
+        .x = state.pos.x->count(),
+        .y = state.pos.y->count(),
+        .theta = state.pos.theta.get(),
+        .left_velocity = state.left.velocity.count(),
+        .left_wanted_velocity = state.left.wanted_velocity.count(),
+        .left_output = state.left.output,
+        .right_velocity = state.right.velocity.count(),
+        .right_wanted_velocity = state.right.wanted_velocity.count(),
+        .right_output = state.right.output,
+        .innovation = state.innovation,
+        .cycle_time = static_cast<std::uint32_t>(std::chrono::microseconds{cycle_time}.count()),
+        .flags = static_cast<std::uint32_t>(state.healthy_sensors.to_ulong()),
+        .sensor_rates = sensor_rates,
+    };
+}
+
+/**
+ * @brief Send the queued records every `telemetry_interval`, in frames of up to `telemetry::max_batch` records (see
+ * `telemetry::encode`). Each frame is a single write, so the log lines from other tasks go between the frames.
+ */
+static void telemetry_loop(void *) noexcept
+{
+    std::array<telemetry::Record, telemetry::max_batch> batch;
+    telemetry::Frame frame;
+    std::uint16_t sequence = 0;
+    while (true)
+    {
+        std::size_t count = 0;
+        while (const auto record = telemetry_queue.pop())
+        {
+            batch[count++] = *record;
+            if (count == batch.size())
+            {
+                break;
+            }
+        }
+        if (count == 0)
+        {
+            vTaskDelay(telemetry_interval);
+            continue;
+        }
+        const auto size = telemetry::encode(std::span{batch}.first(count), sequence++, frame);
+        std::fwrite(frame.data(), 1, size, stdout);
+        std::fflush(stdout);
+    }
+}
+
+static void start_telemetry() noexcept
+{
+    // The console translates LF to CRLF by default, which would change the frames.
+    esp_vfs_dev_uart_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_LF);
+    const auto res = xTaskCreatePinnedToCore(
+        telemetry_loop,
+        "telemetry",
+        telemetry_stack_size,
+        nullptr,
+        telemetry_priority,
+        nullptr,
+        tskNO_AFFINITY
     );
-    static_assert(
-        MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::low + RotationalMotorSpeed::range_type::low)
-        && MotorSpeed::range_type::contains(LinearMotorSpeed::range_type::high + RotationalMotorSpeed::range_type::high)
+    ESP_ERROR_CHECK(res == pdPASS ? ESP_OK : ESP_ERR_NO_MEM);
+}
+#endif
+
+#if CONFIG_CONTROL_TASK
+static void print_deadline_stats(DeadlineStats stats) noexcept
+{
+#if CONFIG_FLIGHT_RECORDER
+    stats.record_stall(DeadlineStats::Timestamp{flight_log_max_stall.load(std::memory_order_relaxed)});
+#endif
+    static constexpr DeadlineStats::Timestamp fast_period{1'000};
+    const auto us = [](DeadlineStats::Timestamp t) { return static_cast<long long>(t.count()); };
+    std::printf(
+        "Control task: %" PRIu32 " periods of %lld us, %" PRIu32 " overruns, max jitter = %lld us, max latency = %lld "
+        "us, execution time: min = %lld us mean = %lld us max = %lld us, max response time = %lld us, max stall = %lld "
+        "us, %lld us period: %s\n",
+        stats.count(),
+        us(stats.period()),
+        stats.overruns(),
+        us(stats.max_jitter()),
+        us(stats.max_latency()),
+        us(stats.min_execution()),
+        us(stats.mean_execution()),
+        us(stats.wcet()),
+        us(stats.max_response()),
+        us(stats.max_stall()),
+        us(fast_period),
+        stats.fits(fast_period) ? "fits" : "doesn't fit"
     );
+}
+#endif
 
-    // Update pos:
-    PidArgs *pid_args = static_cast<PidArgs *>(args);
-    pid_args->left.current_velocity = pid_args->left.motor.get_speed(pid_loop_period);
-    pid_args->right.current_velocity = pid_args->right.motor.get_speed(pid_loop_period);
-    const auto predicted_pos =
-        update_pos(pid_args->pos, pid_args->left.current_velocity, pid_args->right.current_velocity, pid_loop_period);
-    if (pid_args->sensors_available)
-    {
-        pid_args->sensors_available = false;
-        const auto pos_j = pos_jacobian(
-            pid_args->pos,
-            pid_args->left.current_velocity,
-            pid_args->right.current_velocity,
-            pid_loop_period
-        );
-        const auto [distance_sensor_error, distance_sensor_jacobian] =
-            distance_sensors.predict(pid_args->pos, maze_map);
-        // Maybe compensate for the sensors coming later so the reading was in the past...
-        pid_args->pos = kalman_filter(predicted_pos, pos_j, distance_sensor_error, distance_sensor_jacobian);
-    }
-    else
+static auto now() noexcept
+{
+    return std::chrono::milliseconds{millis()};
+}
+
+/**
+ * @brief Wait for `timeout` and let the user select the control mode meanwhile: 'w' for waypoints, 'p' for pure
+ * pursuit and 's' for Stanley.
+ *
+ * @param mode The default mode.
+ * @param timeout How long to wait.
+ * @return The selected mode.
+ */
+static ControlMode select_control_mode(ControlMode mode, std::chrono::milliseconds timeout) noexcept
+{
+    std::printf("Control mode: %s (send 'w', 'p' or 's' to change)\n", to_string(mode));
+    const auto start_time = now();
+    while (now() - start_time < timeout)
     {
-        pid_args->pos = predicted_pos;
+        const auto key = debug_utils::read_key();
+        if (key == 'w' || key == 'p' || key == 's')
+        {
+            mode = key == 'w' ? ControlMode::Waypoints : key == 'p' ? ControlMode::PurePursuit : ControlMode::Stanley;
+            std::printf("Control mode: %s\n", to_string(mode));
+        }
+        delay(10);
     }
+    return mode;
+}
+
+static const char *motor_name(const MotorArgs &motor) noexcept
+{
+    return motor.motor.get_id() == LeftMotor ? "left" : "right";
+}
 
-    // Calculate error
-    const auto x_err = unit_cast<millimeters>((pid_args->target_pos.x - pid_args->pos.x).get());
-    const auto y_err = unit_cast<millimeters>((pid_args->target_pos.y - pid_args->pos.y).get());
-    const auto dist_sign = std::copysign(
-        1.0f,
-        x_err.count() * std::cos(pid_args->pos.theta) + y_err.count() * std::sin(pid_args->pos.theta)
+struct IdentificationArgs
+{
+    std::array<MotorArgs *, 2> motors;
+    std::array<MotorIdentifier, 2> identifiers;
+    std::uint32_t ticks;  // Iterations since the start of the excitation
+    std::atomic<bool> done;
+};
+
+/**
+ * @brief Send the excitation's command to both motors and feed the identifiers with the measured velocities.
+ *
+ * @param args A pointer to an `IdentificationArgs` struct.
+ */
+static void identification_loop(void *args) noexcept
+{
+    auto *identification_args = static_cast<IdentificationArgs *>(args);
+    const auto command = Excitation::command(
+        duration_cast<Excitation::seconds>(pid_loop_period * identification_args->ticks++)
     );
-    const auto dist_err = dist_sign * std::sqrt(std::pow(x_err.count(), 2.0f) + std::pow(y_err.count(), 2.0f));
-    const auto direction_err = [&]()
+    for (std::size_t i = 0; i < identification_args->motors.size(); i++)
+    {
+        auto &motor = identification_args->motors[i]->motor;
+        const auto velocity = motor.observe().velocity;
+        identification_args->identifiers[i].add(command.value_or(0.0f), velocity);
+        motor.set_pwm(Motor::bdc_mcpwm_duty_tick_max * command.value_or(0.0f) / Motor::max_speed);
+    }
+    if (!command)
     {
-        if (dist_err > (50_mm).count())
+        identification_args->done = true;
+    }
+}
+
+/**
+ * @brief Identify both motors (see `MotorIdentifier`) and store their models in the NVS.
+ * Both motors get the same commands, so the robot drives back and forth along a straight line and needs some room.
+ */
+static void identify_motors(MotorArgs &left, MotorArgs &right) noexcept
+{
+    static constexpr MotorIdentifier::seconds period = pid_loop_period;
+    IdentificationArgs args{
+        .motors{&left, &right},
+        .identifiers{MotorIdentifier{period}, MotorIdentifier{period}},
+        .ticks = 0,
+        .done{false},
+    };
+    std::printf("Identifying the motors (%g s)...\n", Excitation::duration.count());
+    PeriodicCaller caller(identification_loop, static_cast<void *>(&args));
+    caller.start(pid_loop_period);
+    while (!args.done)
+    {
+        delay(10);
+    }
+    caller.stop();
+
+    for (std::size_t i = 0; i < args.motors.size(); i++)
+    {
+        const auto &motor = *args.motors[i];
+        const auto &identifier = args.identifiers[i];
+        if (const auto model = identifier.fit())
         {
-            return static_cast<float>(Angle{std::atan2(y_err.count(), x_err.count())} - pid_args->pos.theta);
+            std::printf(
+                "Identified the %s motor: Ks = %g Kv = %g tau = %g s (%" PRIu32 " samples)\n",
+                motor_name(motor),
+                model->Ks,
+                model->Kv,
+                model->tau,
+                identifier.sample_count()
+            );
+            store_motor_model(motor.motor.get_id(), *model);
         }
         else
         {
-            return 0.0f;  // Ignore direction error when close to the target
+            std::printf(
+                "Failed to identify the %s motor (%" PRIu32 " samples)\n",
+                motor_name(motor),
+                identifier.sample_count()
+            );
         }
-    }();
-    const auto angle_err = static_cast<float>(pid_args->target_pos.theta - pid_args->pos.theta) + direction_err;
+    }
+}
+
+/**
+ * @brief Use the motor's identified model (if there is one) for the feed forward terms instead of the defaults.
+ */
+static void load_feed_forward(MotorArgs &motor) noexcept
+{
+    if (const auto model = load_motor_model(motor.motor.get_id()))
+    {
+        motor.Ks = model->Ks;
+        motor.velocity_Kv = model->Kv;
+        motor.velocity_Ka = model->Kv * model->tau;
+        std::printf(
+            "Using the %s motor's model: Ks = %g Kv = %g tau = %g s\n",
+            motor_name(motor),
+            model->Ks,
+            model->Kv,
+            model->tau
+        );
+    }
+}
+
+#if CONFIG_PID_AUTOTUNE_RULE_ZIEGLER_NICHOLS
+static constexpr auto autotune_rule = TuningRule::ZieglerNichols;
+#elif CONFIG_PID_AUTOTUNE_RULE_PESSEN_INTEGRAL
+static constexpr auto autotune_rule = TuningRule::PessenIntegral;
+#elif CONFIG_PID_AUTOTUNE_RULE_NO_OVERSHOOT
+static constexpr auto autotune_rule = TuningRule::NoOvershoot;
+#else
+static constexpr auto autotune_rule = TuningRule::TyreusLuyben;
+#endif
+
+enum class TuningPhase : std::uint8_t
+{
+    Velocity,  // Both velocity loops, while driving forward at `TuningArgs::velocity`.
+    Heading,   // The heading loop, while turning in place around `TuningArgs::heading_setpoint`.
+};
+
+// The velocity loops are tuned at the schedule's speeds, which the robot is driven at.
+static_assert(gain_schedule_speeds.back() <= linear_motion_limits.max_velocity.count());
+static constexpr RelayTuner::Config velocity_relay{
+    .amplitude = 0.03f,    // [motor speed units] Small enough to oscillate around the lowest speed without reversing
+    .hysteresis = 0.005f,  // [m/s]
+    .settle_cycles = 2,
+    .cycles = 4,
+    .tolerance = 0.15f,
+    .timeout = RelayTuner::seconds{2.0f},
+};
+static constexpr RelayTuner::Config heading_relay{
+    .amplitude = 0.15f,   // [m/s] Of each wheel
+    .hysteresis = 0.01f,  // [rad]
+    .settle_cycles = 2,
+    .cycles = 4,
+    .tolerance = 0.15f,
+    .timeout = RelayTuner::seconds{5.0f},
+};
+
+struct TuningArgs
+{
+    PidArgs *pid_args;
+    TuningPhase phase;
+    float velocity;  // [m/s]
+    std::array<RelayTuner, 2> velocity_tuners;
+    RelayTuner heading_tuner;
+    Angle heading_setpoint;
+    std::atomic<bool> done;
+};
 
-    // Calculate wanted velocity from distance and angle errors:
-    const auto calc_wanted_velocity = [&](PidController &pid, float err, float kv)
+/**
+ * @brief Close the loop that is being tuned with its relay instead of its PID.
+ *
+ * @param args A pointer to a `TuningArgs` struct.
+ */
+static void tuning_loop(void *args) noexcept
+{
+    auto *tuning_args = static_cast<TuningArgs *>(args);
+    auto &pid_args = *tuning_args->pid_args;
+    const std::array motors{&pid_args.left, &pid_args.right};
+    for (auto *motor : motors)
+    {
+        motor->current_velocity = motor->motor.observe().velocity;
+    }
+    pid_args.pos =
+        update_pos(pid_args.pos, pid_args.left.current_velocity, pid_args.right.current_velocity, pid_loop_period);
+
+    auto done = true;
+    switch (tuning_args->phase)
+    {
+    case TuningPhase::Velocity:
+    {
+        // Around the feed forward that holds the velocity. Both wheels stop as soon as either tuner is done, since a
+        // wheel that stops alone pivots the robot.
+        auto &tuners = tuning_args->velocity_tuners;
+        done = std::ranges::any_of(tuners, &RelayTuner::done);
+        for (std::size_t i = 0; i < motors.size(); i++)
+        {
+            auto &motor = *motors[i];
+            const auto relay = done ? 0.0f : tuners[i].update(tuning_args->velocity - motor.current_velocity.count());
+            const auto command = motor.Ks + motor.velocity_Kv * tuning_args->velocity + relay;
+            motor.output = done ? 0.0f : Motor::bdc_mcpwm_duty_tick_max * command / Motor::max_speed;
+        }
+        done = done || std::ranges::any_of(tuners, &RelayTuner::done);
+        break;
+    }
+    case TuningPhase::Heading:
+    {
+        // The velocity loops stay closed.
+        auto &tuner = tuning_args->heading_tuner;
+        const auto relay = tuner.update(static_cast<float>(tuning_args->heading_setpoint - pid_args.pos.theta));
+        pid_args.left.wanted_velocity = PhysicalMotorSpeed{relay};
+        pid_args.right.wanted_velocity = PhysicalMotorSpeed{-relay};
+        for (auto *motor : motors)
+        {
+            motor->velocity_schedule.apply(motor->velocity_pid, motor->wanted_velocity.count().get());
+            motor->output =
+                tuner.done() ? 0.0f : Motor::bdc_mcpwm_duty_tick_max * motor_command(*motor, 0.0f) / Motor::max_speed;
+        }
+        done = tuner.done();
+        break;
+    }
+    }
+    for (auto *motor : motors)
     {
-        // Use PID on the error and add a feed forward term which assumes constant acceleration motion (trapezoid motion
-        // profile).
-        return meters_per_second{
-            std::copysign(kv, err) * std::sqrt(2 * Motor::max_acceleration * std::abs(err)) + pid.calculate_pid(err)
-        };
+        motor->motor.set_pwm(motor->output);
+    }
+    if (done)
+    {
+        tuning_args->done = true;
+    }
+}
+
+/**
+ * @brief Auto-tune the velocity loops at each of the schedule's speeds and then the heading loop (see `RelayTuner`),
+ * apply the new gain schedules and store them in the NVS.
+ * The velocity loops are tuned while driving forward, both at once (at most `velocity_relay.timeout` at each speed, so
+ * under two cells at the top speed, or lift the robot), and the heading loop while turning in place. A velocity
+ * loop whose tuner isn't done when the other one is keeps its previous gains.
+ *
+ * @param pid_args The loops to tune. The position is restored when done, the robot should be put back meanwhile.
+ * @param rule The rule that derives the gains from the ultimate points.
+ */
+static void autotune(PidArgs &pid_args, TuningRule rule) noexcept
+{
+    static constexpr RelayTuner::seconds tick = pid_loop_period;
+    const auto start_pos = pid_args.pos;
+    TuningArgs args{
+        .pid_args = &pid_args,
+        .phase = TuningPhase::Velocity,
+        .velocity = 0.0f,
+        .velocity_tuners{RelayTuner{velocity_relay, tick}, RelayTuner{velocity_relay, tick}},
+        .heading_tuner{heading_relay, tick},
+        .heading_setpoint{},
+        .done{false},
     };
-    const auto limit_velocity = [&](float new_velocity, float last_velocity)
+    PeriodicCaller caller(tuning_loop, static_cast<void *>(&args));
+    const auto run = [&](TuningPhase phase)
     {
-        static constexpr auto max_accelaration =
-            Motor::max_acceleration * duration_cast<std::chrono::duration<float>>(pid_loop_period).count();
-        return PhysicalMotorSpeed{
-            std::clamp(new_velocity, last_velocity - max_accelaration, last_velocity + max_accelaration)
-        };
+        args.phase = phase;
+        args.done = false;
+        caller.start(pid_loop_period);
+        while (!args.done)
+        {
+            delay(10);
+        }
+        caller.stop();
+        pid_args.left.motor.set_pwm(0.0f);
+        pid_args.right.motor.set_pwm(0.0f);
+        delay(500);  // Come to a stop
     };
-    const auto calc_motor_velocity = [&](MotorArgs &motor, bool left, float dist_err, float angle_err)
-    {
-        const LinearMotorSpeed wanted_linear_velocity{
-            calc_wanted_velocity(motor.linear_velocity_distance_pid, dist_err, motor.distance_linear_Kv).count()
-        };
-        const RotationalMotorSpeed wanted_angular_velocity{
-            calc_wanted_velocity(motor.angular_velocity_angle_pid, angle_err, motor.distance_angular_Kv).count()
-        };
-
-        motor.wanted_velocity = limit_velocity(
-            left ? wanted_linear_velocity.get() + wanted_angular_velocity.get()
-                 : wanted_linear_velocity.get() - wanted_angular_velocity.get(),
-            motor.wanted_velocity.count().get()
+    const auto tuned_gains = [&](const RelayTuner &tuner, const char *name, float speed) -> std::optional<PidGains>
+    {
+        const auto &point = tuner.result();
+        if (!point)
+        {
+            std::printf("Failed to tune the %s loop at %g m/s (no steady oscillation)\n", name, speed);
+            return std::nullopt;
+        }
+        const auto gains = tune(*point, rule, tick);
+        std::printf(
+            "Tuned the %s loop at %g m/s: Ku = %g Tu = %g s -> kp = %g ki = %g kd = %g\n",
+            name,
+            speed,
+            point->gain,
+            point->period.count(),
+            gains.kp,
+            gains.ki,
+            gains.kd
         );
-        return std::copysign(motor.Ks, motor.wanted_velocity.count())
-             + motor.velocity_Kv * motor.wanted_velocity.count()
-             + motor.velocity_pid.calculate_pid(motor.wanted_velocity.count() - motor.current_velocity.count());
+        return gains;
     };
-    const MotorSpeed left_motor_velocity{calc_motor_velocity(pid_args->left, true, dist_err, angle_err)};
-    const MotorSpeed right_motor_velocity{calc_motor_velocity(pid_args->right, false, dist_err, angle_err)};
-
-    // Outputs:
-    pid_args->left.output = Motor::bdc_mcpwm_duty_tick_max * left_motor_velocity / Motor::max_speed;
-    pid_args->right.output = Motor::bdc_mcpwm_duty_tick_max * right_motor_velocity / Motor::max_speed;
-    pid_args->left.motor.set_pwm(pid_args->left.output);
-    pid_args->right.motor.set_pwm(pid_args->right.output);
+
+    // Speeds that fail keep their previous gains.
+    const std::array motors{&pid_args.left, &pid_args.right};
+    static constexpr std::array velocity_loops{TunedLoop::LeftVelocity, TunedLoop::RightVelocity};
+    for (std::size_t i = 0; i < gain_schedule_speeds.size(); i++)
+    {
+        args.velocity = gain_schedule_speeds[i];
+        args.velocity_tuners.fill(RelayTuner{velocity_relay, tick});
+        run(TuningPhase::Velocity);
+        for (std::size_t j = 0; j < motors.size(); j++)
+        {
+            const auto name = j == 0 ? "left velocity" : "right velocity";
+            if (const auto gains = tuned_gains(args.velocity_tuners[j], name, args.velocity))
+            {
+                motors[j]->velocity_schedule.gains[i] = *gains;
+            }
+        }
+    }
+    for (std::size_t j = 0; j < motors.size(); j++)
+    {
+        store_gain_schedule(velocity_loops[j], motors[j]->velocity_schedule);
+        motors[j]->velocity_pid.reset();
+    }
+
+    args.heading_setpoint = pid_args.pos.theta;
+    run(TuningPhase::Heading);
+    if (const auto gains = tuned_gains(args.heading_tuner, "heading", 0.0f))
+    {
+        // Tuned in place, so the same gains at every speed
+        const auto schedule = SpeedGainSchedule::flat(gain_schedule_speeds, *gains);
+        pid_args.left.angular_schedule = schedule;
+        pid_args.right.angular_schedule = schedule;
+        store_gain_schedule(TunedLoop::Heading, schedule);
+    }
+
+    for (auto *motor : motors)
+    {
+        motor->velocity_pid.reset();
+        motor->wanted_velocity = PhysicalMotorSpeed{0.0f};
+        motor->wanted_acceleration = 0.0f;
+        motor->output = 0.0f;
+    }
+    pid_args.pos = start_pos;
 }
 
-static void print_log(const PidArgs &args, const std::chrono::milliseconds &cycle_time = 0ms) noexcept
+/**
+ * @brief Use the gain schedules from the last auto-tuning (if there was one) instead of the defaults.
+ */
+static void load_tuned_gains(PidArgs &pid_args) noexcept
 {
-    std::printf(
-        "WPos: [ %g  %g  %g ] Pos: [ %g  %g  %g ] L: Actual = %g Wanted = %g Output = %g R: Actual = %g Wanted = %g "
-        "Output = %g Cycle time: %lld\n",
-        args.target_pos.x->count(),
-        args.target_pos.y->count(),
-        args.target_pos.theta.get(),
-        args.pos.x->count(),
-        args.pos.y->count(),
-        args.pos.theta.get(),
-        args.left.current_velocity.count(),
-        args.left.wanted_velocity.count().get(),
-        args.left.output,
-        args.right.current_velocity.count(),
-        args.right.wanted_velocity.count().get(),
-        args.right.output,
-        cycle_time.count()
-    );
+    if (const auto schedule = load_gain_schedule(TunedLoop::LeftVelocity))
+    {
+        pid_args.left.velocity_schedule = *schedule;
+    }
+    if (const auto schedule = load_gain_schedule(TunedLoop::RightVelocity))
+    {
+        pid_args.right.velocity_schedule = *schedule;
+    }
+    if (const auto schedule = load_gain_schedule(TunedLoop::Heading))
+    {
+        pid_args.left.angular_schedule = *schedule;
+        pid_args.right.angular_schedule = *schedule;
+    }
 }
 
-static auto now() noexcept
+using SensorTimings = SensorTimingPolicy<DistanceSensors::sensor_count>;
+
+static constexpr SensorTimings::Config sensor_timing_config{
+    .deceleration = Motor::max_acceleration,
+    .range_margin = 0.1_m,
+    .short_range = 1.3_m,
+    .travel_per_reading = 0.01_m,
+    .idle_period = 100,
+    .idle_budget = VL53L1CD_TimingBudget_33ms,
+};
+
+static constexpr SensorTimings sensor_timing_policy{
+    sensor_timing_config,
+    []
+    {
+        std::array<SensorRole, DistanceSensors::sensor_count> roles{};
+        std::ranges::transform(sensor_angles, roles.begin(), sensor_role);
+        return roles;
+    }(),
+};
+
+using RoutePlannerTask = Planner<AlgorithmApi>;
+
+static constexpr UBaseType_t planner_priority = 1;  // The main loop's, below the sensors' task
+static constexpr std::uint32_t planner_stack_size = 4096;
+static constexpr auto planner_poll_interval = pdMS_TO_TICKS(10);
+
+/**
+ * @brief Plan whenever the main loop reports walls (it notifies the task), and retry every `planner_poll_interval`
+ * while the waypoint queue is full.
+ */
+static void planner_loop(void *args) noexcept
 {
-    return std::chrono::milliseconds{millis()};
+    auto &planner = *static_cast<RoutePlannerTask *>(args);
+    while (true)
+    {
+        if (!planner.step())
+        {
+            ulTaskNotifyTake(pdTRUE, planner_poll_interval);
+        }
+    }
+}
+
+static TaskHandle_t start_planner(RoutePlannerTask &planner) noexcept
+{
+    TaskHandle_t task = nullptr;
+    const auto res = xTaskCreatePinnedToCore(
+        planner_loop,
+        "planner",
+        planner_stack_size,
+        static_cast<void *>(&planner),
+        planner_priority,
+        &task,
+        CONFIG_PLANNER_TASK_CORE
+    );
+    ESP_ERROR_CHECK(res == pdPASS ? ESP_OK : ESP_ERR_NO_MEM);
+    return task;
 }
 
 // WARNING: if program reaches end of function app_main() the MCU will restart.
@@ -283,116 +899,248 @@ extern "C" void app_main()
     auto &distance_sensors = DistanceSensors::get_instance();
     distance_sensors.init(i2c);
 
-    static constexpr float d_kv = 0.014f;
-    static constexpr float d_kp = 0.0005f;
-    static constexpr float d_ki = 0.0f;
-    static constexpr float d_kd = 0.005f;
-
-    static constexpr float a_kv = 0.1f;
-    static constexpr float a_kp = 0.05f;
-    static constexpr float a_ki = 0.0f;
-    static constexpr float a_kd = 0.005f;
-
-    static constexpr float v_kv = 1.0f;
-    static constexpr float v_kp = 3.0f;
-    static constexpr float v_ki = 0.0f;
-    static constexpr float v_kd = 0.25f;
+    // The same gains at every speed, until the loops are auto-tuned (see `autotune`)
+    static constexpr auto &gains = default_control_gains;
+    static constexpr auto linear_schedule = SpeedGainSchedule::flat(gain_schedule_speeds, gains.distance);
+    static constexpr auto angular_schedule = SpeedGainSchedule::flat(gain_schedule_speeds, gains.angle);
+    static constexpr auto velocity_schedule = SpeedGainSchedule::flat(gain_schedule_speeds, gains.velocity);
 
+    // The route is planned in the background, and the main loop takes its waypoints from `planner`.
     AlgorithmApi algorithm;
     const auto start_pos = *algorithm.get_next();
-    auto alg_pos = algorithm.get_next();
+    static RoutePlannerTask planner{algorithm};
+    const auto planner_task = start_planner(planner);
+    auto alg_pos = planner.next_waypoint();
+    while (!alg_pos && !planner.finished())
+    {
+        delay(1);
+        alg_pos = planner.next_waypoint();
+    }
+    std::uint32_t dropped_walls = 0;
+    [[maybe_unused]] std::uint32_t dropped_telemetry = 0;
+    DistanceSensors::Rates sensor_rates{};  // The latest (see `DistanceSensors::take_rates`)
+    DistanceSensors::Timings sensor_timings{};
     PidArgs pid_args{
         .left{
             .motor{GPIO_NUM_15, GPIO_NUM_32, GPIO_NUM_14, GPIO_NUM_21, LeftMotor, true},
-            .linear_velocity_distance_pid{d_kp, d_ki, d_kd},
-            .angular_velocity_angle_pid{a_kp, a_ki, a_kd},
-            .velocity_pid{v_kp, v_ki, v_kd},
-            .distance_linear_Kv = d_kv,
-            .distance_angular_Kv = a_kv,
-            .velocity_Kv = v_kv,
-            .Ks = 0.71f,
+            .linear_velocity_distance_pid = motor_pid(gains.distance),
+            .angular_velocity_angle_pid = motor_pid(gains.angle),
+            .velocity_pid = motor_pid(gains.velocity),
+            .linear_schedule = linear_schedule,
+            .angular_schedule = angular_schedule,
+            .velocity_schedule = velocity_schedule,
+            .distance_linear_Kv = gains.distance_linear_Kv,
+            .distance_angular_Kv = gains.distance_angular_Kv,
+            .velocity_Kv = gains.velocity_Kv,
+            .velocity_Ka = gains.velocity_Ka,
+            .Ks = gains.Ks,
             .output = 0.0f,
             .wanted_velocity{},
+            .wanted_acceleration = 0.0f,
             .current_velocity{},
         },
         .right{
             .motor{GPIO_NUM_33, GPIO_NUM_27, GPIO_NUM_12, GPIO_NUM_18, RightMotor, true},
-            .linear_velocity_distance_pid{d_kp, d_ki, d_kd},
-            .angular_velocity_angle_pid{a_kp, a_ki, a_kd},
-            .velocity_pid{v_kp, v_ki, v_kd},
-            .distance_linear_Kv = d_kv,
-            .distance_angular_Kv = a_kv,
-            .velocity_Kv = v_kv,
-            .Ks = 0.71f,
+            .linear_velocity_distance_pid = motor_pid(gains.distance),
+            .angular_velocity_angle_pid = motor_pid(gains.angle),
+            .velocity_pid = motor_pid(gains.velocity),
+            .linear_schedule = linear_schedule,
+            .angular_schedule = angular_schedule,
+            .velocity_schedule = velocity_schedule,
+            .distance_linear_Kv = gains.distance_linear_Kv,
+            .distance_angular_Kv = gains.distance_angular_Kv,
+            .velocity_Kv = gains.velocity_Kv,
+            .velocity_Ka = gains.velocity_Ka,
+            .Ks = gains.Ks,
             .output = 0.0f,
             .wanted_velocity{},
+            .wanted_acceleration = 0.0f,
             .current_velocity{},
         },
         .target_pos{start_pos},
         .pos{start_pos},
-        .sensors_available = false,
+        .linear_profile{},
+        .profile_ticks = 0,
+        .control_mode = default_control_mode,
+        .tracker = PathTracker{path},
+        .mailbox = nullptr,
     };
+    const auto path_available = path.build(waypoints, linear_motion_limits);
+#if CONFIG_MOTOR_IDENTIFICATION
+    identify_motors(pid_args.left, pid_args.right);
+#endif
+    load_feed_forward(pid_args.left);
+    load_feed_forward(pid_args.right);
+    load_tuned_gains(pid_args);
+#if CONFIG_PID_AUTOTUNE
+    autotune(pid_args, autotune_rule);
+#endif
 
-    // start delay, log setup and sensors warmup:
-    print_log(pid_args);
-    sleep(10);
-    for (auto i = 0; i < DistanceSensors::avg_filter_size; i++)  // warmup
+    // From now on, the main loop only talks to the PID loop through the mailbox.
+    ControlMailbox mailbox{
+        control_loop.state(pid_args, distance_sensors, meters_per_second{0.0f}, VelocityProfile::seconds::zero())
+    };
+    pid_args.mailbox = &mailbox;
+
+    const auto start_segment = [&](const Position &from, const Position &to)
+    { mailbox.start_profile(segment_profile(from, to, mailbox.state().reference_velocity)); };
+    if (alg_pos)
     {
-        distance_sensors.read_all();
+        start_segment(start_pos, *alg_pos);
     }
-    print_log(pid_args);
+    auto last_waypoint = start_pos;  // The last waypoint reached
+    mailbox.send();
 
-    static constexpr auto max_diff_distance = 20.0_mm;
-    static constexpr Angle max_diff_angle{std::numbers::pi_v<float> / 60};
+    // start delay, log setup and sensors warmup:
+    print_log(mailbox.state());
+    pid_args.control_mode = select_control_mode(pid_args.control_mode, 10s);
+    if (pid_args.control_mode != ControlMode::Waypoints && !path_available)
+    {
+        std::printf("The route can't be followed as a path, using waypoints instead\n");
+        pid_args.control_mode = ControlMode::Waypoints;
+    }
+    pid_args.tracker.set_law(
+        pid_args.control_mode == ControlMode::Stanley ? SteeringLaw::Stanley : SteeringLaw::PurePursuit
+    );
+#if CONFIG_FLIGHT_RECORDER
+    start_flight_recorder();  // Before the warmup, to record its frames for the replay's filters
+#endif
+    for (auto i = 0; i < DistanceSensors::filter_window; i++)  // warmup (fill the filters' windows)
+    {
+        [[maybe_unused]] const auto frame = distance_sensors.read_all();
+#if CONFIG_FLIGHT_RECORDER
+        if (frame)
+        {
+            flight_recorder.record(flight_warmup_record(*frame));
+        }
+#endif
+    }
+    distance_sensors.start_acquisition();
+    print_log(mailbox.state());
+#if CONFIG_BINARY_TELEMETRY
+    start_telemetry();
+#endif
 
     // start PID task
     pid_args.left.motor.clear_encoder();
     pid_args.right.motor.clear_encoder();
+    control_loop.restart();  // The auto-tuning's slips aren't the run's
+#if CONFIG_CONTROL_TASK
+    ControlTask pid_caller(pid_loop, static_cast<void *>(&pid_args), CONFIG_CONTROL_TASK_CORE);
+#else
     PeriodicCaller pid_caller(pid_loop, static_cast<void *>(&pid_args));
+#endif
     pid_caller.start(pid_loop_period);
 
+    const auto stop_motors = [&]
+    {
+        pid_caller.stop();
+        pid_args.left.motor.set_pwm(0.0f);
+        pid_args.right.motor.set_pwm(0.0f);
+    };
+
+    // The sensors are read by their own task and taken by the PID loop, so this only paces the planning and the log.
     static constexpr auto loop_interval = 20ms;
-    static_assert(loop_interval >= 20ms, "loop_interval doesn't match with sensor reading times");
     // Main loop
     while (true)
     {
         const auto cycle_start_time = now();
-        distance_sensors.read_all();
-        pid_args.sensors_available = true;
-        if (alg_pos)
+        const auto state = mailbox.state();
+        if (pid_args.control_mode != ControlMode::Waypoints)
         {
-            const auto &next_pos = *alg_pos;
-            pid_args.target_pos = next_pos;
-            const auto x_err = unit_cast<millimeters>((next_pos.x - pid_args.pos.x).get());
-            const auto y_err = unit_cast<millimeters>((next_pos.y - pid_args.pos.y).get());
-            const auto pos_angle_err = next_pos.theta - pid_args.pos.theta;
-            const auto next_direction = to_closest_direction(next_pos.theta);
-            if (std::abs(pos_angle_err.get()) <= max_diff_angle.get()
-                && abs(is_vertical(next_direction) ? y_err : x_err) <= max_diff_distance)
+            // The whole route is a single path, so there's nothing to do until it ends.
+            if (state.profile_time >= path.duration()
+                && unit_cast<millimeters>(path.length() - state.progress) <= max_diff_distance)
             {
-                pid_args.pos = next_pos;  // snap
-                alg_pos = algorithm.get_next();
+                stop_motors();
+            }
+        }
+        else if (alg_pos && planner.replanned())
+        {
+            // The walls changed the route since the held waypoint was taken (like right after reaching the last one,
+            // before the planner task got to its walls), so head for the new route's next waypoint from there.
+            alg_pos = planner.next_waypoint();
+            mailbox.set_target(alg_pos.value_or(last_waypoint));
+            start_segment(last_waypoint, alg_pos.value_or(last_waypoint));
+        }
+        else if (alg_pos)
+        {
+            const auto next_pos = *alg_pos;
+            mailbox.set_target(next_pos);
+            if (reached_waypoint(next_pos, state.pos))
+            {
+                mailbox.reset_pose(next_pos);  // snap
+                last_waypoint = next_pos;
+                if (!planner.report_walls(observe_walls(next_pos, state.distances, state.healthy_sensors)))
+                {
+                    dropped_walls++;
+                }
+                xTaskNotifyGive(planner_task);
+                alg_pos = planner.next_waypoint();
+                if (alg_pos)
+                {
+                    start_segment(next_pos, *alg_pos);
+                }
                 led_state = !led_state;
                 digitalWrite(led_pin, led_state);
             }
         }
+        else if (!planner.finished())
+        {
+            // The planner is behind, hold the last target until it publishes the next waypoint.
+            alg_pos = planner.next_waypoint();
+            if (alg_pos)
+            {
+                start_segment(state.target, *alg_pos);
+            }
+        }
         else
         {
-            pid_caller.stop();
-            pid_args.left.motor.set_pwm(0.0f);
-            pid_args.right.motor.set_pwm(0.0f);
+            stop_motors();
+        }
+        mailbox.send();
+
+        // Trade the sensors' range for rate where it pays off.
+        const auto timings = sensor_timing_policy.plan(
+            meters_per_second{(state.left.velocity.count() + state.right.velocity.count()) / 2},
+            expected_walls(state.pos, maze_map, sensor_timing_config.short_range)
+        );
+        if (timings != sensor_timings)
+        {
+            distance_sensors.set_timings(timings);
+            sensor_timings = timings;
         }
 
         debug_utils::halt_if_input(
             debug_utils::OnHalt(
                 [&]
                 {
-                    pid_caller.stop();
-                    pid_args.left.motor.set_pwm(0.0f);
-                    pid_args.right.motor.set_pwm(0.0f);
+                    stop_motors();
+#if CONFIG_CONTROL_TASK
+                    print_deadline_stats(pid_caller.stats());
+#endif
+                    pid_profiler.dump();
+                    std::printf(
+                        "Slips: %" PRIu32 " Acceleration limit: %g\n",
+                        control_loop.slip_detector().slip_count(),
+                        control_loop.slip_detector().acceleration_limit()
+                    );
+                    std::printf("Dropped wall updates: %" PRIu32 "\n", dropped_walls);
+#if CONFIG_BINARY_TELEMETRY
+                    std::printf("Dropped telemetry records: %" PRIu32 "\n", dropped_telemetry);
+#endif
+#if CONFIG_FLIGHT_RECORDER
+                    flush_flight_log();
+#endif
+                }
+            ),
+            debug_utils::OnResume(
+                [&]
+                {
+                    control_loop.restart();  // The robot may have been moved while halted
+                    pid_caller.start(pid_loop_period);
                 }
             ),
-            debug_utils::OnResume([&] { pid_caller.start(pid_loop_period); }),
             debug_utils::Verbosity::Silent
         );
 
@@ -402,6 +1150,21 @@ extern "C" void app_main()
             delay(1);
         }
 
-        print_log(pid_args, now() - cycle_start_time);
+        if (const auto rates = distance_sensors.take_rates())
+        {
+            sensor_rates = *rates;
+#if !CONFIG_BINARY_TELEMETRY
+            print_sensor_rates(sensor_rates);
+#endif
+        }
+#if CONFIG_BINARY_TELEMETRY
+        // The rates go in every record (a line of text would break the stream).
+        if (!telemetry_queue.push(telemetry_record(mailbox.state(), now() - cycle_start_time, sensor_rates)))
+        {
+            dropped_telemetry++;
+        }
+#else
+        print_log(mailbox.state(), now() - cycle_start_time);
+#endif
     }
 }
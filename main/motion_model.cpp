@@ -1,47 +1,43 @@
 #include "motion_model.h"
 
+#include <misc_utils/fast_math.h>
+
 #include <cmath>
 #include <cstdint>
 
 namespace micromouse
 {
 
+// Below this (half) rotation [rad] per step, sin(x) / x is replaced by its Taylor series.
+static constexpr auto small_angle = 1e-3f;
+
 Position update_pos(const Position &current, meters_per_second vl, meters_per_second vr, const seconds &dt) noexcept
 {
-    Position pos;
-    if (vr == vl)
-    {
-        // Driving in straight line singularity - regular kinematic equations
-        pos.x = current.x + XCoord{vr * std::cos(current.theta) * dt};
-        pos.y = current.y + YCoord{vr * std::sin(current.theta) * dt};
-        pos.theta = current.theta;
-    }
-    else
-    {
-        static constexpr auto l = distance_between_wheels;
-        const auto r = (l / 2) * (vl + vr) / (vl - vr);
-        const auto omega = (vl - vr) / l;
-        const Angle dtheta{(omega * dt).count()};
-        const auto sin_dtheta = std::sin(dtheta);
-        const auto cos_dtheta = std::cos(dtheta);
-        const auto translated_icc_x = XCoord{r * std::sin(current.theta)};
-        const auto translated_icc_y = YCoord{r * std::cos(current.theta)};
-        const auto icc_x = current.x - translated_icc_x;
-        const auto icc_y = current.y + translated_icc_y;
-        pos.x = XCoord{cos_dtheta * translated_icc_x.get()} + XCoord{sin_dtheta * translated_icc_y.get()} + icc_x;
-        pos.y = YCoord{sin_dtheta * translated_icc_x.get()} - YCoord{cos_dtheta * translated_icc_y.get()} + icc_y;
-        pos.theta = current.theta + dtheta;
-    }
-
-    return pos;
+    static constexpr auto l = distance_between_wheels;
+    const auto v = (vl + vr) / 2;
+    const Angle dtheta{((vl - vr) / l * dt).count()};
+    // The robot drives along an arc around the ICC. The displacement is the arc's chord, in the middle heading of the
+    // arc. Unlike going through the ICC, this doesn't lose precision when driving almost straight (huge radius).
+    const auto half_dtheta = dtheta.get() / 2;
+    const auto chord_ratio = std::abs(half_dtheta) < small_angle ? 1 - half_dtheta * half_dtheta / 6
+                                                                 : fast::sin(half_dtheta) / half_dtheta;
+    const auto [sin_heading, cos_heading] = fast::sincos(current.theta + Angle{half_dtheta});
+    const auto chord = v * dt * chord_ratio;
+
+    return {
+        .x = current.x + XCoord{chord * cos_heading},
+        .y = current.y + YCoord{chord * sin_heading},
+        .theta = current.theta + dtheta,
+    };
 }
 
 PosJacobian pos_jacobian(const Position &pos, meters_per_second vl, meters_per_second vr, const seconds &dt) noexcept
 {
     PosJacobian jacobian = PosJacobian::Identity();
     const auto v = (vl + vr) / 2;
-    jacobian(0, 2) = (-v * sin(pos.theta) * dt).count();
-    jacobian(1, 2) = (v * cos(pos.theta) * dt).count();
+    const auto [sin_theta, cos_theta] = fast::sincos(pos.theta);
+    jacobian(0, 2) = (-v * sin_theta * dt).count();
+    jacobian(1, 2) = (v * cos_theta * dt).count();
     return jacobian;
 }
 
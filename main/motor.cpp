@@ -4,13 +4,12 @@
 
 #include <esp_timer.h>
 
-using namespace micromouse::unit_literals;
-
 Motor::Motor(gpio_num_t mcpwm_A, gpio_num_t mcpwm_B, gpio_num_t enc_A, gpio_num_t enc_B, MotorID id, bool reversed)
     noexcept
     : m_motor{nullptr}
     , m_pcnt_encoder{nullptr}
     , m_last_pulse_count{0}
+    , m_velocity_observer{}
     , m_id{id}
     , m_reversed{reversed}
 {
@@ -134,10 +133,7 @@ int Motor::get_enc_ticks() const noexcept
 
 Motor::Distance Motor::ticks_to_distance(int ticks) noexcept
 {
-    // ticks_per_wheel_rotation = ticks_per_motor_rotation * transfer_ratio * gear_ratio
-    static constexpr auto ticks_per_rotation = 48.0f * 9.68f * 18.0f / 25.0f;  // Measured from ticks by rotation ratio
-    static constexpr auto perimeter = std::numbers::pi_v<float> * 3.2e-2_m;    // The wheels' diameter is 3.2 [cm]
-    return perimeter * static_cast<float>(ticks) / ticks_per_rotation;
+    return Distance{wheel_perimeter} * static_cast<float>(ticks) / ticks_per_rotation;
 }
 
 Motor::Velocity Motor::ticks_to_velocity(int ticks, const Time &time) const noexcept
@@ -153,6 +149,12 @@ Motor::Velocity Motor::get_speed(const Time &time_frame) noexcept
     return speed;
 }
 
+const micromouse::VelocityObserver::State &Motor::observe() noexcept
+{
+    const auto position = ticks_to_distance(get_enc_ticks());
+    return m_velocity_observer.update(position, micromouse::VelocityObserver::Timestamp{esp_timer_get_time()});
+}
+
 void Motor::set_pwm(float duty_cycle) noexcept
 {
     if (duty_cycle < 0.0f)
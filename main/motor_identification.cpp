@@ -0,0 +1,101 @@
+#include "motor_identification.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace micromouse
+{
+
+static constexpr float sign(float x) noexcept
+{
+    return x > 0.0f ? 1.0f : x < 0.0f ? -1.0f : 0.0f;
+}
+
+meters_per_second MotorModel::step(meters_per_second velocity, float command, seconds dt) const noexcept
+{
+    auto direction = sign(velocity.count());
+    if (direction == 0.0f)
+    {
+        if (std::abs(command) <= Ks)
+        {
+            return meters_per_second{0.0f};
+        }
+        direction = sign(command);
+    }
+    const auto target = (command - direction * Ks) / Kv;
+    const auto decay = std::exp(-dt.count() / tau);
+    const auto next = target + (velocity.count() - target) * decay;
+    // The friction only stops the motor, it doesn't reverse it.
+    return meters_per_second{direction * next < 0.0f ? 0.0f : next};
+}
+
+std::optional<float> Excitation::command(seconds time) noexcept
+{
+    if (time < seconds::zero())
+    {
+        return std::nullopt;
+    }
+    if (time < steps_duration)
+    {
+        const auto step_period = step_duration + coast_duration;
+        const auto index = static_cast<std::size_t>(time / step_period);
+        if (time - index * step_period >= step_duration)
+        {
+            return 0.0f;
+        }
+        return (index % 2 == 0 ? 1.0f : -1.0f) * step_commands[index / 2];
+    }
+    const auto t = (time - steps_duration).count();
+    if (t >= chirp_duration.count())
+    {
+        return std::nullopt;
+    }
+    // The frequency rises linearly, so the phase is the integral: 2 * pi * (f0 * t + (f1 - f0) * t^2 / (2 * T)).
+    const auto sweep_rate = (chirp_end_frequency - chirp_start_frequency) / chirp_duration.count();
+    const auto phase = 2 * std::numbers::pi_v<float> * (chirp_start_frequency * t + sweep_rate * t * t / 2);
+    return chirp_amplitude * std::sin(phase);
+}
+
+void MotorIdentifier::add(float command, meters_per_second velocity) noexcept
+{
+    if (m_has_previous && std::abs(m_previous_velocity.count()) >= min_velocity.count())
+    {
+        const Eigen::Vector3f x{m_previous_velocity.count(), m_previous_command, sign(m_previous_velocity.count())};
+        m_normal += x * x.transpose();
+        m_rhs += x * (velocity - m_previous_velocity).count();
+        m_count++;
+    }
+    m_has_previous = true;
+    m_previous_command = command;
+    m_previous_velocity = velocity;
+}
+
+std::optional<MotorModel> MotorIdentifier::fit() const noexcept
+{
+    if (m_count < min_samples)
+    {
+        return std::nullopt;
+    }
+    const auto ldlt = m_normal.ldlt();
+    if (ldlt.info() != Eigen::Success || ldlt.rcond() < 1e-6f)
+    {
+        // The samples don't tell the parameters apart (e.g. a single constant command).
+        return std::nullopt;
+    }
+    const Eigen::Vector3f theta = ldlt.solve(m_rhs);
+    const auto a = 1 + theta[0];
+    const auto b = theta[1];
+    const auto c = theta[2];
+    if (a <= 0.0f || a >= 1.0f || b <= 0.0f)
+    {
+        return std::nullopt;
+    }
+    return MotorModel{
+        .Ks = std::max(-c / b, 0.0f),
+        .Kv = (1 - a) / b,
+        .tau = -m_period.count() / std::log(a),
+    };
+}
+
+}  // namespace micromouse
@@ -0,0 +1,133 @@
+#ifndef MAIN_MOTOR_IDENTIFICATION_H
+#define MAIN_MOTOR_IDENTIFICATION_H
+
+#include <misc_utils/physical_size.h>
+
+#include <Eigen/Dense>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace micromouse
+{
+
+/**
+ * @brief A first order plus deadband model of a motor (with its wheel and the robot's share of the mass).
+ *
+ * The command is in the units `pid_loop` sends to the motor (a fraction of `MotorSpecs::max_speed`):
+ * tau * dv/dt + v = (u - Ks * sign(v)) / Kv
+ * So a command of `Ks` just overcomes the friction, and the steady state velocity grows by 1 / `Kv` per command unit
+ * above it.
+ */
+struct MotorModel
+{
+    using seconds = std::chrono::duration<float>;
+
+    float Ks;   // The friction, in command units.
+    float Kv;   // Command units per [m/s].
+    float tau;  // The time constant [s].
+
+    /**
+     * @brief The command that drives the motor at `velocity` while accelerating at `acceleration` [m/s^2].
+     */
+    constexpr float feed_forward(meters_per_second velocity, float acceleration) const noexcept
+    {
+        const auto sign = velocity.count() > 0.0f ? 1.0f : velocity.count() < 0.0f ? -1.0f : 0.0f;
+        return sign * Ks + Kv * (velocity.count() + tau * acceleration);
+    }
+
+    /**
+     * @brief Simulate the motor for `dt` with a constant `command` (exact for the linear part). The motor doesn't
+     * start moving while the command is within the deadband, and stops instead of reversing when it's braked by
+     * the friction.
+     *
+     * @return The velocity after `dt`.
+     */
+    meters_per_second step(meters_per_second velocity, float command, seconds dt) const noexcept;
+};
+
+/**
+ * @brief The commands that excite the motor for identifying it: steps of increasing size in both directions, each one
+ * followed by a coast to a standstill, and then a chirp (a sine sweeping from `chirp_start_frequency` to
+ * `chirp_end_frequency`).
+ * Every step forward is followed by the same step backwards and the chirp has no mean, so the robot ends up roughly
+ * where it started.
+ */
+class Excitation
+{
+public:
+    using seconds = std::chrono::duration<float>;
+
+    static constexpr std::array step_commands{0.9f, 1.1f, 1.3f, 1.5f};
+    static constexpr seconds step_duration{0.4f};
+    static constexpr seconds coast_duration{0.3f};
+    static constexpr float chirp_amplitude = 1.4f;
+    static constexpr float chirp_start_frequency = 0.5f;  // [Hz]
+    static constexpr float chirp_end_frequency = 6.0f;    // [Hz]
+    static constexpr seconds chirp_duration{4.0f};
+
+    static constexpr seconds steps_duration = 2.0f * step_commands.size() * (step_duration + coast_duration);
+    static constexpr seconds duration = steps_duration + chirp_duration;
+
+    /**
+     * @brief The command at `time` since the start, or nothing when the sequence is over.
+     */
+    static std::optional<float> command(seconds time) noexcept;
+};
+
+/**
+ * @brief Fits a `MotorModel` to a sequence of commands and measured velocities, sampled at a fixed period.
+ *
+ * The model is linear in its discrete form, as long as the motor is moving:
+ * v[k+1] - v[k] = (a - 1) * v[k] + b * u[k] + c * sign(v[k])
+ * Where a = exp(-period / tau), b = (1 - a) / Kv and c = -b * Ks. The samples are accumulated into the normal
+ * equations of the least squares fit, so the memory doesn't depend on the length of the sequence.
+ */
+class MotorIdentifier
+{
+public:
+    using seconds = std::chrono::duration<float>;
+
+    // Slower samples are in the deadband (or just reversing), where the model doesn't hold.
+    static constexpr meters_per_second min_velocity{0.05f};
+    static constexpr std::uint32_t min_samples = 100;
+
+    explicit MotorIdentifier(seconds period) noexcept : m_period{period} {}
+
+    /**
+     * @brief Add the next sample.
+     *
+     * @param command The command sent to the motor for the following period.
+     * @param velocity The velocity measured before sending `command`.
+     */
+    void add(float command, meters_per_second velocity) noexcept;
+
+    /**
+     * @brief The next sample doesn't follow the previous one.
+     */
+    void restart() noexcept { m_has_previous = false; }
+
+    std::uint32_t sample_count() const noexcept { return m_count; }
+
+    /**
+     * @brief Fit the model to the samples so far.
+     *
+     * @return The model, or nothing when there are too few samples or they don't fit a (stable) motor.
+     */
+    std::optional<MotorModel> fit() const noexcept;
+
+private:
+    seconds m_period;
+    Eigen::Matrix3f m_normal = Eigen::Matrix3f::Zero();
+    Eigen::Vector3f m_rhs = Eigen::Vector3f::Zero();
+    std::uint32_t m_count = 0;
+    bool m_has_previous = false;
+    float m_previous_command = 0.0f;
+    meters_per_second m_previous_velocity{0.0f};
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_MOTOR_IDENTIFICATION_H
@@ -0,0 +1,29 @@
+#ifndef MAIN_MOTOR_SPECS_H
+#define MAIN_MOTOR_SPECS_H
+
+#include <numbers>
+
+/**
+ * @brief The motors' physical limits, PWM and encoders, kept apart from `Motor` so they can be used without the
+ * hardware drivers (e.g. by the simulator).
+ */
+struct MotorSpecs
+{
+    // Theoretical max speed = (max_rpm / 60) * (wheel_gear_teeth_N / motor_gear_teeth_N) * wheel_Perimeter
+    static constexpr float max_theoretical_speed = 590.0f / 60.0f * 25.0f / 18.0f * 0.032f * std::numbers::pi_v<float>;
+    static constexpr float max_speed = 1.94386f;                            // [m/s]
+    static constexpr float max_angular_velocity = 2 * max_speed / 9.9e-2f;  // [rad/s]
+    static constexpr float max_acceleration = 9.5f;                         // [m/s^2]
+
+    static constexpr int bdc_mcpwm_timer_resolution_hz = 10'000'000;  // 10MHz, 1 tick = 0.1us
+    static constexpr int bdc_mcpwm_freq_hz = 25'000;                  // 25KHz PWM
+    // maximum value we can set for the duty cycle, in ticks
+    static constexpr int bdc_mcpwm_duty_tick_max = (bdc_mcpwm_timer_resolution_hz / bdc_mcpwm_freq_hz);
+
+    // ticks_per_wheel_rotation = ticks_per_motor_rotation * transfer_ratio * gear_ratio
+    // Measured from ticks by rotation ratio
+    static constexpr float ticks_per_rotation = 48.0f * 9.68f * 18.0f / 25.0f;
+    static constexpr float wheel_perimeter = std::numbers::pi_v<float> * 3.2e-2f;  // [m] The wheels' diameter is 3.2 cm
+};
+
+#endif  // MAIN_MOTOR_SPECS_H
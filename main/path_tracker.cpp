@@ -0,0 +1,353 @@
+#include "path_tracker.h"
+
+#include <misc_utils/fast_math.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+namespace micromouse
+{
+
+// Waypoints closer than this are the same point, and corners closer than this to one of the supported turn angles
+// are rounded to it.
+static constexpr auto distance_tolerance = 1e-3f;  // [m]
+static constexpr auto angle_tolerance = 1e-2f;     // [rad]
+static constexpr auto projection_iterations = 3;
+
+namespace
+{
+
+struct Point
+{
+    float x;
+    float y;
+};
+
+}  // namespace
+
+static Point to_point(const Position &pos) noexcept
+{
+    return {.x = pos.x->count(), .y = pos.y->count()};
+}
+
+static float heading(const Point &from, const Point &to) noexcept
+{
+    return static_cast<float>(fast::atan2(to.y - from.y, to.x - from.x));
+}
+
+static float distance(const Point &from, const Point &to) noexcept
+{
+    return fast::hypot(to.x - from.x, to.y - from.y);
+}
+
+/**
+ * @brief The turn that rounds a corner where the heading changes by `angle` (wrapped to [-pi, pi)).
+ */
+static std::optional<TurnType> corner_turn(float angle) noexcept
+{
+    for (const auto type : {TurnType::Turn45, TurnType::Turn90, TurnType::Turn135})
+    {
+        if (std::abs(std::abs(angle) - get_turn(type).angle) < angle_tolerance)
+        {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief The distance from the start (and the end) of a turn to the intersection of its entry and exit lines.
+ * The turns are symmetric, so it's the same on both sides.
+ */
+static float corner_distance(const TurnPrimitive &turn) noexcept
+{
+    return turn.end().y / fast::sin(turn.angle);
+}
+
+bool Path::build(std::span<const Position> waypoints, const MotionLimits &limits) noexcept
+{
+    m_size = 0;
+    m_length = 0.0f;
+    m_duration = 0.0f;
+
+    // The corners of the polyline (including both ends)
+    std::array<Point, max_segments + 1> corners{};
+    std::size_t corner_count = 0;
+    for (const auto &waypoint : waypoints)
+    {
+        const auto point = to_point(waypoint);
+        if (corner_count > 0 && distance(corners[corner_count - 1], point) < distance_tolerance)
+        {
+            continue;
+        }
+        if (corner_count > 1)
+        {
+            const auto change = static_cast<float>(
+                Angle{heading(corners[corner_count - 1], point)}
+                - Angle{heading(corners[corner_count - 2], corners[corner_count - 1])}
+            );
+            if (std::abs(change) < angle_tolerance)
+            {
+                // Still on the same straight line
+                corners[corner_count - 1] = point;
+                continue;
+            }
+        }
+        if (corner_count == corners.size())
+        {
+            return false;
+        }
+        corners[corner_count++] = point;
+    }
+    if (corner_count < 2 || 2 * corner_count - 3 > max_segments)
+    {
+        return false;
+    }
+    const auto straight_count = corner_count - 1;
+
+    // The turns in the corners, and the straights between them
+    std::array<TurnType, max_segments> turns{};
+    std::array<TurnSide, max_segments> sides{};
+    std::array<meters, max_segments> lengths{};
+    std::array<meters_per_second, max_segments + 1> junctions{};
+    for (std::size_t i = 1; i + 1 < corner_count; i++)
+    {
+        const auto change = static_cast<float>(
+            Angle{heading(corners[i], corners[i + 1])} - Angle{heading(corners[i - 1], corners[i])}
+        );
+        const auto turn = corner_turn(change);
+        if (!turn)
+        {
+            return false;
+        }
+        turns[i] = *turn;
+        sides[i] = change > 0 ? TurnSide::Right : TurnSide::Left;
+        junctions[i] = std::min(get_turn(*turn).max_speed(), limits.max_velocity);
+    }
+    for (std::size_t i = 0; i < straight_count; i++)
+    {
+        auto length = distance(corners[i], corners[i + 1]);
+        if (i > 0)
+        {
+            length -= corner_distance(get_turn(turns[i]));
+        }
+        if (i + 1 < straight_count)
+        {
+            length -= corner_distance(get_turn(turns[i + 1]));
+        }
+        if (length < -distance_tolerance)
+        {
+            return false;
+        }
+        lengths[i] = meters{std::max(length, 0.0f)};
+    }
+    plan_junction_velocities(
+        std::span{lengths}.first(straight_count),
+        std::span{junctions}.first(straight_count + 1),
+        limits
+    );
+
+    // Chain the segments, each one starting where the previous one ends.
+    Position pose{
+        .x = XCoord{meters{corners[0].x}},
+        .y = YCoord{meters{corners[0].y}},
+        .theta = Angle{heading(corners[0], corners[1])},
+    };
+    std::size_t size = 0;
+    auto start_distance = 0.0f;
+    auto start_time = 0.0f;
+    for (std::size_t i = 0; i < straight_count; i++)
+    {
+        if (lengths[i].count() > 0.0f)
+        {
+            const auto profile = VelocityProfile::plan(lengths[i], junctions[i], junctions[i + 1], limits);
+            m_segments[size++] = {
+                .type = SegmentType::Straight,
+                .turn{},
+                .side{},
+                .start = pose,
+                .start_distance = start_distance,
+                .start_time = start_time,
+                .length = lengths[i].count(),
+                .speed = 0.0f,
+                .profile = profile,
+            };
+            const auto [sin_theta, cos_theta] = fast::sincos(pose.theta);
+            pose.x += XCoord{lengths[i] * cos_theta};
+            pose.y += YCoord{lengths[i] * sin_theta};
+            start_distance += lengths[i].count();
+            start_time += profile.duration().count();
+        }
+        if (i + 1 == straight_count)
+        {
+            break;
+        }
+        const auto &turn = get_turn(turns[i + 1]);
+        const auto speed = junctions[i + 1].count();
+        if (speed < distance_tolerance)
+        {
+            // Can't get going before the turn (the first corner is too close to the start).
+            return false;
+        }
+        m_segments[size++] = {
+            .type = SegmentType::Turn,
+            .turn = turns[i + 1],
+            .side = sides[i + 1],
+            .start = pose,
+            .start_distance = start_distance,
+            .start_time = start_time,
+            .length = turn.length(),
+            .speed = speed,
+            .profile{},
+        };
+        pose = turn.sample(sides[i + 1], pose, meters_per_second{1.0f}, seconds{turn.length()}).pos;
+        start_distance += turn.length();
+        start_time += turn.length() / speed;
+    }
+
+    m_size = size;
+    m_length = start_distance;
+    m_duration = start_time;
+    return true;
+}
+
+const Path::Segment &Path::segment_at_distance(float distance) const noexcept
+{
+    const auto segments = std::span{m_segments}.first(m_size);
+    const auto next = std::ranges::upper_bound(segments, distance, {}, &Segment::start_distance);
+    return next == segments.begin() ? segments.front() : *(next - 1);
+}
+
+const Path::Segment &Path::segment_at_time(float time) const noexcept
+{
+    const auto segments = std::span{m_segments}.first(m_size);
+    const auto next = std::ranges::upper_bound(segments, time, {}, &Segment::start_time);
+    return next == segments.begin() ? segments.front() : *(next - 1);
+}
+
+PathPoint Path::at(meters distance) const noexcept
+{
+    if (empty())
+    {
+        return {};
+    }
+    const auto &segment = segment_at_distance(distance.count());
+    const auto s = std::clamp(distance.count() - segment.start_distance, 0.0f, segment.length);
+    if (segment.type == SegmentType::Straight)
+    {
+        const auto [sin_theta, cos_theta] = fast::sincos(segment.start.theta);
+        return {
+            .pos{
+                .x = segment.start.x + XCoord{meters{s * cos_theta}},
+                .y = segment.start.y + YCoord{meters{s * sin_theta}},
+                .theta = segment.start.theta,
+            },
+            .curvature = 0.0f,
+        };
+    }
+    // At 1 m/s the time is the distance.
+    const auto &turn = get_turn(segment.turn);
+    const auto sign = segment.side == TurnSide::Right ? 1.0f : -1.0f;
+    return {
+        .pos = turn.sample(segment.side, segment.start, meters_per_second{1.0f}, seconds{s}).pos,
+        .curvature = sign * turn.curvature(s),
+    };
+}
+
+PathReference Path::sample(seconds time) const noexcept
+{
+    if (empty() || time.count() >= m_duration)
+    {
+        return {.distance = meters{m_length}, .velocity = meters_per_second{0.0f}, .acceleration = 0.0f};
+    }
+    const auto &segment = segment_at_time(time.count());
+    const auto t = std::max(time.count() - segment.start_time, 0.0f);
+    if (segment.type == SegmentType::Straight)
+    {
+        const auto reference = segment.profile.sample(VelocityProfile::seconds{t});
+        return {
+            .distance = meters{segment.start_distance} + std::min(reference.position, meters{segment.length}),
+            .velocity = reference.velocity,
+            .acceleration = reference.acceleration,
+        };
+    }
+    return {
+        .distance = meters{segment.start_distance + std::min(segment.speed * t, segment.length)},
+        .velocity = meters_per_second{segment.speed},
+        .acceleration = 0.0f,
+    };
+}
+
+meters Path::project(const Position &pos, meters hint) const noexcept
+{
+    // Newton's method: move along the tangent by the distance to the perpendicular through `pos`.
+    auto s = std::clamp(hint.count(), 0.0f, m_length);
+    for (auto i = 0; i < projection_iterations; i++)
+    {
+        const auto closest = at(meters{s}).pos;
+        const auto [sin_theta, cos_theta] = fast::sincos(closest.theta);
+        const auto dx = (pos.x - closest.x)->count();
+        const auto dy = (pos.y - closest.y)->count();
+        s = std::clamp(s + dx * cos_theta + dy * sin_theta, 0.0f, m_length);
+    }
+    return meters{s};
+}
+
+Steering PathTracker::update(const Position &pos, meters_per_second velocity) noexcept
+{
+    m_progress = std::max(m_progress, m_path->project(pos, m_progress));
+    const auto closest = m_path->at(m_progress);
+    const auto [sin_path, cos_path] = fast::sincos(closest.pos.theta);
+    const auto dx = (pos.x - closest.pos.x)->count();
+    const auto dy = (pos.y - closest.pos.y)->count();
+    // +y is the right side (the angles are clockwise)
+    const auto cross_track_error = -dx * sin_path + dy * cos_path;
+
+    auto angular_velocity = 0.0f;
+    switch (m_config.law)
+    {
+    case SteeringLaw::PurePursuit:
+    {
+        const auto lookahead =
+            std::max(m_config.min_lookahead.count(), std::abs(velocity.count()) * m_config.lookahead_time);
+        const auto target_distance = m_progress.count() + lookahead;
+        auto target = m_path->at(meters{target_distance}).pos;
+        if (const auto beyond = target_distance - m_path->length().count(); beyond > 0)
+        {
+            // Keep aiming straight ahead after the end of the path.
+            const auto [sin_end, cos_end] = fast::sincos(target.theta);
+            target.x += XCoord{meters{beyond * cos_end}};
+            target.y += YCoord{meters{beyond * sin_end}};
+        }
+        const auto [sin_theta, cos_theta] = fast::sincos(pos.theta);
+        const auto tx = (target.x - pos.x)->count();
+        const auto ty = (target.y - pos.y)->count();
+        const auto lateral = -tx * sin_theta + ty * cos_theta;
+        const auto chord_squared = tx * tx + ty * ty;
+        // The curvature of the arc that is tangent to the heading and passes through the target.
+        const auto curvature = chord_squared > 0.0f ? 2 * lateral / chord_squared : 0.0f;
+        angular_velocity = velocity.count() * curvature;
+        break;
+    }
+    case SteeringLaw::Stanley:
+    {
+        const auto heading_error = static_cast<float>(closest.pos.theta - pos.theta);
+        const auto cross_track_correction = static_cast<float>(fast::atan2(
+            -m_config.cross_track_gain * cross_track_error,
+            std::abs(velocity.count()) + m_config.softening.count()
+        ));
+        angular_velocity = velocity.count() * closest.curvature
+                         + m_config.heading_gain * (heading_error + cross_track_correction);
+        break;
+    }
+    }
+
+    return {
+        .progress = m_progress,
+        .cross_track_error = meters{cross_track_error},
+        .angular_velocity = angular_velocity,
+    };
+}
+
+}  // namespace micromouse
@@ -0,0 +1,198 @@
+#ifndef MAIN_PATH_TRACKER_H
+#define MAIN_PATH_TRACKER_H
+
+#include <misc_utils/physical_size.h>
+
+#include "motion_model.h"
+#include "position.h"
+#include "turn_primitives.h"
+#include "velocity_profile.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace micromouse
+{
+
+/**
+ * @brief A point on a path.
+ */
+struct PathPoint
+{
+    Position pos;
+    float curvature;  // [1/m] Positive to the right (clockwise).
+};
+
+/**
+ * @brief The time-indexed reference along a path.
+ */
+struct PathReference
+{
+    meters distance;  // Distance from the start of the path.
+    meters_per_second velocity;
+    float acceleration;  // [m/s^2]
+};
+
+/**
+ * @brief A continuous path through a list of waypoints: straight lines between the waypoints, with the corners rounded
+ * by turn primitives that are driven without stopping.
+ *
+ * The velocity along the path is planned when it is built: every turn is driven at a constant speed and the straights
+ * between them use jerk-limited profiles. Both the geometry (by distance) and the reference (by time) are evaluated
+ * without allocations, so the path can be used from the control loop.
+ */
+class Path
+{
+public:
+    static constexpr std::size_t max_segments = 32;
+
+    /**
+     * @brief An empty path.
+     */
+    constexpr Path() noexcept = default;
+
+    /**
+     * @brief Build the path in-place (it's too large to be returned on a task's stack).
+     *
+     * @param waypoints The points to pass through. Only the positions are used, the path starts and ends at rest, at
+     * the first and last waypoints. Consecutive duplicates and points in the middle of straight lines are skipped.
+     * @param limits The motion limits. The turns are also limited by their own max speed.
+     * @return Whether the path could be built. Fails when a corner isn't 45, 90 or 135 degrees, when two corners are
+     * too close to fit their turns or when there are too many segments. The path is left empty on failure.
+     */
+    bool build(std::span<const Position> waypoints, const MotionLimits &limits) noexcept;
+
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    constexpr meters length() const noexcept { return meters{m_length}; }
+    constexpr seconds duration() const noexcept { return seconds{m_duration}; }
+
+    /**
+     * @brief The point after driving `distance` along the path (clamped to the path's ends).
+     */
+    PathPoint at(meters distance) const noexcept;
+
+    /**
+     * @brief Sample the reference.
+     *
+     * @param time Time since the start of the path. After the end, the reference stays at the end of the path.
+     */
+    PathReference sample(seconds time) const noexcept;
+
+    /**
+     * @brief Find the distance along the path of the point closest to `pos`.
+     *
+     * @param pos The position to project onto the path.
+     * @param hint A distance near the result (e.g. the previous projection). The search is local, so it doesn't jump
+     * between unrelated parts of the path that happen to be close to each other.
+     */
+    meters project(const Position &pos, meters hint) const noexcept;
+
+private:
+    enum class SegmentType : std::uint8_t
+    {
+        Straight,
+        Turn,
+    };
+
+    struct Segment
+    {
+        SegmentType type;
+        TurnType turn;
+        TurnSide side;
+        Position start;
+        float start_distance;     // [m]
+        float start_time;         // [s]
+        float length;             // [m]
+        float speed;              // [m/s] Turns are driven at a constant speed.
+        VelocityProfile profile;  // Straights only.
+    };
+
+    const Segment &segment_at_distance(float distance) const noexcept;
+    const Segment &segment_at_time(float time) const noexcept;
+
+    std::array<Segment, max_segments> m_segments{};
+    std::size_t m_size = 0;
+    float m_length = 0.0f;    // [m]
+    float m_duration = 0.0f;  // [s]
+};
+
+enum class SteeringLaw : std::uint8_t
+{
+    PurePursuit,
+    Stanley,
+};
+
+/**
+ * @brief The tracker's output for a single control loop iteration.
+ */
+struct Steering
+{
+    meters progress;           // The robot's projection on the path.
+    meters cross_track_error;  // Positive when the robot is to the right of the path.
+    float angular_velocity;    // [rad/s] Clockwise.
+};
+
+/**
+ * @brief Steers the robot along a `Path`. Only the angular velocity is controlled, the linear velocity is left to the
+ * caller (usually the path's reference and a PID on `progress`).
+ *
+ * - Pure pursuit: drive along the arc that reaches the point `lookahead` meters ahead on the path. The lookahead grows
+ *   with the speed, and the path's corners are cut a little (the shorter the lookahead, the less).
+ * - Stanley: feed forward the path's curvature and correct the heading error plus `atan(k * e / v)` of the cross track
+ *   error `e`. Tracks the path exactly but is more sensitive to noise in the estimated position.
+ */
+class PathTracker
+{
+public:
+    struct Config
+    {
+        SteeringLaw law;
+        meters min_lookahead;         // Pure pursuit
+        float lookahead_time;         // [s] Pure pursuit: the lookahead at speed v is `max(min_lookahead, v * time)`.
+        float cross_track_gain;       // [1/s] Stanley
+        float heading_gain;           // [1/s] Stanley: the angular velocity per radian of steering.
+        meters_per_second softening;  // Stanley: keeps the cross track term sane at low speeds.
+    };
+
+    static constexpr Config default_config{
+        .law = SteeringLaw::PurePursuit,
+        .min_lookahead = meters{0.04f},
+        .lookahead_time = 0.08f,
+        .cross_track_gain = 10.0f,
+        .heading_gain = 40.0f,
+        .softening = meters_per_second{0.05f},
+    };
+
+    constexpr explicit PathTracker(const Path &path, const Config &config = default_config) noexcept
+        : m_path{&path}, m_config{config}
+    {}
+
+    /**
+     * @brief Calculate the steering for the current position.
+     *
+     * @param pos The estimated position.
+     * @param velocity The current linear velocity.
+     * @return The steering command. Also advances the progress along the path (it never goes backwards).
+     */
+    Steering update(const Position &pos, meters_per_second velocity) noexcept;
+
+    /**
+     * @brief Restart from the beginning of the path.
+     */
+    constexpr void reset() noexcept { m_progress = meters{0.0f}; }
+
+    constexpr void set_law(SteeringLaw law) noexcept { m_config.law = law; }
+    constexpr const Config &config() const noexcept { return m_config; }
+    constexpr meters progress() const noexcept { return m_progress; }
+
+private:
+    const Path *m_path;
+    Config m_config;
+    meters m_progress{0.0f};
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_PATH_TRACKER_H
@@ -7,7 +7,7 @@ PeriodicCaller::PeriodicCaller(esp_timer_cb_t callback, void *args) noexcept : m
         .arg = args,
         .dispatch_method = ESP_TIMER_TASK,
         .name = "periodic",
-        .skip_unhandled_events = false,
+        .skip_unhandled_events = true,  // Don't call back-to-back to catch up after an overrun
     };
 
     ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &m_loop_timer));
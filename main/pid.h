@@ -0,0 +1,153 @@
+#ifndef MAIN_PID_H
+#define MAIN_PID_H
+
+#include <algorithm>
+#include <concepts>
+#include <limits>
+
+namespace micromouse
+{
+
+template <std::floating_point T>
+struct PidLimits
+{
+    T min_output = -std::numeric_limits<T>::infinity();
+    T max_output = std::numeric_limits<T>::infinity();
+    T min_integral = -std::numeric_limits<T>::infinity();
+    T max_integral = std::numeric_limits<T>::infinity();
+};
+
+/**
+ * @brief Per-tick PID gains (see `Pid`).
+ */
+struct PidGains
+{
+    float kp;
+    float ki;
+    float kd;
+};
+
+/**
+ * @brief Positional PID controller.
+ *
+ * The gains are per-tick (the same convention as ESP-IDF's `pid_ctrl`): the integral is the plain sum of the errors
+ * and the derivative is the plain difference between consecutive errors, so the controller must be called at a fixed
+ * rate.
+ *
+ * Compared to `pid_ctrl` (which this replaces), the controller is a value type that can be fully inlined, and adds:
+ * - Anti-windup: besides the integral limits, the integral never grows past the value that saturates the output, so
+ *   it doesn't have to unwind before the output can leave saturation (assumes `ki >= 0`).
+ * - An optional first order low-pass filter on the derivative term.
+ *
+ * @tparam T The type of the error and the output.
+ */
+template <std::floating_point T>
+class Pid
+{
+public:
+    using value_type = T;
+    using Limits = PidLimits<T>;
+
+    /**
+     * @param kp Proportional gain.
+     * @param ki Integral gain.
+     * @param kd Derivative gain.
+     * @param limits Output and integral limits.
+     * @param derivative_filter The derivative low-pass filter's coefficient, in [0, 1). 0 disables the filter, higher
+     * values filter more.
+     */
+    constexpr Pid(T kp, T ki = 0, T kd = 0, const Limits &limits = {}, T derivative_filter = 0) noexcept
+        : m_kp{kp}
+        , m_ki{ki}
+        , m_inv_ki{1 / ki}
+        , m_kd{kd}
+        , m_derivative_filter{derivative_filter}
+        , m_limits{limits}
+    {}
+
+    /**
+     * @brief Use wanted value and actual value with PID constants to produce the control value.
+     *
+     * @param error Difference between wanted value and actual value.
+     * @return The PID calculated value.
+     */
+    constexpr T calculate_pid(T error) noexcept
+    {
+        m_derivative = m_derivative_filter * m_derivative + (1 - m_derivative_filter) * (error - m_last_error);
+        m_last_error = error;
+
+        const auto proportional_derivative = m_kp * error + m_kd * m_derivative;
+        // Anti-windup: don't let the integral grow beyond what is needed to saturate the output.
+        const auto max_useful_integral =
+            std::max(m_integral, (m_limits.max_output - proportional_derivative) * m_inv_ki);
+        const auto min_useful_integral =
+            std::min(m_integral, (m_limits.min_output - proportional_derivative) * m_inv_ki);
+        m_integral = std::clamp(
+            std::clamp(m_integral + error, m_limits.min_integral, m_limits.max_integral),
+            min_useful_integral,
+            max_useful_integral
+        );
+
+        m_pid_val = std::clamp(proportional_derivative + m_ki * m_integral, m_limits.min_output, m_limits.max_output);
+        return m_pid_val;
+    }
+
+    /**
+     * @brief Clear the controller's history (integral and derivative).
+     */
+    constexpr void reset() noexcept
+    {
+        m_integral = 0;
+        m_last_error = 0;
+        m_derivative = 0;
+        m_pid_val = 0;
+    }
+
+    /**
+     * @brief Change the gains without resetting the controller.
+     */
+    constexpr void set_gains(T kp, T ki, T kd) noexcept
+    {
+        m_kp = kp;
+        m_ki = ki;
+        m_inv_ki = 1 / ki;
+        m_kd = kd;
+    }
+
+    /**
+     * @brief Change the gains without a bump in the output: the integral is rescaled so the integral term doesn't
+     * change (unless the old or the new `ki` is 0). Changing `kp` and `kd` only scales the current error, so gains
+     * that change gradually (see `GainSchedule`) don't kick the output.
+     */
+    constexpr void set_gains_bumpless(T kp, T ki, T kd) noexcept
+    {
+        if (m_ki != 0 && ki != 0)
+        {
+            m_integral *= m_ki / ki;
+        }
+        set_gains(kp, ki, kd);
+    }
+
+    constexpr T get_pid_val() const noexcept { return m_pid_val; }
+    constexpr T get_integral() const noexcept { return m_integral; }
+    constexpr T kp() const noexcept { return m_kp; }
+    constexpr T ki() const noexcept { return m_ki; }
+    constexpr T kd() const noexcept { return m_kd; }
+    constexpr const Limits &limits() const noexcept { return m_limits; }
+
+private:
+    T m_kp;
+    T m_ki;
+    T m_inv_ki;  // Infinite when there is no integral term, which only disables the integral limits.
+    T m_kd;
+    T m_derivative_filter;
+    Limits m_limits;
+    T m_integral = 0;
+    T m_last_error = 0;
+    T m_derivative = 0;
+    T m_pid_val = 0;
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_PID_H
@@ -0,0 +1,222 @@
+#ifndef MAIN_PLANNER_H
+#define MAIN_PLANNER_H
+
+#include <maze_solver/cell.h>
+#include <misc_utils/spsc_queue.h>
+
+#include "position.h"
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace micromouse
+{
+
+/**
+ * @brief The walls around a cell, as seen by the distance sensors.
+ */
+struct WallUpdate
+{
+    std::uint8_t row;
+    std::uint8_t col;
+    Walls walls;  // The walls that were seen
+    Walls known;  // The sides that were checked (there's no wall on the ones that aren't in `walls`)
+};
+
+/**
+ * @brief The next few waypoints of a route.
+ */
+struct WaypointBatch
+{
+    static constexpr std::size_t max_size = 4;
+
+    std::array<Position, max_size> waypoints;
+    std::uint8_t size;
+    std::uint32_t route;  // Counts the replans. A batch of a newer route replaces the older route's waypoints.
+    bool last;            // The route ends with this batch.
+};
+
+/**
+ * @brief Plans the route through the maze (like `AlgorithmApi`).
+ */
+template <typename T>
+concept RoutePlanner = requires(T planner, const WallUpdate &update) {
+    // The route's next waypoint, or nothing when it ends.
+    { planner.get_next() } -> std::same_as<std::optional<Position>>;
+    // Whether the route changed. If so, `get_next` continues with the new route.
+    { planner.update_walls(update) } -> std::convertible_to<bool>;
+};
+
+/**
+ * @brief Runs a `RoutePlanner` in its own task, so that planning (and replanning) never delays the main loop.
+ *
+ * The main loop reports the walls it sees with `report_walls` and takes the route's waypoints with `next_waypoint`
+ * (again when the waypoint it holds was `replanned`).
+ * The planner task calls `step`, which gives the reported walls to the algorithm and publishes the route in batches
+ * of `WaypointBatch::max_size` waypoints, until the route ends or the queue is full. Both directions go through
+ * bounded `SpscQueue`s, so neither side ever waits for the other: a full wall queue drops the update (and says so),
+ * and a full batch queue keeps the batch for the next `step`.
+ *
+ * When the walls change the route, the planner starts over with the new route and publishes the route's number, so the
+ * main loop drops whatever is left of the old route (even the batches that are still queued) right away.
+ *
+ * `step` must always be called from one task, and `report_walls`, `next_waypoint` and `finished` from one other task.
+ *
+ * @tparam Algorithm The route planner (only used by the planner task, once it runs).
+ * @tparam BatchQueueSize The number of batches that can wait for the main loop (a power of 2).
+ * @tparam WallQueueSize The number of wall updates that can wait for the planner (a power of 2).
+ */
+template <RoutePlanner Algorithm, std::size_t BatchQueueSize = 4, std::size_t WallQueueSize = 16>
+class Planner
+{
+public:
+    explicit constexpr Planner(Algorithm &algorithm) noexcept : m_algorithm{algorithm} {}
+
+    // Planner task:
+
+    /**
+     * @brief Give the reported walls to the algorithm and publish as much of the route as the queue can hold.
+     * Never blocks.
+     *
+     * @return Whether anything was done (so the task can sleep until there's something to do).
+     */
+    bool step() noexcept
+    {
+        auto progress = false;
+        auto replan = false;
+        while (const auto update = m_walls.pop())
+        {
+            replan |= static_cast<bool>(m_algorithm.update_walls(*update));
+            progress = true;
+        }
+        if (replan)
+        {
+            m_route++;
+            m_published_route.store(m_route, std::memory_order_release);
+            m_pending.reset();  // Part of the old route
+            m_done = false;
+        }
+
+        while (!m_done || m_pending)
+        {
+            if (!m_pending)
+            {
+                m_pending = next_batch();
+            }
+            if (!m_batches.push(*m_pending))
+            {
+                break;  // Full, try again on the next step.
+            }
+            m_done = m_pending->last;
+            m_pending.reset();
+            progress = true;
+        }
+        return progress;
+    }
+
+    // Main loop:
+
+    /**
+     * @brief Send walls to the planner.
+     *
+     * @return Whether there was room for them (if not, the update is lost).
+     */
+    bool report_walls(const WallUpdate &update) noexcept { return m_walls.push(update); }
+
+    /**
+     * @brief The route's next waypoint, if the planner already published it.
+     */
+    std::optional<Position> next_waypoint() noexcept
+    {
+        if (!receive())
+        {
+            return std::nullopt;
+        }
+        m_taken_route = m_batch.route;
+        return m_batch.waypoints[m_next++];
+    }
+
+    /**
+     * @brief Whether the route was replaced since the last waypoint was taken, so that waypoint isn't on the route
+     * anymore (e.g. it was taken right after reporting the walls that changed the route, before the planner got to
+     * them). Check it on every iteration, and take the new route's `next_waypoint` instead.
+     */
+    bool replanned() const noexcept { return m_taken_route < m_published_route.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Whether every waypoint of the route was taken. Until the walls change it again, that is.
+     */
+    bool finished() noexcept { return !receive() && m_batch.last; }
+
+private:
+    WaypointBatch next_batch() noexcept
+    {
+        WaypointBatch batch{.waypoints{}, .size = 0, .route = m_route, .last = false};
+        while (batch.size < WaypointBatch::max_size)
+        {
+            const auto waypoint = m_algorithm.get_next();
+            if (!waypoint)
+            {
+                batch.last = true;
+                break;
+            }
+            batch.waypoints[batch.size++] = *waypoint;
+        }
+        return batch;
+    }
+
+    /**
+     * @brief Make sure there's a waypoint of the latest route left in the current batch, if the planner published
+     * one: drop the rest of a replaced route, skip the batches that were queued before the replan and take the next
+     * batch once the current one is used up.
+     *
+     * @return Whether there's a waypoint.
+     */
+    bool receive() noexcept
+    {
+        if (m_batch.route < m_published_route.load(std::memory_order_acquire))
+        {
+            m_batch = empty_batch;
+            m_next = 0;
+        }
+        while (m_next == m_batch.size && !m_batch.last)
+        {
+            const auto batch = m_batches.pop();
+            if (!batch)
+            {
+                return false;
+            }
+            if (batch->route < m_published_route.load(std::memory_order_acquire))
+            {
+                continue;  // Replanned since
+            }
+            m_batch = *batch;
+            m_next = 0;
+        }
+        return m_next < m_batch.size;
+    }
+
+    static constexpr WaypointBatch empty_batch{.waypoints{}, .size = 0, .route = 0, .last = false};
+
+    // Planner task
+    Algorithm &m_algorithm;
+    std::uint32_t m_route = 0;
+    std::optional<WaypointBatch> m_pending;  // Didn't fit in the queue yet
+    bool m_done = false;                     // The whole route was queued.
+    // Shared
+    SpscQueue<WallUpdate, WallQueueSize> m_walls;
+    SpscQueue<WaypointBatch, BatchQueueSize> m_batches;
+    std::atomic<std::uint32_t> m_published_route{0};  // The planner's `m_route`
+    // Main loop
+    WaypointBatch m_batch = empty_batch;  // The batch the waypoints are taken from
+    std::size_t m_next = 0;               // In `m_batch`
+    std::uint32_t m_taken_route = 0;      // The route of the last waypoint taken
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_PLANNER_H
@@ -0,0 +1,171 @@
+#ifndef MAIN_POSE_ESTIMATOR_H
+#define MAIN_POSE_ESTIMATOR_H
+
+#include <misc_utils/physical_size.h>
+
+#include "distance_sensor.h"
+#include "distance_sensor_model.h"
+#include "kalman_filter.h"
+#include "motion_model.h"
+#include "position.h"
+#include "segment.h"
+#include "wall_follower.h"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace micromouse
+{
+
+/**
+ * @brief The PID loop's pose estimation: the motion model predicts the pose from the wheels' velocities, and every
+ * sensor frame corrects it, either directly from the corridor's walls (see `corridor_update`) or with the EKF.
+ *
+ * Doesn't touch the hardware, so the host replays recorded runs through the same code (see `FlightReplay`).
+ */
+class PoseEstimator
+{
+public:
+    // The stages of a step, for profiling (see `step`)
+    enum class Stage : std::uint8_t
+    {
+        MotionModel,
+        Corridor,
+        RayCasting,  // `predict_readings`
+        Ekf,
+    };
+
+    // How a step corrected the motion model's prediction
+    enum class Update : std::uint8_t
+    {
+        None,  // No sensor frame
+        Corridor,
+        Ekf,
+    };
+
+    // A sensor frame's input
+    struct Sensors
+    {
+        DistanceSensors::Readings readings;                  // Filtered (see `DistanceSensors::Filters`)
+        std::bitset<DistanceSensors::sensor_count> fresh;    // The readings that are new in this frame
+        std::bitset<DistanceSensors::sensor_count> healthy;  // The sensors that weren't failed
+    };
+
+    struct Estimate
+    {
+        Position pos;
+        Update update;
+        std::bitset<DistanceSensors::sensor_count> fused;  // The readings the EKF fused (its degrees of freedom)
+    };
+
+    static constexpr float default_corridor_gain = 0.5f;
+
+    /**
+     * @param maze_map The walls to cast the sensor rays on.
+     * @param corridor_gain How much to trust the corridor's walls (see `corridor_update`).
+     */
+    explicit PoseEstimator(std::span<const Segment> maze_map, float corridor_gain = default_corridor_gain) noexcept
+        : m_maze_map{maze_map}
+        , m_corridor_gain{corridor_gain}
+    {
+    }
+
+    /**
+     * @brief Advance the pose by one period.
+     *
+     * @param pos The pose at the start of the period.
+     * @param vl The left wheel's velocity.
+     * @param vr The right wheel's velocity.
+     * @param dt The period.
+     * @param sensors The sensor frame taken in this period, if any.
+     * @param on_stage Called with every stage as it ends.
+     */
+    Estimate step(
+        const Position &pos,
+        meters_per_second vl,
+        meters_per_second vr,
+        const seconds &dt,
+        const Sensors *sensors,
+        auto &&on_stage
+    ) noexcept
+    {
+        const auto predicted_pos = update_pos(pos, vl, vr, dt);
+        if (sensors == nullptr)
+        {
+            on_stage(Stage::MotionModel);
+            return {predicted_pos, Update::None, {}};
+        }
+
+        const auto pos_j = pos_jacobian(pos, vl, vr, dt);
+        on_stage(Stage::MotionModel);
+        // The corridor estimate needs every sensor (a failed front sensor would look like an open corridor).
+        const auto corrected = sensors->healthy.all()
+                                 ? corridor_update(predicted_pos, sensors->readings, m_corridor_gain)
+                                 : std::nullopt;
+        if (corrected)
+        {
+            // Inside a corridor the walls give the lateral offset and the heading directly, no need for the EKF. The
+            // covariance still shrinks across the corridor, or it would grow without bound along straight runs.
+            m_kalman_filter.corridor_update(pos_j, corridor_axis(predicted_pos.theta), m_corridor_gain);
+            on_stage(Stage::Corridor);
+            return {*corrected, Update::Corridor, {}};
+        }
+
+        on_stage(Stage::Corridor);
+        auto [distance_sensor_error, distance_sensor_jacobian, valid] =
+            predict_readings(pos, sensors->readings, m_maze_map);
+        for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+        {
+            if (!sensors->fresh.test(i))
+            {
+                // Already fused, or a failed sensor (like a sensor without a valid reading)
+                distance_sensor_error(i) = 0.0f;
+                distance_sensor_jacobian.row(i).setZero();
+            }
+        }
+        on_stage(Stage::RayCasting);
+        // Maybe compensate for the sensors coming later so the reading was in the past...
+        const auto updated_pos = m_kalman_filter(predicted_pos, pos_j, distance_sensor_error, distance_sensor_jacobian);
+        on_stage(Stage::Ekf);
+        return {updated_pos, Update::Ekf, valid & sensors->fresh};
+    }
+
+    Estimate step(
+        const Position &pos,
+        meters_per_second vl,
+        meters_per_second vr,
+        const seconds &dt,
+        const Sensors *sensors
+    ) noexcept
+    {
+        return step(pos, vl, vr, dt, sensors, [](Stage) {});
+    }
+
+    KalmanFilter &kalman_filter() noexcept { return m_kalman_filter; }
+    const KalmanFilter &kalman_filter() const noexcept { return m_kalman_filter; }
+
+private:
+    std::span<const Segment> m_maze_map;
+    float m_corridor_gain;
+    KalmanFilter m_kalman_filter;
+};
+
+constexpr const char *enum2str(PoseEstimator::Update update) noexcept
+{
+    switch (update)
+    {
+    case PoseEstimator::Update::None:
+        return "None";
+    case PoseEstimator::Update::Corridor:
+        return "Corridor";
+    case PoseEstimator::Update::Ekf:
+        return "Ekf";
+    }
+    return "Unknown";
+}
+
+}  // namespace micromouse
+
+#endif  // MAIN_POSE_ESTIMATOR_H
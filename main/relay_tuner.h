@@ -0,0 +1,218 @@
+#ifndef MAIN_RELAY_TUNER_H
+#define MAIN_RELAY_TUNER_H
+
+#include "pid.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <optional>
+#include <span>
+
+namespace micromouse
+{
+
+/**
+ * @brief The point where the loop is on the edge of stability: a proportional controller with `gain` makes it
+ * oscillate with `period`.
+ */
+struct UltimatePoint
+{
+    float gain;
+    std::chrono::duration<float> period;
+};
+
+enum class TuningRule : std::uint8_t
+{
+    ZieglerNichols,  // Fast, with a quarter amplitude decay (a large overshoot).
+    PessenIntegral,  // Faster than Ziegler-Nichols, for loops that must reject disturbances quickly.
+    NoOvershoot,     // Ziegler-Nichols' no overshoot variant.
+    TyreusLuyben,    // Conservative: less overshoot and more robust to a changing plant.
+};
+
+/**
+ * @brief Derive PID gains from the ultimate point with one of the classic rules.
+ *
+ * @param point The loop's ultimate point.
+ * @param rule The rule.
+ * @param tick The PID's period (the gains are per-tick).
+ * @return The gains.
+ */
+inline PidGains tune(const UltimatePoint &point, TuningRule rule, std::chrono::duration<float> tick) noexcept
+{
+    struct Factors
+    {
+        float kp;  // Of the ultimate gain
+        float ti;  // Integral time, of the ultimate period
+        float td;  // Derivative time, of the ultimate period
+    };
+    const auto factors = [&]() -> Factors
+    {
+        switch (rule)
+        {
+        case TuningRule::ZieglerNichols:
+            return {.kp = 0.6f, .ti = 0.5f, .td = 0.125f};
+        case TuningRule::PessenIntegral:
+            return {.kp = 0.7f, .ti = 0.4f, .td = 0.15f};
+        case TuningRule::NoOvershoot:
+            return {.kp = 0.2f, .ti = 0.5f, .td = 1.0f / 3.0f};
+        case TuningRule::TyreusLuyben:
+            return {.kp = 1.0f / 2.2f, .ti = 2.2f, .td = 1.0f / 6.3f};
+        }
+        return {.kp = 0.0f, .ti = 1.0f, .td = 0.0f};
+    }();
+    const auto kp = factors.kp * point.gain;
+    const auto ticks_per_period = point.period / tick;
+    return {
+        .kp = kp,
+        .ki = kp / (factors.ti * ticks_per_period),
+        .kd = kp * factors.td * ticks_per_period,
+    };
+}
+
+/**
+ * @brief Relay feedback auto-tuner (Astrom-Hagglund).
+ *
+ * Instead of the PID, the loop is closed with a relay: the output is +`amplitude` when the error is positive and
+ * -`amplitude` when it's negative. Most plants then settle into a limit cycle at their ultimate period, and the
+ * describing function of the relay gives the ultimate gain from the oscillation's amplitude `a`:
+ * Ku = 4 * amplitude / (pi * sqrt(a^2 - hysteresis^2))
+ * The hysteresis keeps the measurement noise from switching the relay back and forth.
+ *
+ * The first `settle_cycles` cycles are ignored, then the tuner is done when the last `cycles` cycles agree with each
+ * other (within `tolerance`).
+ */
+class RelayTuner
+{
+public:
+    using seconds = std::chrono::duration<float>;
+
+    static constexpr std::size_t max_cycles = 8;
+
+    struct Config
+    {
+        float amplitude;             // The relay's output
+        float hysteresis;            // The error must cross +-hysteresis to switch the relay.
+        std::uint8_t settle_cycles;  // Cycles to ignore at the start
+        std::uint8_t cycles;         // Cycles to average, up to `max_cycles`
+        float tolerance;             // The max relative spread of the periods and amplitudes of the averaged cycles
+        seconds timeout;             // Give up when there is no steady oscillation by then.
+    };
+
+    /**
+     * @param config The relay's configuration.
+     * @param tick The period `update` is called at.
+     */
+    constexpr RelayTuner(const Config &config, seconds tick) noexcept : m_config{config}, m_tick{tick}
+    {
+        m_config.cycles = std::clamp<std::uint8_t>(m_config.cycles, 1, max_cycles);
+    }
+
+    /**
+     * @brief Switch the relay by the current error.
+     *
+     * @param error The difference between the setpoint and the measurement.
+     * @return The relay's output (0 when done).
+     */
+    constexpr float update(float error) noexcept
+    {
+        if (done())
+        {
+            return 0.0f;
+        }
+        m_ticks++;
+        m_max_error = std::max(m_max_error, error);
+        m_min_error = std::min(m_min_error, error);
+        if (m_output <= 0.0f && error > m_config.hysteresis)
+        {
+            // A rising switch completes a cycle.
+            if (m_switches > 0)
+            {
+                end_cycle();
+            }
+            m_switches++;
+            m_cycle_start = m_ticks;
+            m_max_error = error;
+            m_min_error = error;
+            m_output = m_config.amplitude;
+        }
+        else if (m_output >= 0.0f && error < -m_config.hysteresis)
+        {
+            m_output = -m_config.amplitude;
+        }
+        else if (m_output == 0.0f)
+        {
+            // Within the hysteresis at the start: push towards the error.
+            m_output = std::copysign(m_config.amplitude, error);
+        }
+        if (m_tick * static_cast<float>(m_ticks) >= m_config.timeout)
+        {
+            m_timed_out = true;
+        }
+        return done() ? 0.0f : m_output;
+    }
+
+    constexpr bool done() const noexcept { return m_result.has_value() || m_timed_out; }
+
+    /**
+     * @brief The ultimate point, or nothing while tuning or when there was no steady oscillation before the timeout.
+     */
+    constexpr const std::optional<UltimatePoint> &result() const noexcept { return m_result; }
+
+private:
+    constexpr void end_cycle() noexcept
+    {
+        const auto index = m_cycle_count % m_config.cycles;
+        m_periods[index] = m_tick * static_cast<float>(m_ticks - m_cycle_start);
+        m_amplitudes[index] = (m_max_error - m_min_error) / 2;
+        m_cycle_count++;
+        if (m_cycle_count < static_cast<std::uint32_t>(m_config.settle_cycles + m_config.cycles))
+        {
+            return;
+        }
+
+        const auto periods = std::span{m_periods}.first(m_config.cycles);
+        const auto amplitudes = std::span{m_amplitudes}.first(m_config.cycles);
+        const auto [min_period, max_period] = std::ranges::minmax(periods);
+        const auto [min_amplitude, max_amplitude] = std::ranges::minmax(amplitudes);
+        auto period = seconds::zero();
+        auto amplitude = 0.0f;
+        for (std::size_t i = 0; i < m_config.cycles; i++)
+        {
+            period += periods[i] / static_cast<float>(m_config.cycles);
+            amplitude += amplitudes[i] / static_cast<float>(m_config.cycles);
+        }
+        if (max_period - min_period > m_config.tolerance * period
+            || max_amplitude - min_amplitude > m_config.tolerance * amplitude || amplitude <= m_config.hysteresis)
+        {
+            return;  // Not steady yet
+        }
+        const auto hysteresis = m_config.hysteresis;
+        m_result = UltimatePoint{
+            .gain = 4 * m_config.amplitude
+                  / (std::numbers::pi_v<float> * std::sqrt(amplitude * amplitude - hysteresis * hysteresis)),
+            .period = period,
+        };
+    }
+
+    Config m_config;
+    seconds m_tick;
+    float m_output = 0.0f;
+    std::uint32_t m_ticks = 0;
+    std::uint32_t m_switches = 0;
+    std::uint32_t m_cycle_start = 0;
+    std::uint32_t m_cycle_count = 0;
+    float m_max_error = 0.0f;
+    float m_min_error = 0.0f;
+    std::array<seconds, max_cycles> m_periods{};
+    std::array<float, max_cycles> m_amplitudes{};
+    std::optional<UltimatePoint> m_result;
+    bool m_timed_out = false;
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_RELAY_TUNER_H
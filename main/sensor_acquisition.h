@@ -0,0 +1,264 @@
+#ifndef MAIN_SENSOR_ACQUISITION_H
+#define MAIN_SENSOR_ACQUISITION_H
+
+#include "sensor_health.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace micromouse
+{
+
+/**
+ * @brief An I2C mux that connects one sensor at a time (like SparkFun's `QWIICMUX`).
+ */
+template <typename T>
+concept SensorMux = requires(T mux, std::uint8_t port) {
+    { mux.setPort(port) } -> std::convertible_to<bool>;
+};
+
+/**
+ * @brief A ranging sensor that measures continuously and raises a data ready flag (like SparkFun's `SFEVL53L1X`).
+ */
+template <typename T>
+concept RangingSensor = requires(T sensor) {
+    { sensor.checkForDataReady() } -> std::convertible_to<bool>;
+    { sensor.getDistance() } -> std::convertible_to<std::uint16_t>;
+    sensor.clearInterrupt();
+};
+
+/**
+ * @brief A reading of every sensor.
+ */
+template <std::size_t N>
+struct SensorFrame
+{
+    using Timestamp = typename SensorHealth<N>::Timestamp;
+
+    std::array<std::uint16_t, N> distances;  // [mm]
+    std::array<Timestamp, N> timestamps;     // When each sensor was read
+    std::bitset<N> fresh;                    // The readings that are new since the previous frame
+    std::bitset<N> healthy;                  // The sensors that weren't failed (see `SensorHealth`)
+    std::uint32_t sequence;                  // Counts the frames
+
+    /**
+     * @brief The frame's time: the time of its oldest reading.
+     */
+    constexpr Timestamp timestamp() const noexcept { return std::ranges::min(timestamps); }
+};
+
+/**
+ * @brief Reads sensors that share an I2C mux without blocking.
+ *
+ * Instead of waiting for each sensor's measurement in turn, every `poll` checks the sensors that weren't read yet in
+ * the current frame (each one once) and reads the ready ones. Once every pacing sensor (by default, every sensor) was
+ * read, the frame is complete and the next one starts. So each sensor is read as soon as it has a new measurement, and
+ * a `poll` takes at most a few I2C transactions per sensor, however long the sensors' timing budget is. When the
+ * sensors measure at different rates, only the fastest ones should pace the frames: the others' readings are
+ * included in whichever frame they're read in, and are marked as `fresh` there.
+ *
+ * Switching the mux costs an I2C transaction, so the sensors are checked starting from the one the mux is already
+ * connected to. A failed switch skips the sensor until the next `poll`.
+ *
+ * Every sensor's health is tracked (see `SensorHealth`): a failed sensor isn't polled and frames don't wait for it
+ * until `recover` re-initializes it, so the other sensors keep going without it.
+ *
+ * @tparam Mux The mux.
+ * @tparam Sensor The sensor currently connected through the mux.
+ * @tparam N The number of sensors.
+ */
+template <SensorMux Mux, RangingSensor Sensor, std::size_t N>
+class SensorAcquisition
+{
+public:
+    using Frame = SensorFrame<N>;
+    using Timestamp = typename Frame::Timestamp;
+    using Health = SensorHealth<N>;
+
+    struct Stats
+    {
+        std::uint32_t polls;
+        std::uint32_t checks;        // Data ready checks
+        std::uint32_t mux_switches;  // Successful ones
+        std::uint32_t mux_errors;
+        std::array<std::uint32_t, N> readings;  // Of every sensor
+    };
+
+    /**
+     * @param mux The mux.
+     * @param sensor The sensor currently connected through the mux.
+     * @param ports The mux port of every sensor.
+     * @param health When to fail sensors.
+     */
+    constexpr SensorAcquisition(
+        Mux &mux,
+        Sensor &sensor,
+        const std::array<std::uint8_t, N> &ports,
+        const typename Health::Config &health = {}
+    ) noexcept
+        : m_mux{mux}
+        , m_sensor{sensor}
+        , m_ports{ports}
+        , m_health{health}
+    {}
+
+    /**
+     * @brief Check the healthy sensors that weren't read yet in the current frame, and read the ready ones.
+     *
+     * @param now The current time.
+     * @return The frame, when its last sensor was read. There are no frames while every sensor is failed.
+     */
+    std::optional<Frame> poll(Timestamp now) noexcept
+    {
+        m_stats.polls++;
+        const auto healthy = m_health.healthy();
+        const auto first = m_current;
+        for (std::size_t offset = 0; offset < N; offset++)
+        {
+            const auto i = (first + offset) % N;
+            if (m_collected.test(i) || !healthy.test(i))
+            {
+                continue;
+            }
+            if (!connect(i))
+            {
+                m_health.error(i, now);
+                continue;
+            }
+            m_stats.checks++;
+            if (!m_sensor.checkForDataReady())
+            {
+                continue;
+            }
+            m_frame.distances[i] = m_sensor.getDistance();
+            m_sensor.clearInterrupt();  // Arm the data ready flag for the next measurement.
+            m_frame.timestamps[i] = now;
+            m_collected.set(i);
+            m_stats.readings[i]++;
+            m_health.reading(i, m_frame.distances[i], now);
+        }
+        m_health.check(now);
+
+        // Wait for the healthy pacing sensors, or for every healthy sensor if none of the pacing ones is.
+        const auto pacing = (m_pacing & m_health.healthy()).any() ? m_pacing & m_health.healthy() : m_health.healthy();
+        if (pacing.none() || (m_collected & pacing) != pacing)
+        {
+            return std::nullopt;
+        }
+        m_frame.healthy = m_health.healthy();
+        m_frame.fresh = m_collected & m_frame.healthy;
+        const auto frame = m_frame;
+        m_frame.sequence++;
+        m_collected.reset();
+        return frame;
+    }
+
+    /**
+     * @brief Set the sensors that a frame waits for (at least one).
+     */
+    constexpr void set_pacing(const std::bitset<N> &sensors) noexcept { m_pacing = sensors.any() ? sensors : all; }
+
+    /**
+     * @brief Connect a sensor through the mux and access it (e.g. to reconfigure it), between `poll`s.
+     *
+     * @param i The sensor.
+     * @param access Called with the sensor, if the mux connected it.
+     * @return Whether the mux connected the sensor.
+     */
+    template <std::invocable<Sensor &> F>
+    bool with_sensor(std::size_t i, F &&access) noexcept
+    {
+        if (!connect(i))
+        {
+            return false;
+        }
+        std::forward<F>(access)(m_sensor);
+        return true;
+    }
+
+    /**
+     * @brief Re-initialize the failed sensors that are due for it (see `SensorHealth::due`), between `poll`s.
+     *
+     * @param now The current time.
+     * @param reinit Called with each sensor (connected through the mux) and its index, returns whether it's working
+     * again.
+     * @return The sensors that recovered.
+     */
+    template <std::predicate<Sensor &, std::size_t> F>
+    std::bitset<N> recover(Timestamp now, F &&reinit) noexcept
+    {
+        std::bitset<N> recovered;
+        const auto due = m_health.due(now);
+        for (std::size_t i = 0; i < N; i++)
+        {
+            if (!due.test(i))
+            {
+                continue;
+            }
+            auto working = false;
+            with_sensor(i, [&](Sensor &sensor) { working = std::invoke(reinit, sensor, i); });
+            if (working)
+            {
+                m_health.recovered(i, now);
+                m_collected.reset(i);
+                recovered.set(i);
+            }
+            else
+            {
+                m_health.recovery_failed(i, now);
+            }
+        }
+        return recovered;
+    }
+
+    /**
+     * @brief Fail a sensor from the outside (e.g. when it didn't begin). `recover` will retry it.
+     */
+    constexpr void fail(std::size_t i, SensorFault fault, Timestamp now) noexcept { m_health.fail(i, fault, now); }
+
+    constexpr const Stats &stats() const noexcept { return m_stats; }
+    constexpr const Health &health() const noexcept { return m_health; }
+
+private:
+    static constexpr std::bitset<N> all{~0ULL};
+
+    bool connect(std::size_t i) noexcept
+    {
+        if (m_connected && m_current == i)
+        {
+            return true;
+        }
+        if (!m_mux.setPort(m_ports[i]))
+        {
+            m_stats.mux_errors++;
+            m_connected = false;
+            return false;
+        }
+        m_stats.mux_switches++;
+        m_current = i;
+        m_connected = true;
+        return true;
+    }
+
+    Mux &m_mux;
+    Sensor &m_sensor;
+    std::array<std::uint8_t, N> m_ports;
+    Frame m_frame{};
+    std::bitset<N> m_collected;
+    std::bitset<N> m_pacing = all;
+    std::size_t m_current = 0;  // The sensor the mux is connected to
+    bool m_connected = false;
+    Health m_health;
+    Stats m_stats{};
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_SENSOR_ACQUISITION_H
@@ -0,0 +1,218 @@
+#ifndef MAIN_SENSOR_HEALTH_H
+#define MAIN_SENSOR_HEALTH_H
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace micromouse
+{
+
+/**
+ * @brief Why a sensor was taken out of use.
+ */
+enum class SensorFault : std::uint8_t
+{
+    None,
+    Timeout,     // No reading for too long
+    Stuck,       // The same reading over and over
+    BusErrors,   // Too many I2C errors in a row
+    InitFailed,  // It didn't begin
+};
+
+constexpr const char *enum2str(SensorFault fault) noexcept
+{
+    switch (fault)
+    {
+    case SensorFault::None:
+        return "None";
+    case SensorFault::Timeout:
+        return "Timeout";
+    case SensorFault::Stuck:
+        return "Stuck";
+    case SensorFault::BusErrors:
+        return "BusErrors";
+    case SensorFault::InitFailed:
+        return "InitFailed";
+    }
+    return "Unknown";
+}
+
+/**
+ * @brief Tracks the health of N sensors: a sensor fails when it stops answering, keeps repeating the same reading or
+ * keeps failing on the bus. A failed sensor should be re-initialized every once in a while (see `due`), backing off
+ * exponentially while that fails, and its readings should be ignored until it recovers.
+ *
+ * Readings without a target (0, or `no_target` and farther) repeat even on a healthy sensor (e.g. while the robot is
+ * idle facing an opening), so only the readings of a target count as repeats.
+ *
+ * Only keeps state: the caller reports the readings and errors, and does the re-initialization.
+ *
+ * @tparam N The number of sensors.
+ */
+template <std::size_t N>
+class SensorHealth
+{
+public:
+    using Timestamp = std::chrono::duration<std::int64_t, std::micro>;  // As returned by `esp_timer_get_time`
+
+    struct Config
+    {
+        Timestamp timeout{500'000};               // Without a reading
+        std::uint16_t max_repeats = 100;          // Identical readings of a target in a row
+        std::uint16_t no_target = 1'300;          // [mm] The readings from here on (like 0) don't see a target.
+        std::uint16_t max_errors = 10;            // Bus errors in a row
+        Timestamp retry_interval{100'000};        // Before the first re-initialization
+        Timestamp max_retry_interval{2'000'000};  // The interval doubles after every failed re-initialization.
+    };
+
+    struct Stats
+    {
+        std::array<std::uint32_t, N> failures;
+        std::array<std::uint32_t, N> recoveries;
+        std::array<std::uint32_t, N> errors;  // Bus errors
+    };
+
+    explicit constexpr SensorHealth(const Config &config) noexcept : m_config{config} {}
+
+    /**
+     * @brief A sensor's new reading. Ignored while the sensor is failed.
+     */
+    constexpr void reading(std::size_t i, std::uint16_t distance, Timestamp now) noexcept
+    {
+        if (m_faults[i] != SensorFault::None)
+        {
+            return;
+        }
+        const auto target = distance > 0 && distance < m_config.no_target;
+        const auto repeated = target && m_readings[i] > 0 && distance == m_last_distance[i];
+        m_repeats[i] = repeated ? static_cast<std::uint16_t>(m_repeats[i] + 1) : 0;
+        m_readings[i]++;
+        m_last_distance[i] = distance;
+        m_last_reading[i] = now;
+        m_error_streak[i] = 0;
+        if (m_repeats[i] >= m_config.max_repeats)
+        {
+            fail(i, SensorFault::Stuck, now);
+        }
+    }
+
+    /**
+     * @brief A bus error while accessing a sensor.
+     */
+    constexpr void error(std::size_t i, Timestamp now) noexcept
+    {
+        m_stats.errors[i]++;
+        if (m_faults[i] == SensorFault::None && ++m_error_streak[i] >= m_config.max_errors)
+        {
+            fail(i, SensorFault::BusErrors, now);
+        }
+    }
+
+    /**
+     * @brief Fail the sensors that didn't have a reading for `timeout`. The first check starts every sensor's clock.
+     */
+    constexpr void check(Timestamp now) noexcept
+    {
+        if (!m_started)
+        {
+            m_last_reading.fill(now);
+            m_started = true;
+        }
+        for (std::size_t i = 0; i < N; i++)
+        {
+            if (m_faults[i] == SensorFault::None && now - m_last_reading[i] > m_config.timeout)
+            {
+                fail(i, SensorFault::Timeout, now);
+            }
+        }
+    }
+
+    /**
+     * @brief Take a sensor out of use. Does nothing if it's already failed.
+     */
+    constexpr void fail(std::size_t i, SensorFault fault, Timestamp now) noexcept
+    {
+        if (m_faults[i] != SensorFault::None)
+        {
+            return;
+        }
+        m_faults[i] = fault;
+        m_stats.failures[i]++;
+        m_retry_interval[i] = m_config.retry_interval;
+        m_next_retry[i] = now + m_retry_interval[i];
+    }
+
+    /**
+     * @brief The failed sensors that should be re-initialized now.
+     */
+    constexpr std::bitset<N> due(Timestamp now) const noexcept
+    {
+        std::bitset<N> res;
+        for (std::size_t i = 0; i < N; i++)
+        {
+            res.set(i, m_faults[i] != SensorFault::None && now >= m_next_retry[i]);
+        }
+        return res;
+    }
+
+    /**
+     * @brief A failed sensor was re-initialized: it's back in use, with a fresh timeout.
+     */
+    constexpr void recovered(std::size_t i, Timestamp now) noexcept
+    {
+        if (m_faults[i] == SensorFault::None)
+        {
+            return;
+        }
+        m_faults[i] = SensorFault::None;
+        m_stats.recoveries[i]++;
+        m_readings[i] = 0;
+        m_repeats[i] = 0;
+        m_error_streak[i] = 0;
+        m_last_reading[i] = now;
+    }
+
+    /**
+     * @brief Re-initializing a failed sensor failed: retry later.
+     */
+    constexpr void recovery_failed(std::size_t i, Timestamp now) noexcept
+    {
+        m_retry_interval[i] = std::min(2 * m_retry_interval[i], m_config.max_retry_interval);
+        m_next_retry[i] = now + m_retry_interval[i];
+    }
+
+    constexpr std::bitset<N> healthy() const noexcept
+    {
+        std::bitset<N> res;
+        for (std::size_t i = 0; i < N; i++)
+        {
+            res.set(i, m_faults[i] == SensorFault::None);
+        }
+        return res;
+    }
+
+    constexpr SensorFault fault(std::size_t i) const noexcept { return m_faults[i]; }
+
+    constexpr const Stats &stats() const noexcept { return m_stats; }
+
+private:
+    Config m_config;
+    std::array<SensorFault, N> m_faults{};
+    std::array<Timestamp, N> m_last_reading{};
+    std::array<std::uint16_t, N> m_last_distance{};
+    std::array<std::uint32_t, N> m_readings{};  // Since the sensor was (re)started
+    std::array<std::uint16_t, N> m_repeats{};
+    std::array<std::uint16_t, N> m_error_streak{};
+    std::array<Timestamp, N> m_retry_interval{};
+    std::array<Timestamp, N> m_next_retry{};
+    bool m_started = false;
+    Stats m_stats{};
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_SENSOR_HEALTH_H
@@ -0,0 +1,171 @@
+#ifndef MAIN_SENSOR_TIMING_H
+#define MAIN_SENSOR_TIMING_H
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+namespace micromouse
+{
+
+/**
+ * @brief How a ranging sensor (a VL53L1X) measures.
+ */
+struct SensorTiming
+{
+    std::uint16_t budget;  // [ms] The timing budget: longer is more range and less noise.
+    std::uint16_t period;  // [ms] The inter-measurement period (at least `budget`)
+    bool long_range;       // The long distance mode (up to ~4 m instead of ~1.3 m, but needs a longer budget)
+
+    constexpr bool operator==(const SensorTiming &) const noexcept = default;
+};
+
+/**
+ * @brief What a sensor is for, by the direction it faces.
+ */
+enum class SensorRole : std::uint8_t
+{
+    Front,     // The walls ahead, as far as the robot needs to stop
+    Diagonal,  // The walls of the next cell
+    Side,      // The side walls, for following them and for finding their ends
+};
+
+/**
+ * @brief The role of a sensor that faces `angle` (relative to the robot).
+ */
+constexpr SensorRole sensor_role(Angle angle) noexcept
+{
+    constexpr auto tolerance = std::numbers::pi_v<float> / 8;
+    const auto offset = std::abs(angle.get());
+    if (offset < tolerance)
+    {
+        return SensorRole::Front;
+    }
+    if (offset > std::numbers::pi_v<float> / 2 - tolerance)
+    {
+        return SensorRole::Side;
+    }
+    return SensorRole::Diagonal;
+}
+
+/**
+ * @brief Picks each sensor's timing from the robot's speed and the walls it expects to see, trading range for rate.
+ *
+ * A sensor that expects a wall nearby only needs the short distance mode, and its period is set so the robot moves
+ * at most `travel_per_reading` between readings (so a faster robot gets faster readings). It gets the longest budget
+ * that fits in that period. A sensor that doesn't expect a wall only has to notice one that appears, so it measures
+ * every `idle_period`. The front sensor switches to the long distance mode when the robot's stopping distance
+ * (plus a margin) is beyond the short mode's range and there's no wall expected before that.
+ *
+ * @tparam N The number of sensors.
+ */
+template <std::size_t N>
+class SensorTimingPolicy
+{
+public:
+    using Timings = std::array<SensorTiming, N>;
+
+    // The budgets the VL53L1X supports [ms] (15 ms only in the short distance mode).
+    static constexpr std::array<std::uint16_t, 7> short_budgets{15, 20, 33, 50, 100, 200, 500};
+    static constexpr std::array<std::uint16_t, 6> long_budgets{20, 33, 50, 100, 200, 500};
+    static constexpr std::uint16_t min_long_budget = 33;  // Shorter ones barely reach further than the short mode.
+
+    struct Config
+    {
+        float deceleration;          // [m/s^2] For the stopping distance
+        meters range_margin;         // Beyond the stopping distance
+        meters short_range;          // The short distance mode's range
+        meters travel_per_reading;   // At most, for sensors that expect a wall
+        std::uint16_t idle_period;   // [ms] For sensors that don't expect a wall (and at a standstill)
+        std::uint16_t idle_budget;   // [ms]
+    };
+
+    constexpr SensorTimingPolicy(const Config &config, const std::array<SensorRole, N> &roles) noexcept
+        : m_config{config}
+        , m_roles{roles}
+    {}
+
+    /**
+     * @param speed The robot's forward speed.
+     * @param walls_expected The sensors that expect a wall within the short distance mode's range.
+     * @return Every sensor's timing.
+     */
+    constexpr Timings plan(meters_per_second speed, const std::bitset<N> &walls_expected) const noexcept
+    {
+        const auto period = reading_period(speed);
+        const auto stopping_distance = meters{speed.count() * speed.count() / (2 * m_config.deceleration)};
+        const auto needs_long_range = stopping_distance + m_config.range_margin > m_config.short_range;
+
+        Timings timings{};
+        for (std::size_t i = 0; i < N; i++)
+        {
+            if (m_roles[i] == SensorRole::Front && needs_long_range && !walls_expected.test(i))
+            {
+                const auto budget = std::max(min_long_budget, longest_budget(long_budgets, period));
+                timings[i] = {.budget = budget, .period = std::max(budget, period), .long_range = true};
+            }
+            else if (walls_expected.test(i) && period < m_config.idle_period)
+            {
+                const auto budget = longest_budget(short_budgets, period);
+                timings[i] = {.budget = budget, .period = std::max(budget, period), .long_range = false};
+            }
+            else
+            {
+                timings[i] = {.budget = m_config.idle_budget, .period = m_config.idle_period, .long_range = false};
+            }
+        }
+        return timings;
+    }
+
+    /**
+     * @brief The sensors that should pace the frames: the fastest ones. A frame waits for a new reading from each of
+     * them, and includes whatever the others measured in the meantime.
+     */
+    static constexpr std::bitset<N> pacing(const Timings &timings) noexcept
+    {
+        const auto fastest = std::ranges::min(timings, {}, &SensorTiming::period).period;
+        std::bitset<N> sensors;
+        for (std::size_t i = 0; i < N; i++)
+        {
+            sensors.set(i, timings[i].period == fastest);
+        }
+        return sensors;
+    }
+
+private:
+    /**
+     * @brief The period between readings for moving `travel_per_reading` [ms].
+     */
+    constexpr std::uint16_t reading_period(meters_per_second speed) const noexcept
+    {
+        const auto seconds = m_config.travel_per_reading.count() / std::abs(speed.count());
+        if (!(seconds * 1000 < m_config.idle_period))  // Also at a standstill (infinity)
+        {
+            return m_config.idle_period;
+        }
+        return std::max(short_budgets.front(), static_cast<std::uint16_t>(seconds * 1000));
+    }
+
+    /**
+     * @brief The longest budget that fits in `period`, or the shortest one.
+     */
+    static constexpr std::uint16_t longest_budget(const auto &budgets, std::uint16_t period) noexcept
+    {
+        const auto fits = std::ranges::upper_bound(budgets, period);
+        return fits == budgets.begin() ? budgets.front() : *(fits - 1);
+    }
+
+    Config m_config;
+    std::array<SensorRole, N> m_roles;
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_SENSOR_TIMING_H
@@ -0,0 +1,797 @@
+#ifndef MAIN_SIMULATOR_H
+#define MAIN_SIMULATOR_H
+
+#include <maze_solver/cell.h>
+#include <maze_solver/direction.h>
+#include <maze_solver/maze.h>
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "algorithm_api_mock.h"
+#include "control_loop.h"
+#include "control_mailbox.h"
+#include "distance_sensor.h"
+#include "distance_sensor_model.h"
+#include "motion_model.h"
+#include "motor_identification.h"
+#include "motor_specs.h"
+#include "path_tracker.h"
+#include "planner.h"
+#include "position.h"
+#include "segment.h"
+#include "temp_map.h"
+#include "velocity_observer.h"
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * A closed loop simulation of the robot on the host: the firmware's control loop (see `ControlLoop`), route planner
+ * (see `Planner`) and main loop's waypoint logic drive a model of the robot through a maze, so changes can be checked
+ * on many mazes (and seeds) in less time than a single run on the robot takes.
+ *
+ * The model is a differential drive robot whose wheels are `MotorModel`s (the same model `MotorIdentifier` fits), with
+ * quantized encoders and VL53L1X-like sensors: rays cast from the true pose on the maze's walls, with noise, a latency
+ * and a period of their own. Everything runs on a simulated clock, so runs are deterministic (given the seed) and as
+ * fast as the host allows.
+ */
+namespace micromouse::sim
+{
+
+using Timestamp = VelocityObserver::Timestamp;
+
+/**
+ * @brief The maze's walls as segments (like `maze_map`), each wall once.
+ */
+template <std::size_t Rows, std::size_t Columns>
+std::vector<Segment> maze_segments(const Maze<Rows, Columns> &maze)
+{
+    std::vector<Segment> segments;
+    const auto corner = [](std::size_t row, std::size_t col)
+    { return Eigen::Vector2f{col * wall_length, row * wall_length}; };
+    for (std::size_t row = 0; row < Rows; row++)
+    {
+        for (std::size_t col = 0; col < Columns; col++)
+        {
+            const auto walls = maze[row, col];
+            // The north and west walls of every cell, and the south and east walls of the last row and column.
+            if ((walls & Walls::North) != empty_walls)
+            {
+                segments.emplace_back(corner(row, col), corner(row, col + 1));
+            }
+            if ((walls & Walls::West) != empty_walls)
+            {
+                segments.emplace_back(corner(row, col), corner(row + 1, col));
+            }
+            if (row == Rows - 1 && (walls & Walls::South) != empty_walls)
+            {
+                segments.emplace_back(corner(row + 1, col), corner(row + 1, col + 1));
+            }
+            if (col == Columns - 1 && (walls & Walls::East) != empty_walls)
+            {
+                segments.emplace_back(corner(row, col + 1), corner(row + 1, col + 1));
+            }
+        }
+    }
+    return segments;
+}
+
+/**
+ * @brief A route through the maze, in the formats the firmware takes it (see `positions` and `waypoints`).
+ */
+struct Route
+{
+    std::vector<Position> positions;  // The targets, stopping (and turning in place) at every corner
+    std::vector<Position> waypoints;  // The same route as a polyline (see `Path`)
+};
+
+/**
+ * @brief The shortest route from the bottom left corner to the maze's center (like the fixed route of `AlgorithmApi`).
+ * The robot starts with its back to the wall, facing the start cell's open side.
+ *
+ * @return The route, or nothing if the center can't be reached.
+ */
+template <std::size_t Rows, std::size_t Columns>
+std::optional<Route> shortest_route(const Maze<Rows, Columns> &maze)
+{
+    struct Cell
+    {
+        std::size_t row;
+        std::size_t col;
+    };
+    static constexpr std::array directions{Direction::North, Direction::East, Direction::South, Direction::West};
+    static constexpr Cell start{Rows - 1, 0};
+    const auto is_goal = [](const Cell &cell)
+    {
+        return (cell.row == Rows / 2 || cell.row == (Rows - 1) / 2)
+            && (cell.col == Columns / 2 || cell.col == (Columns - 1) / 2);
+    };
+    const auto neighbor = [](const Cell &cell, Direction d) -> Cell
+    {
+        switch (d)
+        {
+        case Direction::North:
+            return {cell.row - 1, cell.col};
+        case Direction::East:
+            return {cell.row, cell.col + 1};
+        case Direction::South:
+            return {cell.row + 1, cell.col};
+        case Direction::West:
+            return {cell.row, cell.col - 1};
+        }
+        return cell;
+    };
+
+    // Breadth first search, remembering the direction each cell was entered from.
+    std::array<std::array<std::optional<Direction>, Columns>, Rows> entered{};
+    std::deque<Cell> queue{start};
+    std::optional<Cell> goal;
+    while (!queue.empty() && !goal)
+    {
+        const auto cell = queue.front();
+        queue.pop_front();
+        for (const auto d : directions)
+        {
+            if ((maze[cell.row, cell.col] & static_cast<Walls>(std::to_underlying(d))) != empty_walls)
+            {
+                continue;
+            }
+            const auto next = neighbor(cell, d);
+            if ((next.row == start.row && next.col == start.col) || entered[next.row][next.col])
+            {
+                continue;
+            }
+            entered[next.row][next.col] = d;
+            if (is_goal(next))
+            {
+                goal = next;
+                break;
+            }
+            queue.push_back(next);
+        }
+    }
+    if (!goal)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<std::pair<Cell, Direction>> moves;  // Into each cell, from the goal back to the start
+    for (auto cell = *goal; cell.row != start.row || cell.col != start.col;)
+    {
+        const auto d = *entered[cell.row][cell.col];
+        moves.emplace_back(cell, d);
+        cell = neighbor(cell, turn_back(d));
+    }
+    std::ranges::reverse(moves);
+
+    auto heading = moves.front().second;
+    Route route{.positions{convert(start.row, start.col, heading)}, .waypoints{}};
+    route.waypoints.push_back(route.positions.front());
+    for (std::size_t i = 1; i < moves.size(); i++)
+    {
+        const auto &corner = moves[i - 1].first;
+        const auto next_heading = moves[i].second;
+        if (next_heading != heading)
+        {
+            route.positions.push_back(pivot(corner.row, corner.col, heading, next_heading));
+            route.positions.push_back(turn(corner.row, corner.col, heading, next_heading));
+            route.waypoints.push_back(translate_pos(corner.row, corner.col, heading));
+            heading = next_heading;
+        }
+    }
+    route.positions.push_back(convert(goal->row, goal->col, heading));
+    route.waypoints.push_back(route.positions.back());
+    return route;
+}
+
+/**
+ * @brief Plays a precomputed route (see `RoutePlanner`). The route was planned on the true maze, so the walls never
+ * change it.
+ */
+class RoutePlayer
+{
+public:
+    explicit RoutePlayer(std::span<const Position> positions) noexcept : m_positions{positions} {}
+
+    std::optional<Position> get_next() noexcept
+    {
+        if (m_next < m_positions.size())
+        {
+            return m_positions[m_next++];
+        }
+        return std::nullopt;
+    }
+
+    constexpr bool update_walls(const WallUpdate &) noexcept { return false; }
+
+private:
+    std::span<const Position> m_positions;
+    std::size_t m_next = 0;
+};
+
+/**
+ * @brief A wheel: its motor (see `MotorModel`), driven by the PWM duty cycle, and its encoder. The control loop's
+ * side is `Motor`'s (see `ControlMotor`).
+ */
+class Motor
+{
+public:
+    /**
+     * @param model The motor's dynamics, in the control loop's command units.
+     * @param clock The simulation's clock, for the velocity observer (like `esp_timer_get_time`).
+     */
+    Motor(const MotorModel &model, const Timestamp &clock) noexcept : m_model{model}, m_clock{&clock} {}
+
+    const VelocityObserver::State &observe() noexcept
+    {
+        return m_velocity_observer.update(ticks_to_distance(get_enc_ticks()), *m_clock);
+    }
+
+    void set_pwm(float duty_cycle) noexcept
+    {
+        m_duty_cycle = std::clamp(
+            duty_cycle,
+            -static_cast<float>(MotorSpecs::bdc_mcpwm_duty_tick_max),
+            static_cast<float>(MotorSpecs::bdc_mcpwm_duty_tick_max)
+        );
+    }
+
+    int get_enc_ticks() const noexcept
+    {
+        const auto rotations = m_distance.count() / MotorSpecs::wheel_perimeter;
+        return static_cast<int>(std::floor(rotations * MotorSpecs::ticks_per_rotation));
+    }
+
+    static meters ticks_to_distance(int ticks) noexcept
+    {
+        return meters{MotorSpecs::wheel_perimeter} * static_cast<float>(ticks) / MotorSpecs::ticks_per_rotation;
+    }
+
+    // The plant:
+
+    /**
+     * @brief Drive the wheel with the current duty cycle for `dt`.
+     */
+    void advance(seconds dt) noexcept
+    {
+        const auto command = m_duty_cycle * MotorSpecs::max_speed / MotorSpecs::bdc_mcpwm_duty_tick_max;
+        m_velocity = m_model.step(m_velocity, command, dt);
+        m_distance += m_velocity * dt;
+    }
+
+    meters_per_second velocity() const noexcept { return m_velocity; }
+
+private:
+    MotorModel m_model;
+    const Timestamp *m_clock;
+    VelocityObserver m_velocity_observer{};
+    float m_duty_cycle = 0.0f;
+    meters_per_second m_velocity{0.0f};
+    meters m_distance{0.0f};  // The wheel's true travel
+};
+
+/**
+ * @brief The distance from a sensor to the nearest wall along its ray (what an ideal sensor would read).
+ * Unlike the firmware's model (see `predict_readings`), which only looks a few centimeters ahead, this hits the walls
+ * at any range: the ray is intersected with every wall instead of testing whether the crossing point is on the wall.
+ *
+ * @return The distance, or infinity if there's no wall within `range`.
+ */
+inline meters cast_ray(const Position &pos, std::size_t sensor, std::span<const Segment> walls, meters range) noexcept
+{
+    const auto theta = pos.theta.get();
+    const Eigen::Vector2f offset{sensor_disposition[sensor].first->count(), sensor_disposition[sensor].second->count()};
+    const Eigen::Vector2f origin =
+        Eigen::Vector2f{pos.x->count(), pos.y->count()} + Eigen::Rotation2Df{theta} * offset;
+    const auto direction = theta + sensor_angles[sensor].get();
+    const Eigen::Vector2f ray{std::cos(direction), std::sin(direction)};
+
+    auto best = range.count();
+    bool hit = false;
+    for (const auto &wall : walls)
+    {
+        // origin + t * ray == p1 + u * (p2 - p1)
+        const Eigen::Vector2f along = wall.p2() - wall.p1();
+        const auto denominator = ray.x() * along.y() - ray.y() * along.x();
+        if (std::abs(denominator) < epsilon)
+        {
+            continue;  // Parallel
+        }
+        const Eigen::Vector2f to_wall = wall.p1() - origin;
+        const auto t = (to_wall.x() * along.y() - to_wall.y() * along.x()) / denominator;
+        const auto u = (to_wall.x() * ray.y() - to_wall.y() * ray.x()) / denominator;
+        if (t >= 0.0f && t <= best && u >= -epsilon && u <= 1.0f + epsilon)
+        {
+            best = t;
+            hit = true;
+        }
+    }
+    return hit ? meters{best} : meters{std::numeric_limits<float>::infinity()};
+}
+
+/**
+ * @brief The distance sensors (see `ControlSensors`): every sensor measures once per its period, and its reading
+ * arrives `latency` later. The readings go through the firmware's `DistanceSensors::Filters`.
+ */
+class Sensors
+{
+public:
+    using Frame = DistanceSensors::Frame;
+
+    struct Config
+    {
+        std::array<Timestamp, DistanceSensors::sensor_count> periods;
+        Timestamp latency;  // From the measurement to the frame
+        float noise;        // [mm] The standard deviation
+        meters range;       // Farther walls read as `range`
+    };
+
+    Sensors(const Config &config, std::span<const Segment> walls, std::uint32_t seed) noexcept
+        : m_config{config}
+        , m_walls{walls}
+        , m_gen{seed}
+    {
+        for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+        {
+            m_next_measurement[i] = config.periods[i] * i / DistanceSensors::sensor_count;
+        }
+    }
+
+    /**
+     * @brief Fill the filters' windows (like the firmware's warmup) at the starting pose.
+     */
+    void warm_up(const Position &truth) noexcept
+    {
+        Frame frame{};
+        frame.fresh.set();
+        frame.healthy.set();
+        for (auto i = 0; i < DistanceSensors::filter_window; i++)
+        {
+            for (std::size_t j = 0; j < DistanceSensors::sensor_count; j++)
+            {
+                frame.distances[j] = measure(truth, j);
+            }
+            m_filters.update(frame);
+        }
+    }
+
+    /**
+     * @brief Measure with the sensors that are due and deliver the readings that arrived.
+     *
+     * @param now The simulation's time.
+     * @param truth The robot's true pose.
+     */
+    void update(Timestamp now, const Position &truth) noexcept
+    {
+        for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+        {
+            if (now >= m_next_measurement[i])
+            {
+                m_pending[i].push_back({.distance = measure(truth, i), .time = now});
+                m_next_measurement[i] = now + m_config.periods[i];
+            }
+            while (!m_pending[i].empty() && now >= m_pending[i].front().time + m_config.latency)
+            {
+                m_frame.distances[i] = m_pending[i].front().distance;
+                m_frame.timestamps[i] = m_pending[i].front().time;
+                m_frame.fresh.set(i);
+                m_pending[i].pop_front();
+            }
+        }
+    }
+
+    std::optional<Frame> take_frame() noexcept
+    {
+        if (m_frame.fresh.none())
+        {
+            return std::nullopt;
+        }
+        m_frame.healthy.set();
+        m_frame.sequence++;
+        m_filters.update(m_frame);
+        const auto frame = m_frame;
+        m_frame.fresh.reset();
+        return frame;
+    }
+
+    DistanceSensors::Readings readings() const noexcept { return m_filters.readings(); }
+    std::bitset<DistanceSensors::sensor_count> healthy() const noexcept { return ~0ULL; }
+
+    /**
+     * @brief Sensors with the same period (they're staggered across it).
+     */
+    static constexpr std::array<Timestamp, DistanceSensors::sensor_count> periods(Timestamp period) noexcept
+    {
+        std::array<Timestamp, DistanceSensors::sensor_count> res;
+        res.fill(period);
+        return res;
+    }
+
+private:
+    struct Reading
+    {
+        std::uint16_t distance;  // [mm]
+        Timestamp time;          // Of the measurement
+    };
+
+    std::uint16_t measure(const Position &truth, std::size_t sensor) noexcept
+    {
+        const auto distance = std::min(cast_ray(truth, sensor, m_walls, m_config.range), m_config.range);
+        const auto reading = unit_cast<millimeters>(distance).count() + m_noise(m_gen) * m_config.noise;
+        return static_cast<std::uint16_t>(std::clamp(std::round(reading), 0.0f, 65535.0f));
+    }
+
+    Config m_config;
+    std::span<const Segment> m_walls;
+    std::mt19937 m_gen;
+    std::normal_distribution<float> m_noise{0.0f, 1.0f};
+    std::array<Timestamp, DistanceSensors::sensor_count> m_next_measurement{};
+    std::array<std::deque<Reading>, DistanceSensors::sensor_count> m_pending{};
+    Frame m_frame{};
+    DistanceSensors::Filters m_filters;
+};
+
+struct Config
+{
+    ControlLoop<Motor>::Period period;     // The PID loop's
+    std::uint32_t mission_ticks;           // PID loop iterations per main loop iteration
+    ControlMode control_mode;
+    ControlGains gains;
+    KalmanNoise noise;                     // The pose estimator's EKF's
+    std::array<MotorModel, 2> motors;      // The left and the right motors' true dynamics
+    Sensors::Config sensors;
+    meters robot_radius;                   // Of the body, centered `center_offset` ahead of the wheels' axle (the pose)
+    seconds timeout;                       // Of the simulated time
+    std::uint32_t seed;                    // For the sensors' noise
+};
+
+inline constexpr Config default_config{
+    .period = ControlLoop<Motor>::Period{5000.0f},  // CONFIG_PID_LOOP_PERIOD's default
+    .mission_ticks = 4,  // The main loop's 20 ms
+    .control_mode = ControlMode::Waypoints,
+    .gains = default_control_gains,
+    .noise = default_kalman_noise,
+    .motors{
+        MotorModel{.Ks = 0.7f, .Kv = 1.0f, .tau = 0.05f},
+        MotorModel{.Ks = 0.72f, .Kv = 1.03f, .tau = 0.055f},  // A slightly weaker right motor
+    },
+    .sensors{
+        .periods = Sensors::periods(Timestamp{20'000}),
+        .latency = Timestamp{10'000},
+        .noise = 3.0f,
+        .range = meters{4.0f},
+    },
+    .robot_radius = meters{0.05f},
+    .timeout = seconds{60.0f},
+    .seed = 1,
+};
+
+/**
+ * @brief How a run went.
+ */
+struct Result
+{
+    bool finished;                 // Reached the route's end before the timeout, without touching a wall
+    seconds lap_time;              // Until the main loop stopped the motors (or the timeout)
+    std::uint32_t ticks;           // PID loop iterations
+    meters max_tracking_error;     // Of the true pose from the route's polyline
+    meters rms_tracking_error;
+    meters max_estimation_error;   // Of the estimated position from the true one
+    meters min_clearance;          // From the robot's edge to the nearest wall (negative when it hit one)
+};
+
+/**
+ * @brief Drives the firmware's control loop and main loop logic through a maze, one PID loop period at a time.
+ */
+class Simulator
+{
+public:
+    using PidArgs = ControlLoop<Motor>::PidArgs;
+
+    /**
+     * @param walls The maze's walls (see `maze_segments`). The same walls are the firmware's map.
+     * @param route The route to drive (see `shortest_route`).
+     * @param config The simulation's parameters.
+     */
+    Simulator(std::span<const Segment> walls, const Route &route, const Config &config) noexcept
+        : m_config{config}
+        , m_walls{walls}
+        , m_route{route}
+        , m_path_available{m_path.build(route.waypoints, linear_motion_limits)}
+        , m_control_loop{config.period, m_path, walls}
+        , m_truth{route.positions.front()}
+        , m_sensors{config.sensors, walls, config.seed}
+        , m_algorithm{route.positions}
+        , m_planner{m_algorithm}
+        , m_args{
+              .left{
+                  .motor{config.motors[0], m_now},
+                  .linear_velocity_distance_pid = motor_pid(config.gains.distance),
+                  .angular_velocity_angle_pid = motor_pid(config.gains.angle),
+                  .velocity_pid = motor_pid(config.gains.velocity),
+                  .linear_schedule{},
+                  .angular_schedule{},
+                  .velocity_schedule{},
+                  .distance_linear_Kv = 0.0f,
+                  .distance_angular_Kv = 0.0f,
+                  .velocity_Kv = 0.0f,
+                  .velocity_Ka = 0.0f,
+                  .Ks = 0.0f,
+                  .output = 0.0f,
+                  .wanted_velocity{},
+                  .wanted_acceleration = 0.0f,
+                  .current_velocity{},
+              },
+              .right{
+                  .motor{config.motors[1], m_now},
+                  .linear_velocity_distance_pid = motor_pid(config.gains.distance),
+                  .angular_velocity_angle_pid = motor_pid(config.gains.angle),
+                  .velocity_pid = motor_pid(config.gains.velocity),
+                  .linear_schedule{},
+                  .angular_schedule{},
+                  .velocity_schedule{},
+                  .distance_linear_Kv = 0.0f,
+                  .distance_angular_Kv = 0.0f,
+                  .velocity_Kv = 0.0f,
+                  .velocity_Ka = 0.0f,
+                  .Ks = 0.0f,
+                  .output = 0.0f,
+                  .wanted_velocity{},
+                  .wanted_acceleration = 0.0f,
+                  .current_velocity{},
+              },
+              .target_pos = route.positions.front(),
+              .pos = route.positions.front(),
+              .linear_profile{},
+              .profile_ticks = 0,
+              .control_mode = m_path_available ? config.control_mode : ControlMode::Waypoints,
+              .tracker = PathTracker{m_path},
+              .mailbox = nullptr,
+          }
+        , m_mailbox{m_control_loop.state(m_args, m_sensors, meters_per_second{0.0f}, VelocityProfile::seconds::zero())}
+    {
+        apply_gains(m_args.left, config.gains);
+        apply_gains(m_args.right, config.gains);
+        m_control_loop.pose_estimator().kalman_filter().set_noise(config.noise);
+        m_args.mailbox = &m_mailbox;
+        m_args.tracker.set_law(
+            m_args.control_mode == ControlMode::Stanley ? SteeringLaw::Stanley : SteeringLaw::PurePursuit
+        );
+
+        m_algorithm.get_next();  // The start, taken before the planner runs (like `app_main` does)
+        m_planner.step();
+        m_alg_pos = m_planner.next_waypoint();
+        m_last_waypoint = route.positions.front();
+        if (m_alg_pos)
+        {
+            start_segment(route.positions.front(), *m_alg_pos);
+        }
+        m_mailbox.send();
+        m_sensors.warm_up(m_truth);
+    }
+
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
+
+    /**
+     * @brief Simulate one PID loop period, and the main loop every `Config::mission_ticks` periods.
+     *
+     * @return Whether the run goes on (the main loop didn't stop and there's time left).
+     */
+    bool step() noexcept
+    {
+        if (m_ticks % m_config.mission_ticks == 0 && !mission())
+        {
+            m_stopped = true;
+            return false;
+        }
+
+        m_sensors.update(m_now, m_truth);
+        m_control_loop.step(m_args, m_sensors);
+
+        // The plant, until the next iteration
+        const auto dt = duration_cast<seconds>(m_config.period);
+        const auto vl = m_args.left.motor.velocity();
+        const auto vr = m_args.right.motor.velocity();
+        m_args.left.motor.advance(dt);
+        m_args.right.motor.advance(dt);
+        m_truth = update_pos(
+            m_truth,
+            (vl + m_args.left.motor.velocity()) / 2,
+            (vr + m_args.right.motor.velocity()) / 2,
+            dt
+        );
+        m_now += Timestamp{static_cast<std::int64_t>(m_config.period.count())};
+        m_ticks++;
+        measure();
+        return time() < m_config.timeout;
+    }
+
+    /**
+     * @brief Simulate until the main loop stops the motors or the timeout.
+     */
+    Result run() noexcept
+    {
+        while (step())
+        {
+        }
+        return result();
+    }
+
+    Result result() const noexcept
+    {
+        return {
+            .finished = m_stopped && m_reached_end && m_min_clearance >= 0.0f,
+            .lap_time = time(),
+            .ticks = m_ticks,
+            .max_tracking_error = meters{m_max_tracking_error},
+            .rms_tracking_error = meters{m_ticks > 0 ? std::sqrt(m_tracking_error_sum / m_ticks) : 0.0f},
+            .max_estimation_error = meters{m_max_estimation_error},
+            .min_clearance = meters{m_min_clearance},
+        };
+    }
+
+    seconds time() const noexcept { return duration_cast<seconds>(m_config.period * m_ticks); }
+    const Position &truth() const noexcept { return m_truth; }
+    const PidArgs &args() const noexcept { return m_args; }
+
+private:
+    void start_segment(const Position &from, const Position &to) noexcept
+    {
+        m_mailbox.start_profile(segment_profile(from, to, m_mailbox.state().reference_velocity));
+    }
+
+    /**
+     * @brief The main loop's waypoint logic (see `app_main`). The planner runs synchronously here.
+     *
+     * @return Whether the motors keep running.
+     */
+    bool mission() noexcept
+    {
+        const auto state = m_mailbox.state();
+        if (m_args.control_mode != ControlMode::Waypoints)
+        {
+            if (state.profile_time >= m_path.duration()
+                && unit_cast<millimeters>(m_path.length() - state.progress) <= max_diff_distance)
+            {
+                m_reached_end = true;
+                return false;
+            }
+        }
+        else if (m_alg_pos && m_planner.replanned())
+        {
+            m_alg_pos = m_planner.next_waypoint();
+            m_mailbox.set_target(m_alg_pos.value_or(m_last_waypoint));
+            start_segment(m_last_waypoint, m_alg_pos.value_or(m_last_waypoint));
+        }
+        else if (m_alg_pos)
+        {
+            const auto next_pos = *m_alg_pos;
+            m_mailbox.set_target(next_pos);
+            if (reached_waypoint(next_pos, state.pos))
+            {
+                m_mailbox.reset_pose(next_pos);  // snap
+                m_last_waypoint = next_pos;
+                m_planner.report_walls(observe_walls(next_pos, state.distances, state.healthy_sensors));
+                m_planner.step();
+                m_alg_pos = m_planner.next_waypoint();
+                if (m_alg_pos)
+                {
+                    start_segment(next_pos, *m_alg_pos);
+                }
+            }
+        }
+        else if (!m_planner.finished())
+        {
+            m_planner.step();
+            m_alg_pos = m_planner.next_waypoint();
+            if (m_alg_pos)
+            {
+                start_segment(state.target, *m_alg_pos);
+            }
+        }
+        else
+        {
+            m_reached_end = true;
+            return false;
+        }
+        m_mailbox.send();
+        return true;
+    }
+
+    /**
+     * @brief Update the run's metrics with the current true pose.
+     */
+    void measure() noexcept
+    {
+        const Eigen::Vector2f p{m_truth.x->count(), m_truth.y->count()};
+        // From the point q to the segment ab
+        const auto distance = [](const Eigen::Vector2f &q, const Eigen::Vector2f &a, const Eigen::Vector2f &b)
+        {
+            const Eigen::Vector2f ab = b - a;
+            const auto t = ab.squaredNorm() > 0.0f ? std::clamp((q - a).dot(ab) / ab.squaredNorm(), 0.0f, 1.0f) : 0.0f;
+            return (a + t * ab - q).norm();
+        };
+        const auto point = [](const Position &pos) { return Eigen::Vector2f{pos.x->count(), pos.y->count()}; };
+
+        auto tracking_error = std::numeric_limits<float>::infinity();
+        for (std::size_t i = 1; i < m_route.waypoints.size(); i++)
+        {
+            tracking_error =
+                std::min(tracking_error, distance(p, point(m_route.waypoints[i - 1]), point(m_route.waypoints[i])));
+        }
+        m_max_tracking_error = std::max(m_max_tracking_error, tracking_error);
+        m_tracking_error_sum += tracking_error * tracking_error;
+
+        m_max_estimation_error = std::max(m_max_estimation_error, (point(m_args.pos) - p).norm());
+
+        const auto theta = m_truth.theta.get();
+        const Eigen::Vector2f body = p + center_offset.count() * Eigen::Vector2f{std::cos(theta), std::sin(theta)};
+        for (const auto &wall : m_walls)
+        {
+            const auto clearance = distance(body, wall.p1(), wall.p2()) - m_config.robot_radius.count();
+            m_min_clearance = std::min(m_min_clearance, clearance);
+        }
+    }
+
+    Config m_config;
+    std::span<const Segment> m_walls;
+    const Route &m_route;
+    Path m_path;
+    bool m_path_available;
+    ControlLoop<Motor> m_control_loop;
+    Timestamp m_now{0};
+    std::uint32_t m_ticks = 0;
+    Position m_truth;
+    Sensors m_sensors;
+    RoutePlayer m_algorithm;
+    Planner<RoutePlayer> m_planner;
+    PidArgs m_args;
+    ControlMailbox m_mailbox;
+    std::optional<Position> m_alg_pos;
+    Position m_last_waypoint;  // The last waypoint reached
+    bool m_stopped = false;
+    bool m_reached_end = false;
+    // Metrics
+    float m_max_tracking_error = 0.0f;    // [m]
+    float m_tracking_error_sum = 0.0f;    // [m^2]
+    float m_max_estimation_error = 0.0f;  // [m]
+    float m_min_clearance = std::numeric_limits<float>::infinity();  // [m]
+};
+
+/**
+ * @brief Drive the shortest route to the maze's center.
+ *
+ * @return The run's result, or nothing if the center can't be reached.
+ */
+template <std::size_t Rows, std::size_t Columns>
+std::optional<Result> simulate(const Maze<Rows, Columns> &maze, const Config &config = default_config)
+{
+    const auto route = shortest_route(maze);
+    if (!route)
+    {
+        return std::nullopt;
+    }
+    const auto walls = maze_segments(maze);
+    Simulator simulator{walls, *route, config};
+    return simulator.run();
+}
+
+}  // namespace micromouse::sim
+
+#endif  // MAIN_SIMULATOR_H
@@ -0,0 +1,155 @@
+#ifndef MAIN_SLIP_DETECTOR_H
+#define MAIN_SLIP_DETECTOR_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+namespace micromouse
+{
+
+/**
+ * @brief Detects the wheels slipping (spinning up or locking) and backs off the acceleration limit in response.
+ *
+ * The odometry assumes the wheels roll without slipping, so when an acceleration exceeds the traction the position
+ * silently drifts. Two signs of a slip are used:
+ * - A wheel accelerating differently from what it was commanded to: an unloaded wheel spins up faster than commanded
+ *   and a locked one stops faster. The commanded acceleration is first delayed by `response_time` (the motor's time
+ *   constant plus the velocity observer's lag), so the wheels following the command late isn't a slip.
+ * - The EKF's normalized innovation squared (see `KalmanFilter::normalized_innovation`) jumping over a gate: the
+ *   distance sensors disagree with where the odometry put the robot.
+ *
+ * While slipping (and for `hold` after the last detection) the EKF's process noise is inflated so the sensors pull
+ * the position back. Every slip multiplies the acceleration limit by `backoff` (at most once per `hold`), and the
+ * limit grows back by `recovery` while there is no slip, so the robot settles just under the traction limit.
+ */
+class SlipDetector
+{
+public:
+    using seconds = std::chrono::duration<float>;
+    // The normalized innovation squared's gates, by the number of fused readings (from 1)
+    using InnovationGates = std::array<float, 8>;
+
+    // The chi-square distribution's 99% quantiles, by the degrees of freedom (from 1)
+    static constexpr InnovationGates chi_square_99{6.63f, 9.21f, 11.34f, 13.28f, 15.09f, 16.81f, 18.48f, 20.09f};
+
+    struct Config
+    {
+        float max_acceleration;            // [m/s^2] The limit without slips
+        float min_acceleration;            // [m/s^2] The limit never backs off below this.
+        seconds response_time;             // The delay from the commanded acceleration to the encoders
+        float acceleration_error;          // [m/s^2] A wheel accelerating this far from the (delayed) command slips.
+        std::uint8_t confirm_ticks;        // Consecutive ticks over `acceleration_error` before it counts (noise)
+        InnovationGates innovation_gates;  // A normalized innovation squared over its gate is a slip.
+        float backoff;                     // The limit's factor on every slip, in (0, 1)
+        float recovery;                    // [m/s^3] How fast the limit grows back without slips
+        float process_noise_scale;         // The process noise's factor while slipping
+        seconds hold;                      // How long a slip lasts after it was last detected
+    };
+
+    /**
+     * @brief A wheel's accelerations in the last tick [m/s^2].
+     */
+    struct WheelMotion
+    {
+        float encoder_acceleration;
+        float commanded_acceleration;
+    };
+
+    explicit constexpr SlipDetector(const Config &config) noexcept : m_config{config}, m_limit{config.max_acceleration}
+    {}
+
+    /**
+     * @brief Compare the wheels' motion to the commands, once per tick.
+     *
+     * @param left The left wheel's accelerations.
+     * @param right The right wheel's accelerations.
+     * @param dt The tick's duration.
+     * @return Whether the wheels are slipping.
+     */
+    constexpr bool update(const WheelMotion &left, const WheelMotion &right, seconds dt) noexcept
+    {
+        m_hold_left = std::max(seconds::zero(), m_hold_left - dt);
+        m_since_backoff += dt;
+
+        const auto delay = std::clamp(dt / (m_config.response_time + dt), 0.0f, 1.0f);
+        auto mismatch = false;
+        for (const auto &[wheel, expected] : {std::pair{left, &m_expected_left}, std::pair{right, &m_expected_right}})
+        {
+            *expected += delay * (wheel.commanded_acceleration - *expected);
+            mismatch |= std::abs(wheel.encoder_acceleration - *expected) > m_config.acceleration_error;
+        }
+        m_mismatch_ticks = mismatch ? m_mismatch_ticks + 1 : 0;
+        if (m_mismatch_ticks >= m_config.confirm_ticks)
+        {
+            detect();
+        }
+        else if (!slipping())
+        {
+            m_limit = std::min(m_config.max_acceleration, m_limit + m_config.recovery * dt.count());
+        }
+        return slipping();
+    }
+
+    /**
+     * @brief Check the EKF's latest normalized innovation squared, after every measurement update.
+     *
+     * @param normalized_innovation The normalized innovation squared (see `KalmanFilter::normalized_innovation`).
+     * @param fused The number of readings the update fused (its degrees of freedom).
+     */
+    constexpr void check_innovation(float normalized_innovation, std::size_t fused) noexcept
+    {
+        if (fused == 0)
+        {
+            return;
+        }
+        const auto gate = m_config.innovation_gates[std::min(fused, m_config.innovation_gates.size()) - 1];
+        if (normalized_innovation > gate)
+        {
+            detect();
+        }
+    }
+
+    /**
+     * @brief Start over at the full limit (e.g. after the robot was placed back at the start).
+     */
+    constexpr void reset() noexcept
+    {
+        *this = SlipDetector{m_config};
+    }
+
+    constexpr bool slipping() const noexcept { return m_hold_left > seconds::zero(); }
+    constexpr float acceleration_limit() const noexcept { return m_limit; }
+    constexpr float process_noise_scale() const noexcept { return slipping() ? m_config.process_noise_scale : 1.0f; }
+    constexpr std::uint32_t slip_count() const noexcept { return m_slip_count; }
+
+private:
+    constexpr void detect() noexcept
+    {
+        if (!slipping() || m_since_backoff >= m_config.hold)
+        {
+            m_limit = std::max(m_config.min_acceleration, m_limit * m_config.backoff);
+            m_since_backoff = seconds::zero();
+            m_slip_count++;
+        }
+        m_hold_left = m_config.hold;
+    }
+
+    Config m_config;
+    float m_limit;
+    float m_expected_left = 0.0f;
+    float m_expected_right = 0.0f;
+    std::uint32_t m_mismatch_ticks = 0;
+    std::uint32_t m_slip_count = 0;
+    seconds m_hold_left = seconds::zero();
+    seconds m_since_backoff = seconds::zero();
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_SLIP_DETECTOR_H
@@ -0,0 +1,284 @@
+#ifndef MAIN_STAGE_PROFILER_H
+#define MAIN_STAGE_PROFILER_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <type_traits>
+
+#ifdef ESP_PLATFORM
+#include <esp_cpu.h>
+#include <sdkconfig.h>
+#endif
+
+namespace micromouse::profiler
+{
+
+using Ticks = std::uint32_t;
+
+#ifdef ESP_PLATFORM
+inline constexpr float ticks_per_us = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+
+/**
+ * @brief The CPU cycle counter. Wraps every few seconds, so only differences between close readings are meaningful.
+ */
+inline Ticks now() noexcept
+{
+    return esp_cpu_get_cycle_count();
+}
+#else
+inline constexpr float ticks_per_us = 1e3f;
+
+inline Ticks now() noexcept
+{
+    return static_cast<Ticks>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count()
+    );
+}
+#endif
+
+/**
+ * @brief The distribution of a stage's durations, in constant memory.
+ *
+ * The durations are counted in a log-linear histogram: every power of 2 is split into `sub_buckets` buckets, so the
+ * percentiles are accurate to within 1 / `sub_buckets` (12.5%).
+ */
+class StageStats
+{
+public:
+    static constexpr std::size_t sub_bucket_bits = 3;
+    static constexpr std::size_t sub_buckets = 1 << sub_bucket_bits;
+    static constexpr std::size_t bucket_count =
+        (std::numeric_limits<Ticks>::digits - sub_bucket_bits + 1) * sub_buckets;
+
+    constexpr void record(Ticks duration) noexcept
+    {
+        m_count++;
+        m_total += duration;
+        m_min = std::min(m_min, duration);
+        m_max = std::max(m_max, duration);
+        m_buckets[bucket(duration)]++;
+    }
+
+    constexpr std::uint32_t count() const noexcept { return m_count; }
+    constexpr Ticks min() const noexcept { return m_count > 0 ? m_min : 0; }
+    constexpr Ticks max() const noexcept { return m_max; }
+    constexpr Ticks mean() const noexcept { return m_count > 0 ? static_cast<Ticks>(m_total / m_count) : 0; }
+
+    /**
+     * @brief The duration that `fraction` of the recorded durations didn't exceed (up to the bucket's resolution).
+     */
+    constexpr Ticks percentile(float fraction) const noexcept
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        // The rank (1-based) of the duration in the sorted durations: ceil(fraction * count).
+        const auto exact_rank = fraction * static_cast<float>(m_count);
+        auto rank = static_cast<std::uint32_t>(exact_rank);
+        rank += static_cast<float>(rank) < exact_rank ? 1 : 0;
+        std::uint32_t seen = 0;
+        for (std::size_t i = 0; i < bucket_count; i++)
+        {
+            seen += m_buckets[i];
+            if (seen >= std::max(rank, std::uint32_t{1}))
+            {
+                return std::min(bucket_upper_bound(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    /**
+     * @brief The histogram bucket of a duration. The first `sub_buckets` durations have a bucket each.
+     */
+    static constexpr std::size_t bucket(Ticks duration) noexcept
+    {
+        if (duration < sub_buckets)
+        {
+            return duration;
+        }
+        const auto msb = static_cast<std::size_t>(std::bit_width(duration)) - 1;
+        const auto sub_bucket = (duration >> (msb - sub_bucket_bits)) & (sub_buckets - 1);
+        return (msb - sub_bucket_bits + 1) * sub_buckets + sub_bucket;
+    }
+
+    /**
+     * @brief The longest duration in a bucket.
+     */
+    static constexpr Ticks bucket_upper_bound(std::size_t index) noexcept
+    {
+        if (index < sub_buckets)
+        {
+            return static_cast<Ticks>(index);
+        }
+        const auto msb = index / sub_buckets + sub_bucket_bits - 1;
+        const auto width = std::uint64_t{1} << (msb - sub_bucket_bits);
+        const auto lower_bound = (sub_buckets + index % sub_buckets) * width;
+        return static_cast<Ticks>(lower_bound + width - 1);
+    }
+
+private:
+    std::uint32_t m_count = 0;
+    std::uint64_t m_total = 0;
+    Ticks m_min = std::numeric_limits<Ticks>::max();
+    Ticks m_max = 0;
+    std::array<std::uint32_t, bucket_count> m_buckets{};
+};
+
+/**
+ * @brief Accumulates the durations of the stages of a periodic loop and prints them as a table.
+ *
+ * @tparam Stage An enum of the stages, ending with `Count`.
+ * @tparam Enabled When false, the profiler is empty and all of its methods do nothing, so profiling calls can be left
+ * in the code at no cost.
+ */
+template <typename Stage, bool Enabled = true>
+    requires std::is_enum_v<Stage>
+class StageProfiler
+{
+public:
+    static constexpr auto stage_count = static_cast<std::size_t>(Stage::Count);
+    using Names = std::array<const char *, stage_count>;
+
+    /**
+     * @brief Measures from its construction to its destruction.
+     */
+    class [[nodiscard]] Scope
+    {
+    public:
+        explicit Scope(StageProfiler &profiler, Stage stage) noexcept : m_profiler{profiler}, m_stage{stage}
+        {
+            if constexpr (Enabled)
+            {
+                m_start = now();
+            }
+        }
+        ~Scope()
+        {
+            if constexpr (Enabled)
+            {
+                m_profiler.record(m_stage, now() - m_start);
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        StageProfiler &m_profiler;
+        Stage m_stage;
+        Ticks m_start = 0;
+    };
+
+    /**
+     * @brief Measures consecutive stages without nesting them in scopes: every `lap` ends the current stage and
+     * starts the next one.
+     */
+    class [[nodiscard]] Stopwatch
+    {
+    public:
+        explicit Stopwatch(StageProfiler &profiler) noexcept : m_profiler{profiler}
+        {
+            if constexpr (Enabled)
+            {
+                m_last = now();
+            }
+        }
+
+        /**
+         * @brief Record the time since the previous lap (or the construction) as `stage`.
+         */
+        void lap(Stage stage) noexcept
+        {
+            if constexpr (Enabled)
+            {
+                const auto cur = now();
+                m_profiler.record(stage, cur - m_last);
+                m_last = cur;
+            }
+        }
+
+    private:
+        StageProfiler &m_profiler;
+        Ticks m_last = 0;
+    };
+
+    explicit constexpr StageProfiler(const Names &names) noexcept
+    {
+        if constexpr (Enabled)
+        {
+            m_names = names;
+        }
+    }
+
+    Scope scope(Stage stage) noexcept { return Scope{*this, stage}; }
+    Stopwatch stopwatch() noexcept { return Stopwatch{*this}; }
+
+    constexpr void record(Stage stage, Ticks duration) noexcept
+    {
+        if constexpr (Enabled)
+        {
+            m_stats[static_cast<std::size_t>(stage)].record(duration);
+        }
+    }
+
+    constexpr const StageStats &stats(Stage stage) const noexcept
+        requires Enabled
+    {
+        return m_stats[static_cast<std::size_t>(stage)];
+    }
+
+    constexpr void reset() noexcept
+    {
+        if constexpr (Enabled)
+        {
+            m_stats = {};
+        }
+    }
+
+    /**
+     * @brief Print the table of the stages (in microseconds).
+     */
+    void dump() const noexcept
+    {
+        if constexpr (Enabled)
+        {
+            static constexpr auto us = [](Ticks ticks) { return static_cast<float>(ticks) / ticks_per_us; };
+            std::printf("%-16s %8s %10s %10s %10s %10s [us]\n", "stage", "count", "min", "mean", "p99", "max");
+            for (std::size_t i = 0; i < stage_count; i++)
+            {
+                const auto &stats = m_stats[i];
+                std::printf(
+                    "%-16s %8lu %10.1f %10.1f %10.1f %10.1f\n",
+                    m_names[i],
+                    static_cast<unsigned long>(stats.count()),
+                    us(stats.min()),
+                    us(stats.mean()),
+                    us(stats.percentile(0.99f)),
+                    us(stats.max())
+                );
+            }
+        }
+    }
+
+private:
+    struct Empty
+    {
+    };
+    template <typename T>
+    using Storage = std::conditional_t<Enabled, T, Empty>;
+
+    [[no_unique_address]] Storage<Names> m_names{};
+    [[no_unique_address]] Storage<std::array<StageStats, stage_count>> m_stats{};
+};
+
+}  // namespace micromouse::profiler
+
+#endif  // MAIN_STAGE_PROFILER_H
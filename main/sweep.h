@@ -0,0 +1,681 @@
+#ifndef MAIN_SWEEP_H
+#define MAIN_SWEEP_H
+
+#include <misc_utils/physical_size.h>
+#include <misc_utils/work_stealing_pool.h>
+
+#include "control_loop.h"
+#include "kalman_filter.h"
+#include "motor_identification.h"
+#include "segment.h"
+#include "simulator.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A search for the control loop's parameters on the host: every candidate drives the closed loop simulation (see
+ * `sim::Simulator`, which runs the firmware's feed-forward, PID and EKF code) through a set of mazes and robustness
+ * scenarios (sensor noise seeds, mismatched motors). The runs are independent, so they're spread over all the cores
+ * (see `WorkStealingPool`).
+ *
+ * The candidates come from a grid, from random sampling or from CMA-ES, and are ranked by their worst lap time among
+ * the candidates that meet the robustness constraints (see `Constraints`) in every run.
+ */
+namespace micromouse::sweep
+{
+
+// The swept parameters (see `apply`)
+enum class Parameter : std::uint8_t
+{
+    DistanceKp,
+    DistanceKi,
+    DistanceKd,
+    AngleKp,
+    AngleKi,
+    AngleKd,
+    VelocityKp,
+    VelocityKi,
+    VelocityKd,
+    Ks,
+    PositionNoise,        // The EKF's process noise of x and y
+    HeadingNoise,         // The EKF's process noise of theta
+    SideSensorNoise,      // The EKF's measurement noise of the side sensors
+    DiagonalSensorNoise,  // The EKF's measurement noise of the diagonal sensors
+    FrontSensorNoise,     // The EKF's measurement noise of the front sensor
+    Count,
+};
+
+inline constexpr auto parameter_count = static_cast<std::size_t>(Parameter::Count);
+
+constexpr const char *enum2str(Parameter parameter) noexcept
+{
+    switch (parameter)
+    {
+    case Parameter::DistanceKp:
+        return "distance_kp";
+    case Parameter::DistanceKi:
+        return "distance_ki";
+    case Parameter::DistanceKd:
+        return "distance_kd";
+    case Parameter::AngleKp:
+        return "angle_kp";
+    case Parameter::AngleKi:
+        return "angle_ki";
+    case Parameter::AngleKd:
+        return "angle_kd";
+    case Parameter::VelocityKp:
+        return "velocity_kp";
+    case Parameter::VelocityKi:
+        return "velocity_ki";
+    case Parameter::VelocityKd:
+        return "velocity_kd";
+    case Parameter::Ks:
+        return "Ks";
+    case Parameter::PositionNoise:
+        return "position_noise";
+    case Parameter::HeadingNoise:
+        return "heading_noise";
+    case Parameter::SideSensorNoise:
+        return "side_sensor_noise";
+    case Parameter::DiagonalSensorNoise:
+        return "diagonal_sensor_noise";
+    case Parameter::FrontSensorNoise:
+        return "front_sensor_noise";
+    case Parameter::Count:
+        break;
+    }
+    return "Unknown";
+}
+
+// The value of every parameter
+using Candidate = std::array<float, parameter_count>;
+
+/**
+ * @brief A configuration's parameters.
+ */
+constexpr Candidate candidate(const sim::Config &config) noexcept
+{
+    const auto &gains = config.gains;
+    const auto &noise = config.noise;
+    return {
+        gains.distance.kp,
+        gains.distance.ki,
+        gains.distance.kd,
+        gains.angle.kp,
+        gains.angle.ki,
+        gains.angle.kd,
+        gains.velocity.kp,
+        gains.velocity.ki,
+        gains.velocity.kd,
+        gains.Ks,
+        noise.process[0],
+        noise.process[2],
+        noise.measurement[0],
+        noise.measurement[1],
+        noise.measurement[2],
+    };
+}
+
+/**
+ * @brief The configuration with the candidate's parameters (the symmetric sensors share their noise).
+ */
+constexpr sim::Config apply(sim::Config config, const Candidate &c) noexcept
+{
+    const auto at = [&](Parameter p) { return c[static_cast<std::size_t>(p)]; };
+    auto &gains = config.gains;
+    gains.distance = {at(Parameter::DistanceKp), at(Parameter::DistanceKi), at(Parameter::DistanceKd)};
+    gains.angle = {at(Parameter::AngleKp), at(Parameter::AngleKi), at(Parameter::AngleKd)};
+    gains.velocity = {at(Parameter::VelocityKp), at(Parameter::VelocityKi), at(Parameter::VelocityKd)};
+    gains.Ks = at(Parameter::Ks);
+    auto &noise = config.noise;
+    noise.process = {at(Parameter::PositionNoise), at(Parameter::PositionNoise), at(Parameter::HeadingNoise)};
+    noise.measurement = {
+        at(Parameter::SideSensorNoise),
+        at(Parameter::DiagonalSensorNoise),
+        at(Parameter::FrontSensorNoise),
+        at(Parameter::DiagonalSensorNoise),
+        at(Parameter::SideSensorNoise),
+    };
+    return config;
+}
+
+/**
+ * @brief The values a parameter may take.
+ */
+struct Range
+{
+    float min;
+    float max;               // Equal to `min` for a fixed parameter
+    bool log;                // Spread the values evenly on a log scale (`min` must be positive)
+    std::size_t levels = 1;  // The values on the grid (see `grid`), 1 for the base value only
+
+    bool fixed() const noexcept { return !(max > min); }
+
+    /**
+     * @brief The value at `x` in [0, 1] (from `min` to `max`).
+     */
+    float at(float x) const noexcept
+    {
+        if (fixed())
+        {
+            return min;
+        }
+        return log ? min * std::pow(max / min, x) : min + x * (max - min);
+    }
+
+    /**
+     * @brief Where `value` is in the range (the inverse of `at`), clamped to [0, 1].
+     */
+    float position(float value) const noexcept
+    {
+        if (fixed())
+        {
+            return 0.0f;
+        }
+        const auto x = log ? std::log(value / min) / std::log(max / min) : (value - min) / (max - min);
+        return std::isfinite(x) ? std::clamp(x, 0.0f, 1.0f) : 0.0f;
+    }
+};
+
+/**
+ * @brief The parameters' ranges, and the values of the parameters that aren't searched (or aren't on the grid).
+ */
+struct Space
+{
+    Candidate base;
+    std::array<Range, parameter_count> ranges;
+
+    /**
+     * @brief The searched parameters (the ones whose ranges aren't fixed).
+     */
+    std::vector<std::size_t> free() const
+    {
+        std::vector<std::size_t> res;
+        for (std::size_t i = 0; i < parameter_count; i++)
+        {
+            if (!ranges[i].fixed())
+            {
+                res.push_back(i);
+            }
+        }
+        return res;
+    }
+};
+
+/**
+ * @brief Search around `base`: the gains from a quarter to 4 times their values, `Ks` within 30% and the noise
+ * covariances from a tenth to 10 times their values. The parameters that are 0 (the integral gains) stay 0.
+ */
+inline Space default_space(const Candidate &base) noexcept
+{
+    Space space{.base = base, .ranges{}};
+    for (std::size_t i = 0; i < parameter_count; i++)
+    {
+        const auto value = base[i];
+        const auto parameter = static_cast<Parameter>(i);
+        if (value <= 0.0f)
+        {
+            space.ranges[i] = {.min = value, .max = value, .log = false};
+        }
+        else if (parameter == Parameter::Ks)
+        {
+            space.ranges[i] = {.min = 0.7f * value, .max = 1.3f * value, .log = false};
+        }
+        else if (parameter >= Parameter::PositionNoise)
+        {
+            space.ranges[i] = {.min = 0.1f * value, .max = 10.0f * value, .log = true};
+        }
+        else
+        {
+            space.ranges[i] = {.min = 0.25f * value, .max = 4.0f * value, .log = true};
+        }
+    }
+    return space;
+}
+
+/**
+ * @brief Every combination of the ranges' levels (the base value for a range with a single level).
+ */
+inline std::vector<Candidate> grid(const Space &space)
+{
+    std::vector<Candidate> res{space.base};
+    for (std::size_t i = 0; i < parameter_count; i++)
+    {
+        const auto &range = space.ranges[i];
+        if (range.fixed() || range.levels < 2)
+        {
+            continue;
+        }
+        std::vector<Candidate> expanded;
+        expanded.reserve(res.size() * range.levels);
+        for (const auto &c : res)
+        {
+            for (std::size_t level = 0; level < range.levels; level++)
+            {
+                auto next = c;
+                next[i] = range.at(static_cast<float>(level) / static_cast<float>(range.levels - 1));
+                expanded.push_back(next);
+            }
+        }
+        res = std::move(expanded);
+    }
+    return res;
+}
+
+/**
+ * @brief `count` candidates, uniformly distributed in the space (on a log scale for the log ranges).
+ */
+inline std::vector<Candidate> random_candidates(const Space &space, std::size_t count, std::uint32_t seed)
+{
+    std::mt19937 gen{seed};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+    std::vector<Candidate> res(count, space.base);
+    for (auto &c : res)
+    {
+        for (std::size_t i = 0; i < parameter_count; i++)
+        {
+            if (!space.ranges[i].fixed())
+            {
+                c[i] = space.ranges[i].at(uniform(gen));
+            }
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief A maze, with the route through it.
+ */
+struct Track
+{
+    std::string name;
+    std::vector<Segment> walls;  // See `sim::maze_segments`
+    sim::Route route;
+};
+
+template <std::size_t Rows, std::size_t Columns>
+std::optional<Track> make_track(std::string name, const Maze<Rows, Columns> &maze)
+{
+    auto route = sim::shortest_route(maze);
+    if (!route)
+    {
+        return std::nullopt;
+    }
+    return Track{.name = std::move(name), .walls = sim::maze_segments(maze), .route = std::move(*route)};
+}
+
+/**
+ * @brief The conditions the candidate is tested in: for every seed, the base configuration's motors, a weaker left
+ * motor and a weaker right motor (more friction and less velocity per command, by `motor_spread`).
+ */
+inline std::vector<sim::Config> robustness_scenarios(
+    const sim::Config &base,
+    std::uint32_t seeds,
+    float motor_spread
+)
+{
+    std::vector<sim::Config> res;
+    for (std::uint32_t seed = 1; seed <= seeds; seed++)
+    {
+        for (std::size_t variant = 0; variant <= base.motors.size(); variant++)
+        {
+            auto config = base;
+            config.seed = seed;
+            if (variant > 0)
+            {
+                auto &motor = config.motors[variant - 1];
+                motor.Ks *= 1 + motor_spread;
+                motor.Kv *= 1 + motor_spread;
+            }
+            res.push_back(config);
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief What a candidate must do in every run to be acceptable.
+ */
+struct Constraints
+{
+    meters max_tracking_error;  // Of the true pose from the route
+    meters min_clearance;       // From the walls
+};
+
+inline constexpr Constraints default_constraints{
+    .max_tracking_error = meters{0.05f},
+    .min_clearance = meters{0.0f},
+};
+
+/**
+ * @brief How a candidate did in all of its runs.
+ */
+struct Evaluation
+{
+    Candidate candidate;
+    std::uint32_t runs;
+    std::uint32_t failures;  // Runs that didn't finish
+    seconds worst_lap_time;
+    seconds mean_lap_time;
+    meters max_tracking_error;
+    meters min_clearance;
+    bool feasible;           // Finished every run within the constraints
+    float cost;              // Lower is better [s] (see `Evaluator`)
+};
+
+/**
+ * @brief Runs candidates on every track in every scenario, in parallel.
+ *
+ * The cost of a feasible candidate is its worst lap time, plus a second per meter of its worst tracking error (which
+ * breaks the ties of the path following modes, whose lap time is mostly the path's velocity profile). An infeasible
+ * candidate costs more than any feasible one (the timeout) plus how far it was from the constraints, so the search is
+ * still guided towards the feasible region.
+ */
+class Evaluator
+{
+public:
+    Evaluator(
+        std::span<const Track> tracks,
+        std::span<const sim::Config> scenarios,
+        const Constraints &constraints,
+        WorkStealingPool &pool
+    ) noexcept
+        : m_tracks{tracks}
+        , m_scenarios{scenarios}
+        , m_constraints{constraints}
+        , m_pool{pool}
+    {
+    }
+
+    std::vector<Evaluation> operator()(std::span<const Candidate> candidates)
+    {
+        const auto runs_per_candidate = m_tracks.size() * m_scenarios.size();
+        std::vector<sim::Result> results(candidates.size() * runs_per_candidate);
+        m_pool.parallel_for(
+            results.size(),
+            [&](std::size_t i)
+            {
+                const auto &track = m_tracks[i % runs_per_candidate / m_scenarios.size()];
+                const auto config = apply(m_scenarios[i % m_scenarios.size()], candidates[i / runs_per_candidate]);
+                sim::Simulator simulator{track.walls, track.route, config};
+                results[i] = simulator.run();
+            }
+        );
+
+        // Aggregate in order, so the evaluations don't depend on the order the runs ended in.
+        std::vector<Evaluation> res;
+        res.reserve(candidates.size());
+        for (std::size_t i = 0; i < candidates.size(); i++)
+        {
+            const auto runs = std::span{results}.subspan(i * runs_per_candidate, runs_per_candidate);
+            res.push_back(evaluate(candidates[i], runs));
+        }
+        m_runs += results.size();
+        for (const auto &result : results)
+        {
+            m_simulated += result.lap_time;
+        }
+        return res;
+    }
+
+    std::uint64_t runs() const noexcept { return m_runs; }
+    seconds simulated() const noexcept { return m_simulated; }
+
+private:
+    Evaluation evaluate(const Candidate &candidate, std::span<const sim::Result> results) const noexcept
+    {
+        Evaluation res{
+            .candidate = candidate,
+            .runs = static_cast<std::uint32_t>(results.size()),
+            .failures = 0,
+            .worst_lap_time = seconds{0.0f},
+            .mean_lap_time = seconds{0.0f},
+            .max_tracking_error = meters{0.0f},
+            .min_clearance = meters{std::numeric_limits<float>::infinity()},
+            .feasible = false,
+            .cost = 0.0f,
+        };
+        seconds timeout{0.0f};
+        for (std::size_t i = 0; i < results.size(); i++)
+        {
+            const auto &result = results[i];
+            timeout = std::max(timeout, m_scenarios[i % m_scenarios.size()].timeout);
+            res.failures += result.finished ? 0 : 1;
+            res.worst_lap_time = std::max(res.worst_lap_time, result.lap_time);
+            res.mean_lap_time += result.lap_time / static_cast<float>(results.size());
+            res.max_tracking_error = std::max(res.max_tracking_error, result.max_tracking_error);
+            res.min_clearance = std::min(res.min_clearance, result.min_clearance);
+        }
+        const auto tracking_excess = std::max(res.max_tracking_error - m_constraints.max_tracking_error, meters{0.0f});
+        const auto clearance_deficit = std::max(m_constraints.min_clearance - res.min_clearance, meters{0.0f});
+        res.feasible = res.failures == 0 && tracking_excess <= meters{0.0f} && clearance_deficit <= meters{0.0f};
+        res.cost = res.worst_lap_time.count() + res.max_tracking_error.count();
+        if (!res.feasible)
+        {
+            // Every failure costs a timeout, and every centimeter over the constraints costs a second.
+            const auto violation = unit_cast<centimeters>(tracking_excess + clearance_deficit).count();
+            res.cost += timeout.count() * static_cast<float>(1 + res.failures) + violation;
+        }
+        return res;
+    }
+
+    std::span<const Track> m_tracks;
+    std::span<const sim::Config> m_scenarios;
+    Constraints m_constraints;
+    WorkStealingPool &m_pool;
+    std::uint64_t m_runs = 0;
+    seconds m_simulated{0.0f};
+};
+
+/**
+ * @brief Best first (by cost, so the feasible candidates come first, see `Evaluator`).
+ */
+inline void rank(std::vector<Evaluation> &evaluations)
+{
+    std::ranges::stable_sort(evaluations, {}, &Evaluation::cost);
+}
+
+/**
+ * @brief The CMA-ES search (covariance matrix adaptation evolution strategy, see
+ * https://arxiv.org/abs/1604.00772): every generation samples candidates from a normal distribution, and moves and
+ * reshapes the distribution towards the best of them.
+ *
+ * Works on the free parameters' positions in their ranges (see `Range::position`), so all of them are on the same
+ * scale. Samples that fall outside of the ranges are clamped into them.
+ */
+class Cmaes
+{
+public:
+    using Vector = Eigen::VectorXf;
+    using Matrix = Eigen::MatrixXf;
+
+    /**
+     * @param space The ranges to search in, starting from the base candidate.
+     * @param sigma The initial step size (a fraction of the ranges).
+     * @param population The candidates per generation (0 for the recommended 4 + 3 ln(n)).
+     * @param seed For the samples.
+     */
+    Cmaes(const Space &space, float sigma, std::size_t population, std::uint32_t seed)
+        : m_space{space}
+        , m_free{space.free()}
+        , m_n{m_free.size()}
+        , m_lambda{population > 0 ? population : default_population(m_n)}
+        , m_mu{m_lambda / 2}
+        , m_sigma{sigma}
+        , m_mean(m_n)
+        , m_C{Matrix::Identity(m_n, m_n)}
+        , m_B{Matrix::Identity(m_n, m_n)}
+        , m_D{Vector::Ones(m_n)}
+        , m_pc{Vector::Zero(m_n)}
+        , m_ps{Vector::Zero(m_n)}
+        , m_gen{seed}
+    {
+        for (std::size_t i = 0; i < m_n; i++)
+        {
+            m_mean(i) = space.ranges[m_free[i]].position(space.base[m_free[i]]);
+        }
+
+        m_weights.resize(m_mu);
+        for (std::size_t i = 0; i < m_mu; i++)
+        {
+            m_weights(i) = std::log(m_mu + 0.5f) - std::log(i + 1.0f);
+        }
+        m_weights /= m_weights.sum();
+        m_mueff = 1.0f / m_weights.squaredNorm();
+
+        const auto n = static_cast<float>(m_n);
+        m_cs = (m_mueff + 2) / (n + m_mueff + 5);
+        m_ds = 1 + 2 * std::max(0.0f, std::sqrt((m_mueff - 1) / (n + 1)) - 1) + m_cs;
+        m_cc = (4 + m_mueff / n) / (n + 4 + 2 * m_mueff / n);
+        m_c1 = 2 / ((n + 1.3f) * (n + 1.3f) + m_mueff);
+        m_cmu = std::min(1 - m_c1, 2 * (m_mueff - 2 + 1 / m_mueff) / ((n + 2) * (n + 2) + m_mueff));
+        m_chi_n = std::sqrt(n) * (1 - 1 / (4 * n) + 1 / (21 * n * n));
+    }
+
+    static std::size_t default_population(std::size_t n) noexcept
+    {
+        return 4 + static_cast<std::size_t>(3 * std::log(static_cast<float>(std::max<std::size_t>(n, 1))));
+    }
+
+    std::size_t population() const noexcept { return m_lambda; }
+    float sigma() const noexcept { return m_sigma; }
+
+    /**
+     * @brief Sample the next generation's candidates.
+     */
+    std::vector<Candidate> ask()
+    {
+        std::normal_distribution<float> normal{0.0f, 1.0f};
+        m_samples.resize(m_n, static_cast<Eigen::Index>(m_lambda));
+        std::vector<Candidate> res(m_lambda, m_space.base);
+        for (std::size_t k = 0; k < m_lambda; k++)
+        {
+            Vector z(m_n);
+            for (auto &value : z)
+            {
+                value = normal(m_gen);
+            }
+            const Vector x = (m_mean + m_sigma * (m_B * m_D.asDiagonal() * z)).cwiseMax(0.0f).cwiseMin(1.0f);
+            m_samples.col(static_cast<Eigen::Index>(k)) = x;
+            for (std::size_t i = 0; i < m_n; i++)
+            {
+                res[k][m_free[i]] = m_space.ranges[m_free[i]].at(x(i));
+            }
+        }
+        return res;
+    }
+
+    /**
+     * @brief Update the distribution with the costs of the candidates of the last `ask`, in the same order.
+     */
+    void tell(std::span<const float> costs)
+    {
+        std::vector<std::size_t> order(m_lambda);
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, {}, [&](std::size_t k) { return costs[k]; });
+
+        const Vector old_mean = m_mean;
+        m_mean.setZero();
+        for (std::size_t i = 0; i < m_mu; i++)
+        {
+            m_mean += m_weights(i) * m_samples.col(static_cast<Eigen::Index>(order[i]));
+        }
+        const Vector step = (m_mean - old_mean) / m_sigma;
+
+        // The evolution paths
+        const Matrix inverse_sqrt_C = m_B * m_D.cwiseInverse().asDiagonal() * m_B.transpose();
+        m_ps = (1 - m_cs) * m_ps + std::sqrt(m_cs * (2 - m_cs) * m_mueff) * inverse_sqrt_C * step;
+        m_generation++;
+        const auto ps_norm = m_ps.norm() / std::sqrt(1 - std::pow(1 - m_cs, 2.0f * m_generation));
+        const auto hs = ps_norm < (1.4f + 2 / (m_n + 1.0f)) * m_chi_n ? 1.0f : 0.0f;
+        m_pc = (1 - m_cc) * m_pc + hs * std::sqrt(m_cc * (2 - m_cc) * m_mueff) * step;
+
+        // The covariance: rank one update from the path, rank mu update from the best samples
+        Matrix rank_mu = Matrix::Zero(m_n, m_n);
+        for (std::size_t i = 0; i < m_mu; i++)
+        {
+            const Vector y = (m_samples.col(static_cast<Eigen::Index>(order[i])) - old_mean) / m_sigma;
+            rank_mu += m_weights(i) * y * y.transpose();
+        }
+        m_C = (1 - m_c1 - m_cmu) * m_C + m_c1 * (m_pc * m_pc.transpose() + (1 - hs) * m_cc * (2 - m_cc) * m_C)
+            + m_cmu * rank_mu;
+        m_sigma *= std::exp((m_cs / m_ds) * (m_ps.norm() / m_chi_n - 1));
+
+        const Eigen::SelfAdjointEigenSolver<Matrix> eigen{m_C};
+        m_B = eigen.eigenvectors();
+        m_D = eigen.eigenvalues().cwiseMax(1e-12f).cwiseSqrt();
+    }
+
+private:
+    Space m_space;
+    std::vector<std::size_t> m_free;
+    std::size_t m_n;
+    std::size_t m_lambda;
+    std::size_t m_mu;
+    Vector m_weights;
+    float m_mueff;
+    float m_cs;
+    float m_ds;
+    float m_cc;
+    float m_c1;
+    float m_cmu;
+    float m_chi_n;
+    float m_sigma;
+    Vector m_mean;
+    Matrix m_C;
+    Matrix m_B;  // The eigenvectors of C
+    Vector m_D;  // The square roots of C's eigenvalues
+    Vector m_pc;
+    Vector m_ps;
+    Matrix m_samples;  // The last generation, a column per candidate
+    std::uint32_t m_generation = 0;
+    std::mt19937 m_gen;
+};
+
+/**
+ * @brief Run CMA-ES (see `Cmaes`) for `generations` generations.
+ *
+ * @return Every evaluated candidate, the base candidate first.
+ */
+inline std::vector<Evaluation> cma_es(
+    Evaluator &evaluate,
+    const Space &space,
+    std::size_t generations,
+    std::size_t population,
+    std::uint32_t seed
+)
+{
+    auto res = evaluate(std::span{&space.base, 1});
+    Cmaes cmaes{space, 0.3f, population, seed};
+    for (std::size_t g = 0; g < generations; g++)
+    {
+        const auto evaluations = evaluate(cmaes.ask());
+        std::vector<float> costs;
+        costs.reserve(evaluations.size());
+        for (const auto &evaluation : evaluations)
+        {
+            costs.push_back(evaluation.cost);
+        }
+        cmaes.tell(costs);
+        res.insert(res.end(), evaluations.begin(), evaluations.end());
+    }
+    return res;
+}
+
+}  // namespace micromouse::sweep
+
+#endif  // MAIN_SWEEP_H
@@ -0,0 +1,182 @@
+#ifndef MAIN_TELEMETRY_H
+#define MAIN_TELEMETRY_H
+
+#include <misc_utils/cobs.h>
+#include <misc_utils/crc.h>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace micromouse::telemetry
+{
+
+inline constexpr std::size_t sensor_count = 5;
+
+/**
+ * @brief A snapshot of the robot, taken every main loop cycle and sent in binary instead of printed.
+ *
+ * The fields are all 4 bytes wide, so the layout has no padding and is the same on the ESP32 and on the host (both
+ * are little endian). Bump `version` when changing it.
+ */
+struct Record
+{
+    std::uint32_t time;                            // [us] Since boot (wraps around after ~71 minutes)
+    float target_x;                                // [m]
+    float target_y;                                // [m]
+    float target_theta;                            // [rad]
+    float x;                                       // [m]
+    float y;                                       // [m]
+    float theta;                                   // [rad]
+    float left_velocity;                           // [m/s]
+    float left_wanted_velocity;                    // [m/s]
+    float left_output;                             // [ticks] PWM duty
+    float right_velocity;                          // [m/s]
+    float right_wanted_velocity;                   // [m/s]
+    float right_output;                            // [ticks] PWM duty
+    float innovation;                              // The EKF's latest normalized innovation squared
+    std::uint32_t cycle_time;                      // [us] Of the main loop
+    std::uint32_t flags;                           // The healthy distance sensors (bit per sensor)
+    std::array<float, sensor_count> sensor_rates;  // [Hz] Every distance sensor's readings per second (last second)
+};
+static_assert(sizeof(Record) == 84);
+static_assert(std::is_trivially_copyable_v<Record>);
+static_assert(std::endian::native == std::endian::little);
+
+/**
+ * The stream is a series of frames, each one a batch of records encoded with COBS between two zeros:
+ *
+ *     version (1 byte) | count (1 byte) | sequence (2 bytes) | count records | CRC-16 (2 bytes, of everything before)
+ *
+ * The sequence counts the batches (wrapping around), so the decoder can tell how many were lost. Anything between
+ * the frames (like log lines) doesn't decode and is skipped, and the leading zero keeps it out of the next frame.
+ */
+inline constexpr std::uint8_t version = 2;
+inline constexpr std::size_t max_batch = 8;  // Records per frame
+inline constexpr std::size_t header_size = 4;
+inline constexpr std::size_t crc_size = 2;
+inline constexpr std::size_t max_payload_size = header_size + max_batch * sizeof(Record) + crc_size;
+inline constexpr std::size_t max_frame_size = cobs::max_encoded_size(max_payload_size) + 2;  // With the delimiters
+
+using Frame = std::array<std::uint8_t, max_frame_size>;
+
+/**
+ * @brief Encode a batch of records (at most `max_batch`) into a frame.
+ *
+ * @return The frame's size (with the delimiters).
+ */
+inline std::size_t encode(std::span<const Record> records, std::uint16_t sequence, Frame &frame) noexcept
+{
+    std::array<std::uint8_t, max_payload_size> payload;
+    payload[0] = version;
+    payload[1] = static_cast<std::uint8_t>(records.size());
+    payload[2] = static_cast<std::uint8_t>(sequence);
+    payload[3] = static_cast<std::uint8_t>(sequence >> 8);
+    std::memcpy(&payload[header_size], records.data(), records.size_bytes());
+    const auto size = header_size + records.size_bytes();
+    const auto crc = crc16(std::span{payload}.first(size));
+    payload[size] = static_cast<std::uint8_t>(crc);
+    payload[size + 1] = static_cast<std::uint8_t>(crc >> 8);
+
+    frame[0] = 0;
+    const auto encoded = cobs::encode(std::span{payload}.first(size + crc_size), std::span{frame}.subspan(1));
+    frame[encoded + 1] = 0;
+    return encoded + 2;
+}
+
+/**
+ * @brief Finds the frames in a stream and decodes their records.
+ *
+ * @tparam OnRecord Called with every record and its batch's sequence number.
+ */
+template <typename OnRecord>
+class Decoder
+{
+public:
+    struct Stats
+    {
+        std::uint32_t frames;
+        std::uint32_t records;
+        std::uint32_t bad_frames;    // Malformed, the wrong size or version, or a CRC mismatch (or not a frame)
+        std::uint32_t lost_batches;  // By the gaps in the sequence
+    };
+
+    explicit Decoder(OnRecord on_record) noexcept : m_on_record{std::move(on_record)} {}
+
+    void feed(std::span<const std::uint8_t> bytes) noexcept
+    {
+        for (const auto byte : bytes)
+        {
+            if (byte != 0)
+            {
+                // A frame that's too long is bad, but its end still has to be found.
+                if (m_size < m_frame.size())
+                {
+                    m_frame[m_size] = byte;
+                }
+                m_size++;
+                continue;
+            }
+            if (m_size > 0)
+            {
+                decode_frame();
+            }
+            m_size = 0;
+        }
+    }
+
+    const Stats &stats() const noexcept { return m_stats; }
+
+private:
+    void decode_frame() noexcept
+    {
+        std::array<std::uint8_t, max_frame_size> payload;
+        const auto size =
+            m_size <= m_frame.size() ? cobs::decode(std::span{m_frame}.first(m_size), payload) : std::nullopt;
+        if (!size || *size < header_size + crc_size || payload[0] != version || payload[1] > max_batch
+            || *size != header_size + payload[1] * sizeof(Record) + crc_size)
+        {
+            m_stats.bad_frames++;
+            return;
+        }
+        const std::size_t count = payload[1];
+        const auto data_size = header_size + count * sizeof(Record);
+        const auto crc = static_cast<std::uint16_t>(payload[data_size] | payload[data_size + 1] << 8);
+        if (crc16(std::span{payload}.first(data_size)) != crc)
+        {
+            m_stats.bad_frames++;
+            return;
+        }
+
+        const auto sequence = static_cast<std::uint16_t>(payload[2] | payload[3] << 8);
+        if (m_stats.frames > 0)
+        {
+            m_stats.lost_batches += static_cast<std::uint16_t>(sequence - m_last_sequence - 1);
+        }
+        m_last_sequence = sequence;
+        m_stats.frames++;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Record record;
+            std::memcpy(&record, &payload[header_size + i * sizeof(Record)], sizeof(Record));
+            m_on_record(record, sequence);
+            m_stats.records++;
+        }
+    }
+
+    OnRecord m_on_record;
+    std::array<std::uint8_t, max_frame_size> m_frame;
+    std::size_t m_size = 0;
+    std::uint16_t m_last_sequence = 0;
+    Stats m_stats{};
+};
+
+}  // namespace micromouse::telemetry
+
+#endif  // MAIN_TELEMETRY_H
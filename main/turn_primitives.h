@@ -0,0 +1,294 @@
+#ifndef MAIN_TURN_PRIMITIVES_H
+#define MAIN_TURN_PRIMITIVES_H
+
+#include <misc_utils/angle.h>
+#include <misc_utils/fast_math.h>
+#include <misc_utils/physical_size.h>
+
+#include "motion_model.h"
+#include "motor_specs.h"
+#include "position.h"
+#include "temp_map.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+namespace micromouse
+{
+
+enum class TurnType : std::uint8_t
+{
+    Turn45,
+    Turn90,
+    Turn135,
+    Turn180,
+};
+
+/**
+ * @brief Right turns are clockwise (the heading increases), left turns are counterclockwise.
+ */
+enum class TurnSide : bool
+{
+    Left,
+    Right,
+};
+
+/**
+ * @brief A point on a turn's path, in the turn's frame (starting at the origin, heading along the x-axis).
+ */
+struct TurnPoint
+{
+    float x;      // [m]
+    float y;      // [m]
+    float theta;  // [rad]
+};
+
+/**
+ * @brief The time-indexed reference of a turn for the controller.
+ */
+struct TurnReference
+{
+    Position pos;
+    meters_per_second left_velocity;
+    meters_per_second right_velocity;
+    float angular_velocity;  // [rad/s]
+};
+
+/**
+ * @brief A smooth in-motion turn: a clothoid (the curvature grows linearly with the distance), an arc and a mirrored
+ * clothoid. Driven at a constant speed, the angular velocity ramps up and down linearly, so the wheel speeds never
+ * jump like they do when switching from a straight line straight into an arc.
+ *
+ * The shape doesn't depend on the speed: sampling it at a different speed only changes the timing.
+ * The (right turn) path is precomputed at compile time into a table at uniform distances.
+ */
+struct TurnPrimitive
+{
+    static constexpr std::size_t table_size = 65;
+    // The lateral acceleration the tires can take without slipping.
+    static constexpr float max_lateral_acceleration = 6.0f;  // [m/s^2]
+
+    float angle;            // [rad]
+    float arc_radius;       // [m]
+    float clothoid_length;  // [m] (of each clothoid)
+    std::array<TurnPoint, table_size> table;
+
+    constexpr float max_curvature() const noexcept { return 1 / arc_radius; }
+    constexpr float arc_length() const noexcept { return arc_radius * angle - clothoid_length; }
+    constexpr float length() const noexcept { return 2 * clothoid_length + arc_length(); }
+
+    /**
+     * @brief The curvature (for a right turn) after driving `s` meters into the turn.
+     */
+    constexpr float curvature(float s) const noexcept
+    {
+        s = std::clamp(s, 0.0f, length());
+        if (s < clothoid_length)
+        {
+            return max_curvature() * s / clothoid_length;
+        }
+        if (s <= clothoid_length + arc_length())
+        {
+            return max_curvature();
+        }
+        return max_curvature() * (length() - s) / clothoid_length;
+    }
+
+    /**
+     * @brief The heading (for a right turn) after driving `s` meters into the turn (the integral of the curvature).
+     */
+    constexpr float heading(float s) const noexcept
+    {
+        s = std::clamp(s, 0.0f, length());
+        if (s < clothoid_length)
+        {
+            return max_curvature() * s * s / (2 * clothoid_length);
+        }
+        if (s <= clothoid_length + arc_length())
+        {
+            return max_curvature() * (clothoid_length / 2 + s - clothoid_length);
+        }
+        const auto left = length() - s;
+        return angle - max_curvature() * left * left / (2 * clothoid_length);
+    }
+
+    /**
+     * @brief The point (of a right turn) after driving `s` meters into the turn.
+     */
+    constexpr TurnPoint point(float s) const noexcept
+    {
+        s = std::clamp(s, 0.0f, length());
+        const auto step = length() / (table_size - 1);
+        const auto index = std::min(static_cast<std::size_t>(s / step), table_size - 2);
+        const auto ratio = (s - static_cast<float>(index) * step) / step;
+        const auto &a = table[index];
+        const auto &b = table[index + 1];
+        return {.x = a.x + (b.x - a.x) * ratio, .y = a.y + (b.y - a.y) * ratio, .theta = heading(s)};
+    }
+
+    constexpr const TurnPoint &end() const noexcept { return table.back(); }
+
+    /**
+     * @brief The highest speed the turn can be driven at: limited by the outer wheel's max speed and by the lateral
+     * acceleration in the arc.
+     */
+    constexpr meters_per_second max_speed() const noexcept
+    {
+        const auto outer_wheel_ratio = 1 + distance_between_wheels.count() * max_curvature() / 2;
+        return meters_per_second{std::min(
+            MotorSpecs::max_speed / outer_wheel_ratio,
+            fast::sqrt(max_lateral_acceleration * arc_radius)
+        )};
+    }
+
+    /**
+     * @brief How long the turn takes at the given speed.
+     */
+    constexpr seconds duration(meters_per_second speed) const noexcept { return seconds{length() / speed.count()}; }
+
+    /**
+     * @brief Sample the turn.
+     *
+     * @param side The turn's direction.
+     * @param start The pose at the start of the turn.
+     * @param speed The (constant) linear speed through the turn.
+     * @param time Time since the start of the turn.
+     * @return The pose and velocity references.
+     */
+    constexpr TurnReference sample(TurnSide side, const Position &start, meters_per_second speed, seconds time)
+        const noexcept
+    {
+        const auto s = speed.count() * time.count();
+        const auto sign = side == TurnSide::Right ? 1.0f : -1.0f;
+        const auto p = point(s);
+        const auto [sin_theta, cos_theta] = fast::sincos(start.theta);
+        const auto y = sign * p.y;
+        const auto angular_velocity = s < length() ? sign * curvature(s) * speed.count() : 0.0f;
+        const auto wheels_delta = meters_per_second{angular_velocity * distance_between_wheels.count() / 2};
+        return {
+            .pos{
+                .x = start.x + XCoord{meters{p.x * cos_theta - y * sin_theta}},
+                .y = start.y + YCoord{meters{p.x * sin_theta + y * cos_theta}},
+                .theta = start.theta + Angle{sign * p.theta},
+            },
+            .left_velocity = speed + wheels_delta,
+            .right_velocity = speed - wheels_delta,
+            .angular_velocity = angular_velocity,
+        };
+    }
+};
+
+namespace detail
+{
+
+inline constexpr std::size_t turn_integration_substeps = 8;  // Per table entry
+
+/**
+ * @brief Build a turn primitive, integrating its path with Simpson's rule.
+ */
+consteval TurnPrimitive make_turn(float angle, float arc_radius, float clothoid_length)
+{
+    TurnPrimitive turn{.angle = angle, .arc_radius = arc_radius, .clothoid_length = clothoid_length, .table{}};
+    const auto step = turn.length() / (TurnPrimitive::table_size - 1);
+    const auto h = step / turn_integration_substeps;
+    TurnPoint cur{.x = 0.0f, .y = 0.0f, .theta = 0.0f};
+    turn.table[0] = cur;
+    for (std::size_t i = 1; i < TurnPrimitive::table_size; i++)
+    {
+        for (std::size_t j = 0; j < turn_integration_substeps; j++)
+        {
+            const auto s = static_cast<float>(i - 1) * step + static_cast<float>(j) * h;
+            const auto a = fast::sincos(turn.heading(s));
+            const auto m = fast::sincos(turn.heading(s + h / 2));
+            const auto b = fast::sincos(turn.heading(s + h));
+            cur.x += h / 6 * (a.cos + 4 * m.cos + b.cos);
+            cur.y += h / 6 * (a.sin + 4 * m.sin + b.sin);
+        }
+        cur.theta = turn.heading(static_cast<float>(i) * step);
+        turn.table[i] = cur;
+    }
+    return turn;
+}
+
+/**
+ * @brief Build the turn that ends `end_offset` to the side of its start.
+ * The clothoids' length is a fixed ratio of the arc's radius, so the whole path scales with the radius, and the radius
+ * is the unit turn's (radius 1) scaled to the offset. The turn is symmetric, so the offset fixes its end.
+ */
+consteval TurnPrimitive fit_turn(float angle, float clothoid_ratio, float end_offset)
+{
+    const auto unit = make_turn(angle, 1.0f, clothoid_ratio);
+    const auto arc_radius = end_offset / unit.end().y;
+    return make_turn(angle, arc_radius, clothoid_ratio * arc_radius);
+}
+
+}  // namespace detail
+
+/**
+ * @brief Where the turns end (in the turn's frame), indexed by `TurnType`. They start and end on the middle lines of
+ * the straight corridors and on the diagonals, which cross the cells' edges in their middles (away from the posts):
+ * - The 45 degrees turn goes from a cell's center onto the diagonal through the middle of the cell's far edge.
+ * - The 90 degrees turn connects the middles of two adjacent edges of a cell (half a cell forward and half a cell to
+ *   the side).
+ * - The 135 degrees turn goes from the middle of a cell's edge onto the diagonal through the middle of the cell's far
+ *   edge.
+ * - The 180 degrees turn moves to the neighboring corridor (a cell to the side).
+ */
+inline constexpr std::array<TurnPoint, 4> turn_ends = []
+{
+    // A symmetric turn ends as far from the corner (where its entry and exit lines cross) as it starts.
+    const auto around_corner = [](float angle, float corner_distance)
+    {
+        const auto [sin_angle, cos_angle] = fast::sincos(Angle{angle});
+        return TurnPoint{.x = corner_distance * (1 + cos_angle), .y = corner_distance * sin_angle, .theta = angle};
+    };
+    return std::array{
+        around_corner(std::numbers::pi_v<float> / 4, wall_length / 2),
+        around_corner(std::numbers::pi_v<float> / 2, wall_length / 2),
+        around_corner(3 * std::numbers::pi_v<float> / 4, wall_length),
+        TurnPoint{.x = 0.0f, .y = wall_length, .theta = std::numbers::pi_v<float>},
+    };
+}();
+
+/**
+ * @brief The turn shapes, indexed by `TurnType`, fitted to `turn_ends`. The clothoids take a quarter to two thirds of
+ * the radius (a longer clothoid is smoother but needs a tighter arc to reach the same end).
+ */
+inline constexpr std::array<TurnPrimitive, 4> turn_primitives{
+    detail::fit_turn(turn_ends[0].theta, 0.25f, turn_ends[0].y),
+    detail::fit_turn(turn_ends[1].theta, 2.0f / 3, turn_ends[1].y),
+    detail::fit_turn(turn_ends[2].theta, 0.6f, turn_ends[2].y),
+    detail::fit_turn(turn_ends[3].theta, 0.57f, turn_ends[3].y),
+};
+
+constexpr const TurnPrimitive &get_turn(TurnType type) noexcept
+{
+    return turn_primitives[static_cast<std::size_t>(type)];
+}
+
+// The shapes must be possible: the arc can't be negative and the inner wheel must keep going forward.
+static_assert(std::ranges::all_of(
+    turn_primitives,
+    [](const auto &turn)
+    { return turn.arc_length() >= 0 && turn.arc_radius > distance_between_wheels.count() / 2; }
+));
+
+// And they must fit the maze.
+static_assert(std::ranges::all_of(
+    std::array{TurnType::Turn45, TurnType::Turn90, TurnType::Turn135, TurnType::Turn180},
+    [](TurnType type)
+    {
+        const auto &end = get_turn(type).end();
+        const auto &expected = turn_ends[static_cast<std::size_t>(type)];
+        return end.theta == expected.theta && std::abs(end.x - expected.x) < 5e-4f
+               && std::abs(end.y - expected.y) < 5e-4f;
+    }
+));
+
+}  // namespace micromouse
+
+#endif  // MAIN_TURN_PRIMITIVES_H
@@ -0,0 +1,282 @@
+#include "../average_filter.h"
+
+#include "benchmark.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+/**
+ * @brief The median of the last `window` samples, the slow way (the window starts full of `initial`).
+ */
+template <typename T>
+static std::vector<T> brute_force_median(const std::vector<T> &samples, std::size_t window, T initial)
+{
+    std::vector<T> history(window, initial);
+    std::vector<T> medians;
+    for (const auto sample : samples)
+    {
+        history.erase(history.begin());
+        history.push_back(sample);
+        auto sorted = history;
+        std::ranges::nth_element(sorted, sorted.begin() + window / 2);
+        medians.push_back(sorted[window / 2]);
+    }
+    return medians;
+}
+
+template <std::size_t N>
+static void check_median(const std::vector<int> &samples)
+{
+    median_filter<int, N> filter{7};
+    const auto expected = brute_force_median(samples, N, 7);
+    for (std::size_t i = 0; i < samples.size(); i++)
+    {
+        ASSERT_EQ(filter(samples[i]), expected[i]) << "N = " << N << ", sample " << i;
+        ASSERT_EQ(filter.value(), expected[i]);
+    }
+}
+
+TEST(AverageFilterTest, Average)
+{
+    avg_filter<std::uint16_t, 4, int> filter{100};
+    EXPECT_EQ(filter.value(), 100);
+    filter = 200;
+    EXPECT_EQ(filter.avg(), 125);
+    EXPECT_EQ(filter(300), 175);
+    static_assert(filter_stage<decltype(filter), std::uint16_t>);
+}
+
+TEST(AverageFilterTest, Median)
+{
+    std::mt19937 gen{0};
+    std::uniform_int_distribution<int> wide{-1000, 1000};
+    std::uniform_int_distribution<int> narrow{0, 3};  // Many ties
+    for (auto *distribution : {&wide, &narrow})
+    {
+        std::vector<int> samples(2000);
+        std::ranges::generate(samples, [&] { return (*distribution)(gen); });
+        check_median<1>(samples);
+        check_median<3>(samples);
+        check_median<5>(samples);
+        check_median<7>(samples);
+        check_median<15>(samples);
+        check_median<31>(samples);
+    }
+    // Monotonic runs move every sample across the median.
+    std::vector<int> ramps;
+    for (auto i = 0; i < 100; i++)
+    {
+        ramps.push_back(i);
+    }
+    for (auto i = 100; i > -100; i--)
+    {
+        ramps.push_back(i);
+    }
+    check_median<9>(ramps);
+}
+
+TEST(AverageFilterTest, Constexpr)
+{
+    static constexpr auto median = []
+    {
+        median_filter<int, 5> filter;
+        for (const auto sample : {5, 1, 4, 2, 3})
+        {
+            filter(sample);
+        }
+        return filter.value();
+    }();
+    static_assert(median == 3);
+
+    static constexpr auto pipeline_output = []
+    {
+        filter_pipeline pipeline{
+            hampel_filter<int, 5>{{.threshold = 3.0f, .min_deviation = 2}, 100},
+            rate_limiter<int>{{.max_rise = 10, .max_fall = 10}, 100},
+        };
+        pipeline(1000);  // An outlier
+        return pipeline(101);
+    }();
+    static_assert(pipeline_output == 101);
+}
+
+TEST(AverageFilterTest, Hampel)
+{
+    using Filter = hampel_filter<std::uint16_t, 5>;
+    static constexpr Filter::config config{.threshold = 3.0f, .min_deviation = 5};
+    Filter filter{config, 100};
+
+    // Noise within the threshold passes through.
+    for (const std::uint16_t sample : {102, 98, 101, 99, 103, 97})
+    {
+        EXPECT_EQ(filter(sample), sample);
+        EXPECT_FALSE(filter.outlier());
+    }
+    // A spike is replaced with the median, in both directions.
+    EXPECT_EQ(filter(2000), 101);
+    EXPECT_TRUE(filter.outlier());
+    EXPECT_EQ(filter(0), 99);
+    EXPECT_TRUE(filter.outlier());
+    EXPECT_EQ(filter(100), 100);
+
+    // A step is held for at most half the window, then followed.
+    std::size_t held = 0;
+    for (auto i = 0; i < 5; i++)
+    {
+        if (filter(300) != 300)
+        {
+            held++;
+        }
+    }
+    EXPECT_LE(held, 3);
+    EXPECT_EQ(filter.value(), 300);
+    EXPECT_EQ(filter(300), 300);
+}
+
+TEST(AverageFilterTest, Ema)
+{
+    static constexpr auto config = ema_filter<float>::config::for_time_constant(0.01f, 0.09f);
+    EXPECT_FLOAT_EQ(config.alpha, 0.1f);
+    ema_filter<float> filter{config};
+    for (auto i = 1; i <= 20; i++)
+    {
+        EXPECT_NEAR(filter(std::uint16_t{100}), 100 * (1 - std::pow(0.9f, static_cast<float>(i))), 1e-3f);
+    }
+    // Settles at a constant input
+    for (auto i = 0; i < 200; i++)
+    {
+        filter(100);
+    }
+    EXPECT_NEAR(filter.value(), 100.0f, 1e-3f);
+}
+
+TEST(AverageFilterTest, RateLimiter)
+{
+    rate_limiter<int> filter{{.max_rise = 10, .max_fall = 30}, 0};
+    EXPECT_EQ(filter(5), 5);  // Within the limit
+    EXPECT_EQ(filter(100), 15);
+    EXPECT_EQ(filter(100), 25);
+    EXPECT_EQ(filter(-100), -5);
+    EXPECT_EQ(filter(-20), -20);
+    EXPECT_EQ(filter.value(), -20);
+
+    rate_limiter<std::uint16_t> unsigned_filter{{.max_rise = 10, .max_fall = 10}, 5};
+    EXPECT_EQ(unsigned_filter(0), 0);  // Doesn't wrap around
+}
+
+TEST(AverageFilterTest, Pipeline)
+{
+    filter_pipeline pipeline{
+        hampel_filter<std::uint16_t, 5>{{.threshold = 3.0f, .min_deviation = 5}, 100},
+        ema_filter<float>{{.alpha = 0.5f}, 100.0f},
+    };
+    static_assert(std::is_same_v<decltype(pipeline(std::uint16_t{})), float>);
+    EXPECT_EQ(pipeline(2000), 100.0f);  // Rejected before smoothing
+    EXPECT_TRUE(pipeline.stage<0>().outlier());
+    EXPECT_EQ(pipeline(110), 105.0f);
+    EXPECT_EQ(pipeline.value(), 105.0f);
+}
+
+/**
+ * @brief The Hampel filter the slow way: the median and the median absolute deviation of the whole window, sorted
+ * every sample.
+ */
+template <std::size_t N>
+class NaiveHampel
+{
+public:
+    float operator()(float value)
+    {
+        m_window[m_oldest] = value;
+        m_oldest = (m_oldest + 1) % N;
+        auto sorted = m_window;
+        std::ranges::nth_element(sorted, sorted.begin() + N / 2);
+        const auto median = sorted[N / 2];
+        std::ranges::transform(m_window, sorted.begin(), [&](auto sample) { return std::abs(sample - median); });
+        std::ranges::nth_element(sorted, sorted.begin() + N / 2);
+        return std::abs(value - median) > 3.0f * 1.4826f * sorted[N / 2] ? median : value;
+    }
+
+private:
+    std::array<float, N> m_window{};
+    std::size_t m_oldest = 0;
+};
+
+TEST(AverageFilterBenchmark, Stages)
+{
+    static constexpr std::size_t iterations = 200'000;
+    static constexpr std::size_t window = 15;
+    static const auto inputs = []
+    {
+        std::mt19937 gen{0};
+        std::normal_distribution<float> noise{0.1f, 0.01f};
+        std::array<float, 1024> res{};
+        std::ranges::generate(res, [&] { return noise(gen); });
+        return res;
+    }();
+    const auto input = [](std::size_t i) { return inputs[i % inputs.size()]; };
+
+    std::cout << "Average cost per sample (baseline vs stage), window = " << window << ":" << std::endl;
+    {
+        std::array<float, window> history{};
+        median_filter<float, window> median;
+        bench::report(
+            "median / nth_element",
+            bench::measure(
+                [&](auto i)
+                {
+                    history[i % window] = input(i);
+                    auto sorted = history;
+                    std::ranges::nth_element(sorted, sorted.begin() + window / 2);
+                    return sorted[window / 2];
+                },
+                iterations
+            ),
+            bench::measure([&](auto i) { return median(input(i)); }, iterations)
+        );
+    }
+    {
+        NaiveHampel<window> naive;
+        hampel_filter<float, window> hampel{{.threshold = 3.0f, .min_deviation = 0.0f}};
+        bench::report(
+            "hampel / sorted MAD",
+            bench::measure([&](auto i) { return naive(input(i)); }, iterations),
+            bench::measure([&](auto i) { return hampel(input(i)); }, iterations)
+        );
+    }
+    {
+        avg_filter<float, window> average;
+        ema_filter<float> ema{{.alpha = 0.1f}};
+        bench::report(
+            "ema / moving average",
+            bench::measure([&](auto i) { return average(input(i)); }, iterations),
+            bench::measure([&](auto i) { return ema(input(i)); }, iterations)
+        );
+    }
+    {
+        avg_filter<float, window> average;
+        rate_limiter<float> limiter{{.max_rise = 0.01f, .max_fall = 0.01f}};
+        bench::report(
+            "rate / moving average",
+            bench::measure([&](auto i) { return average(input(i)); }, iterations),
+            bench::measure([&](auto i) { return limiter(input(i)); }, iterations)
+        );
+    }
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(average_filter_tests);
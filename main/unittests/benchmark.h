@@ -0,0 +1,81 @@
+#ifndef UNITTESTS_BENCHMARK_H
+#define UNITTESTS_BENCHMARK_H
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+
+#ifdef ESP_PLATFORM
+#include <esp_cpu.h>
+#endif
+
+namespace micromouse::tests::bench
+{
+
+#ifdef ESP_PLATFORM
+inline constexpr std::string_view tick_unit = "cycles";
+
+inline std::uint64_t ticks() noexcept
+{
+    return esp_cpu_get_cycle_count();
+}
+#else
+inline constexpr std::string_view tick_unit = "ns";
+
+inline std::uint64_t ticks() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+/**
+ * @brief Prevent the compiler from optimizing away the computation of `value`.
+ */
+template <typename T>
+inline void do_not_optimize(const T &value) noexcept
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Measure the average cost of a single call to `f`.
+ *
+ * @param f The function to measure. Its result (if any) is kept alive with `do_not_optimize`.
+ * @param iterations How many times to call `f`.
+ * @return Average ticks (`tick_unit`) per call.
+ */
+template <std::invocable<std::size_t> F>
+double measure(F &&f, std::size_t iterations)
+{
+    const auto start = ticks();
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        if constexpr (std::is_void_v<std::invoke_result_t<F, std::size_t>>)
+        {
+            f(i);
+        }
+        else
+        {
+            do_not_optimize(f(i));
+        }
+    }
+    const auto end = ticks();
+    return static_cast<double>(end - start) / static_cast<double>(iterations);
+}
+
+inline void report(std::string_view name, double baseline, double candidate)
+{
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << baseline << std::setw(10) << candidate << ' ' << tick_unit << "  (x"
+              << std::setprecision(2) << baseline / candidate << ")" << std::endl;
+}
+
+}  // namespace micromouse::tests::bench
+
+#endif  // UNITTESTS_BENCHMARK_H
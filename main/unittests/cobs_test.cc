@@ -0,0 +1,93 @@
+#include "misc_utils/cobs.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+static std::vector<std::uint8_t> encode(const std::vector<std::uint8_t> &data)
+{
+    std::vector<std::uint8_t> out(cobs::max_encoded_size(data.size()));
+    out.resize(cobs::encode(data, out));
+    return out;
+}
+
+static std::vector<std::uint8_t> decode(const std::vector<std::uint8_t> &frame)
+{
+    std::vector<std::uint8_t> out(frame.size());
+    const auto size = cobs::decode(frame, out);
+    EXPECT_TRUE(size);
+    out.resize(size.value_or(0));
+    return out;
+}
+
+TEST(CobsTest, Examples)
+{
+    using Bytes = std::vector<std::uint8_t>;
+    EXPECT_EQ(encode({}), (Bytes{0x01}));
+    EXPECT_EQ(encode({0x00}), (Bytes{0x01, 0x01}));
+    EXPECT_EQ(encode({0x00, 0x00}), (Bytes{0x01, 0x01, 0x01}));
+    EXPECT_EQ(encode({0x00, 0x11, 0x00}), (Bytes{0x01, 0x02, 0x11, 0x01}));
+    EXPECT_EQ(encode({0x11, 0x22, 0x00, 0x33}), (Bytes{0x03, 0x11, 0x22, 0x02, 0x33}));
+    EXPECT_EQ(encode({0x11, 0x22, 0x33, 0x44}), (Bytes{0x05, 0x11, 0x22, 0x33, 0x44}));
+    EXPECT_EQ(encode({0x11, 0x00, 0x00, 0x00}), (Bytes{0x02, 0x11, 0x01, 0x01, 0x01}));
+
+    // Runs of 254 non-zero bytes
+    Bytes run(254);
+    std::ranges::generate(run, [i = 1]() mutable { return static_cast<std::uint8_t>(i++); });
+    Bytes expected{0xff};
+    expected.insert(expected.end(), run.begin(), run.end());
+    EXPECT_EQ(encode(run), expected);
+    run.push_back(0xff);
+    expected.insert(expected.end(), {0x02, 0xff});
+    EXPECT_EQ(encode(run), expected);
+    run.back() = 0x00;
+    expected.resize(expected.size() - 2);
+    expected.insert(expected.end(), {0x01, 0x01});
+    EXPECT_EQ(encode(run), expected);
+}
+
+TEST(CobsTest, RoundTrip)
+{
+    std::mt19937 gen{0};
+    std::uniform_int_distribution<int> byte{0, 255};
+    std::uniform_int_distribution<int> sparse{0, 3};
+    for (const std::size_t size : {0, 1, 2, 253, 254, 255, 256, 508, 509, 1000})
+    {
+        for (auto *distribution : {&byte, &sparse})
+        {
+            std::vector<std::uint8_t> data(size);
+            std::ranges::generate(data, [&] { return static_cast<std::uint8_t>((*distribution)(gen)); });
+            const auto frame = encode(data);
+            EXPECT_LE(frame.size(), cobs::max_encoded_size(size));
+            EXPECT_EQ(std::ranges::count(frame, 0), 0);
+            EXPECT_EQ(decode(frame), data) << size;
+        }
+    }
+    for (const std::uint8_t value : {0x00, 0xff})
+    {
+        const std::vector<std::uint8_t> data(600, value);
+        EXPECT_EQ(decode(encode(data)), data);
+    }
+}
+
+TEST(CobsTest, Malformed)
+{
+    std::vector<std::uint8_t> out(16);
+    EXPECT_FALSE(cobs::decode(std::vector<std::uint8_t>{0x03, 0x11}, out));        // Ends in a run
+    EXPECT_FALSE(cobs::decode(std::vector<std::uint8_t>{0x03, 0x11, 0x00}, out));  // Has a zero
+    EXPECT_FALSE(cobs::decode(std::vector<std::uint8_t>{0x00}, out));
+    EXPECT_EQ(cobs::decode(std::vector<std::uint8_t>{}, out), 0);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(cobs_tests);
@@ -0,0 +1,137 @@
+#include "../control_mailbox.h"
+
+#include <misc_utils/physical_size.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+static constexpr MotionLimits limits{.max_velocity = 1.0_mps, .max_acceleration = 5.0f, .max_jerk = 100.0f};
+
+static Position at(float x)
+{
+    return Position{XCoord{meters{x}}, YCoord{0.0_m}, Angle{0.0f}};
+}
+
+static ControlState initial_state()
+{
+    return ControlState{
+        .pos = at(0.0f),
+        .target = at(0.0f),
+        .reference_velocity = 0.0_mps,
+        .profile_time = VelocityProfile::seconds::zero(),
+        .progress = 0.0_m,
+        .left{},
+        .right{},
+        .distances{},
+        .healthy_sensors{},
+        .innovation = 0.0f,
+    };
+}
+
+TEST(ControlMailboxTest, Requests)
+{
+    ControlMailbox mailbox{initial_state()};
+    EXPECT_FALSE(mailbox.receive());
+
+    mailbox.set_target(at(1.0f));
+    mailbox.send();
+    auto update = mailbox.receive();
+    ASSERT_TRUE(update);
+    EXPECT_EQ(update->target.x->count(), 1.0f);
+    EXPECT_FALSE(update->pose_reset);
+    EXPECT_FALSE(update->profile);
+    EXPECT_FALSE(mailbox.receive());
+
+    // A reset and a profile, replaced by a newer command before they were received, still arrive (once).
+    mailbox.reset_pose(at(0.9f));
+    mailbox.start_profile(VelocityProfile::plan(0.5_m, 0.0_mps, 0.0_mps, limits));
+    mailbox.send();
+    mailbox.set_target(at(1.5f));
+    mailbox.send();
+    update = mailbox.receive();
+    ASSERT_TRUE(update);
+    EXPECT_EQ(update->target.x->count(), 1.5f);
+    ASSERT_TRUE(update->pose_reset);
+    EXPECT_EQ(update->pose_reset->x->count(), 0.9f);
+    ASSERT_TRUE(update->profile);
+    EXPECT_EQ(update->profile->distance().count(), 0.5f);
+
+    mailbox.send();
+    update = mailbox.receive();
+    ASSERT_TRUE(update);
+    EXPECT_FALSE(update->pose_reset);
+    EXPECT_FALSE(update->profile);
+}
+
+TEST(ControlMailboxTest, State)
+{
+    ControlMailbox mailbox{initial_state()};
+    EXPECT_EQ(mailbox.state().pos.x->count(), 0.0f);
+    auto state = initial_state();
+    state.pos = at(0.25f);
+    mailbox.publish(state);
+    EXPECT_EQ(mailbox.state().pos.x->count(), 0.25f);
+    EXPECT_EQ(mailbox.state().pos.x->count(), 0.25f);  // Kept until the next one
+}
+
+/**
+ * @brief A planner and a controller at full rate in different threads: every pose reset is applied at most once and
+ * in order, and the last one is applied. Run under ThreadSanitizer (MICROMOUSE_TSAN) to check for races.
+ */
+TEST(ControlMailboxTest, Stress)
+{
+    static constexpr std::uint32_t resets = 20'000;
+    ControlMailbox mailbox{initial_state()};
+
+    std::thread planner{[&]
+                        {
+                            for (std::uint32_t i = 1; i <= resets; i++)
+                            {
+                                mailbox.set_target(at(static_cast<float>(i)));
+                                mailbox.reset_pose(at(static_cast<float>(i)));
+                                mailbox.send();
+                                // Follow the controller's state, like the main loop does.
+                                [[maybe_unused]] const auto state = mailbox.state();
+                            }
+                        }};
+
+    auto state = initial_state();
+    auto last_reset = 0.0f;
+    auto applied = 0u;
+    auto out_of_order = false;
+    while (last_reset < static_cast<float>(resets))
+    {
+        const auto update = mailbox.receive();
+        if (!update)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        state.target = update->target;
+        if (update->pose_reset)
+        {
+            const auto reset = update->pose_reset->x->count();
+            out_of_order |= reset <= last_reset;
+            last_reset = reset;
+            state.pos = *update->pose_reset;
+            applied++;
+        }
+        mailbox.publish(state);
+    }
+    planner.join();
+    EXPECT_FALSE(out_of_order);
+    EXPECT_GT(applied, 0u);
+    EXPECT_LE(applied, resets);
+    EXPECT_FALSE(mailbox.receive());
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(control_mailbox_tests);
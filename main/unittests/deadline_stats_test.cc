@@ -0,0 +1,102 @@
+#include "../deadline_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using Timestamp = DeadlineStats::Timestamp;
+
+static constexpr Timestamp period{5'000};
+
+TEST(DeadlineStatsTest, Empty)
+{
+    const DeadlineStats stats{period};
+    EXPECT_EQ(stats.count(), 0);
+    EXPECT_EQ(stats.overruns(), 0);
+    EXPECT_EQ(stats.min_execution(), Timestamp::zero());
+    EXPECT_EQ(stats.mean_execution(), Timestamp::zero());
+    EXPECT_EQ(stats.wcet(), Timestamp::zero());
+    // Nothing was observed, so there's nothing to base a decision on.
+    EXPECT_FALSE(stats.fits(period));
+}
+
+TEST(DeadlineStatsTest, PeriodicTask)
+{
+    // Scheduling latency [us] and execution time [us] per period.
+    static constexpr std::array<std::int64_t, 5> latencies{20, 20, 60, 10, 20};
+    static constexpr std::array<std::int64_t, 5> executions{300, 320, 280, 800, 300};
+
+    DeadlineStats stats{period};
+    for (std::size_t i = 0; i < latencies.size(); i++)
+    {
+        const auto release = period * static_cast<std::int64_t>(i);
+        const auto start = release + Timestamp{latencies[i]};
+        stats.record(release, start, start + Timestamp{executions[i]});
+    }
+
+    EXPECT_EQ(stats.count(), 5);
+    EXPECT_EQ(stats.overruns(), 0);
+    EXPECT_EQ(stats.max_latency(), Timestamp{60});
+    // From the start at +60 to the start at +10
+    EXPECT_EQ(stats.max_jitter(), Timestamp{50});
+    EXPECT_EQ(stats.min_execution(), Timestamp{280});
+    EXPECT_EQ(stats.mean_execution(), Timestamp{400});
+    EXPECT_EQ(stats.wcet(), Timestamp{800});
+    EXPECT_EQ(stats.max_response(), Timestamp{810});
+
+    // The worst response time must fit in half of the period.
+    EXPECT_TRUE(stats.fits(period));
+    EXPECT_TRUE(stats.fits(Timestamp{1'620}));
+    EXPECT_FALSE(stats.fits(Timestamp{1'000}));
+
+    stats.reset();
+    EXPECT_EQ(stats.count(), 0);
+    EXPECT_EQ(stats.period(), period);
+    EXPECT_EQ(stats.wcet(), Timestamp::zero());
+}
+
+TEST(DeadlineStatsTest, Overruns)
+{
+    DeadlineStats stats{period};
+    stats.record(Timestamp{0}, Timestamp{10}, Timestamp{1'000});
+    // Ran past the next release
+    stats.record(period, period + Timestamp{10}, period * 2 + Timestamp{100});
+    EXPECT_EQ(stats.overruns(), 1);
+    // The release in the middle of the previous period was coalesced with this one.
+    stats.record(period * 3, period * 3 + Timestamp{10}, period * 3 + Timestamp{500}, 1);
+    EXPECT_EQ(stats.overruns(), 2);
+    EXPECT_EQ(stats.max_response(), period + Timestamp{100});
+    EXPECT_EQ(stats.max_jitter(), period);
+
+    // Any overrun means the current period is already too short.
+    EXPECT_FALSE(stats.fits(period * 100));
+}
+
+TEST(DeadlineStatsTest, Stalls)
+{
+    DeadlineStats stats{period};
+    stats.record(Timestamp{0}, Timestamp{10}, Timestamp{410});
+    EXPECT_TRUE(stats.fits(Timestamp{1'000}));
+
+    // A flash write that didn't hit a period yet, but may hit the next one.
+    stats.record_stall(Timestamp{300});
+    stats.record_stall(Timestamp{200});
+    EXPECT_EQ(stats.max_stall(), Timestamp{300});
+    EXPECT_EQ(stats.max_response(), Timestamp{410});
+    EXPECT_EQ(stats.overruns(), 0);
+    EXPECT_FALSE(stats.fits(Timestamp{1'000}));
+    EXPECT_TRUE(stats.fits(Timestamp{1'420}));
+
+    stats.reset();
+    EXPECT_EQ(stats.max_stall(), Timestamp::zero());
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(deadline_stats_tests);
@@ -0,0 +1,183 @@
+#include "misc_utils/fast_math.h"
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "benchmark.h"
+#include "misc_utils_adapters.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+// The documented error bounds (see fast_math.h)
+inline constexpr double trig_max_error = 1.5e-6;
+inline constexpr double atan2_max_error = 1e-6;
+inline constexpr double sqrt_max_rel_error = 5e-6;
+
+// Everything is usable in constant expressions
+static_assert(fast::sin(0.0f) == 0.0f);
+static_assert(fast::cos(Angle{0.0f}) > 0.999f);
+static_assert(fast::atan2(0.0f, 0.0f).get() == 0.0f);
+static_assert(fast::rsqrt(4.0f) > 0.499f && fast::rsqrt(4.0f) < 0.501f);
+static_assert(fast::square(3) == 9);
+
+static double angle_diff(double a, double b)
+{
+    return std::remainder(a - b, 2 * std::numbers::pi);
+}
+
+TEST(FastMathTest, SinCos)
+{
+    auto max_sin_err = 0.0;
+    auto max_cos_err = 0.0;
+    for (auto x = -1e4; x <= 1e4; x += 0.0137)
+    {
+        const auto xf = static_cast<float>(x);
+        const auto [s, c] = fast::sincos(xf);
+        max_sin_err = std::max(max_sin_err, std::abs(s - std::sin(static_cast<double>(xf))));
+        max_cos_err = std::max(max_cos_err, std::abs(c - std::cos(static_cast<double>(xf))));
+        ASSERT_EQ(s, fast::sin(xf));
+        ASSERT_EQ(c, fast::cos(xf));
+    }
+    EXPECT_LE(max_sin_err, trig_max_error);
+    EXPECT_LE(max_cos_err, trig_max_error);
+}
+
+TEST(FastMathTest, SinCosAngle)
+{
+    auto max_sin_err = 0.0;
+    auto max_cos_err = 0.0;
+    for (auto x = -std::numbers::pi; x < std::numbers::pi; x += 1e-4)
+    {
+        const Angle angle{static_cast<float>(x)};
+        const auto [s, c] = fast::sincos(angle);
+        max_sin_err = std::max(max_sin_err, std::abs(s - std::sin(static_cast<double>(angle.get()))));
+        max_cos_err = std::max(max_cos_err, std::abs(c - std::cos(static_cast<double>(angle.get()))));
+        // The Angle overloads skip the range reduction but must agree with the float versions.
+        ASSERT_NEAR(s, fast::sin(angle.get()), 1e-6f);
+        ASSERT_NEAR(c, fast::cos(angle.get()), 1e-6f);
+    }
+    EXPECT_LE(max_sin_err, trig_max_error);
+    EXPECT_LE(max_cos_err, trig_max_error);
+}
+
+TEST(FastMathTest, Atan2)
+{
+    auto max_err = 0.0;
+    for (auto t = -std::numbers::pi; t < std::numbers::pi; t += 1e-4)
+    {
+        for (auto r : {1e-3, 1.0, 1e3})
+        {
+            const auto y = static_cast<float>(r * std::sin(t));
+            const auto x = static_cast<float>(r * std::cos(t));
+            const auto expected = std::atan2(static_cast<double>(y), static_cast<double>(x));
+            max_err = std::max(max_err, std::abs(angle_diff(fast::atan2(y, x).get(), expected)));
+        }
+    }
+    EXPECT_LE(max_err, atan2_max_error);
+
+    // Axes
+    EXPECT_EQ(fast::atan2(0.0f, 1.0f).get(), 0.0f);
+    EXPECT_NEAR(fast::atan2(1.0f, 0.0f).get(), std::numbers::pi_v<float> / 2, atan2_max_error);
+    EXPECT_NEAR(fast::atan2(-1.0f, 0.0f).get(), -std::numbers::pi_v<float> / 2, atan2_max_error);
+    EXPECT_NEAR(std::abs(fast::atan2(0.0f, -1.0f).get()), std::numbers::pi_v<float>, atan2_max_error);
+}
+
+TEST(FastMathTest, Sqrt)
+{
+    auto max_rsqrt_err = 0.0;
+    auto max_sqrt_err = 0.0;
+    for (auto x = 1e-30; x < 1e30; x *= 1.001)
+    {
+        const auto xf = static_cast<float>(x);
+        const auto expected = std::sqrt(static_cast<double>(xf));
+        max_rsqrt_err = std::max(max_rsqrt_err, std::abs(fast::rsqrt(xf) * expected - 1));
+        max_sqrt_err = std::max(max_sqrt_err, std::abs(fast::sqrt(xf) / expected - 1));
+    }
+    EXPECT_LE(max_rsqrt_err, sqrt_max_rel_error);
+    EXPECT_LE(max_sqrt_err, sqrt_max_rel_error);
+    EXPECT_EQ(fast::sqrt(0.0f), 0.0f);
+    EXPECT_EQ(fast::sqrt(-1.0f), 0.0f);
+    EXPECT_NEAR(fast::hypot(3.0f, 4.0f), 5.0f, 5.0f * sqrt_max_rel_error);
+}
+
+TEST(FastMathTest, PhysicalSize)
+{
+    using namespace unit_literals;
+
+    const auto h = fast::hypot(30.0_mm, -40.0_mm);
+    static_assert(std::is_same_v<decltype(h), const millimeters>);
+    EXPECT_NEAR(h.count(), 50.0f, 50.0f * sqrt_max_rel_error);
+
+    const auto angle = fast::atan2(10.0_cm, -10.0_cm);
+    static_assert(std::is_same_v<decltype(angle), const Angle>);
+    EXPECT_NEAR(angle.get(), 3 * std::numbers::pi_v<float> / 4, atan2_max_error);
+
+    EXPECT_EQ(fast::square(3.0_m), 3.0_m * 3.0_m);
+}
+
+TEST(FastMathBenchmark, AgainstLibm)
+{
+    static constexpr std::size_t iterations = 10'000;
+    static constexpr std::size_t mask = 0xff;
+    static const auto inputs = []
+    {
+        std::array<float, mask + 1> res{};
+        for (std::size_t i = 0; i < res.size(); i++)
+        {
+            res[i] = -std::numbers::pi_v<float> + 2 * std::numbers::pi_v<float> * static_cast<float>(i) / res.size();
+        }
+        return res;
+    }();
+    const auto input = [](std::size_t i) { return inputs[i & mask]; };
+
+    std::cout << "Average cost per call (libm vs fast):" << std::endl;
+    bench::report(
+        "sin",
+        bench::measure([&](auto i) { return std::sin(input(i)); }, iterations),
+        bench::measure([&](auto i) { return fast::sin(input(i)); }, iterations)
+    );
+    bench::report(
+        "sin + cos / sincos(Angle)",
+        bench::measure([&](auto i) { return std::sin(input(i)) + std::cos(input(i)); }, iterations),
+        bench::measure(
+            [&](auto i)
+            {
+                const auto [s, c] = fast::sincos(Angle{unsafe, input(i)});
+                return s + c;
+            },
+            iterations
+        )
+    );
+    bench::report(
+        "atan2",
+        bench::measure([&](auto i) { return std::atan2(input(i), input(i + 7)); }, iterations),
+        bench::measure([&](auto i) { return fast::atan2(input(i), input(i + 7)).get(); }, iterations)
+    );
+    bench::report(
+        "sqrt(pow + pow) / hypot",
+        bench::measure(
+            [&](auto i) { return std::sqrt(std::pow(input(i), 2.0f) + std::pow(input(i + 7), 2.0f)); },
+            iterations
+        ),
+        bench::measure([&](auto i) { return fast::hypot(input(i), input(i + 7)); }, iterations)
+    );
+    bench::report(
+        "1 / sqrt",
+        bench::measure([&](auto i) { return 1.0f / std::sqrt(std::abs(input(i)) + 1.0f); }, iterations),
+        bench::measure([&](auto i) { return fast::rsqrt(std::abs(input(i)) + 1.0f); }, iterations)
+    );
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(fast_math_tests);
@@ -0,0 +1,309 @@
+#include "../flight_log.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using flight_log::Record;
+
+/**
+ * @brief NOR flash: erasing sets whole sectors to ones and writing (whole pages) can only clear bits.
+ */
+struct MemoryFlash
+{
+    explicit MemoryFlash(std::size_t blocks) : bytes(blocks * flight_log::block_size, 0xff) {}
+
+    std::size_t size() const { return bytes.size(); }
+
+    bool read(std::size_t offset, std::span<std::uint8_t> data) const
+    {
+        std::copy_n(&bytes[offset], data.size(), data.begin());
+        return true;
+    }
+
+    bool write(std::size_t offset, std::span<const std::uint8_t> data)
+    {
+        EXPECT_EQ(offset % flight_log::write_size, 0);
+        EXPECT_EQ(data.size(), flight_log::write_size);
+        if (fail_writes)
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < data.size(); i++)
+        {
+            bytes[offset + i] &= data[i];
+        }
+        writes++;
+        return true;
+    }
+
+    bool erase(std::size_t offset, std::size_t size)
+    {
+        EXPECT_EQ(offset % flight_log::block_size, 0);
+        EXPECT_EQ(size % flight_log::block_size, 0);
+        std::fill_n(&bytes[offset], size, 0xff);
+        erased += size / flight_log::block_size;
+        return true;
+    }
+
+    std::vector<std::uint8_t> bytes;
+    std::uint32_t writes = 0;
+    std::uint32_t erased = 0;  // [blocks]
+    bool fail_writes = false;
+};
+
+using Recorder = flight_log::Recorder<MemoryFlash>;
+
+static Record record(std::uint32_t i)
+{
+    return {
+        .time = i * 5000,
+        .distances{static_cast<std::uint16_t>(i), 100, 200, 300, 400},
+        .fresh = static_cast<std::uint8_t>(i % 32),
+        .healthy = 0b11111,
+        .left_ticks = static_cast<std::int32_t>(i),
+        .right_ticks = -static_cast<std::int32_t>(i),
+        .left_velocity = 0.25f,
+        .right_velocity = 0.35f,
+        .process_noise_scale = 1.0f,
+        .prior_x = 0.001f * static_cast<float>(i),
+        .prior_y = 0.09f,
+        .prior_theta = 0.5f,
+        .x = 0.001f * static_cast<float>(i + 1),
+        .y = 0.09f,
+        .theta = 0.5f,
+        .x_variance = 1e-6f,
+        .y_variance = 2e-6f,
+        .theta_variance = 3e-6f,
+        .innovation = 4.0f,
+        .left_wanted_velocity = 0.3f,
+        .right_wanted_velocity = 0.4f,
+        .left_output = 100.0f,
+        .right_output = -100.0f,
+        .flags = i % 2 == 0 ? flight_log::frame_flag : 0,
+    };
+}
+
+static void write_all(Recorder &recorder)
+{
+    while (recorder.write_some())
+    {
+    }
+}
+
+/**
+ * @brief The times of the records in the flash (the records must match `record`).
+ */
+static std::vector<std::uint32_t> read_times(const MemoryFlash &flash, flight_log::ReadStats *stats = nullptr)
+{
+    std::vector<std::uint32_t> times;
+    const auto res = flight_log::read(
+        flash.bytes,
+        [&](const Record &r, std::uint32_t)
+        {
+            times.push_back(r.time);
+            const auto expected = record(r.time / 5000);
+            EXPECT_EQ(std::memcmp(&r, &expected, sizeof(r)), 0);
+        }
+    );
+    if (stats != nullptr)
+    {
+        *stats = res;
+    }
+    return times;
+}
+
+static std::vector<std::uint32_t> expected_times(std::uint32_t first, std::uint32_t last)
+{
+    std::vector<std::uint32_t> times;
+    for (auto i = first; i < last; i++)
+    {
+        times.push_back(record(i).time);
+    }
+    return times;
+}
+
+TEST(FlightLogTest, RoundTrip)
+{
+    static constexpr std::uint32_t count = 3 * flight_log::records_per_block + 10;
+    MemoryFlash flash{8};
+    Recorder recorder{flash};
+    recorder.record(record(1000));  // Not started yet
+    ASSERT_TRUE(recorder.start());
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        recorder.record(record(i));
+        write_all(recorder);
+    }
+    EXPECT_TRUE(recorder.finish());
+    write_all(recorder);
+    EXPECT_TRUE(recorder.flushed());
+
+    flight_log::ReadStats stats;
+    EXPECT_EQ(read_times(flash, &stats), expected_times(0, count));
+    EXPECT_EQ(stats.blocks, 4);
+    EXPECT_EQ(stats.records, count);
+    EXPECT_EQ(stats.dropped, 0);
+    EXPECT_EQ(stats.bad_blocks, 0);
+    EXPECT_EQ(recorder.stats().blocks, 4);
+    EXPECT_EQ(recorder.stats().records, count);
+
+    // The partial block only programs the pages it uses.
+    const auto last_block_pages =
+        (sizeof(flight_log::BlockHeader) + 10 * sizeof(Record) + flight_log::write_size - 1) / flight_log::write_size;
+    EXPECT_EQ(flash.writes, 3 * flight_log::block_size / flight_log::write_size + last_block_pages);
+}
+
+TEST(FlightLogTest, DropsWhileWriting)
+{
+    MemoryFlash flash{8};
+    Recorder recorder{flash};
+    ASSERT_TRUE(recorder.start());
+    // The writer doesn't get to run: the first block is handed off, the second one fills and then records are dropped.
+    const auto filled = static_cast<std::uint32_t>(2 * flight_log::records_per_block);
+    for (std::uint32_t i = 0; i < filled + 5; i++)
+    {
+        recorder.record(record(i));
+    }
+    EXPECT_EQ(recorder.stats().dropped, 5);
+    EXPECT_FALSE(recorder.flushed());
+    EXPECT_TRUE(recorder.write_some());  // A page at a time
+
+    write_all(recorder);
+    recorder.record(record(filled + 5));
+    EXPECT_FALSE(recorder.finish());  // The second block is still being written
+    write_all(recorder);
+    EXPECT_TRUE(recorder.finish());
+    write_all(recorder);
+
+    flight_log::ReadStats stats;
+    auto expected = expected_times(0, filled);
+    expected.push_back(record(filled + 5).time);
+    EXPECT_EQ(read_times(flash, &stats), expected);
+    EXPECT_EQ(stats.dropped, 5);
+    EXPECT_EQ(stats.blocks, 3);
+}
+
+TEST(FlightLogTest, Full)
+{
+    MemoryFlash flash{2};
+    Recorder recorder{flash};
+    ASSERT_TRUE(recorder.start());
+    const auto capacity = static_cast<std::uint32_t>(2 * flight_log::records_per_block);
+    for (std::uint32_t i = 0; i < capacity + 100; i++)
+    {
+        recorder.record(record(i));
+        write_all(recorder);
+    }
+    EXPECT_TRUE(recorder.finish());
+    EXPECT_EQ(recorder.stats().dropped, 100);
+    EXPECT_EQ(read_times(flash), expected_times(0, capacity));
+}
+
+TEST(FlightLogTest, StartErasesThePreviousLog)
+{
+    MemoryFlash flash{16};
+    {
+        Recorder recorder{flash};
+        ASSERT_TRUE(recorder.start());
+        EXPECT_EQ(flash.erased, 1);  // Already erased
+        for (std::uint32_t i = 0; i < 3 * flight_log::records_per_block; i++)
+        {
+            recorder.record(record(i));
+            write_all(recorder);
+        }
+        EXPECT_TRUE(recorder.finish());
+        write_all(recorder);
+    }
+
+    flash.erased = 0;
+    Recorder recorder{flash};
+    ASSERT_TRUE(recorder.start());
+    EXPECT_EQ(flash.erased, 4);  // Up to the first erased block
+    for (std::uint32_t i = 1000; i < 1010; i++)
+    {
+        recorder.record(record(i));
+    }
+    EXPECT_TRUE(recorder.finish());
+    write_all(recorder);
+    EXPECT_EQ(read_times(flash), expected_times(1000, 1010));
+}
+
+TEST(FlightLogTest, BadBlocks)
+{
+    MemoryFlash flash{8};
+    Recorder recorder{flash};
+    ASSERT_TRUE(recorder.start());
+    for (std::uint32_t i = 0; i < 3 * flight_log::records_per_block; i++)
+    {
+        recorder.record(record(i));
+        write_all(recorder);
+    }
+    EXPECT_TRUE(recorder.finish());
+    flash.fail_writes = true;
+    write_all(recorder);
+    EXPECT_EQ(recorder.stats().write_errors, 1);
+    EXPECT_TRUE(recorder.flushed());
+
+    // A flipped bit in the first block, the second one is fine and the third one was never written.
+    flash.bytes[100] ^= 0x04;
+    flight_log::ReadStats stats;
+    const auto first = static_cast<std::uint32_t>(flight_log::records_per_block);
+    EXPECT_EQ(read_times(flash, &stats), expected_times(first, 2 * first));
+    EXPECT_EQ(stats.bad_blocks, 1);
+    EXPECT_EQ(stats.blocks, 1);
+}
+
+/**
+ * @brief Record from one thread and write from another, like the PID loop and the writer task. Whatever isn't dropped
+ * must arrive whole and in order. Run under ThreadSanitizer (MICROMOUSE_TSAN) to check for races.
+ */
+TEST(FlightLogTest, Stress)
+{
+    static constexpr std::uint32_t count = 20'000;
+    MemoryFlash flash{count / flight_log::records_per_block + 2};
+    Recorder recorder{flash};
+    ASSERT_TRUE(recorder.start());
+
+    std::atomic<bool> done = false;
+    std::thread writer{[&]
+                       {
+                           while (!done.load(std::memory_order_acquire) || !recorder.flushed())
+                           {
+                               recorder.write_some();
+                           }
+                       }};
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        recorder.record(record(i));
+    }
+    while (!recorder.finish())
+    {
+        std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    writer.join();
+
+    const auto stats = recorder.stats();
+    const auto times = read_times(flash);
+    EXPECT_EQ(times.size(), stats.records);
+    EXPECT_EQ(stats.records + stats.dropped, count);
+    EXPECT_TRUE(std::ranges::is_sorted(times));
+    EXPECT_EQ(std::ranges::adjacent_find(times), times.end());
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(flight_log_tests);
@@ -0,0 +1,252 @@
+#include "../flight_replay.h"
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "../distance_sensor.h"
+#include "../distance_sensor_model.h"
+#include "../flight_log.h"
+#include "../motion_model.h"
+#include "../pose_estimator.h"
+#include "../temp_map.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using flight_log::Record;
+
+static constexpr std::chrono::duration<float, std::micro> period{5000};
+
+/**
+ * @brief A run of the firmware's pose estimation, like the PID loop: driving down the first row of the maze with a
+ * (noisy) sensor frame every few ticks, with outliers, stale and failed sensors, a varying process noise scale and a
+ * pose reset (to the true pose) every now and then.
+ *
+ * @param warmup Whether the filters are filled before the run and their frames recorded first, like the firmware.
+ */
+static std::vector<Record> record_run(
+    std::size_t ticks,
+    float corridor_gain = PoseEstimator::default_corridor_gain,
+    bool warmup = false
+)
+{
+    std::mt19937 gen{4321};
+    std::normal_distribution<float> noise{0.0f, 3.0f};  // [mm]
+    std::uniform_int_distribution<std::uint32_t> bits{0, (1U << DistanceSensors::sensor_count) - 1};
+
+    PoseEstimator estimator{maze_map, corridor_gain};
+    DistanceSensors::Filters filters;
+    Position truth{XCoord{meters{wall_length / 2}}, YCoord{meters{wall_length / 2}}, Angle{0.0f}};
+    auto pos = truth;
+    std::vector<Record> records;
+    const auto distances = [&](const Position &at)
+    {
+        // No readings are far enough to be out of range, so the predictions' errors are the walls' distances.
+        const auto walls = predict_readings(at, DistanceSensors::Readings{}, maze_map).error;
+        decltype(Record::distances) res{};
+        for (std::size_t j = 0; j < DistanceSensors::sensor_count; j++)
+        {
+            res[j] = static_cast<std::uint16_t>(walls(j) == 0.0f ? 200.0f : -walls(j) * 1000 + noise(gen));  // [mm]
+        }
+        return res;
+    };
+    if (warmup)
+    {
+        for (std::size_t i = 0; i < DistanceSensors::filter_window; i++)
+        {
+            DistanceSensors::Frame frame{};
+            frame.distances = distances(truth);
+            frame.fresh = 0b11111;
+            frame.healthy = 0b11111;
+            filters.update(frame);
+            Record record{};
+            record.time = static_cast<std::uint32_t>(i * 20'000);
+            record.distances = frame.distances;
+            record.fresh = 0b11111;
+            record.healthy = 0b11111;
+            record.flags = flight_log::frame_flag | flight_log::warmup_flag;
+            records.push_back(record);
+        }
+    }
+    for (std::size_t i = 0; i < ticks; i++)
+    {
+        if (i % 150 == 149)
+        {
+            pos = truth;  // Snapped to a waypoint
+        }
+        const auto prior_pos = pos;
+        const meters_per_second vl{0.2f + 0.01f * std::sin(static_cast<float>(i) / 40)};
+        const meters_per_second vr{0.2f - 0.01f * std::sin(static_cast<float>(i) / 40)};
+        truth = update_pos(truth, vl * 1.02f, vr, period);  // The left wheel slips a little.
+        estimator.kalman_filter().set_process_noise_scale(i % 100 < 10 ? 4.0f : 1.0f);
+
+        std::optional<DistanceSensors::Frame> frame;
+        if (i % 4 == 0)
+        {
+            frame = DistanceSensors::Frame{};
+            frame->distances = distances(truth);
+            if (i % 37 == 0)
+            {
+                frame->distances.fill(20);  // Outliers
+            }
+            frame->fresh = i % 12 == 0 ? bits(gen) : 0b11111;
+            frame->healthy = i % 200 < 20 ? 0b11101 : 0b11111;
+            filters.update(*frame);
+        }
+        const auto sensors = frame ? std::optional{PoseEstimator::Sensors{
+                                         .readings = filters.readings(),
+                                         .fresh = frame->fresh,
+                                         .healthy = frame->healthy,
+                                     }}
+                                   : std::nullopt;
+        pos = estimator.step(pos, vl, vr, period, sensors ? &*sensors : nullptr).pos;
+
+        const auto variance = estimator.kalman_filter().covariance().diagonal();
+        records.push_back({
+            .time = static_cast<std::uint32_t>(i * 5000),
+            .distances = frame ? frame->distances : decltype(Record::distances){},
+            .fresh = static_cast<std::uint8_t>(frame ? frame->fresh.to_ulong() : 0),
+            .healthy = static_cast<std::uint8_t>(frame ? frame->healthy.to_ulong() : 0),
+            .left_ticks = 0,
+            .right_ticks = 0,
+            .left_velocity = vl.count(),
+            .right_velocity = vr.count(),
+            .process_noise_scale = estimator.kalman_filter().process_noise_scale(),
+            .prior_x = prior_pos.x->count(),
+            .prior_y = prior_pos.y->count(),
+            .prior_theta = prior_pos.theta.get(),
+            .x = pos.x->count(),
+            .y = pos.y->count(),
+            .theta = pos.theta.get(),
+            .x_variance = variance(0),
+            .y_variance = variance(1),
+            .theta_variance = variance(2),
+            .innovation = estimator.kalman_filter().normalized_innovation(),
+            .left_wanted_velocity = 0.0f,
+            .right_wanted_velocity = 0.0f,
+            .left_output = 0.0f,
+            .right_output = 0.0f,
+            .flags = frame ? flight_log::frame_flag : 0,
+        });
+    }
+    return records;
+}
+
+static std::vector<FlightReplay::Output> replay_all(
+    const std::vector<Record> &records,
+    float corridor_gain = PoseEstimator::default_corridor_gain
+)
+{
+    FlightReplay replay{maze_map, period, corridor_gain};
+    std::vector<FlightReplay::Output> outputs;
+    for (const auto &record : records)
+    {
+        if (const auto output = replay(record))
+        {
+            outputs.push_back(*output);
+        }
+    }
+    return outputs;
+}
+
+static bool same_bits(float a, float b)
+{
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+TEST(FlightReplayTest, ReproducesTheRecordedPoses)
+{
+    const auto records = record_run(1000);
+    const auto outputs = replay_all(records);
+    ASSERT_EQ(outputs.size(), records.size());
+    std::size_t updates[3]{};
+    for (std::size_t i = 0; i < records.size(); i++)
+    {
+        const auto &r = records[i];
+        const auto &out = outputs[i];
+        EXPECT_EQ(out.time, r.time);
+        EXPECT_TRUE(same_bits(out.pos.x->count(), r.x)) << "tick " << i;
+        EXPECT_TRUE(same_bits(out.pos.y->count(), r.y)) << "tick " << i;
+        EXPECT_TRUE(same_bits(out.pos.theta.get(), r.theta)) << "tick " << i;
+        EXPECT_TRUE(same_bits(out.variance[0], r.x_variance)) << "tick " << i;
+        EXPECT_TRUE(same_bits(out.variance[2], r.theta_variance)) << "tick " << i;
+        EXPECT_TRUE(same_bits(out.innovation, r.innovation)) << "tick " << i;
+        updates[static_cast<std::size_t>(out.update)]++;
+    }
+    // Every path of the estimator was taken.
+    EXPECT_GT(updates[static_cast<std::size_t>(PoseEstimator::Update::None)], 0);
+    EXPECT_GT(updates[static_cast<std::size_t>(PoseEstimator::Update::Corridor)], 0);
+    EXPECT_GT(updates[static_cast<std::size_t>(PoseEstimator::Update::Ekf)], 0);
+}
+
+TEST(FlightReplayTest, FillsTheFiltersWithTheWarmup)
+{
+    static constexpr std::size_t warmup = DistanceSensors::filter_window;
+    const auto records = record_run(200, PoseEstimator::default_corridor_gain, true);
+    const auto outputs = replay_all(records);
+    ASSERT_EQ(outputs.size(), records.size() - warmup);
+    for (std::size_t i = 0; i < outputs.size(); i++)
+    {
+        const auto &r = records[warmup + i];
+        EXPECT_EQ(outputs[i].time, r.time);
+        EXPECT_TRUE(same_bits(outputs[i].pos.x->count(), r.x)) << "tick " << i;
+        EXPECT_TRUE(same_bits(outputs[i].pos.y->count(), r.y)) << "tick " << i;
+        EXPECT_TRUE(same_bits(outputs[i].pos.theta.get(), r.theta)) << "tick " << i;
+    }
+
+    // The first tick's frame alone doesn't fill the filters the same way.
+    const std::vector<Record> ticks{records.begin() + warmup, records.end()};
+    const auto unfilled = replay_all(ticks);
+    ASSERT_EQ(ticks.front().flags & flight_log::frame_flag, flight_log::frame_flag);
+    const auto &first = unfilled.front();
+    EXPECT_FALSE(
+        same_bits(first.pos.x->count(), ticks.front().x) && same_bits(first.pos.y->count(), ticks.front().y)
+        && same_bits(first.pos.theta.get(), ticks.front().theta)
+    );
+}
+
+TEST(FlightReplayTest, Deterministic)
+{
+    const auto records = record_run(1000);
+    const auto first = replay_all(records);
+    const auto second = replay_all(records);
+    ASSERT_EQ(first.size(), second.size());
+    for (std::size_t i = 0; i < first.size(); i++)
+    {
+        EXPECT_TRUE(same_bits(first[i].pos.x->count(), second[i].pos.x->count())) << "tick " << i;
+        EXPECT_TRUE(same_bits(first[i].pos.y->count(), second[i].pos.y->count())) << "tick " << i;
+        EXPECT_TRUE(same_bits(first[i].pos.theta.get(), second[i].pos.theta.get())) << "tick " << i;
+        EXPECT_EQ(first[i].update, second[i].update);
+    }
+}
+
+TEST(FlightReplayTest, ResynchronizesOnResets)
+{
+    // Replaying with another corridor gain diverges from the recorded poses...
+    const auto records = record_run(300);
+    const auto outputs = replay_all(records, 0.1f);
+    static constexpr std::size_t reset = 149;  // See `record_run`
+    EXPECT_FALSE(same_bits(outputs[reset - 1].pos.y->count(), records[reset - 1].y));
+    // ...until the firmware resets the pose. The reset's tick has no sensor frame, so it's the motion model's alone.
+    ASSERT_EQ(records[reset].flags & flight_log::frame_flag, 0);
+    EXPECT_TRUE(same_bits(outputs[reset].pos.x->count(), records[reset].x));
+    EXPECT_TRUE(same_bits(outputs[reset].pos.y->count(), records[reset].y));
+    EXPECT_TRUE(same_bits(outputs[reset].pos.theta.get(), records[reset].theta));
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(flight_replay_tests);
@@ -0,0 +1,185 @@
+#include "../gain_schedule.h"
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "../control_loop.h"
+#include "../pid.h"
+#include "../position.h"
+#include "../relay_tuner.h"
+#include "../temp_map.h"
+#include "lag_plant.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using seconds = RelayTuner::seconds;
+
+static constexpr seconds tick = std::chrono::microseconds{5'000};
+
+TEST(GainScheduleTest, Interpolation)
+{
+    static constexpr GainSchedule<3> schedule{
+        .speeds{0.2f, 0.8f, 1.6f},
+        .gains{PidGains{4.0f, 0.2f, 1.0f}, PidGains{2.0f, 0.1f, 0.5f}, PidGains{1.0f, 0.0f, 0.1f}},
+    };
+    // Held beyond the ends
+    EXPECT_FLOAT_EQ(schedule.at(0.0f).kp, 4.0f);
+    EXPECT_FLOAT_EQ(schedule.at(2.0f).kp, 1.0f);
+    // Exact at the table's speeds, in both directions
+    for (std::size_t i = 0; i < schedule.speeds.size(); i++)
+    {
+        EXPECT_FLOAT_EQ(schedule.at(schedule.speeds[i]).kp, schedule.gains[i].kp);
+        EXPECT_FLOAT_EQ(schedule.at(-schedule.speeds[i]).ki, schedule.gains[i].ki);
+    }
+    // Linear in between
+    const auto middle = schedule.at(1.2f);
+    EXPECT_FLOAT_EQ(middle.kp, 1.5f);
+    EXPECT_FLOAT_EQ(middle.ki, 0.05f);
+    EXPECT_FLOAT_EQ(middle.kd, 0.3f);
+
+    const auto flat = SpeedGainSchedule::flat(gain_schedule_speeds, {1.0f, 2.0f, 3.0f});
+    for (const auto speed : {0.0f, 0.5f, 1.0f, 2.0f})
+    {
+        EXPECT_FLOAT_EQ(flat.at(speed).ki, 2.0f);
+    }
+}
+
+TEST(GainScheduleTest, Bumpless)
+{
+    static constexpr auto error = 0.1f;
+    Pid<float> bumpless{1.0f, 0.5f, 0.0f};
+    Pid<float> plain{1.0f, 0.5f, 0.0f};
+    for (auto i = 0; i < 100; i++)
+    {
+        bumpless.calculate_pid(error);
+        plain.calculate_pid(error);
+    }
+    const auto before = bumpless.calculate_pid(error);
+    ASSERT_FLOAT_EQ(plain.calculate_pid(error), before);
+
+    // Halving ki doubles the integral term's share of the output with plain `set_gains`.
+    bumpless.set_gains_bumpless(1.0f, 0.25f, 0.0f);
+    plain.set_gains(1.0f, 0.25f, 0.0f);
+    const auto integral_step = 0.25f * error;  // One more tick of integration
+    EXPECT_NEAR(bumpless.calculate_pid(error), before + integral_step, 1e-4f);
+    EXPECT_GT(std::abs(plain.calculate_pid(error) - before), 10 * integral_step);
+}
+
+// The top of the schedule
+static constexpr auto top_speed = gain_schedule_speeds.back();
+
+/**
+ * @brief The speed-dependent plant: stiffer (a higher gain) at higher speeds.
+ */
+static LagPlant plant_at(float speed)
+{
+    return LagPlant{tick, 0.8f * (1 + 5 * speed / top_speed)};
+}
+
+struct StepResponse
+{
+    float overshoot;       // Relative to the step
+    float settling_error;  // The max relative error in the last half second
+};
+
+/**
+ * @brief Step from a standstill to `speed` (with a feed forward bias that holds it), on the plant at `speed`.
+ */
+static StepResponse step_response(float speed, const PidGains &gains)
+{
+    static constexpr auto duration = seconds{2.0f};
+    auto plant = plant_at(speed);
+    Pid<float> pid{gains.kp, gains.ki, gains.kd};
+    StepResponse response{.overshoot = 0.0f, .settling_error = 0.0f};
+    for (auto t = seconds::zero(); t < duration; t += tick)
+    {
+        plant.step(speed / plant.gain() + pid.calculate_pid(speed - plant.output()));
+        response.overshoot = std::max(response.overshoot, plant.output() / speed - 1);
+        if (t > duration - seconds{0.5f})
+        {
+            response.settling_error = std::max(response.settling_error, std::abs(plant.output() / speed - 1));
+        }
+    }
+    return response;
+}
+
+/**
+ * @brief Tune the plant at each of the schedule's speeds (like `autotune` does on the robot, but from the exact
+ * ultimate points), then compare the closed loop with the scheduled gains to the closed loop with the low speed gains
+ * everywhere.
+ */
+TEST(GainScheduleTest, ClosedLoop)
+{
+    SpeedGainSchedule schedule{.speeds = gain_schedule_speeds, .gains{}};
+    for (std::size_t i = 0; i < schedule.speeds.size(); i++)
+    {
+        schedule.gains[i] = tune(plant_at(schedule.speeds[i]).ultimate_point(), TuningRule::TyreusLuyben, tick);
+    }
+    EXPECT_GT(schedule.gains.front().kp, schedule.gains.back().kp);
+
+    for (const auto speed : {top_speed / 8, top_speed * 5 / 16, top_speed * 5 / 8, top_speed})
+    {
+        const auto scheduled = step_response(speed, schedule.at(speed));
+        const auto fixed = step_response(speed, schedule.gains.front());
+        std::cout << speed << " m/s: scheduled overshoot = " << scheduled.overshoot * 100
+                  << "%, low speed gains overshoot = " << fixed.overshoot * 100 << "%" << std::endl;
+        EXPECT_LT(scheduled.overshoot, 0.2f) << speed;
+        EXPECT_LT(scheduled.settling_error, 0.01f) << speed;
+        if (speed >= top_speed * 3 / 4)
+        {
+            // The low speed gains are too stiff at high speed.
+            EXPECT_GT(fixed.overshoot, 2 * scheduled.overshoot) << speed;
+        }
+    }
+}
+
+/**
+ * @brief The schedules are looked up by the reference velocity, so the planned segments must sweep the schedule's
+ * speeds: a long straight accelerates through every gain and cruises at the top one.
+ */
+TEST(GainScheduleTest, PlannedSpeeds)
+{
+    static constexpr auto kp = [](float speed) { return 1 + speed; };
+    SpeedGainSchedule schedule{.speeds = gain_schedule_speeds, .gains{}};
+    for (std::size_t i = 0; i < schedule.speeds.size(); i++)
+    {
+        schedule.gains[i] = {.kp = kp(schedule.speeds[i]), .ki = 0.0f, .kd = 0.0f};
+    }
+
+    const Position from{XCoord{wall_length / 2}, YCoord{wall_length / 2}, Angle{0.0f}};
+    const Position to{XCoord{wall_length * 4.5f}, YCoord{wall_length / 2}, Angle{0.0f}};
+    const auto profile = segment_profile(from, to, meters_per_second{0.0f});
+    auto max_speed = 0.0f;
+    auto interpolated = 0;
+    for (auto t = seconds::zero(); t < profile.duration(); t += tick)
+    {
+        const auto speed = profile.sample(t).velocity.count();
+        max_speed = std::max(max_speed, speed);
+        const auto gains = schedule.at(speed);
+        if (gains.kp > schedule.gains.front().kp && gains.kp < schedule.gains.back().kp)
+        {
+            // The gains are linear in the speed between the table's speeds.
+            EXPECT_NEAR(gains.kp, kp(speed), 1e-5f) << t.count();
+            interpolated++;
+        }
+    }
+    EXPECT_FLOAT_EQ(max_speed, linear_motion_limits.max_velocity.count());
+    EXPECT_EQ(schedule.at(max_speed).kp, schedule.gains.back().kp);
+    EXPECT_GT(interpolated, 10);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(gain_schedule_tests);
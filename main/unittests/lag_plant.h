@@ -0,0 +1,78 @@
+#ifndef UNITTESTS_LAG_PLANT_H
+#define UNITTESTS_LAG_PLANT_H
+
+#include "../relay_tuner.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <numbers>
+
+namespace micromouse::tests
+{
+
+/**
+ * @brief A plant with two first order lags and a dead time (like a motor, measured through a velocity observer, a
+ * period late): K * exp(-L * s) / ((tau1 * s + 1) * (tau2 * s + 1))
+ */
+class LagPlant
+{
+public:
+    using seconds = std::chrono::duration<float>;
+
+    static constexpr float tau1 = 0.06f;  // [s]
+    static constexpr float tau2 = 0.02f;  // [s]
+    static constexpr std::size_t delay_ticks = 1;
+    static constexpr auto steps = 10;  // Per tick
+
+    explicit LagPlant(seconds tick, float gain = 0.8f) : m_tick{tick}, m_gain{gain} {}
+
+    float gain() const { return m_gain; }
+    float output() const { return m_delayed.front(); }
+
+    /**
+     * @brief The ultimate point, solved from the plant's phase crossing -pi.
+     */
+    UltimatePoint ultimate_point() const
+    {
+        const auto delay = delay_ticks * m_tick.count();
+        const auto phase = [&](float w) { return std::atan(w * tau1) + std::atan(w * tau2) + w * delay; };
+        auto low = 0.0f;
+        auto high = 1e4f;
+        for (auto i = 0; i < 100; i++)
+        {
+            const auto mid = (low + high) / 2;
+            (phase(mid) < std::numbers::pi_v<float> ? low : high) = mid;
+        }
+        const auto w = low;
+        const auto magnitude = m_gain / std::sqrt((1 + w * w * tau1 * tau1) * (1 + w * w * tau2 * tau2));
+        return {.gain = 1 / magnitude, .period = seconds{2 * std::numbers::pi_v<float> / w}};
+    }
+
+    /**
+     * @brief Hold `input` for a tick.
+     */
+    void step(float input)
+    {
+        const auto dt = m_tick.count() / steps;
+        for (auto i = 0; i < steps; i++)
+        {
+            m_x1 += (m_gain * input - m_x1) * dt / tau1;
+            m_x2 += (m_x1 - m_x2) * dt / tau2;
+        }
+        m_delayed.push_back(m_x2);
+        m_delayed.pop_front();
+    }
+
+private:
+    seconds m_tick;
+    float m_gain;
+    float m_x1 = 0.0f;
+    float m_x2 = 0.0f;
+    std::deque<float> m_delayed = std::deque<float>(delay_ticks, 0.0f);
+};
+
+}  // namespace micromouse::tests
+
+#endif  // UNITTESTS_LAG_PLANT_H
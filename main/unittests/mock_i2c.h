@@ -0,0 +1,137 @@
+#ifndef UNITTESTS_MOCK_I2C_H
+#define UNITTESTS_MOCK_I2C_H
+
+#include "../sensor_acquisition.h"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+namespace micromouse::tests
+{
+
+/**
+ * @brief N ranging sensors behind an I2C mux, with fault injection. The sensor at port `p` is `sensors[p - 1]`.
+ *
+ * Every sensor measures every `period` (each with its own phase). Like the real ones, only the sensor the mux is
+ * connected to answers, and the data ready flag stays up until it's cleared.
+ *
+ * The faults:
+ * - `dead`: the sensor doesn't answer (never ready, reads 0 and doesn't re-initialize).
+ * - `stuck`: the sensor keeps measuring, but always reads `distance` (without the `jitter`).
+ * - `unreachable`: switching the mux to these sensors fails (`fail_switches` fails every switch).
+ */
+template <std::size_t N>
+struct MockI2c
+{
+    using Timestamp = SensorFrame<N>::Timestamp;
+
+    struct Device
+    {
+        Timestamp phase;
+        std::uint16_t distance;
+        Timestamp last_cleared{-1'000'000};
+        Timestamp period{0};       // `MockI2c::period` if 0
+        std::uint16_t jitter = 0;  // [mm] Added to every other reading
+        bool dead = false;
+        bool stuck = false;
+        std::uint32_t reads = 0;
+        std::uint32_t inits = 0;  // Successful re-initializations
+    };
+
+    /**
+     * @brief The mux (a `SensorMux`).
+     */
+    struct Mux
+    {
+        MockI2c &bus;
+
+        bool setPort(std::uint8_t port)
+        {
+            bus.transactions++;
+            if (bus.fail_switches || bus.unreachable.test(static_cast<std::size_t>(port - 1)))
+            {
+                return false;
+            }
+            bus.port = port;
+            return true;
+        }
+    };
+
+    /**
+     * @brief The sensor the mux is connected to (a `RangingSensor`).
+     */
+    struct Sensor
+    {
+        MockI2c &bus;
+
+        bool checkForDataReady()
+        {
+            bus.transactions++;
+            const auto &device = bus.connected();
+            return !device.dead && bus.ready(device);
+        }
+
+        std::uint16_t getDistance()
+        {
+            bus.transactions++;
+            auto &device = bus.connected();
+            if (device.dead)
+            {
+                return 0;
+            }
+            const auto jitter = device.stuck || device.reads++ % 2 == 0 ? 0 : device.jitter;
+            return static_cast<std::uint16_t>(device.distance + jitter);
+        }
+
+        void clearInterrupt()
+        {
+            bus.transactions++;
+            bus.connected().last_cleared = bus.now;
+        }
+
+        /**
+         * @brief Like `SFEVL53L1X::begin` (and restarting the measurements), but returns whether it succeeded.
+         */
+        bool reinit()
+        {
+            bus.transactions++;
+            auto &device = bus.connected();
+            if (device.dead)
+            {
+                return false;
+            }
+            device.inits++;
+            return true;
+        }
+    };
+
+    explicit MockI2c(const std::array<Device, N> &devices) : sensors{devices} {}
+
+    Device &connected() { return sensors.at(static_cast<std::size_t>(port - 1)); }
+
+    // The start of the latest measurement period
+    Timestamp latest_measurement(const Device &device) const
+    {
+        const auto device_period = device.period == Timestamp::zero() ? period : device.period;
+        return now - (now - device.phase + 10 * device_period) % device_period;
+    }
+
+    bool ready(const Device &device) const
+    {
+        return now >= device.phase && device.last_cleared < latest_measurement(device);
+    }
+
+    Timestamp period{20'000};
+    Timestamp now{0};
+    std::array<Device, N> sensors;
+    int port = -1;
+    bool fail_switches = false;
+    std::bitset<N> unreachable;
+    std::uint32_t transactions = 0;
+};
+
+}  // namespace micromouse::tests
+
+#endif  // UNITTESTS_MOCK_I2C_H
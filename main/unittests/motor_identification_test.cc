@@ -0,0 +1,122 @@
+#include "../motor_identification.h"
+
+#include <misc_utils/physical_size.h>
+
+#include "../motor_specs.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using seconds = MotorModel::seconds;
+
+static constexpr MotorModel true_model{.Ks = 0.71f, .Kv = 1.2f, .tau = 0.06f};
+static constexpr seconds period = std::chrono::microseconds{5'000};
+
+TEST(MotorModelTest, Step)
+{
+    // Stays in the deadband
+    EXPECT_EQ(true_model.step(meters_per_second{0.0f}, 0.7f, period).count(), 0.0f);
+    EXPECT_EQ(true_model.step(meters_per_second{0.0f}, -0.7f, period).count(), 0.0f);
+
+    // Settles at the steady state velocity, which the feed forward inverts.
+    for (const auto command : {1.0f, -1.5f})
+    {
+        auto velocity = meters_per_second{0.0f};
+        for (auto t = seconds::zero(); t < 10 * seconds{true_model.tau}; t += period)
+        {
+            velocity = true_model.step(velocity, command, period);
+        }
+        const auto steady_state = std::copysign(std::abs(command) - true_model.Ks, command) / true_model.Kv;
+        EXPECT_NEAR(velocity.count(), steady_state, 1e-4f);
+        EXPECT_NEAR(true_model.feed_forward(velocity, 0.0f), command, 1e-4f);
+    }
+
+    // Braked to a standstill without reversing
+    EXPECT_EQ(true_model.step(meters_per_second{0.01f}, -0.5f, period).count(), 0.0f);
+    EXPECT_EQ(true_model.step(meters_per_second{-0.01f}, 0.5f, period).count(), 0.0f);
+}
+
+TEST(ExcitationTest, Sequence)
+{
+    EXPECT_FALSE(Excitation::command(seconds{-1.0f}));
+    EXPECT_FALSE(Excitation::command(Excitation::duration));
+
+    auto velocity = meters_per_second{0.0f};
+    auto position = 0.0f;
+    auto max_distance = 0.0f;
+    for (auto t = seconds::zero(); t < Excitation::duration; t += period)
+    {
+        const auto command = Excitation::command(t);
+        ASSERT_TRUE(command);
+        ASSERT_LE(std::abs(*command), MotorSpecs::max_speed);
+        velocity = true_model.step(velocity, *command, period);
+        position += velocity.count() * period.count();
+        max_distance = std::max(max_distance, std::abs(position));
+    }
+    // Stays close to where it started
+    EXPECT_LT(std::abs(position), 0.1f);
+    EXPECT_LT(max_distance, 0.5f);
+}
+
+/**
+ * @brief Identify the model from the excitation sequence with noisy velocity measurements.
+ */
+TEST(MotorIdentifierTest, Fit)
+{
+    static constexpr auto plant_steps = 10;  // Per period
+    std::mt19937 gen{0};
+    std::normal_distribution<float> noise{0.0f, 0.01f};  // [m/s]
+
+    MotorIdentifier identifier{period};
+    EXPECT_FALSE(identifier.fit());
+    auto velocity = meters_per_second{0.0f};
+    for (auto t = seconds::zero(); const auto command = Excitation::command(t); t += period)
+    {
+        identifier.add(*command, velocity + meters_per_second{noise(gen)});
+        for (auto i = 0; i < plant_steps; i++)
+        {
+            velocity = true_model.step(velocity, *command, period / plant_steps);
+        }
+    }
+    const auto model = identifier.fit();
+    ASSERT_TRUE(model);
+    std::cout << "Identified: Ks = " << model->Ks << " Kv = " << model->Kv << " tau = " << model->tau << std::endl;
+    EXPECT_NEAR(model->Ks, true_model.Ks, 0.05f * true_model.Ks);
+    EXPECT_NEAR(model->Kv, true_model.Kv, 0.05f * true_model.Kv);
+    EXPECT_NEAR(model->tau, true_model.tau, 0.1f * true_model.tau);
+}
+
+TEST(MotorIdentifierTest, Degenerate)
+{
+    // A constant velocity can't tell the friction from the velocity factor.
+    MotorIdentifier identifier{period};
+    for (auto i = 0u; i < 2 * MotorIdentifier::min_samples; i++)
+    {
+        identifier.add(1.0f, meters_per_second{0.5f});
+    }
+    EXPECT_FALSE(identifier.fit());
+
+    // Too few samples
+    MotorIdentifier short_identifier{period};
+    auto velocity = meters_per_second{0.0f};
+    for (auto i = 0u; i < MotorIdentifier::min_samples / 2; i++)
+    {
+        const auto command = i % 20 < 10 ? 1.2f : -1.2f;
+        short_identifier.add(command, velocity);
+        velocity = true_model.step(velocity, command, period);
+    }
+    EXPECT_FALSE(short_identifier.fit());
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(motor_identification_tests);
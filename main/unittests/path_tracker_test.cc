@@ -0,0 +1,287 @@
+#include "../path_tracker.h"
+
+#include <misc_utils/angle.h>
+#include <misc_utils/fast_math.h>
+#include <misc_utils/physical_size.h>
+
+#include "../algorithm_api_mock.h"
+#include "../motion_model.h"
+#include "../temp_map.h"
+#include "../velocity_profile.h"
+#include "misc_utils_adapters.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using namespace unit_literals;
+
+static constexpr MotionLimits limits{
+    .max_velocity = 1.0_mps,
+    .max_acceleration = 5.0f,
+    .max_jerk = 100.0f,
+};
+
+static float distance(const Position &a, const Position &b)
+{
+    return std::hypot((a.x - b.x)->count(), (a.y - b.y)->count());
+}
+
+TEST(PathTest, Geometry)
+{
+    Path path;
+    ASSERT_TRUE(path.build(waypoints, limits));
+
+    // Starts and ends at the route's ends, heading along the first and last legs.
+    const auto start = path.at(0.0_m).pos;
+    EXPECT_LT(distance(start, waypoints.front()), 1e-6f);
+    EXPECT_NEAR(static_cast<float>(start.theta - waypoints.front().theta), 0.0f, 1e-5f);
+    const auto end = path.at(path.length()).pos;
+    EXPECT_LT(distance(end, waypoints.back()), 2e-3f);
+    EXPECT_NEAR(static_cast<float>(end.theta - waypoints.back().theta), 0.0f, 1e-5f);
+
+    // Continuous, and never further than a rounded corner from the polyline's cells.
+    static constexpr auto ds = 1e-3f;
+    auto prev = path.at(0.0_m);
+    for (auto s = ds; s <= path.length().count(); s += ds)
+    {
+        const auto cur = path.at(meters{s});
+        ASSERT_NEAR(distance(prev.pos, cur.pos), ds, 1e-4f);
+        ASSERT_LT(std::abs(static_cast<float>(cur.pos.theta - prev.pos.theta)), ds * std::abs(cur.curvature) + 1e-3f);
+        ASSERT_LE(std::abs(cur.curvature), 1 / get_turn(TurnType::Turn90).arc_radius * 1.0001f);
+        prev = cur;
+    }
+
+    // Every point projects onto itself.
+    for (auto s = 0.0f; s <= path.length().count(); s += 0.05f)
+    {
+        EXPECT_NEAR(path.project(path.at(meters{s}).pos, meters{std::max(s - 0.02f, 0.0f)}).count(), s, 1e-4f);
+    }
+}
+
+TEST(PathTest, InvalidWaypoints)
+{
+    Path path;
+    const std::array<Position, 1> single{waypoints.front()};
+    EXPECT_FALSE(path.build(single, limits));
+    EXPECT_TRUE(path.empty());
+
+    // A 60 degrees corner
+    const std::array sharp{
+        Position{XCoord{0.0_m}, YCoord{0.0_m}, Angle{0.0f}},
+        Position{XCoord{0.5_m}, YCoord{0.0_m}, Angle{0.0f}},
+        Position{XCoord{0.75_m}, YCoord{meters{0.25f * std::numbers::sqrt3_v<float>}}, Angle{0.0f}},
+    };
+    EXPECT_FALSE(path.build(sharp, limits));
+
+    // Two 90 degrees corners that are too close to each other
+    const std::array close{
+        Position{XCoord{0.0_m}, YCoord{0.0_m}, Angle{0.0f}},
+        Position{XCoord{0.5_m}, YCoord{0.0_m}, Angle{0.0f}},
+        Position{XCoord{0.5_m}, YCoord{0.1_m}, Angle{0.0f}},
+        Position{XCoord{0.0_m}, YCoord{0.1_m}, Angle{0.0f}},
+    };
+    EXPECT_FALSE(path.build(close, limits));
+
+    // Duplicates and points in the middle of a straight line are skipped.
+    const std::array straight{
+        Position{XCoord{0.0_m}, YCoord{0.0_m}, Angle{0.0f}},
+        Position{XCoord{0.0_m}, YCoord{0.0_m}, Angle{1.0f}},
+        Position{XCoord{0.2_m}, YCoord{0.0_m}, Angle{0.0f}},
+        Position{XCoord{0.5_m}, YCoord{0.0_m}, Angle{0.0f}},
+    };
+    ASSERT_TRUE(path.build(straight, limits));
+    EXPECT_NEAR(path.length().count(), 0.5f, 1e-5f);
+}
+
+TEST(PathTest, Reference)
+{
+    Path path;
+    ASSERT_TRUE(path.build(waypoints, limits));
+
+    static constexpr seconds dt{1e-3f};
+    auto prev = path.sample(seconds{0.0f});
+    EXPECT_EQ(prev.distance.count(), 0.0f);
+    EXPECT_EQ(prev.velocity.count(), 0.0f);
+    for (auto t = dt; t <= path.duration() + dt; t += dt)
+    {
+        const auto cur = path.sample(t);
+        ASSERT_LE(cur.velocity, limits.max_velocity);
+        ASSERT_GE(cur.distance, prev.distance);
+        ASSERT_NEAR(cur.distance.count(), prev.distance.count() + prev.velocity.count() * dt.count(), 2e-4f);
+        // Slow enough for the current curvature
+        const auto curvature = std::abs(path.at(cur.distance).curvature);
+        ASSERT_LE(cur.velocity.count() * cur.velocity.count() * curvature, TurnPrimitive::max_lateral_acceleration);
+        prev = cur;
+    }
+    EXPECT_FLOAT_EQ(prev.distance.count(), path.length().count());
+    EXPECT_EQ(prev.velocity.count(), 0.0f);
+}
+
+/**
+ * @brief A closed-loop simulation: the differential drive motion model with wheels that follow the wanted velocities
+ * with a first order lag, controlled like `pid_loop` does (at the same period).
+ */
+class ClosedLoop
+{
+public:
+    static constexpr auto control_period = std::chrono::microseconds{5'000};
+    static constexpr auto plant_steps = 5;              // Per control period
+    static constexpr auto wheel_time_constant = 0.02f;  // [s]
+    static constexpr auto distance_gain = 20.0f;        // [1/s] On the distance from the reference
+    static constexpr auto max_duration = seconds{30.0f};
+
+    explicit ClosedLoop(const Position &start) : m_pos{start} {}
+
+    const Position &pos() const { return m_pos; }
+    seconds time() const { return m_time; }
+    meters_per_second velocity() const { return (m_left + m_right) / 2; }
+
+    /**
+     * @brief Run a control period with the given linear and angular velocities.
+     */
+    void step(meters_per_second linear, float angular)
+    {
+        const auto wheels_delta = meters_per_second{angular * distance_between_wheels.count() / 2};
+        const auto dt = duration_cast<seconds>(control_period) / plant_steps;
+        const auto alpha = 1 - std::exp(-dt.count() / wheel_time_constant);
+        for (auto i = 0; i < plant_steps; i++)
+        {
+            m_left += (linear + wheels_delta - m_left) * alpha;
+            m_right += (linear - wheels_delta - m_right) * alpha;
+            m_pos = update_pos(m_pos, m_left, m_right, dt);
+        }
+        m_time += duration_cast<seconds>(control_period);
+    }
+
+    /**
+     * @brief Follow a path, steering with `tracker`.
+     *
+     * @param done When to stop (given the progress along the path), in addition to the reference reaching the end.
+     * @return The max cross track error [m].
+     */
+    template <typename Done>
+    float follow(const Path &path, PathTracker &tracker, Done &&done)
+    {
+        const auto start_time = m_time;
+        auto max_cross_track_error = 0.0f;
+        while (m_time < max_duration)
+        {
+            const auto steering = tracker.update(m_pos, velocity());
+            max_cross_track_error = std::max(max_cross_track_error, std::abs(steering.cross_track_error.count()));
+            const auto reference = path.sample(m_time - start_time);
+            if (m_time - start_time >= path.duration() && done(steering.progress))
+            {
+                break;
+            }
+            const auto distance_error = (reference.distance - steering.progress).count();
+            step(reference.velocity + meters_per_second{distance_gain * distance_error}, steering.angular_velocity);
+        }
+        return max_cross_track_error;
+    }
+
+    /**
+     * @brief Turn in place (like `pid_loop` does between targets) with a jerk-limited profile for the wheels.
+     */
+    void turn_in_place(const Angle &heading)
+    {
+        const auto start = m_pos.theta;
+        const auto angle = static_cast<float>(heading - start);
+        const auto sign = std::copysign(1.0f, angle);
+        const auto half_width = distance_between_wheels.count() / 2;
+        const auto profile = VelocityProfile::plan(meters{std::abs(angle) * half_width}, 0.0_mps, 0.0_mps, limits);
+        const auto start_time = m_time;
+        while (m_time < max_duration)
+        {
+            const auto t = m_time - start_time;
+            const auto turned = sign * static_cast<float>(m_pos.theta - start) * half_width;
+            // The same threshold `app_main` uses before moving on to the next target
+            const auto done = std::abs(static_cast<float>(m_pos.theta - heading)) <= std::numbers::pi_v<float> / 60;
+            if (t >= profile.duration() && done)
+            {
+                break;
+            }
+            const auto reference = profile.sample(t);
+            const auto wheel_velocity =
+                reference.velocity.count() + distance_gain * (reference.position.count() - turned);
+            step(0.0_mps, sign * wheel_velocity / half_width);
+        }
+    }
+
+private:
+    Position m_pos;
+    seconds m_time{0.0f};
+    meters_per_second m_left{0.0f};
+    meters_per_second m_right{0.0f};
+};
+
+/**
+ * @brief Drive the mock route: stopping at every waypoint and turning in place (the way `app_main` drives it) vs.
+ * following the rounded path with each steering law.
+ */
+TEST(PathTrackerTest, LapTime)
+{
+    static constexpr auto goal_tolerance = 5e-3f;  // [m]
+    // `max_diff_distance` in `app_main`
+    static constexpr auto waypoint_tolerance = unit_cast<meters>(20_mm).count();
+
+    // Stop and turn at every waypoint, drive the straights with the same tracker.
+    ClosedLoop point_to_point{waypoints.front()};
+    auto point_to_point_error = 0.0f;
+    for (std::size_t i = 1; i < waypoints.size(); i++)
+    {
+        const auto &target = waypoints[i];
+        const auto from = point_to_point.pos();
+        point_to_point.turn_in_place(fast::atan2((target.y - from.y).get(), (target.x - from.x).get()));
+        Path leg;
+        const std::array ends{point_to_point.pos(), target};
+        ASSERT_TRUE(leg.build(ends, limits));
+        PathTracker tracker{leg};
+        tracker.set_law(SteeringLaw::Stanley);
+        const auto tolerance = i + 1 == waypoints.size() ? goal_tolerance : waypoint_tolerance;
+        const auto error = point_to_point.follow(
+            leg,
+            tracker,
+            [&](meters progress) { return (leg.length() - progress).count() <= tolerance; }
+        );
+        point_to_point_error = std::max(point_to_point_error, error);
+    }
+    const auto point_to_point_time = point_to_point.time();
+    EXPECT_LT(distance(point_to_point.pos(), waypoints.back()), 2 * goal_tolerance);
+
+    Path path;
+    ASSERT_TRUE(path.build(waypoints, limits));
+    for (const auto law : {SteeringLaw::PurePursuit, SteeringLaw::Stanley})
+    {
+        const auto name = law == SteeringLaw::PurePursuit ? "pure pursuit" : "Stanley";
+        SCOPED_TRACE(name);
+        ClosedLoop robot{waypoints.front()};
+        PathTracker tracker{path};
+        tracker.set_law(law);
+        const auto max_error = robot.follow(
+            path,
+            tracker,
+            [&](meters progress) { return (path.length() - progress).count() <= goal_tolerance; }
+        );
+        EXPECT_LT(robot.time(), point_to_point_time * 0.8f);
+        EXPECT_LT(max_error, 5e-3f);
+        EXPECT_LT(distance(robot.pos(), waypoints.back()), 2 * goal_tolerance);
+        std::cout << "Lap time: stop at every waypoint = " << point_to_point_time.count()
+                  << " s (max cross track error " << point_to_point_error * 1e3f << " mm), " << name << " = "
+                  << robot.time().count() << " s (max cross track error " << max_error * 1e3f << " mm)" << std::endl;
+    }
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(path_tracker_tests);
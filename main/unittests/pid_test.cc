@@ -0,0 +1,192 @@
+#include "../pid.h"
+
+#include "benchmark.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using PidF = Pid<float>;
+
+/**
+ * @brief A copy of `pid_ctrl`'s positional calculation, called the same way: `pid_compute` validates the opaque
+ * heap-allocated handle and dispatches through the block's `calculate_func` pointer.
+ */
+struct ReferencePidBlock
+{
+    float kp, ki, kd;
+    float max_output, min_output;
+    float max_integral, min_integral;
+    float integral_err = 0;
+    float previous_err = 0;
+    float (*calculate_func)(ReferencePidBlock *pid, float error) = nullptr;
+};
+
+using reference_pid_handle = ReferencePidBlock *;
+
+[[gnu::noinline]] static float reference_pid_calc_positional(reference_pid_handle pid, float error) noexcept
+{
+    pid->integral_err = std::clamp(pid->integral_err + error, pid->min_integral, pid->max_integral);
+    const auto output = error * pid->kp + (error - pid->previous_err) * pid->kd + pid->integral_err * pid->ki;
+    pid->previous_err = error;
+    return std::clamp(output, pid->min_output, pid->max_output);
+}
+
+[[gnu::noinline]] static bool reference_pid_compute(reference_pid_handle pid, float error, float *output) noexcept
+{
+    if (pid == nullptr || output == nullptr)
+    {
+        return false;
+    }
+    *output = pid->calculate_func(pid, error);
+    return true;
+}
+
+static ReferencePidBlock make_reference(float kp, float ki, float kd, float max_output, float max_integral)
+{
+    return {kp, ki, kd, max_output, -max_output, max_integral, -max_integral, 0, 0, reference_pid_calc_positional};
+}
+
+static constexpr PidF::Limits test_limits{
+    .min_output = -400.0f,
+    .max_output = 400.0f,
+    .min_integral = -200.0f,
+    .max_integral = 200.0f,
+};
+
+// Usable in constant expressions
+static_assert(
+    []
+    {
+        PidF pid{2.0f, 0.5f, 1.0f};
+        pid.calculate_pid(1.0f);
+        return pid.calculate_pid(1.0f);
+    }()
+    == 2.0f + 0.5f * 2.0f + 0.0f
+);
+
+TEST(PidTest, MatchesPidCtrlWhenNotSaturated)
+{
+    auto reference = make_reference(3.0f, 0.1f, 0.25f, 400.0f, 200.0f);
+    PidF pid{3.0f, 0.1f, 0.25f, test_limits};
+    for (auto i = 0; i < 500; i++)
+    {
+        const auto error = 20.0f * std::sin(0.05f * static_cast<float>(i));
+        float expected = 0;
+        reference_pid_compute(&reference, error, &expected);
+        ASSERT_FLOAT_EQ(pid.calculate_pid(error), expected) << "at tick " << i;
+        ASSERT_EQ(pid.get_pid_val(), expected);
+    }
+}
+
+TEST(PidTest, Limits)
+{
+    PidF pid{10.0f, 1.0f, 0.0f, test_limits};
+    EXPECT_EQ(pid.calculate_pid(100.0f), test_limits.max_output);
+    EXPECT_EQ(pid.calculate_pid(-100.0f), test_limits.min_output);
+
+    PidF integrator{0.0f, 1.0f, 0.0f, test_limits};
+    for (auto i = 0; i < 1000; i++)
+    {
+        integrator.calculate_pid(1.0f);
+    }
+    EXPECT_EQ(integrator.get_integral(), test_limits.max_integral);
+    EXPECT_EQ(integrator.get_pid_val(), test_limits.max_integral);
+}
+
+TEST(PidTest, AntiWindup)
+{
+    // A large error saturates the output for a while, then the error flips sign.
+    auto reference = make_reference(1.0f, 0.5f, 0.0f, 400.0f, 1e6f);
+    PidF pid{1.0f, 0.5f, 0.0f, {.min_output = -400.0f, .max_output = 400.0f}};
+    for (auto i = 0; i < 100; i++)
+    {
+        float reference_output = 0;
+        reference_pid_compute(&reference, 300.0f, &reference_output);
+        EXPECT_EQ(pid.calculate_pid(300.0f), 400.0f);
+    }
+
+    // Without anti-windup the integral (15000) keeps the output saturated long after the error changed sign.
+    float reference_output = 0;
+    reference_pid_compute(&reference, -50.0f, &reference_output);
+    EXPECT_EQ(reference_output, 400.0f);
+    EXPECT_LT(pid.calculate_pid(-50.0f), 400.0f);
+    EXPECT_LE(pid.get_integral(), 2 * 400.0f);
+}
+
+TEST(PidTest, DerivativeFilter)
+{
+    PidF unfiltered{0.0f, 0.0f, 1.0f};
+    PidF filtered{0.0f, 0.0f, 1.0f, {}, 0.75f};
+
+    // A step in the error: the unfiltered derivative kicks once, the filtered one decays geometrically.
+    EXPECT_EQ(unfiltered.calculate_pid(1.0f), 1.0f);
+    EXPECT_EQ(filtered.calculate_pid(1.0f), 0.25f);
+    EXPECT_EQ(unfiltered.calculate_pid(1.0f), 0.0f);
+    EXPECT_EQ(filtered.calculate_pid(1.0f), 0.75f * 0.25f);
+
+    filtered.reset();
+    EXPECT_EQ(filtered.get_pid_val(), 0.0f);
+    EXPECT_EQ(filtered.calculate_pid(0.0f), 0.0f);
+}
+
+TEST(PidBenchmark, AgainstHandle)
+{
+    static constexpr std::size_t iterations = 1'000'000;
+
+    // Three controllers per motor, like `MotorArgs` - six calls per control tick.
+    const auto reference = make_reference(3.0f, 0.1f, 0.25f, 400.0f, 200.0f);
+    std::array<std::unique_ptr<ReferencePidBlock>, 6> blocks;
+    for (auto &block : blocks)
+    {
+        block = std::make_unique<ReferencePidBlock>(reference);
+    }
+    const PidF pid{reference.kp, reference.ki, reference.kd, test_limits};
+    std::array<PidF, 6> pids{pid, pid, pid, pid, pid, pid};
+
+    const auto error = [](std::size_t i) { return static_cast<float>(i & 0xff) - 128.0f; };
+    std::cout << "Average cost per control tick (6 controllers, pid_ctrl-style handle vs Pid<float>):" << std::endl;
+    bench::report(
+        "tick",
+        bench::measure(
+            [&](auto i)
+            {
+                float res = 0;
+                for (auto &block : blocks)
+                {
+                    float output = 0;
+                    reference_pid_compute(block.get(), error(i), &output);
+                    res += output;
+                }
+                return res;
+            },
+            iterations
+        ),
+        bench::measure(
+            [&](auto i)
+            {
+                float res = 0;
+                for (auto &pid : pids)
+                {
+                    res += pid.calculate_pid(error(i));
+                }
+                return res;
+            },
+            iterations
+        )
+    );
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(pid_tests);
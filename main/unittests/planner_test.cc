@@ -0,0 +1,213 @@
+#include "../planner.h"
+
+#include <misc_utils/physical_size.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+static Position at(float x)
+{
+    return Position{XCoord{meters{x}}, YCoord{0.0_m}, Angle{0.0f}};
+}
+
+/**
+ * @brief Route `r` (the number of walls seen so far) is `length` waypoints at x = 1000 * r + 0, 1, 2...
+ */
+class CountingPlanner
+{
+public:
+    explicit CountingPlanner(std::uint32_t length) noexcept : m_length{length} {}
+
+    std::optional<Position> get_next() noexcept
+    {
+        if (m_next == m_length)
+        {
+            return std::nullopt;
+        }
+        return at(static_cast<float>(1000 * m_route + m_next++));
+    }
+
+    bool update_walls(const WallUpdate &update) noexcept
+    {
+        if (update.walls == empty_walls)
+        {
+            return false;
+        }
+        m_route++;
+        m_next = 0;
+        return true;
+    }
+
+private:
+    std::uint32_t m_length;
+    std::uint32_t m_route = 0;
+    std::uint32_t m_next = 0;
+};
+static_assert(RoutePlanner<CountingPlanner>);
+
+static constexpr WallUpdate open_cell{.row = 0, .col = 0, .walls = empty_walls, .known = full_walls};
+static constexpr WallUpdate walled_cell{.row = 0, .col = 0, .walls = Walls::North, .known = full_walls};
+
+static std::vector<float> take_all(auto &planner)
+{
+    std::vector<float> waypoints;
+    while (const auto waypoint = planner.next_waypoint())
+    {
+        waypoints.push_back(waypoint->x->count());
+    }
+    return waypoints;
+}
+
+TEST(PlannerTest, Batches)
+{
+    CountingPlanner algorithm{10};
+    Planner planner{algorithm};
+    EXPECT_FALSE(planner.next_waypoint());
+    EXPECT_FALSE(planner.finished());
+
+    EXPECT_TRUE(planner.step());  // 4 + 4 + 2 (last)
+    EXPECT_FALSE(planner.step());
+    EXPECT_EQ(take_all(planner), (std::vector<float>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    EXPECT_TRUE(planner.finished());
+}
+
+TEST(PlannerTest, FullQueue)
+{
+    CountingPlanner algorithm{30};
+    Planner<CountingPlanner, 2> planner{algorithm};
+
+    std::vector<float> waypoints;
+    while (!planner.finished())
+    {
+        planner.step();  // At most 2 batches
+        for (auto i = 0; i < 3; i++)
+        {
+            if (const auto waypoint = planner.next_waypoint())
+            {
+                waypoints.push_back(waypoint->x->count());
+            }
+        }
+    }
+    ASSERT_EQ(waypoints.size(), 30);
+    for (std::size_t i = 0; i < waypoints.size(); i++)
+    {
+        EXPECT_EQ(waypoints[i], static_cast<float>(i));
+    }
+}
+
+TEST(PlannerTest, Replan)
+{
+    CountingPlanner algorithm{20};
+    Planner planner{algorithm};
+    planner.step();  // 16 waypoints queued
+    EXPECT_EQ(planner.next_waypoint()->x->count(), 0.0f);
+    EXPECT_EQ(planner.next_waypoint()->x->count(), 1.0f);
+
+    EXPECT_TRUE(planner.report_walls(open_cell));
+    planner.step();  // Nothing changed
+    EXPECT_EQ(planner.next_waypoint()->x->count(), 2.0f);
+
+    EXPECT_TRUE(planner.report_walls(walled_cell));
+    EXPECT_EQ(planner.next_waypoint()->x->count(), 3.0f);  // Not replanned yet
+    EXPECT_FALSE(planner.replanned());
+    planner.step();  // The queue is still full of the old route.
+    EXPECT_TRUE(planner.replanned());  // 3 is stale
+    // The rest of the old route (in the current batch and in the queue) is dropped, which makes room for the new one.
+    EXPECT_FALSE(planner.next_waypoint());
+    EXPECT_TRUE(planner.replanned());
+    planner.step();
+    auto expected = std::vector<float>(16);
+    std::ranges::generate(expected, [x = 1000.0f]() mutable { return x++; });
+    EXPECT_EQ(take_all(planner), expected);
+    EXPECT_FALSE(planner.finished());
+    planner.step();
+    EXPECT_EQ(take_all(planner), (std::vector<float>{1016, 1017, 1018, 1019}));
+    EXPECT_TRUE(planner.finished());
+    EXPECT_FALSE(planner.replanned());
+
+    // A replan after the route ended starts a new one.
+    EXPECT_TRUE(planner.report_walls(walled_cell));
+    planner.step();
+    EXPECT_FALSE(planner.finished());
+    EXPECT_EQ(planner.next_waypoint()->x->count(), 2000.0f);
+}
+
+TEST(PlannerTest, FullWallQueue)
+{
+    CountingPlanner algorithm{1};
+    Planner<CountingPlanner, 4, 2> planner{algorithm};
+    EXPECT_TRUE(planner.report_walls(open_cell));
+    EXPECT_TRUE(planner.report_walls(open_cell));
+    EXPECT_FALSE(planner.report_walls(walled_cell));
+}
+
+/**
+ * @brief The planner in its own thread, while the main thread takes waypoints and reports walls: every route's
+ * waypoints arrive in order, and the last route arrives whole. Run under ThreadSanitizer (MICROMOUSE_TSAN) to check
+ * for races.
+ */
+TEST(PlannerTest, Stress)
+{
+    static constexpr std::uint32_t length = 100;
+    static constexpr auto replans = 500;
+    CountingPlanner algorithm{length};
+    Planner<CountingPlanner, 2> planner{algorithm};
+
+    std::atomic<bool> stop = false;
+    std::thread planner_task{[&]
+                             {
+                                 while (!stop.load())
+                                 {
+                                     if (!planner.step())
+                                     {
+                                         std::this_thread::yield();
+                                     }
+                                 }
+                             }};
+
+    auto reported = 0;
+    auto route = 0;
+    auto last = -1.0f;
+    auto out_of_order = false;
+    auto last_route_count = 0u;
+    while (route < replans || !planner.finished())
+    {
+        const auto waypoint = planner.next_waypoint();
+        if (!waypoint)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        const auto x = waypoint->x->count();
+        // Within a route the waypoints are consecutive, and a new route starts from its beginning.
+        const auto new_route = last < 0 || static_cast<int>(x) / 1000 != route;
+        route = static_cast<int>(x) / 1000;
+        out_of_order |= new_route ? static_cast<int>(x) % 1000 != 0 || x < last : x != last + 1;
+        last_route_count = new_route ? 1 : last_route_count + 1;
+        last = x;
+        if (reported < replans && static_cast<int>(x) % 7 == 0 && planner.report_walls(walled_cell))
+        {
+            reported++;
+        }
+    }
+    stop = true;
+    planner_task.join();
+    EXPECT_FALSE(out_of_order);
+    EXPECT_EQ(last, 1000.0f * replans + length - 1);
+    EXPECT_EQ(last_route_count, length);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(planner_tests);
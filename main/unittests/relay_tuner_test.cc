@@ -0,0 +1,129 @@
+#include "../relay_tuner.h"
+
+#include "../pid.h"
+#include "lag_plant.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using seconds = RelayTuner::seconds;
+
+static constexpr seconds tick = std::chrono::microseconds{5'000};
+
+static constexpr RelayTuner::Config config{
+    .amplitude = 0.2f,
+    .hysteresis = 0.005f,
+    .settle_cycles = 2,
+    .cycles = 4,
+    .tolerance = 0.1f,
+    .timeout = seconds{5.0f},
+};
+
+TEST(RelayTunerTest, UltimatePoint)
+{
+    static constexpr auto setpoint = 0.3f;
+    std::mt19937 gen{0};
+    std::normal_distribution<float> noise{0.0f, 0.001f};
+
+    LagPlant plant{tick};
+    RelayTuner tuner{config, tick};
+    auto ticks = 0;
+    while (!tuner.done())
+    {
+        // Around a bias that holds the setpoint, like the feed forward does.
+        const auto bias = setpoint / plant.gain();
+        plant.step(bias + tuner.update(setpoint - plant.output() + noise(gen)));
+        ticks++;
+    }
+    ASSERT_TRUE(tuner.result());
+    const auto expected = plant.ultimate_point();
+    const auto &result = *tuner.result();
+    std::cout << "Ultimate point: Ku = " << result.gain << " (expected " << expected.gain << ") Tu = "
+              << result.period.count() << " s (expected " << expected.period.count() << " s) after "
+              << ticks * tick.count() << " s" << std::endl;
+    // The describing function is an approximation (the plant's output isn't a pure sine).
+    EXPECT_NEAR(result.gain, expected.gain, 0.15f * expected.gain);
+    EXPECT_NEAR(result.period.count(), expected.period.count(), 0.1f * expected.period.count());
+    EXPECT_EQ(tuner.update(1.0f), 0.0f);
+}
+
+TEST(RelayTunerTest, Timeout)
+{
+    // No response, so no oscillation
+    RelayTuner tuner{config, tick};
+    auto ticks = 0;
+    while (!tuner.done())
+    {
+        EXPECT_EQ(std::abs(tuner.update(1.0f)), ticks + 1 < config.timeout / tick ? config.amplitude : 0.0f);
+        ticks++;
+    }
+    EXPECT_FALSE(tuner.result());
+    EXPECT_NEAR(ticks * tick.count(), config.timeout.count(), tick.count());
+}
+
+TEST(RelayTunerTest, Rules)
+{
+    static constexpr UltimatePoint point{.gain = 2.0f, .period = seconds{0.1f}};
+    const auto zn = tune(point, TuningRule::ZieglerNichols, tick);
+    EXPECT_FLOAT_EQ(zn.kp, 1.2f);
+    EXPECT_FLOAT_EQ(zn.ki, 1.2f * tick.count() / 0.05f);
+    EXPECT_FLOAT_EQ(zn.kd, 1.2f * 0.0125f / tick.count());
+
+    // The conservative rules are less aggressive.
+    for (const auto rule : {TuningRule::NoOvershoot, TuningRule::TyreusLuyben})
+    {
+        const auto gains = tune(point, rule, tick);
+        EXPECT_LT(gains.kp, zn.kp);
+        EXPECT_LT(gains.ki, zn.ki);
+    }
+    EXPECT_GT(tune(point, TuningRule::PessenIntegral, tick).ki, zn.ki);
+}
+
+/**
+ * @brief Tune the plant and close the loop with the tuned gains: every rule settles on the setpoint, and the
+ * conservative ones overshoot less.
+ */
+TEST(RelayTunerTest, ClosedLoop)
+{
+    static constexpr auto setpoint = 0.3f;
+    LagPlant relay_plant{tick};
+    RelayTuner tuner{config, tick};
+    while (!tuner.done())
+    {
+        relay_plant.step(setpoint / relay_plant.gain() + tuner.update(setpoint - relay_plant.output()));
+    }
+    ASSERT_TRUE(tuner.result());
+
+    for (const auto rule :
+         {TuningRule::ZieglerNichols, TuningRule::PessenIntegral, TuningRule::NoOvershoot, TuningRule::TyreusLuyben})
+    {
+        SCOPED_TRACE(static_cast<int>(rule));
+        const auto gains = tune(*tuner.result(), rule, tick);
+        Pid<float> pid{gains.kp, gains.ki, gains.kd};
+        LagPlant plant{tick};
+        auto max_output = 0.0f;
+        for (auto t = seconds::zero(); t < seconds{3.0f}; t += tick)
+        {
+            plant.step(pid.calculate_pid(setpoint - plant.output()));
+            max_output = std::max(max_output, plant.output());
+        }
+        EXPECT_NEAR(plant.output(), setpoint, 0.01f * setpoint);
+        std::cout << "Rule " << static_cast<int>(rule) << ": overshoot = " << (max_output / setpoint - 1) * 100 << "%"
+                  << std::endl;
+    }
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(relay_tuner_tests);
@@ -0,0 +1,321 @@
+#include "../sensor_acquisition.h"
+
+#include "mock_i2c.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+static constexpr std::size_t sensor_count = 3;
+static constexpr std::array<std::uint8_t, sensor_count> ports{1, 2, 3};
+
+/**
+ * @brief The sensors, each with its own phase.
+ */
+struct MockBus : MockI2c<sensor_count>
+{
+    MockBus()
+        : MockI2c{{
+              Device{.phase = Timestamp{3'000}, .distance = 100},
+              Device{.phase = Timestamp{11'000}, .distance = 200},
+              Device{.phase = Timestamp{17'000}, .distance = 300},
+          }}
+    {}
+};
+using MockMux = MockBus::Mux;
+using MockSensor = MockBus::Sensor;
+
+static_assert(SensorMux<MockMux>);
+static_assert(RangingSensor<MockSensor>);
+
+using Acquisition = SensorAcquisition<MockMux, MockSensor, sensor_count>;
+
+TEST(SensorAcquisitionTest, ReadsEachSensorWhenReady)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports};
+    static constexpr MockBus::Timestamp poll_period{1'000};
+
+    std::uint32_t frames = 0;
+    for (; bus.now < MockBus::Timestamp{200'000}; bus.now += poll_period)
+    {
+        const auto transactions = bus.transactions;
+        const auto frame = acquisition.poll(bus.now);
+        // A poll never waits: at most a switch, a check, a read and a clear per sensor.
+        EXPECT_LE(bus.transactions - transactions, 4 * sensor_count);
+        if (!frame)
+        {
+            continue;
+        }
+        EXPECT_EQ(frame->sequence, frames++);
+        for (std::size_t i = 0; i < sensor_count; i++)
+        {
+            EXPECT_EQ(frame->distances[i], bus.sensors[i].distance);
+            // Read in the first poll after the measurement was ready
+            const auto ready = bus.latest_measurement(bus.sensors[i]);
+            EXPECT_GE(frame->timestamps[i], ready) << i;
+            EXPECT_LT(frame->timestamps[i], ready + poll_period) << i;
+        }
+        // The frame completes when its last sensor is read.
+        EXPECT_EQ(bus.now, std::ranges::max(frame->timestamps));
+        EXPECT_LE(bus.now - frame->timestamp(), bus.period);
+    }
+    // A frame per measurement period (the first period is partial)
+    EXPECT_GE(frames, 9);
+    EXPECT_EQ(acquisition.stats().polls, 200);
+    EXPECT_EQ(acquisition.stats().mux_errors, 0);
+    EXPECT_EQ(acquisition.stats().readings, (std::array<std::uint32_t, sensor_count>{frames, frames, frames}));
+}
+
+TEST(SensorAcquisitionTest, Pacing)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports};
+    bus.sensors[0].period = MockBus::Timestamp{5'000};
+    bus.sensors[2].period = MockBus::Timestamp{5'000};
+    acquisition.set_pacing(std::bitset<sensor_count>{0b101});
+
+    std::uint32_t frames = 0;
+    std::uint32_t slow_readings = 0;
+    for (; bus.now < MockBus::Timestamp{200'000}; bus.now += MockBus::Timestamp{1'000})
+    {
+        const auto frame = acquisition.poll(bus.now);
+        if (!frame)
+        {
+            continue;
+        }
+        frames++;
+        // The fast sensors are fresh in every frame, and the slow one only when it was read.
+        EXPECT_TRUE(frame->fresh.test(0));
+        EXPECT_TRUE(frame->fresh.test(2));
+        if (frame->fresh.test(1))
+        {
+            slow_readings++;
+            EXPECT_EQ(frame->distances[1], 200);
+        }
+    }
+    // A frame per fast measurement period, instead of per slow one
+    EXPECT_GE(frames, 35);
+    EXPECT_EQ(slow_readings, acquisition.stats().readings[1]);
+    EXPECT_GE(slow_readings, 9);
+    EXPECT_LE(slow_readings, 10);
+}
+
+TEST(SensorAcquisitionTest, WithSensor)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports};
+    EXPECT_TRUE(acquisition.with_sensor(1, [&](MockSensor &) { EXPECT_EQ(bus.port, ports[1]); }));
+    EXPECT_TRUE(acquisition.with_sensor(1, [](MockSensor &) {}));  // Already connected
+    EXPECT_EQ(acquisition.stats().mux_switches, 1);
+
+    bus.fail_switches = true;
+    auto accessed = false;
+    EXPECT_FALSE(acquisition.with_sensor(2, [&](MockSensor &) { accessed = true; }));
+    EXPECT_FALSE(accessed);
+    EXPECT_EQ(acquisition.stats().mux_errors, 1);
+}
+
+TEST(SensorAcquisitionTest, MuxSwitches)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports};
+    // All of the sensors are ready together: every sensor is checked once, with a switch each.
+    bus.sensors[1].phase = bus.sensors[0].phase;
+    bus.sensors[2].phase = bus.sensors[0].phase;
+    bus.now = bus.sensors[0].phase;
+    ASSERT_TRUE(acquisition.poll(bus.now));
+    EXPECT_EQ(acquisition.stats().mux_switches, sensor_count);
+    EXPECT_EQ(acquisition.stats().checks, sensor_count);
+
+    // None is ready: the next frame starts from the sensor the mux is connected to.
+    bus.now += MockBus::Timestamp{1'000};
+    EXPECT_FALSE(acquisition.poll(bus.now));
+    EXPECT_EQ(acquisition.stats().mux_switches, 2 * sensor_count - 1);
+    EXPECT_EQ(acquisition.stats().checks, 2 * sensor_count);
+}
+
+TEST(SensorAcquisitionTest, MuxErrors)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports};
+    bus.now = MockBus::Timestamp{18'000};  // Every sensor is ready.
+
+    bus.fail_switches = true;
+    EXPECT_FALSE(acquisition.poll(bus.now));
+    EXPECT_EQ(acquisition.stats().mux_errors, sensor_count);
+    EXPECT_EQ(acquisition.stats().checks, 0);
+
+    // Retried in the next poll
+    bus.fail_switches = false;
+    bus.now += MockBus::Timestamp{1'000};
+    const auto frame = acquisition.poll(bus.now);
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->distances, (std::array<std::uint16_t, sensor_count>{100, 200, 300}));
+}
+
+static constexpr Acquisition::Health::Config health_config{
+    .timeout = MockBus::Timestamp{100'000},
+    .max_repeats = 5,
+    .no_target = 1'300,
+    .max_errors = 5,
+    .retry_interval = MockBus::Timestamp{10'000},
+    .max_retry_interval = MockBus::Timestamp{40'000},
+};
+
+/**
+ * @brief Poll every millisecond until `end`, re-initializing the failed sensors between polls (like the acquisition
+ * task).
+ *
+ * @return The frames.
+ */
+static std::vector<Acquisition::Frame> run(MockBus &bus, Acquisition &acquisition, MockBus::Timestamp end)
+{
+    std::vector<Acquisition::Frame> frames;
+    for (; bus.now < end; bus.now += MockBus::Timestamp{1'000})
+    {
+        acquisition.recover(bus.now, [](MockSensor &sensor, std::size_t) { return sensor.reinit(); });
+        if (const auto frame = acquisition.poll(bus.now))
+        {
+            frames.push_back(*frame);
+        }
+    }
+    return frames;
+}
+
+TEST(SensorAcquisitionTest, DeadSensor)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports, health_config};
+    for (auto &device : bus.sensors)
+    {
+        device.jitter = 1;
+    }
+    EXPECT_EQ(run(bus, acquisition, MockBus::Timestamp{100'000}).back().healthy, std::bitset<sensor_count>{0b111});
+
+    // The frames stop until the sensor times out, and then go on without it.
+    bus.sensors[1].dead = true;
+    auto frames = run(bus, acquisition, MockBus::Timestamp{300'000});
+    EXPECT_EQ(acquisition.health().fault(1), SensorFault::Timeout);
+    ASSERT_FALSE(frames.empty());
+    EXPECT_LE(frames.front().timestamp(), MockBus::Timestamp{100'000 + 100'000 + 20'000});
+    EXPECT_EQ(frames.back().healthy, std::bitset<sensor_count>{0b101});
+    EXPECT_EQ(frames.back().fresh, std::bitset<sensor_count>{0b101});
+    EXPECT_GE(frames.size(), 4);
+
+    // Retried, but it stays failed.
+    frames = run(bus, acquisition, MockBus::Timestamp{500'000});
+    EXPECT_EQ(frames.size(), 10);
+    EXPECT_EQ(acquisition.health().fault(1), SensorFault::Timeout);
+    EXPECT_EQ(bus.sensors[1].inits, 0);
+    EXPECT_EQ(acquisition.stats().readings[1], 5);  // Only before it died
+
+    // It comes back at the next retry.
+    bus.sensors[1].dead = false;
+    frames = run(bus, acquisition, MockBus::Timestamp{600'000});
+    EXPECT_EQ(acquisition.health().fault(1), SensorFault::None);
+    EXPECT_EQ(bus.sensors[1].inits, 1);
+    EXPECT_EQ(acquisition.health().stats().failures[1], 1);
+    EXPECT_EQ(acquisition.health().stats().recoveries[1], 1);
+    EXPECT_EQ(frames.back().healthy, std::bitset<sensor_count>{0b111});
+    EXPECT_EQ(frames.back().fresh, std::bitset<sensor_count>{0b111});
+}
+
+TEST(SensorAcquisitionTest, StuckSensor)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports, health_config};
+    for (auto &device : bus.sensors)
+    {
+        device.jitter = 1;
+    }
+    bus.sensors[2].stuck = true;
+
+    // Fails after `max_repeats` identical readings, and again after every re-initialization while it's still stuck.
+    const auto frames = run(bus, acquisition, MockBus::Timestamp{400'000});
+    const auto &stats = acquisition.health().stats();
+    EXPECT_GE(stats.failures[2], 2);
+    EXPECT_LE(stats.failures[2] - stats.recoveries[2], 1);
+    EXPECT_EQ(stats.failures[0] + stats.failures[1], 0);
+    for (const auto &frame : frames)
+    {
+        // The reading that showed it's stuck isn't fresh either.
+        EXPECT_EQ(frame.fresh.test(2), frame.healthy.test(2));
+        EXPECT_TRUE(frame.fresh.test(0));
+        EXPECT_TRUE(frame.fresh.test(1));
+    }
+
+    bus.sensors[2].stuck = false;
+    const auto failures = stats.failures[2];
+    run(bus, acquisition, MockBus::Timestamp{800'000});
+    EXPECT_EQ(acquisition.health().fault(2), SensorFault::None);
+    EXPECT_EQ(stats.failures[2], failures);
+}
+
+TEST(SensorAcquisitionTest, UnreachableSensor)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports, health_config};
+    bus.unreachable.set(0);
+
+    // Fails after `max_errors` polls, long before it would time out.
+    const auto frames = run(bus, acquisition, MockBus::Timestamp{100'000});
+    EXPECT_EQ(acquisition.health().fault(0), SensorFault::BusErrors);
+    EXPECT_EQ(acquisition.health().stats().errors[0], health_config.max_errors);
+    EXPECT_EQ(acquisition.stats().readings[0], 0);
+    ASSERT_FALSE(frames.empty());
+    EXPECT_EQ(frames.front().healthy, std::bitset<sensor_count>{0b110});
+    EXPECT_LE(frames.front().timestamp(), MockBus::Timestamp{20'000});
+    EXPECT_EQ(bus.sensors[0].inits, 0);  // The mux can't reach it to re-initialize it.
+}
+
+TEST(SensorAcquisitionTest, EverySensorFailed)
+{
+    MockBus bus;
+    MockMux mux{bus};
+    MockSensor sensor{bus};
+    Acquisition acquisition{mux, sensor, ports, health_config};
+    acquisition.fail(0, SensorFault::InitFailed, bus.now);
+    bus.fail_switches = true;
+
+    EXPECT_TRUE(run(bus, acquisition, MockBus::Timestamp{100'000}).empty());
+    EXPECT_TRUE(acquisition.health().healthy().none());
+    EXPECT_EQ(acquisition.health().fault(0), SensorFault::InitFailed);
+    EXPECT_EQ(acquisition.health().fault(1), SensorFault::BusErrors);
+
+    bus.fail_switches = false;
+    const auto frames = run(bus, acquisition, MockBus::Timestamp{200'000});
+    ASSERT_FALSE(frames.empty());
+    EXPECT_EQ(frames.back().healthy, std::bitset<sensor_count>{0b111});
+    EXPECT_EQ(frames.back().distances, (std::array<std::uint16_t, sensor_count>{100, 200, 300}));
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(sensor_acquisition_tests);
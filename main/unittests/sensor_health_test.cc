@@ -0,0 +1,153 @@
+#include "../sensor_health.h"
+
+#include <gtest/gtest.h>
+
+#include <bitset>
+#include <cstdint>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using Health = SensorHealth<2>;
+using Timestamp = Health::Timestamp;
+
+static constexpr Health::Config config{
+    .timeout = Timestamp{100'000},
+    .max_repeats = 3,
+    .no_target = 1'300,
+    .max_errors = 4,
+    .retry_interval = Timestamp{10'000},
+    .max_retry_interval = Timestamp{50'000},
+};
+
+TEST(SensorHealthTest, Timeout)
+{
+    Health health{config};
+    health.check(Timestamp{1'000'000});  // Starts the clock
+    EXPECT_EQ(health.healthy(), std::bitset<2>{0b11});
+
+    health.reading(0, 100, Timestamp{1'050'000});
+    health.check(Timestamp{1'100'000});
+    EXPECT_EQ(health.healthy(), std::bitset<2>{0b11});
+    health.check(Timestamp{1'100'001});
+    EXPECT_EQ(health.healthy(), std::bitset<2>{0b01});
+    EXPECT_EQ(health.fault(1), SensorFault::Timeout);
+    health.check(Timestamp{1'150'001});
+    EXPECT_EQ(health.fault(0), SensorFault::Timeout);
+    EXPECT_EQ(health.stats().failures[0], 1);
+    EXPECT_EQ(health.stats().failures[1], 1);
+}
+
+TEST(SensorHealthTest, Stuck)
+{
+    Health health{config};
+    const Timestamp now{0};
+    health.reading(0, 100, now);
+    health.reading(0, 100, now);
+    health.reading(0, 101, now);  // Starts over
+    health.reading(0, 101, now);
+    health.reading(0, 101, now);
+    EXPECT_EQ(health.fault(0), SensorFault::None);
+    health.reading(0, 101, now);  // The 3rd repeat
+    EXPECT_EQ(health.fault(0), SensorFault::Stuck);
+
+    // Readings are ignored while failed, and counted from scratch after recovering.
+    health.reading(0, 101, now);
+    health.recovered(0, now);
+    health.reading(0, 101, now);
+    health.reading(0, 101, now);
+    EXPECT_EQ(health.fault(0), SensorFault::None);
+    EXPECT_EQ(health.stats().failures[0], 1);
+}
+
+/**
+ * @brief Without a target the sensor returns the same reading for as long as nothing comes in range.
+ */
+TEST(SensorHealthTest, NoTargetIsntStuck)
+{
+    Health health{config};
+    const Timestamp now{0};
+    for (auto i = 0; i < 10; i++)
+    {
+        health.reading(0, 0, now);
+        health.reading(1, config.no_target, now);
+    }
+    EXPECT_EQ(health.healthy(), std::bitset<2>{0b11});
+
+    // A target starts the count over.
+    health.reading(1, config.no_target - 1, now);
+    health.reading(1, config.no_target - 1, now);
+    health.reading(1, config.no_target - 1, now);
+    EXPECT_EQ(health.fault(1), SensorFault::None);
+    health.reading(1, config.no_target - 1, now);
+    EXPECT_EQ(health.fault(1), SensorFault::Stuck);
+}
+
+TEST(SensorHealthTest, BusErrors)
+{
+    Health health{config};
+    const Timestamp now{0};
+    for (auto i = 0; i < 3; i++)
+    {
+        health.error(1, now);
+    }
+    health.reading(1, 100, now);  // Resets the streak
+    for (auto i = 0; i < 3; i++)
+    {
+        health.error(1, now);
+    }
+    EXPECT_EQ(health.fault(1), SensorFault::None);
+    health.error(1, now);
+    EXPECT_EQ(health.fault(1), SensorFault::BusErrors);
+    health.error(1, now);
+    EXPECT_EQ(health.stats().errors[1], 8);
+    EXPECT_EQ(health.stats().failures[1], 1);
+}
+
+TEST(SensorHealthTest, Backoff)
+{
+    Health health{config};
+    health.fail(0, SensorFault::InitFailed, Timestamp{0});
+    health.fail(0, SensorFault::Timeout, Timestamp{0});  // Already failed
+    EXPECT_EQ(health.fault(0), SensorFault::InitFailed);
+    EXPECT_EQ(health.stats().failures[0], 1);
+
+    // 10, 20, 40 and then 50 ms apart
+    Timestamp now{0};
+    std::uint32_t attempts = 0;
+    for (auto expected : {10'000, 30'000, 70'000, 120'000, 170'000})
+    {
+        EXPECT_FALSE(health.due(Timestamp{expected - 1}).any());
+        now = Timestamp{expected};
+        EXPECT_EQ(health.due(now), std::bitset<2>{0b01});
+        health.recovery_failed(0, now);
+        attempts++;
+    }
+    EXPECT_EQ(attempts, 5);
+
+    // A new failure starts from the first interval again.
+    health.recovered(0, now);
+    EXPECT_EQ(health.stats().recoveries[0], 1);
+    EXPECT_FALSE(health.due(now + Timestamp{1'000'000}).any());
+    health.fail(0, SensorFault::Stuck, now);
+    EXPECT_EQ(health.due(now + config.retry_interval), std::bitset<2>{0b01});
+}
+
+TEST(SensorHealthTest, RecoveryRestartsTimeout)
+{
+    Health health{config};
+    health.check(Timestamp{0});
+    health.check(Timestamp{200'000});
+    EXPECT_EQ(health.healthy(), std::bitset<2>{});
+    health.recovered(1, Timestamp{250'000});
+    health.check(Timestamp{340'000});
+    EXPECT_EQ(health.healthy(), std::bitset<2>{0b10});
+    health.check(Timestamp{350'001});
+    EXPECT_EQ(health.healthy(), std::bitset<2>{});
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(sensor_health_tests);
@@ -0,0 +1,105 @@
+#include "../sensor_timing.h"
+
+#include <misc_utils/physical_size.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <bitset>
+#include <numbers>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using namespace unit_literals;
+
+using Policy = SensorTimingPolicy<5>;
+
+static constexpr Policy::Config config{
+    .deceleration = 5.0f,
+    .range_margin = 0.2_m,
+    .short_range = 1.3_m,
+    .travel_per_reading = 0.02_m,
+    .idle_period = 100,
+    .idle_budget = 33,
+};
+static constexpr std::array roles{
+    SensorRole::Side,
+    SensorRole::Diagonal,
+    SensorRole::Front,
+    SensorRole::Diagonal,
+    SensorRole::Side,
+};
+static constexpr Policy policy{config, roles};
+static constexpr std::bitset<5> all_walls{0b11111};
+
+TEST(SensorTimingTest, Roles)
+{
+    EXPECT_EQ(sensor_role(Angle{0.0f}), SensorRole::Front);
+    EXPECT_EQ(sensor_role(Angle{0.7f}), SensorRole::Diagonal);
+    EXPECT_EQ(sensor_role(Angle{-0.65f}), SensorRole::Diagonal);
+    EXPECT_EQ(sensor_role(Angle{std::numbers::pi_v<float> / 2}), SensorRole::Side);
+    EXPECT_EQ(sensor_role(Angle{-std::numbers::pi_v<float> / 2}), SensorRole::Side);
+}
+
+TEST(SensorTimingTest, Standstill)
+{
+    for (const auto &timing : policy.plan(0.0_mps, all_walls))
+    {
+        EXPECT_EQ(timing, (SensorTiming{.budget = 33, .period = 100, .long_range = false}));
+    }
+}
+
+TEST(SensorTimingTest, FasterIsFaster)
+{
+    auto previous = policy.plan(0.1_mps, all_walls);
+    for (const auto speed : {0.3_mps, 0.5_mps, 1.0_mps, 1.5_mps})
+    {
+        const auto timings = policy.plan(speed, all_walls);
+        for (std::size_t i = 0; i < timings.size(); i++)
+        {
+            EXPECT_LE(timings[i].period, previous[i].period) << speed.count();
+            EXPECT_LE(timings[i].budget, timings[i].period);
+            EXPECT_FALSE(timings[i].long_range);
+            // The robot moves at most `travel_per_reading` between readings (down to the shortest budget).
+            if (timings[i].period > Policy::short_budgets.front())
+            {
+                EXPECT_LE(speed.count() * timings[i].period / 1000, config.travel_per_reading.count() + 1e-6f);
+            }
+        }
+        previous = timings;
+    }
+    // 20 mm at 1 m/s
+    EXPECT_EQ(policy.plan(1.0_mps, all_walls)[0], (SensorTiming{.budget = 20, .period = 20, .long_range = false}));
+    // 20 mm at 0.5 m/s: 40 ms, with the longest budget that fits
+    EXPECT_EQ(policy.plan(0.5_mps, all_walls)[0], (SensorTiming{.budget = 33, .period = 40, .long_range = false}));
+    // Faster than the shortest budget
+    EXPECT_EQ(policy.plan(3.0_mps, all_walls)[0], (SensorTiming{.budget = 15, .period = 15, .long_range = false}));
+}
+
+TEST(SensorTimingTest, NoWallExpected)
+{
+    const auto timings = policy.plan(1.0_mps, std::bitset<5>{0b01110});  // Open on both sides
+    EXPECT_EQ(timings[0], (SensorTiming{.budget = 33, .period = 100, .long_range = false}));
+    EXPECT_EQ(timings[4], timings[0]);
+    EXPECT_EQ(timings[1].period, 20);
+    EXPECT_EQ(Policy::pacing(timings), std::bitset<5>{0b01110});
+}
+
+TEST(SensorTimingTest, LongRangeAhead)
+{
+    // Stopping from 3 m/s takes 0.9 m (+ 0.2 m): the short mode is enough.
+    EXPECT_FALSE(policy.plan(3.0_mps, std::bitset<5>{0b10001})[2].long_range);
+    // From 3.5 m/s it takes 1.225 m (+ 0.2 m).
+    const auto open_ahead = policy.plan(3.5_mps, std::bitset<5>{0b10001});
+    EXPECT_EQ(open_ahead[2], (SensorTiming{.budget = Policy::min_long_budget, .period = 33, .long_range = true}));
+    EXPECT_EQ(Policy::pacing(open_ahead), std::bitset<5>{0b10001});
+    // Unless there's a wall ahead anyway
+    EXPECT_FALSE(policy.plan(3.5_mps, all_walls)[2].long_range);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(sensor_timing_tests);
@@ -0,0 +1,139 @@
+#include "../simulator.h"
+
+#include <maze_solver/direction.h>
+#include <maze_solver/maze_samples/small_8x8.h>
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "../algorithm_api_mock.h"
+#include "../control_loop.h"
+#include "../distance_sensor.h"
+#include "../distance_sensor_model.h"
+#include "../temp_map.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+TEST(SimulatorTest, MazeSegmentsMatchTheMap)
+{
+    // `maze_map` is `small_8x8` drawn by hand, so every ray hits the same wall.
+    const auto walls = sim::maze_segments(mazes::small_8x8);
+    for (std::size_t row = 0; row < 8; row++)
+    {
+        for (std::size_t col = 0; col < 8; col++)
+        {
+            for (const auto heading : {Direction::North, Direction::East, Direction::South, Direction::West})
+            {
+                const auto pos = translate_pos(row, col, heading);
+                for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+                {
+                    const auto expected = sim::cast_ray(pos, i, maze_map, meters{4.0f}).count();
+                    const auto actual = sim::cast_ray(pos, i, walls, meters{4.0f}).count();
+                    if (std::isinf(expected))
+                    {
+                        EXPECT_TRUE(std::isinf(actual)) << "cell (" << row << ", " << col << "), sensor " << i;
+                    }
+                    else
+                    {
+                        EXPECT_NEAR(actual, expected, 1e-5f) << "cell (" << row << ", " << col << "), sensor " << i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(SimulatorTest, RaysHitFarWalls)
+{
+    // At the start, the front sensor sees the wall at the end of the first corridor, 3 cells ahead.
+    const auto walls = sim::maze_segments(mazes::small_8x8);
+    const auto pos = translate_pos(7, 0, Direction::East);
+    const auto expected = 3 * wall_length - pos.x->count() - sensor_disposition[2].first->count();
+    EXPECT_NEAR(sim::cast_ray(pos, 2, walls, meters{4.0f}).count(), expected, 1e-5f);
+    EXPECT_TRUE(std::isinf(sim::cast_ray(pos, 2, walls, meters{0.3f}).count()));
+}
+
+TEST(SimulatorTest, ShortestRouteMatchesTheFixedRoute)
+{
+    const auto route = sim::shortest_route(mazes::small_8x8);
+    ASSERT_TRUE(route);
+    ASSERT_EQ(route->positions.size(), positions.size());
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        EXPECT_FLOAT_EQ(route->positions[i].x->count(), positions[i].x->count()) << "position " << i;
+        EXPECT_FLOAT_EQ(route->positions[i].y->count(), positions[i].y->count()) << "position " << i;
+        EXPECT_FLOAT_EQ(route->positions[i].theta.get(), positions[i].theta.get()) << "position " << i;
+    }
+    ASSERT_EQ(route->waypoints.size(), waypoints.size());
+    for (std::size_t i = 0; i < waypoints.size(); i++)
+    {
+        EXPECT_FLOAT_EQ(route->waypoints[i].x->count(), waypoints[i].x->count()) << "waypoint " << i;
+        EXPECT_FLOAT_EQ(route->waypoints[i].y->count(), waypoints[i].y->count()) << "waypoint " << i;
+    }
+}
+
+TEST(SimulatorTest, FinishesInEveryControlMode)
+{
+    for (const auto mode : {ControlMode::Waypoints, ControlMode::PurePursuit, ControlMode::Stanley})
+    {
+        auto config = sim::default_config;
+        config.control_mode = mode;
+        const auto result = sim::simulate(mazes::small_8x8, config);
+        ASSERT_TRUE(result);
+        EXPECT_TRUE(result->finished) << to_string(mode);
+        EXPECT_LT(result->lap_time, config.timeout) << to_string(mode);
+        EXPECT_LT(result->max_tracking_error, meters{0.1f}) << to_string(mode);
+        EXPECT_LT(result->max_estimation_error, meters{0.1f}) << to_string(mode);
+        EXPECT_GT(result->min_clearance, meters{0.0f}) << to_string(mode);
+    }
+}
+
+TEST(SimulatorTest, TouchingAWallFails)
+{
+    auto config = sim::default_config;
+    config.robot_radius = meters{0.1f};  // Wider than a cell
+    const auto result = sim::simulate(mazes::small_8x8, config);
+    ASSERT_TRUE(result);
+    EXPECT_FALSE(result->finished);
+    EXPECT_LT(result->min_clearance, meters{0.0f});
+}
+
+TEST(SimulatorTest, Deterministic)
+{
+    auto config = sim::default_config;
+    config.control_mode = ControlMode::PurePursuit;
+    config.timeout = seconds{5.0f};
+    const auto first = sim::simulate(mazes::small_8x8, config);
+    const auto second = sim::simulate(mazes::small_8x8, config);
+    ASSERT_TRUE(first && second);
+    EXPECT_EQ(first->ticks, second->ticks);
+    EXPECT_EQ(first->max_tracking_error, second->max_tracking_error);
+    EXPECT_EQ(first->max_estimation_error, second->max_estimation_error);
+
+    // Another seed, other sensor noise
+    config.seed++;
+    const auto third = sim::simulate(mazes::small_8x8, config);
+    ASSERT_TRUE(third);
+    EXPECT_NE(first->max_estimation_error, third->max_estimation_error);
+}
+
+TEST(SimulatorTest, StopsAtTheTimeout)
+{
+    auto config = sim::default_config;
+    config.timeout = seconds{1.0f};
+    const auto result = sim::simulate(mazes::small_8x8, config);
+    ASSERT_TRUE(result);
+    EXPECT_FALSE(result->finished);
+    EXPECT_EQ(result->ticks, 200);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(simulator_tests);
@@ -0,0 +1,243 @@
+#include "../slip_detector.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using seconds = SlipDetector::seconds;
+
+static constexpr seconds tick = std::chrono::microseconds{5'000};
+static constexpr SlipDetector::Config config{
+    .max_acceleration = 9.5f,
+    .min_acceleration = 3.0f,
+    .response_time = seconds{0.05f},
+    .acceleration_error = 4.0f,
+    .confirm_ticks = 3,
+    .innovation_gates = SlipDetector::chi_square_99,
+    .backoff = 0.8f,
+    .recovery = 0.5f,
+    .process_noise_scale = 10.0f,
+    .hold = seconds{0.2f},
+};
+
+static constexpr SlipDetector::WheelMotion gripping{.encoder_acceleration = 5.0f, .commanded_acceleration = 5.0f};
+static constexpr SlipDetector::WheelMotion spinning{.encoder_acceleration = 15.0f, .commanded_acceleration = 5.0f};
+
+TEST(SlipDetectorTest, Grip)
+{
+    SlipDetector detector{config};
+    for (auto t = seconds::zero(); t < seconds{1.0f}; t += tick)
+    {
+        EXPECT_FALSE(detector.update(gripping, gripping, tick));
+    }
+    // A short spike (encoder noise) isn't a slip.
+    for (auto i = 1; i < config.confirm_ticks; i++)
+    {
+        EXPECT_FALSE(detector.update(gripping, spinning, tick));
+    }
+    EXPECT_FALSE(detector.update(gripping, gripping, tick));
+    EXPECT_EQ(detector.slip_count(), 0);
+    EXPECT_EQ(detector.acceleration_limit(), config.max_acceleration);
+    EXPECT_EQ(detector.process_noise_scale(), 1.0f);
+    // Not even innovations just under the gate
+    detector.check_innovation(config.innovation_gates[4], 5);
+    EXPECT_FALSE(detector.slipping());
+    // Nor updates without readings
+    detector.check_innovation(100.0f, 0);
+    EXPECT_FALSE(detector.slipping());
+}
+
+TEST(SlipDetectorTest, SlipAndRecover)
+{
+    SlipDetector detector{config};
+    for (auto i = 0; i < config.confirm_ticks; i++)
+    {
+        detector.update(spinning, gripping, tick);
+    }
+    EXPECT_TRUE(detector.slipping());
+    EXPECT_EQ(detector.slip_count(), 1);
+    EXPECT_FLOAT_EQ(detector.acceleration_limit(), config.backoff * config.max_acceleration);
+    EXPECT_EQ(detector.process_noise_scale(), config.process_noise_scale);
+
+    // Slipping on: backs off once per hold
+    for (auto t = seconds::zero(); t < 2.5f * config.hold; t += tick)
+    {
+        detector.update(spinning, gripping, tick);
+    }
+    EXPECT_EQ(detector.slip_count(), 3);
+
+    // Held for a while after the wheels grip again, then the limit grows back.
+    const auto backed_off = detector.acceleration_limit();
+    detector.update(gripping, gripping, tick);
+    EXPECT_TRUE(detector.slipping());
+    auto t = tick;
+    while (detector.update(gripping, gripping, tick))
+    {
+        t += tick;
+    }
+    EXPECT_NEAR(t.count(), config.hold.count(), tick.count());
+    EXPECT_EQ(detector.process_noise_scale(), 1.0f);
+    for (auto i = 0; i < 10; i++)
+    {
+        detector.update(gripping, gripping, tick);
+    }
+    EXPECT_GT(detector.acceleration_limit(), backed_off);
+    for (auto t = seconds::zero(); t < seconds{10.0f}; t += tick)
+    {
+        detector.update(gripping, gripping, tick);
+    }
+    EXPECT_EQ(detector.acceleration_limit(), config.max_acceleration);
+}
+
+/**
+ * @brief An innovation that is fine for a full frame is a slip when it comes from a single reading.
+ */
+TEST(SlipDetectorTest, InnovationGateByReadings)
+{
+    SlipDetector detector{config};
+    detector.check_innovation(10.0f, 5);
+    EXPECT_FALSE(detector.slipping());
+    detector.check_innovation(10.0f, 1);
+    EXPECT_TRUE(detector.slipping());
+    EXPECT_EQ(detector.slip_count(), 1);
+
+    detector.reset();
+    EXPECT_FALSE(detector.slipping());
+    EXPECT_EQ(detector.slip_count(), 0);
+    EXPECT_EQ(detector.acceleration_limit(), config.max_acceleration);
+}
+
+TEST(SlipDetectorTest, Limits)
+{
+    SlipDetector detector{config};
+    for (auto i = 0; i < 100; i++)
+    {
+        detector.check_innovation(2 * config.innovation_gates[4], 5);
+        for (auto t = seconds::zero(); t < config.hold; t += tick)
+        {
+            detector.update(gripping, gripping, tick);
+        }
+    }
+    EXPECT_NEAR(detector.acceleration_limit(), config.min_acceleration, 0.1f);
+
+    // Following a command late isn't a slip.
+    detector.reset();
+    SlipDetector::WheelMotion late{.encoder_acceleration = 0.0f, .commanded_acceleration = 9.0f};
+    for (auto i = 0; i < 40; i++)
+    {
+        EXPECT_FALSE(detector.update(late, gripping, tick));
+        late.encoder_acceleration += tick / (0.7f * config.response_time) * (9.0f - late.encoder_acceleration);
+    }
+}
+
+/**
+ * @brief A wheel with limited traction: it follows the wanted velocity with a first order lag, unless that takes more
+ * than the traction's acceleration. Then it breaks loose and, unloaded, catches up with the wanted velocity much
+ * faster, while the robot only accelerates at the traction limit until the wheel grips again.
+ */
+class TractionWheel
+{
+public:
+    static constexpr float tau = 0.03f;            // [s]
+    static constexpr float unloaded_tau = 0.008f;  // [s]
+    static constexpr float traction = 6.0f;        // [m/s^2]
+    static constexpr float grip_velocity = 0.02f;  // [m/s] Slower slips grip again.
+
+    /**
+     * @return The wheel's (encoder) acceleration.
+     */
+    float step(float wanted_velocity) noexcept
+    {
+        const auto dt = tick.count();
+        auto acceleration = (wanted_velocity - m_wheel_velocity) / tau;
+        m_spinning = m_spinning ? m_wheel_velocity - m_ground_velocity > grip_velocity : acceleration > traction;
+        if (m_spinning)
+        {
+            acceleration = (wanted_velocity - m_wheel_velocity) / unloaded_tau;
+            m_ground_velocity += traction * dt;
+        }
+        m_wheel_velocity += acceleration * dt;
+        if (!m_spinning)
+        {
+            m_ground_velocity = m_wheel_velocity;
+        }
+        m_odometry += m_wheel_velocity * dt;
+        m_distance += m_ground_velocity * dt;
+        return acceleration;
+    }
+
+    float drift() const noexcept { return m_odometry - m_distance; }
+
+private:
+    float m_wheel_velocity = 0.0f;
+    float m_ground_velocity = 0.0f;
+    float m_odometry = 0.0f;
+    float m_distance = 0.0f;
+    bool m_spinning = false;
+};
+
+/**
+ * @brief Accelerate hard (like `limit_velocity` does) from a standstill and back, repeatedly, with and without the
+ * detector's limit. The detector should settle the limit around the traction, and the odometry should drift less (in
+ * the last run, once it settled).
+ */
+TEST(SlipDetectorTest, ClosedLoop)
+{
+    static constexpr auto top_speed = 1.5f;  // [m/s]
+    static constexpr auto runs = 10;
+    const auto drive = [](SlipDetector *detector)
+    {
+        TractionWheel wheel;
+        auto wanted_velocity = 0.0f;
+        auto wanted_acceleration = 0.0f;
+        auto drift = 0.0f;
+        for (auto run = 0; run < runs; run++)
+        {
+            drift = wheel.drift();
+            for (const auto target : {top_speed, 0.0f})
+            {
+                for (auto t = seconds::zero(); t < seconds{1.0f}; t += tick)
+                {
+                    const auto encoder_acceleration = wheel.step(wanted_velocity);
+                    const SlipDetector::WheelMotion motion{
+                        .encoder_acceleration = encoder_acceleration,
+                        .commanded_acceleration = wanted_acceleration,
+                    };
+                    if (detector)
+                    {
+                        detector->update(motion, motion, tick);
+                    }
+                    const auto limit = detector ? detector->acceleration_limit() : config.max_acceleration;
+                    const auto change = limit * tick.count();
+                    const auto last_velocity = wanted_velocity;
+                    wanted_velocity = std::clamp(target, wanted_velocity - change, wanted_velocity + change);
+                    wanted_acceleration = (wanted_velocity - last_velocity) / tick.count();
+                }
+            }
+        }
+        return wheel.drift() - drift;
+    };
+
+    SlipDetector detector{config};
+    const auto drift = drive(&detector);
+    const auto unlimited_drift = drive(nullptr);
+    std::cout << "Drift: " << drift * 1000 << " mm (without slip detection: " << unlimited_drift * 1000
+              << " mm), acceleration limit: " << detector.acceleration_limit() << " m/s^2 after "
+              << detector.slip_count() << " slips" << std::endl;
+    EXPECT_GT(detector.slip_count(), 0);
+    EXPECT_LT(detector.acceleration_limit(), config.max_acceleration);
+    EXPECT_GE(detector.acceleration_limit(), config.min_acceleration);
+    EXPECT_LT(drift, unlimited_drift / 2);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(slip_detector_tests);
@@ -0,0 +1,96 @@
+#include "misc_utils/spsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <thread>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+TEST(SpscQueueTest, Fifo)
+{
+    SpscQueue<int, 4> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop());
+
+    for (auto i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4));  // Full
+    EXPECT_EQ(queue.size(), 4);
+
+    EXPECT_EQ(queue.pop(), 0);
+    EXPECT_EQ(queue.pop(), 1);
+    EXPECT_TRUE(queue.push(4));
+    EXPECT_TRUE(queue.push(5));  // Wraps around
+    EXPECT_FALSE(queue.push(6));
+    for (auto i = 2; i < 6; i++)
+    {
+        EXPECT_EQ(queue.pop(), i);
+    }
+    EXPECT_FALSE(queue.pop());
+    EXPECT_TRUE(queue.empty());
+}
+
+/**
+ * @brief Push as fast as possible from one thread and pop from another through a small queue, so it's often full and
+ * often empty. Every value must arrive whole, once and in order. Run under ThreadSanitizer (MICROMOUSE_TSAN) to check
+ * for races.
+ */
+TEST(SpscQueueTest, Stress)
+{
+    struct Value
+    {
+        std::uint32_t sequence;
+        std::array<std::uint32_t, 8> payload;  // Every element is `sequence`.
+    };
+    static constexpr std::uint32_t value_count = 200'000;
+
+    SpscQueue<Value, 16> queue;
+    std::thread producer{[&]
+                         {
+                             for (std::uint32_t sequence = 1; sequence <= value_count;)
+                             {
+                                 Value value{.sequence = sequence, .payload{}};
+                                 value.payload.fill(sequence);
+                                 if (queue.push(value))
+                                 {
+                                     sequence++;
+                                 }
+                                 else
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }
+                         }};
+
+    std::uint32_t expected = 1;
+    bool torn = false;
+    bool lost = false;
+    while (expected <= value_count)
+    {
+        const auto value = queue.pop();
+        if (!value)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        torn |= !std::ranges::all_of(value->payload, [&](auto element) { return element == value->sequence; });
+        lost |= value->sequence != expected;
+        expected = value->sequence + 1;
+    }
+    producer.join();
+    EXPECT_FALSE(torn);
+    EXPECT_FALSE(lost);
+    EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(spsc_queue_tests);
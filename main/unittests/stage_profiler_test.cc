@@ -0,0 +1,129 @@
+#include "../stage_profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using profiler::StageProfiler;
+using profiler::StageStats;
+using profiler::Ticks;
+
+enum class TestStage : std::uint8_t
+{
+    First,
+    Second,
+    Count,
+};
+
+static constexpr StageProfiler<TestStage>::Names names{"first", "second"};
+
+TEST(StageStatsTest, Buckets)
+{
+    for (Ticks duration = 0; duration < 1 << 16; duration++)
+    {
+        const auto bucket = StageStats::bucket(duration);
+        ASSERT_LT(bucket, StageStats::bucket_count);
+        ASSERT_LE(duration, StageStats::bucket_upper_bound(bucket));
+        ASSERT_LE(StageStats::bucket_upper_bound(bucket) - duration, duration / StageStats::sub_buckets);
+        if (bucket > 0)
+        {
+            ASSERT_GT(duration, StageStats::bucket_upper_bound(bucket - 1));
+        }
+    }
+    const auto last = StageStats::bucket(std::numeric_limits<Ticks>::max());
+    EXPECT_EQ(last, StageStats::bucket_count - 1);
+    EXPECT_EQ(StageStats::bucket_upper_bound(last), std::numeric_limits<Ticks>::max());
+}
+
+TEST(StageStatsTest, Distribution)
+{
+    StageStats stats;
+    EXPECT_EQ(stats.count(), 0);
+    EXPECT_EQ(stats.min(), 0);
+    EXPECT_EQ(stats.max(), 0);
+    EXPECT_EQ(stats.mean(), 0);
+    EXPECT_EQ(stats.percentile(0.99f), 0);
+
+    std::mt19937 gen{0};
+    std::lognormal_distribution<float> dist{8.0f, 0.5f};
+    std::vector<Ticks> durations(10'000);
+    std::ranges::generate(durations, [&] { return static_cast<Ticks>(dist(gen)); });
+    for (const auto duration : durations)
+    {
+        stats.record(duration);
+    }
+    std::ranges::sort(durations);
+    std::uint64_t total = 0;
+    for (const auto duration : durations)
+    {
+        total += duration;
+    }
+
+    EXPECT_EQ(stats.count(), durations.size());
+    EXPECT_EQ(stats.min(), durations.front());
+    EXPECT_EQ(stats.max(), durations.back());
+    EXPECT_EQ(stats.mean(), total / durations.size());
+    for (const auto fraction : {0.5f, 0.9f, 0.99f})
+    {
+        const auto exact = static_cast<float>(durations[static_cast<std::size_t>(fraction * durations.size()) - 1]);
+        const auto percentile = static_cast<float>(stats.percentile(fraction));
+        EXPECT_GE(percentile, exact) << fraction;
+        EXPECT_LE(percentile, exact * (1 + 1.0f / StageStats::sub_buckets)) << fraction;
+    }
+    EXPECT_EQ(stats.percentile(1.0f), stats.max());
+}
+
+TEST(StageProfilerTest, Record)
+{
+    StageProfiler<TestStage> profiler{names};
+    for (auto i = 0; i < 10; i++)
+    {
+        const auto scope = profiler.scope(TestStage::First);
+        auto stopwatch = profiler.stopwatch();
+        stopwatch.lap(TestStage::Second);
+        stopwatch.lap(TestStage::Second);
+    }
+    EXPECT_EQ(profiler.stats(TestStage::First).count(), 10);
+    EXPECT_EQ(profiler.stats(TestStage::Second).count(), 20);
+    // The scope contains both laps.
+    EXPECT_GE(profiler.stats(TestStage::First).max(), profiler.stats(TestStage::Second).min());
+
+    profiler.record(TestStage::Second, 1'000'000);
+    EXPECT_EQ(profiler.stats(TestStage::Second).max(), 1'000'000);
+    profiler.dump();
+
+    profiler.reset();
+    EXPECT_EQ(profiler.stats(TestStage::First).count(), 0);
+    EXPECT_EQ(profiler.stats(TestStage::Second).count(), 0);
+}
+
+TEST(StageProfilerTest, Disabled)
+{
+    using DisabledProfiler = StageProfiler<TestStage, false>;
+    static_assert(std::is_empty_v<DisabledProfiler>);
+    static_assert(sizeof(StageProfiler<TestStage>) >= 2 * sizeof(StageStats));
+
+    DisabledProfiler profiler{names};
+    {
+        const auto scope = profiler.scope(TestStage::First);
+        auto stopwatch = profiler.stopwatch();
+        stopwatch.lap(TestStage::Second);
+    }
+    profiler.record(TestStage::First, 1);
+    profiler.reset();
+    profiler.dump();
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(stage_profiler_tests);
@@ -0,0 +1,197 @@
+#include "../sweep.h"
+
+#include <maze_solver/maze_samples/small_8x8.h>
+#include <misc_utils/physical_size.h>
+#include <misc_utils/work_stealing_pool.h>
+
+#include "../control_loop.h"
+#include "../simulator.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+static constexpr auto index(sweep::Parameter parameter)
+{
+    return static_cast<std::size_t>(parameter);
+}
+
+TEST(SweepTest, ApplyRoundTrips)
+{
+    sweep::Candidate c{};
+    for (std::size_t i = 0; i < sweep::parameter_count; i++)
+    {
+        c[i] = 0.1f * (i + 1);
+    }
+    const auto config = sweep::apply(sim::default_config, c);
+    EXPECT_EQ(sweep::candidate(config), c);
+    EXPECT_FLOAT_EQ(config.gains.velocity.kd, c[index(sweep::Parameter::VelocityKd)]);
+    EXPECT_FLOAT_EQ(config.noise.measurement[4], c[index(sweep::Parameter::SideSensorNoise)]);
+    EXPECT_FLOAT_EQ(config.noise.process[1], c[index(sweep::Parameter::PositionNoise)]);
+    // Everything else is kept
+    EXPECT_EQ(config.gains.velocity_Kv, sim::default_config.gains.velocity_Kv);
+    EXPECT_EQ(config.timeout, sim::default_config.timeout);
+
+    const auto defaults = sweep::candidate(sim::default_config);
+    EXPECT_EQ(sweep::candidate(sweep::apply(sim::default_config, defaults)), defaults);
+}
+
+TEST(SweepTest, GridCoversTheLevels)
+{
+    const auto base = sweep::candidate(sim::default_config);
+    auto space = sweep::default_space(base);
+    space.ranges[index(sweep::Parameter::VelocityKp)].levels = 3;
+    space.ranges[index(sweep::Parameter::Ks)].levels = 2;
+    space.ranges[index(sweep::Parameter::DistanceKi)].levels = 5;  // Fixed at 0, not on the grid
+
+    const auto candidates = sweep::grid(space);
+    ASSERT_EQ(candidates.size(), 6);
+    const auto &kp = space.ranges[index(sweep::Parameter::VelocityKp)];
+    const auto &ks = space.ranges[index(sweep::Parameter::Ks)];
+    EXPECT_FLOAT_EQ(candidates.front()[index(sweep::Parameter::VelocityKp)], kp.min);
+    EXPECT_FLOAT_EQ(candidates[2][index(sweep::Parameter::VelocityKp)], 3.0f);  // The log range's middle
+    EXPECT_FLOAT_EQ(candidates.back()[index(sweep::Parameter::VelocityKp)], kp.max);
+    EXPECT_FLOAT_EQ(candidates.front()[index(sweep::Parameter::Ks)], ks.min);
+    EXPECT_FLOAT_EQ(candidates.back()[index(sweep::Parameter::Ks)], ks.max);
+    for (const auto &c : candidates)
+    {
+        EXPECT_EQ(c[index(sweep::Parameter::AngleKp)], base[index(sweep::Parameter::AngleKp)]);
+        EXPECT_EQ(c[index(sweep::Parameter::DistanceKi)], 0.0f);
+    }
+}
+
+TEST(SweepTest, RandomCandidatesStayInTheSpace)
+{
+    const auto base = sweep::candidate(sim::default_config);
+    const auto space = sweep::default_space(base);
+    const auto candidates = sweep::random_candidates(space, 100, 1);
+    ASSERT_EQ(candidates.size(), 100);
+    for (const auto &c : candidates)
+    {
+        for (std::size_t i = 0; i < sweep::parameter_count; i++)
+        {
+            EXPECT_GE(c[i], space.ranges[i].min * (1 - 1e-6f)) << sweep::enum2str(static_cast<sweep::Parameter>(i));
+            EXPECT_LE(c[i], space.ranges[i].max * (1 + 1e-6f)) << sweep::enum2str(static_cast<sweep::Parameter>(i));
+        }
+    }
+    EXPECT_NE(candidates[0], candidates[1]);
+    EXPECT_EQ(sweep::random_candidates(space, 100, 1), candidates);
+}
+
+/**
+ * @brief CMA-ES on a stretched quadratic bowl (no simulation), starting at the ranges' edge.
+ */
+TEST(SweepTest, CmaesConvergesOnAQuadratic)
+{
+    sweep::Space space{.base{}, .ranges{}};
+    for (std::size_t i = 0; i < 4; i++)
+    {
+        space.base[i] = 1.0f;
+        space.ranges[i] = {.min = 0.0f, .max = 1.0f, .log = false};
+    }
+    const auto cost = [](const sweep::Candidate &c)
+    {
+        auto res = 0.0f;
+        for (std::size_t i = 0; i < 4; i++)
+        {
+            res += (i + 1) * (c[i] - 0.3f) * (c[i] - 0.3f);
+        }
+        return res;
+    };
+
+    sweep::Cmaes cmaes{space, 0.3f, 0, 1};
+    EXPECT_EQ(cmaes.population(), 8);
+    auto best = cost(space.base);
+    for (auto generation = 0; generation < 100; generation++)
+    {
+        const auto candidates = cmaes.ask();
+        std::vector<float> costs;
+        for (const auto &c : candidates)
+        {
+            for (std::size_t i = 4; i < sweep::parameter_count; i++)
+            {
+                EXPECT_EQ(c[i], 0.0f);  // Not searched
+            }
+            costs.push_back(cost(c));
+            best = std::min(best, costs.back());
+        }
+        cmaes.tell(costs);
+    }
+    EXPECT_LT(best, 1e-6f);
+    EXPECT_LT(cmaes.sigma(), 0.01f);
+}
+
+TEST(SweepTest, EvaluatorAppliesTheConstraints)
+{
+    const auto track = sweep::make_track("small_8x8", mazes::small_8x8);
+    ASSERT_TRUE(track);
+    auto base = sim::default_config;
+    base.control_mode = ControlMode::PurePursuit;
+    const auto scenarios = sweep::robustness_scenarios(base, 1, 0.05f);
+    ASSERT_EQ(scenarios.size(), 3);
+    EXPECT_GT(scenarios[1].motors[0].Ks, base.motors[0].Ks);
+    EXPECT_EQ(scenarios[1].motors[1].Ks, base.motors[1].Ks);
+
+    WorkStealingPool pool{4};
+    const std::vector tracks{*track};
+    const auto candidate = sweep::candidate(base);
+    sweep::Evaluator evaluate{tracks, scenarios, sweep::default_constraints, pool};
+    const auto loose = evaluate(std::span{&candidate, 1});
+    ASSERT_EQ(loose.size(), 1);
+    EXPECT_EQ(loose[0].runs, 3);
+    EXPECT_EQ(loose[0].failures, 0);
+    EXPECT_TRUE(loose[0].feasible);
+    EXPECT_FLOAT_EQ(loose[0].cost, loose[0].worst_lap_time.count() + loose[0].max_tracking_error.count());
+    EXPECT_LE(loose[0].mean_lap_time, loose[0].worst_lap_time);
+    EXPECT_EQ(evaluate.runs(), 3);
+
+    // No candidate tracks within a millimeter
+    const sweep::Constraints constraints{.max_tracking_error = meters{0.001f}, .min_clearance = meters{0.0f}};
+    sweep::Evaluator strict{tracks, scenarios, constraints, pool};
+    const auto tight = strict(std::span{&candidate, 1});
+    EXPECT_FALSE(tight[0].feasible);
+    EXPECT_GT(tight[0].cost, base.timeout.count());
+
+    std::vector evaluations{tight[0], loose[0]};
+    sweep::rank(evaluations);
+    EXPECT_TRUE(evaluations[0].feasible);
+}
+
+/**
+ * @brief The evaluations don't depend on the number of workers (or on the order the runs end in).
+ */
+TEST(SweepTest, Deterministic)
+{
+    const auto track = sweep::make_track("small_8x8", mazes::small_8x8);
+    ASSERT_TRUE(track);
+    auto base = sim::default_config;
+    base.control_mode = ControlMode::Stanley;
+    base.timeout = seconds{5.0f};
+    const auto scenarios = sweep::robustness_scenarios(base, 2, 0.1f);
+    const std::vector tracks{*track};
+    const auto candidates = sweep::random_candidates(sweep::default_space(sweep::candidate(base)), 4, 1);
+
+    WorkStealingPool single{1};
+    WorkStealingPool many{4};
+    sweep::Evaluator evaluate_single{tracks, scenarios, sweep::default_constraints, single};
+    sweep::Evaluator evaluate_many{tracks, scenarios, sweep::default_constraints, many};
+    const auto expected = evaluate_single(candidates);
+    const auto actual = evaluate_many(candidates);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+        EXPECT_EQ(actual[i].cost, expected[i].cost) << "candidate " << i;
+        EXPECT_EQ(actual[i].max_tracking_error, expected[i].max_tracking_error) << "candidate " << i;
+    }
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(sweep_tests);
@@ -0,0 +1,168 @@
+#include "../telemetry.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using telemetry::Record;
+
+static Record record(std::uint32_t i)
+{
+    return Record{
+        .time = i * 20'000,
+        .target_x = 0.09f,
+        .target_y = 0.27f,
+        .target_theta = 1.57f,
+        .x = 0.001f * static_cast<float>(i),
+        .y = 0.0f,  // Plenty of zeros to stuff
+        .theta = -0.01f,
+        .left_velocity = 0.5f,
+        .left_wanted_velocity = 0.55f,
+        .left_output = 0.3f,
+        .right_velocity = 0.49f,
+        .right_wanted_velocity = 0.55f,
+        .right_output = 0.31f,
+        .innovation = 2.5f,
+        .cycle_time = 20'000,
+        .flags = 0b11111,
+        .sensor_rates{50.0f, 33.3f, 50.0f, 33.3f, 0.0f},
+    };
+}
+
+static bool operator==(const Record &a, const Record &b)
+{
+    return std::memcmp(&a, &b, sizeof(Record)) == 0;
+}
+
+/**
+ * @brief Encodes batches of records into a stream.
+ */
+class Stream
+{
+public:
+    void send(std::uint32_t first, std::size_t count)
+    {
+        std::vector<Record> records;
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            records.push_back(record(first + i));
+        }
+        telemetry::Frame frame;
+        const auto size = telemetry::encode(records, m_sequence++, frame);
+        EXPECT_LE(size, frame.size());
+        EXPECT_EQ(std::count(frame.begin(), frame.begin() + static_cast<std::ptrdiff_t>(size), 0), 2);
+        EXPECT_EQ(frame[0], 0);
+        EXPECT_EQ(frame[size - 1], 0);
+        bytes.insert(bytes.end(), frame.begin(), frame.begin() + static_cast<std::ptrdiff_t>(size));
+    }
+
+    void skip() { m_sequence++; }
+
+    void text(std::string_view line) { bytes.insert(bytes.end(), line.begin(), line.end()); }
+
+    std::vector<std::uint8_t> bytes;
+
+private:
+    std::uint16_t m_sequence = 0;
+};
+
+TEST(TelemetryTest, Crc)
+{
+    static constexpr std::string_view check = "123456789";
+    static constexpr auto crc = []
+    {
+        std::array<std::uint8_t, check.size()> data{};
+        std::ranges::copy(check, data.begin());
+        return crc16(data);
+    }();
+    static_assert(crc == 0x29b1);
+
+    // Continued in parts
+    const std::span data{reinterpret_cast<const std::uint8_t *>(check.data()), check.size()};
+    EXPECT_EQ(crc16(data.subspan(4), crc16(data.first(4))), crc);
+}
+
+TEST(TelemetryTest, RoundTrip)
+{
+    Stream stream;
+    stream.send(0, telemetry::max_batch);
+    stream.send(8, 1);
+    stream.send(9, 0);
+    stream.send(9, 3);
+
+    std::vector<Record> records;
+    std::vector<std::uint16_t> sequences;
+    telemetry::Decoder decoder{[&](const Record &r, std::uint16_t sequence)
+                               {
+                                   records.push_back(r);
+                                   sequences.push_back(sequence);
+                               }};
+    // In arbitrary chunks
+    for (std::size_t i = 0; i < stream.bytes.size(); i += 7)
+    {
+        decoder.feed(std::span{stream.bytes}.subspan(i, std::min<std::size_t>(7, stream.bytes.size() - i)));
+    }
+    ASSERT_EQ(records.size(), 12);
+    for (std::uint32_t i = 0; i < records.size(); i++)
+    {
+        EXPECT_TRUE(records[i] == record(i)) << i;
+    }
+    EXPECT_EQ(sequences.front(), 0);
+    EXPECT_EQ(sequences.back(), 3);
+    EXPECT_EQ(decoder.stats().frames, 4);
+    EXPECT_EQ(decoder.stats().bad_frames, 0);
+    EXPECT_EQ(decoder.stats().lost_batches, 0);
+}
+
+TEST(TelemetryTest, Resync)
+{
+    Stream stream;
+    stream.text("I (1234) sensor: Sensor at port 1 is online!\n");
+    stream.send(0, 2);
+    stream.skip();
+    stream.skip();
+    stream.send(2, 2);
+    const auto corrupted_start = stream.bytes.size();
+    stream.send(4, 2);
+    stream.bytes[corrupted_start + 20] ^= 0x40;
+    stream.send(6, 2);
+    // A stream that starts in the middle of the log line
+    const std::vector<std::uint8_t> bytes(stream.bytes.begin() + 10, stream.bytes.end());
+
+    std::vector<std::uint32_t> times;
+    telemetry::Decoder decoder{[&](const Record &r, std::uint16_t) { times.push_back(r.time); }};
+    decoder.feed(bytes);
+    EXPECT_EQ(times, (std::vector<std::uint32_t>{0, 20'000, 40'000, 60'000, 120'000, 140'000}));
+    EXPECT_EQ(decoder.stats().bad_frames, 2);  // The log line and the corrupted frame
+    EXPECT_EQ(decoder.stats().lost_batches, 2 + 1);
+}
+
+TEST(TelemetryTest, SequenceWrapsAround)
+{
+    std::vector<std::uint8_t> bytes;
+    telemetry::Frame frame;
+    const auto records = std::vector{record(0)};
+    for (const std::uint16_t sequence : {0xfffe, 0xffff, 0x0000, 0x0002})
+    {
+        const auto size = telemetry::encode(records, sequence, frame);
+        bytes.insert(bytes.end(), frame.begin(), frame.begin() + static_cast<std::ptrdiff_t>(size));
+    }
+    telemetry::Decoder decoder{[](const Record &, std::uint16_t) {}};
+    decoder.feed(bytes);
+    EXPECT_EQ(decoder.stats().records, 4);
+    EXPECT_EQ(decoder.stats().lost_batches, 1);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(telemetry_tests);
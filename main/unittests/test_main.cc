@@ -26,15 +26,44 @@
 
 #include "hack.h"
 
+LOAD_TEST_FILE(cobs_tests);
+LOAD_TEST_FILE(fast_math_tests);
 LOAD_TEST_FILE(physical_size_tests);
+LOAD_TEST_FILE(spsc_queue_tests);
 LOAD_TEST_FILE(strongly_typed_tests);
+LOAD_TEST_FILE(triple_buffer_tests);
 LOAD_TEST_FILE(type_utils_tests);
 LOAD_TEST_FILE(value_range_tests);
+LOAD_TEST_FILE(work_stealing_pool_tests);
 
 LOAD_TEST_FILE(cell_tests);
 LOAD_TEST_FILE(direction_tests);
 LOAD_TEST_FILE(maze_tests);
 
+LOAD_TEST_FILE(average_filter_tests);
+LOAD_TEST_FILE(control_mailbox_tests);
+LOAD_TEST_FILE(deadline_stats_tests);
+LOAD_TEST_FILE(flight_log_tests);
+LOAD_TEST_FILE(flight_replay_tests);
+LOAD_TEST_FILE(gain_schedule_tests);
+LOAD_TEST_FILE(motor_identification_tests);
+LOAD_TEST_FILE(path_tracker_tests);
+LOAD_TEST_FILE(pid_tests);
+LOAD_TEST_FILE(planner_tests);
+LOAD_TEST_FILE(relay_tuner_tests);
+LOAD_TEST_FILE(sensor_acquisition_tests);
+LOAD_TEST_FILE(sensor_health_tests);
+LOAD_TEST_FILE(sensor_timing_tests);
+LOAD_TEST_FILE(simulator_tests);
+LOAD_TEST_FILE(slip_detector_tests);
+LOAD_TEST_FILE(stage_profiler_tests);
+LOAD_TEST_FILE(sweep_tests);
+LOAD_TEST_FILE(telemetry_tests);
+LOAD_TEST_FILE(turn_primitives_tests);
+LOAD_TEST_FILE(velocity_observer_tests);
+LOAD_TEST_FILE(velocity_profile_tests);
+LOAD_TEST_FILE(wall_follower_tests);
+
 void run_tests()
 {
     int argc = 1;
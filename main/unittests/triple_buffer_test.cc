@@ -0,0 +1,96 @@
+#include "misc_utils/triple_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+TEST(TripleBufferTest, Latest)
+{
+    TripleBuffer<int> buffer{-1};
+    EXPECT_FALSE(buffer.take());
+    EXPECT_EQ(buffer.read(), -1);
+
+    buffer.write(1);
+    buffer.write(2);
+    EXPECT_EQ(buffer.take(), 2);  // 1 was dropped
+    EXPECT_FALSE(buffer.take());
+    EXPECT_EQ(buffer.read(), 2);
+
+    // Writing doesn't touch the value being read.
+    buffer.write_buffer() = 3;
+    EXPECT_EQ(buffer.read(), 2);
+    buffer.publish();
+    EXPECT_EQ(buffer.read(), 2);
+    EXPECT_TRUE(buffer.update());
+    EXPECT_EQ(buffer.read(), 3);
+}
+
+/**
+ * @brief Publish as fast as possible from one thread and take from another. Every value the consumer sees must be
+ * whole (not torn) and newer than the previous one. Run under ThreadSanitizer (MICROMOUSE_TSAN) to check for races.
+ */
+TEST(TripleBufferTest, Stress)
+{
+    struct Frame
+    {
+        std::uint32_t sequence;
+        std::array<std::uint32_t, 32> payload;  // Every element is `sequence`.
+    };
+    static constexpr std::uint32_t frame_count = 200'000;
+    static constexpr std::uint32_t chunk = 10'000;
+
+    TripleBuffer<Frame> buffer;
+    std::atomic<std::uint32_t> seen = 0;
+    std::thread producer{[&]
+                         {
+                             for (std::uint32_t sequence = 1; sequence <= frame_count; sequence++)
+                             {
+                                 auto &frame = buffer.write_buffer();
+                                 frame.sequence = sequence;
+                                 frame.payload.fill(sequence);
+                                 buffer.publish();
+                                 // Let the consumer catch up once in a while, so it doesn't only see the last frame.
+                                 while (sequence % chunk == 0 && seen.load() + chunk <= sequence)
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }
+                         }};
+
+    std::uint32_t last = 0;
+    std::uint32_t taken = 0;
+    bool torn = false;
+    bool out_of_order = false;
+    while (last < frame_count)
+    {
+        if (!buffer.update())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        const auto &frame = buffer.read();
+        torn |= !std::ranges::all_of(frame.payload, [&](auto value) { return value == frame.sequence; });
+        out_of_order |= frame.sequence <= last;
+        last = frame.sequence;
+        seen = last;
+        taken++;
+    }
+    producer.join();
+    EXPECT_FALSE(torn);
+    EXPECT_FALSE(out_of_order);
+    EXPECT_GE(taken, frame_count / chunk);
+    EXPECT_FALSE(buffer.update());
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(triple_buffer_tests);
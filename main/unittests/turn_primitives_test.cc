@@ -0,0 +1,148 @@
+#include "../turn_primitives.h"
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "../motion_model.h"
+#include "../motor_specs.h"
+#include "../temp_map.h"
+#include "misc_utils_adapters.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using namespace unit_literals;
+
+static constexpr std::array all_turns{TurnType::Turn45, TurnType::Turn90, TurnType::Turn135, TurnType::Turn180};
+
+// The tables are built at compile time and fit the maze
+static_assert(get_turn(TurnType::Turn90).end().theta == std::numbers::pi_v<float> / 2);
+static_assert(std::abs(get_turn(TurnType::Turn90).end().x - wall_length / 2) < 5e-4f);
+static_assert(std::abs(get_turn(TurnType::Turn90).end().y - wall_length / 2) < 5e-4f);
+static_assert(std::abs(get_turn(TurnType::Turn180).end().x) < 5e-4f);
+static_assert(std::abs(get_turn(TurnType::Turn180).end().y - wall_length) < 5e-4f);
+
+TEST(TurnPrimitivesTest, MatchesReferenceIntegration)
+{
+    for (const auto type : all_turns)
+    {
+        const auto &turn = get_turn(type);
+        SCOPED_TRACE(testing::Message() << "angle " << turn.angle);
+
+        // Integrate the heading in double precision with libm.
+        static constexpr auto steps = 100'000;
+        const auto ds = static_cast<double>(turn.length()) / steps;
+        auto x = 0.0;
+        auto y = 0.0;
+        for (auto i = 0; i < steps; i++)
+        {
+            const auto theta = static_cast<double>(turn.heading(static_cast<float>((i + 0.5) * ds)));
+            x += std::cos(theta) * ds;
+            y += std::sin(theta) * ds;
+            if ((i + 1) % (steps / 10) == 0)
+            {
+                const auto p = turn.point(static_cast<float>((i + 1) * ds));
+                // Between the table's points the path is linearly interpolated
+                EXPECT_NEAR(p.x, x, 5e-5);
+                EXPECT_NEAR(p.y, y, 5e-5);
+            }
+        }
+        EXPECT_NEAR(turn.end().x, x, 1e-5);
+        EXPECT_NEAR(turn.end().y, y, 1e-5);
+        EXPECT_FLOAT_EQ(turn.end().theta, turn.angle);
+    }
+}
+
+TEST(TurnPrimitivesTest, WheelLimits)
+{
+    static constexpr seconds dt{1e-3f};
+
+    for (const auto type : all_turns)
+    {
+        const auto &turn = get_turn(type);
+        SCOPED_TRACE(testing::Message() << "angle " << turn.angle);
+        const auto speed = turn.max_speed();
+        const Position start{XCoord{0.0f}, YCoord{0.0f}, Angle{0.0f}};
+
+        auto prev = turn.sample(TurnSide::Right, start, speed, seconds{0.0f});
+        EXPECT_EQ(prev.angular_velocity, 0.0f);
+        for (auto t = dt; t <= turn.duration(speed) + dt; t += dt)
+        {
+            const auto cur = turn.sample(TurnSide::Right, start, speed, t);
+            ASSERT_LE(cur.left_velocity.count(), MotorSpecs::max_speed * 1.0001f);
+            ASSERT_GE(cur.right_velocity.count(), 0.0f);
+            ASSERT_NEAR(cur.left_velocity.count() + cur.right_velocity.count(), 2 * speed.count(), 1e-4f);
+            // The angular velocity ramps up and down (no steps in the wheel speeds).
+            const auto max_angular_velocity_step =
+                speed.count() * speed.count() * turn.max_curvature() / turn.clothoid_length * dt.count();
+            ASSERT_LE(std::abs(cur.angular_velocity - prev.angular_velocity), max_angular_velocity_step * 1.01f);
+            prev = cur;
+        }
+        EXPECT_EQ(prev.angular_velocity, 0.0f);
+        EXPECT_EQ(prev.left_velocity, speed);
+    }
+}
+
+/**
+ * @brief Feed the turn's wheel velocities to the motion model and make sure it ends where the turn says it should.
+ */
+TEST(TurnPrimitivesTest, FollowedByMotionModel)
+{
+    static constexpr auto dt = std::chrono::microseconds{500};
+    static constexpr auto speed = 0.5_mps;
+
+    for (const auto side : {TurnSide::Left, TurnSide::Right})
+    {
+        for (const auto type : all_turns)
+        {
+            const auto &turn = get_turn(type);
+            const auto sign = side == TurnSide::Right ? 1.0f : -1.0f;
+            SCOPED_TRACE(testing::Message() << "angle " << sign * turn.angle);
+            const Position start{XCoord{0.63f}, YCoord{1.17f}, Angle{-std::numbers::pi_v<float> / 2}};
+
+            auto pos = start;
+            const auto steps = static_cast<int>(turn.duration(speed) / dt);
+            for (auto i = 0; i < steps; i++)
+            {
+                // The average velocity over the step
+                const auto ref = turn.sample(side, start, speed, seconds{dt} * (i + 0.5f));
+                pos = update_pos(pos, ref.left_velocity, ref.right_velocity, dt);
+            }
+            const auto expected = turn.sample(side, start, speed, seconds{dt} * steps);
+            EXPECT_NEAR(pos.x->count(), expected.pos.x->count(), 1e-3f);
+            EXPECT_NEAR(pos.y->count(), expected.pos.y->count(), 1e-3f);
+            EXPECT_NEAR(static_cast<float>(pos.theta - expected.pos.theta), 0.0f, 1e-3f);
+
+            const auto end = turn.sample(side, start, speed, turn.duration(speed));
+            EXPECT_NEAR(static_cast<float>(end.pos.theta - (start.theta + Angle{sign * turn.angle})), 0.0f, 1e-5f);
+        }
+    }
+}
+
+TEST(TurnPrimitivesTest, SpeedOnlyChangesTiming)
+{
+    const auto &turn = get_turn(TurnType::Turn90);
+    const Position start{XCoord{0.0f}, YCoord{0.0f}, Angle{0.0f}};
+    EXPECT_FLOAT_EQ(turn.duration(0.5_mps).count(), 2 * turn.duration(1.0_mps).count());
+    for (auto t = 0.0f; t < turn.duration(1.0_mps).count(); t += 0.01f)
+    {
+        const auto slow = turn.sample(TurnSide::Left, start, 0.5_mps, seconds{2 * t});
+        const auto fast = turn.sample(TurnSide::Left, start, 1.0_mps, seconds{t});
+        EXPECT_FLOAT_EQ(slow.pos.x->count(), fast.pos.x->count());
+        EXPECT_FLOAT_EQ(slow.pos.y->count(), fast.pos.y->count());
+        EXPECT_FLOAT_EQ(2 * slow.angular_velocity, fast.angular_velocity);
+    }
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(turn_primitives_tests);
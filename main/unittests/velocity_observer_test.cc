@@ -0,0 +1,153 @@
+#include "../velocity_observer.h"
+
+#include <misc_utils/physical_size.h>
+
+#include "../motor_specs.h"
+#include "misc_utils_adapters.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+// The same encoder as in `Motor::ticks_to_distance`
+static constexpr auto tick_size = MotorSpecs::wheel_perimeter / MotorSpecs::ticks_per_rotation;  // [m]
+static constexpr VelocityObserver::Timestamp period{5'000};
+
+static meters quantize(float position)
+{
+    return meters{std::floor(position / tick_size) * tick_size};
+}
+
+TEST(VelocityObserverTest, ConstantAccelerationWithoutLag)
+{
+    static constexpr auto acceleration = 2.0f;  // [m/s^2]
+
+    VelocityObserver observer;
+    observer.reset(meters{0.0f}, VelocityObserver::Timestamp::zero());
+    for (auto now = period; now <= std::chrono::seconds{1}; now += period)
+    {
+        const auto t = std::chrono::duration_cast<VelocityObserver::seconds>(now).count();
+        observer.update(meters{acceleration * t * t / 2}, now);
+    }
+    EXPECT_NEAR(observer.state().velocity.count(), acceleration * 1.0f, 1e-3f);
+    EXPECT_NEAR(observer.state().acceleration, acceleration, 1e-2f);
+    EXPECT_NEAR(observer.state().position.count(), acceleration / 2, 1e-4f);
+}
+
+TEST(VelocityObserverTest, TimestampHandling)
+{
+    VelocityObserver observer;
+
+    // The first update only initializes the observer.
+    EXPECT_EQ(observer.update(meters{0.5f}, VelocityObserver::Timestamp{1'000}).velocity.count(), 0.0f);
+    EXPECT_EQ(observer.state().position.count(), 0.5f);
+
+    // The same timestamp again - nothing to integrate.
+    EXPECT_EQ(observer.update(meters{0.6f}, VelocityObserver::Timestamp{1'000}).position.count(), 0.5f);
+
+    observer.update(meters{0.501f}, VelocityObserver::Timestamp{6'000});
+    EXPECT_GT(observer.state().velocity.count(), 0.0f);
+
+    // A long gap restarts the observer.
+    observer.update(meters{2.0f}, VelocityObserver::Timestamp{6'000} + VelocityObserver::max_update_interval * 2);
+    EXPECT_EQ(observer.state().position.count(), 2.0f);
+    EXPECT_EQ(observer.state().velocity.count(), 0.0f);
+}
+
+/**
+ * @brief Drive a simulated wheel through slow and fast segments and compare the velocity error of the observer with
+ * the error of `Motor::get_speed` (the tick difference over the nominal period).
+ */
+TEST(VelocityObserverTest, QuantizedEncoder)
+{
+    // Velocity profile: creep, accelerate, cruise, decelerate.
+    const auto true_velocity = [](float t)
+    {
+        if (t < 1.0f)
+        {
+            return 0.05f;
+        }
+        if (t < 1.25f)
+        {
+            return 0.05f + 2.0f * (t - 1.0f);
+        }
+        if (t < 2.0f)
+        {
+            return 0.55f;
+        }
+        return std::max(0.55f - 2.0f * (t - 2.0f), 0.02f);
+    };
+
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<std::int64_t> jitter{-200, 200};  // [us]
+
+    VelocityObserver observer;
+    auto position = 0.0f;
+    auto last_ticks_position = quantize(position);
+    observer.reset(last_ticks_position, VelocityObserver::Timestamp::zero());
+
+    auto raw_sq_err = 0.0f;
+    auto observer_sq_err = 0.0f;
+    auto slow_raw_max_err = 0.0f;
+    auto slow_observer_max_err = 0.0f;
+    auto samples = 0;
+    auto now = VelocityObserver::Timestamp::zero();
+    // Integrate the true motion finely, sample it every (jittered) period.
+    static constexpr VelocityObserver::Timestamp sim_step{10};
+    auto next_sample = period;
+    for (; now < std::chrono::seconds{3}; now += sim_step)
+    {
+        const auto t = std::chrono::duration_cast<VelocityObserver::seconds>(now).count();
+        position += true_velocity(t) * std::chrono::duration_cast<VelocityObserver::seconds>(sim_step).count();
+        if (now < next_sample)
+        {
+            continue;
+        }
+        next_sample = now + period + VelocityObserver::Timestamp{jitter(gen)};
+
+        const auto measured = quantize(position);
+        const auto raw = (measured - last_ticks_position).count()
+                       / std::chrono::duration_cast<VelocityObserver::seconds>(period).count();
+        last_ticks_position = measured;
+        const auto estimated = observer.update(measured, now).velocity.count();
+
+        if (t < 0.2f)  // Allow the observer to converge
+        {
+            continue;
+        }
+        const auto v = true_velocity(t);
+        raw_sq_err += (raw - v) * (raw - v);
+        observer_sq_err += (estimated - v) * (estimated - v);
+        samples++;
+        if (t < 1.0f)
+        {
+            slow_raw_max_err = std::max(slow_raw_max_err, std::abs(raw - v));
+            slow_observer_max_err = std::max(slow_observer_max_err, std::abs(estimated - v));
+        }
+    }
+
+    const auto raw_rms = std::sqrt(raw_sq_err / samples);
+    const auto observer_rms = std::sqrt(observer_sq_err / samples);
+    std::cout << "Velocity RMS error: raw difference = " << raw_rms * 1e3f
+              << " mm/s, observer = " << observer_rms * 1e3f
+              << " mm/s; at 50 mm/s max error: raw = " << slow_raw_max_err * 1e3f
+              << " mm/s, observer = " << slow_observer_max_err * 1e3f << " mm/s" << std::endl;
+    EXPECT_LT(observer_rms, raw_rms / 3);
+    EXPECT_LT(slow_observer_max_err, slow_raw_max_err / 3);
+    // The observer's position must track the encoder (no drift in the odometry).
+    EXPECT_NEAR(observer.state().position.count(), quantize(position).count(), 2 * tick_size);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(velocity_observer_tests);
@@ -0,0 +1,161 @@
+#include "../velocity_profile.h"
+
+#include <misc_utils/physical_size.h>
+
+#include "../motor_specs.h"
+#include "../temp_map.h"
+#include "misc_utils_adapters.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+using namespace unit_literals;
+
+static constexpr MotionLimits limits{
+    .max_velocity = 1.0_mps,
+    .max_acceleration = MotorSpecs::max_acceleration,
+    .max_jerk = 200.0f,
+};
+
+// Relative slack for the numerical checks.
+static constexpr auto tolerance = 1e-3f;
+
+/**
+ * @brief Sample the profile densely and check the limits, the continuity and the boundary conditions.
+ */
+static void check_profile(const VelocityProfile &profile, meters distance, const MotionLimits &limits)
+{
+    static constexpr VelocityProfile::seconds dt{1e-4f};
+
+    const auto start = profile.sample(VelocityProfile::seconds{0});
+    EXPECT_FLOAT_EQ(start.position.count(), 0.0f);
+    EXPECT_FLOAT_EQ(start.velocity.count(), profile.entry_velocity().count());
+    EXPECT_FLOAT_EQ(start.acceleration, 0.0f);
+
+    auto prev = start;
+    for (auto t = dt; t <= profile.duration() + dt; t += dt)
+    {
+        const auto cur = profile.sample(t);
+        ASSERT_LE(cur.velocity, std::max(limits.max_velocity, profile.entry_velocity()) + meters_per_second{tolerance});
+        ASSERT_GE(cur.velocity.count(), -tolerance);
+        ASSERT_LE(std::abs(cur.acceleration), limits.max_acceleration * (1 + tolerance));
+        // Continuity and the jerk limit
+        ASSERT_NEAR(cur.position.count(), prev.position.count() + prev.velocity.count() * dt.count(), 1e-5f);
+        ASSERT_NEAR(cur.velocity.count(), prev.velocity.count() + prev.acceleration * dt.count(), 1e-3f);
+        ASSERT_LE(std::abs(cur.acceleration - prev.acceleration), limits.max_jerk * dt.count() * (1 + tolerance));
+        prev = cur;
+    }
+
+    const auto end = profile.sample(profile.duration());
+    EXPECT_NEAR(end.position.count(), distance.count(), 1e-4f);
+    EXPECT_NEAR(end.velocity.count(), profile.exit_velocity().count(), 1e-3f);
+    EXPECT_NEAR(end.acceleration, 0.0f, limits.max_jerk * 1e-4f);
+}
+
+TEST(VelocityProfileTest, Limits)
+{
+    // distance [m], entry [m/s], exit [m/s]
+    static constexpr std::array cases{
+        std::tuple{wall_length, 0.0f, 0.0f},       // One cell, start and stop
+        std::tuple{8 * wall_length, 0.0f, 0.0f},   // Long straight: reaches the max velocity
+        std::tuple{2 * wall_length, 0.3f, 0.5f},   // Between junctions
+        std::tuple{2 * wall_length, 0.8f, 0.2f},   // Slowing down into a turn
+        std::tuple{0.5f * wall_length, 0.4f, 0.4f},
+        std::tuple{0.01f, 0.0f, 0.0f},             // Very short
+    };
+    for (const auto &[distance, entry, exit] : cases)
+    {
+        SCOPED_TRACE(testing::Message() << distance << " m, " << entry << " -> " << exit << " m/s");
+        const auto profile =
+            VelocityProfile::plan(meters{distance}, meters_per_second{entry}, meters_per_second{exit}, limits);
+        EXPECT_EQ(profile.entry_velocity().count(), entry);
+        EXPECT_EQ(profile.exit_velocity().count(), exit);
+        EXPECT_FLOAT_EQ(profile.distance().count(), distance);
+        check_profile(profile, meters{distance}, limits);
+    }
+}
+
+TEST(VelocityProfileTest, ReachesMaxVelocity)
+{
+    const auto profile = VelocityProfile::plan(meters{8 * wall_length}, 0.0_mps, 0.0_mps, limits);
+    EXPECT_NEAR(profile.sample(profile.duration() / 2).velocity.count(), limits.max_velocity.count(), 1e-4f);
+
+    // The time-optimal profile: the max acceleration is reached and held.
+    auto max_acceleration = 0.0f;
+    for (auto t = VelocityProfile::seconds{0}; t < profile.duration(); t += VelocityProfile::seconds{1e-4f})
+    {
+        max_acceleration = std::max(max_acceleration, profile.sample(t).acceleration);
+    }
+    EXPECT_NEAR(max_acceleration, limits.max_acceleration, 1e-3f);
+}
+
+TEST(VelocityProfileTest, UnreachableExitVelocity)
+{
+    // Not enough distance to reach the wanted exit velocity.
+    const auto faster = VelocityProfile::plan(0.02_m, 0.0_mps, 1.0_mps, limits);
+    EXPECT_LT(faster.exit_velocity().count(), 1.0f);
+    EXPECT_NEAR(faster.exit_velocity().count(), max_reachable_velocity(0.0_mps, 0.02_m, limits).count(), 1e-6f);
+    check_profile(faster, 0.02_m, limits);
+
+    // Not enough distance to stop - the limits are kept and the segment ends faster than wanted.
+    const auto slower = VelocityProfile::plan(0.02_m, 1.0_mps, 0.0_mps, limits);
+    EXPECT_GT(slower.exit_velocity().count(), 0.0f);
+    check_profile(slower, 0.02_m, limits);
+}
+
+TEST(VelocityProfileTest, AfterTheEnd)
+{
+    const auto profile = VelocityProfile::plan(meters{wall_length}, 0.2_mps, 0.4_mps, limits);
+    const auto after = profile.sample(profile.duration() + VelocityProfile::seconds{0.1f});
+    EXPECT_FLOAT_EQ(after.velocity.count(), 0.4f);
+    EXPECT_NEAR(after.position.count(), wall_length + 0.04f, 1e-5f);
+    EXPECT_EQ(after.acceleration, 0.0f);
+
+    const VelocityProfile still;
+    EXPECT_EQ(still.duration().count(), 0.0f);
+    EXPECT_EQ(still.sample(VelocityProfile::seconds{1.0f}).position.count(), 0.0f);
+}
+
+TEST(VelocityProfileTest, JunctionVelocities)
+{
+    // A run with short and long straights. The junction limits are the (smooth) turn speeds.
+    const std::array lengths{
+        meters{3 * wall_length},
+        meters{0.5f * wall_length},
+        meters{wall_length},
+        meters{5 * wall_length},
+    };
+    std::array junctions{
+        meters_per_second{0.0f},  // Start
+        meters_per_second{0.7f},
+        meters_per_second{0.9f},
+        meters_per_second{2.0f},  // Above max_velocity
+        meters_per_second{0.0f},  // Stop
+    };
+    plan_junction_velocities(lengths, junctions, limits);
+
+    EXPECT_EQ(junctions.front().count(), 0.0f);
+    EXPECT_EQ(junctions.back().count(), 0.0f);
+    for (std::size_t i = 0; i < lengths.size(); i++)
+    {
+        SCOPED_TRACE(testing::Message() << "segment " << i);
+        EXPECT_GT(junctions[i + 1].count() + junctions[i].count(), 0.0f);
+        const auto profile = VelocityProfile::plan(lengths[i], junctions[i], junctions[i + 1], limits);
+        // All the junctions are feasible, so they aren't adjusted.
+        EXPECT_NEAR(profile.exit_velocity().count(), junctions[i + 1].count(), 1e-4f);
+        check_profile(profile, lengths[i], limits);
+    }
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(velocity_profile_tests);
@@ -0,0 +1,274 @@
+#include "../wall_follower.h"
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "../distance_sensor_model.h"
+#include "../kalman_filter.h"
+#include "../motion_model.h"
+#include "../temp_map.h"
+#include "benchmark.h"
+#include "misc_utils_adapters.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <random>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+// A straight corridor along the x-axis: the cell's walls are at y = 0 and y = wall_length.
+static constexpr auto corridor_center = wall_length / 2;
+static constexpr meters out_of_range{2.0f};
+
+/**
+ * @brief Cast the sensor rays on the corridor walls (and an optional front wall at x = front_wall).
+ */
+static DistanceSensors::Readings simulate_readings(
+    const Position &pos,
+    float noise_stddev = 0.0f,
+    float front_wall = std::numeric_limits<float>::infinity()
+)
+{
+    static std::mt19937 gen{1234};
+    std::normal_distribution<float> noise{0.0f, noise_stddev > 0.0f ? noise_stddev : 1e-12f};
+
+    DistanceSensors::Readings res;
+    for (std::size_t i = 0; i < res.size(); i++)
+    {
+        const auto theta = pos.theta.get();
+        const auto sx = pos.x->count() + sensor_disposition[i].first->count() * std::cos(theta)
+                      - sensor_disposition[i].second->count() * std::sin(theta);
+        const auto sy = pos.y->count() + sensor_disposition[i].first->count() * std::sin(theta)
+                      + sensor_disposition[i].second->count() * std::cos(theta);
+        const auto dx = std::cos(theta + sensor_angles[i].get());
+        const auto dy = std::sin(theta + sensor_angles[i].get());
+
+        auto distance = std::numeric_limits<float>::infinity();
+        if (dy > 0)
+        {
+            distance = std::min(distance, (wall_length - sy) / dy);
+        }
+        if (dy < 0)
+        {
+            distance = std::min(distance, -sy / dy);
+        }
+        if (dx > 0)
+        {
+            distance = std::min(distance, (front_wall - sx) / dx);
+        }
+        distance += noise_stddev > 0.0f ? noise(gen) : 0.0f;
+        res[i] = meters{distance} > max_sensor_range ? out_of_range : meters{distance};
+    }
+    return res;
+}
+
+static Position corridor_pos(float x, float lateral_offset, float yaw)
+{
+    return Position{XCoord{x}, YCoord{corridor_center + lateral_offset}, Angle{yaw}};
+}
+
+TEST(WallFollowerTest, ExactWithoutNoise)
+{
+    for (auto offset : {-0.02f, -0.01f, 0.0f, 0.01f, 0.015f})
+    {
+        for (auto yaw : {-0.1f, -0.05f, 0.0f, 0.05f, 0.1f})
+        {
+            const auto truth = corridor_pos(0.5f, offset, yaw);
+            const auto corridor = estimate_corridor(simulate_readings(truth));
+            ASSERT_TRUE(corridor.left.has_value());
+            ASSERT_TRUE(corridor.right.has_value());
+            EXPECT_NEAR(corridor.left->yaw.get(), yaw, 1e-4f);
+            EXPECT_NEAR(corridor.right->yaw.get(), yaw, 1e-4f);
+            EXPECT_NEAR(corridor.left->distance.count(), corridor_center + offset, 1e-4f);
+            EXPECT_NEAR(corridor.right->distance.count(), corridor_center - offset, 1e-4f);
+
+            // Start from a wrong estimate and fully trust the walls.
+            const auto estimate = corridor_pos(0.5f, offset + 0.01f, yaw - 0.05f);
+            const auto corrected = corridor_update(estimate, simulate_readings(truth));
+            ASSERT_TRUE(corrected.has_value());
+            EXPECT_FLOAT_EQ(corrected->x->count(), truth.x->count());
+            EXPECT_NEAR(corrected->y->count(), truth.y->count(), 1e-4f);
+            EXPECT_NEAR(corrected->theta.get(), truth.theta.get(), 1e-4f);
+        }
+    }
+}
+
+TEST(WallFollowerTest, SingleWall)
+{
+    const auto truth = corridor_pos(0.5f, 0.01f, 0.05f);
+    auto readings = simulate_readings(truth);
+    readings[0] = out_of_range;  // No right wall
+
+    const auto corridor = estimate_corridor(readings);
+    EXPECT_TRUE(corridor.left.has_value());
+    EXPECT_FALSE(corridor.right.has_value());
+
+    const auto corrected = corridor_update(corridor_pos(0.5f, 0.0f, 0.0f), readings);
+    ASSERT_TRUE(corrected.has_value());
+    EXPECT_NEAR(corrected->y->count(), truth.y->count(), 1e-4f);
+    EXPECT_NEAR(corrected->theta.get(), truth.theta.get(), 1e-4f);
+}
+
+TEST(WallFollowerTest, FallBackToEkf)
+{
+    const auto truth = corridor_pos(0.5f, 0.0f, 0.0f);
+
+    // Front wall - the EKF can correct the position along the corridor.
+    EXPECT_FALSE(corridor_update(truth, simulate_readings(truth, 0.0f, 0.6f)).has_value());
+
+    // No side walls.
+    auto readings = simulate_readings(truth);
+    readings[0] = readings[1] = readings[3] = readings[4] = out_of_range;
+    EXPECT_FALSE(corridor_update(truth, readings).has_value());
+
+    // The walls disagree on the heading (e.g. a diagonal sensor sees a wall across an opening).
+    readings = simulate_readings(truth);
+    readings[1] = meters{readings[1].count() * 0.7f};
+    EXPECT_FALSE(corridor_update(truth, readings).has_value());
+
+    // The correction would leave the cell.
+    EXPECT_FALSE(corridor_update(corridor_pos(0.5f, 0.06f, 0.0f), simulate_readings(truth)).has_value());
+}
+
+TEST(WallFollowerTest, TrackingSimulation)
+{
+    using namespace std::chrono_literals;
+    static constexpr auto dt = 5ms;
+    static constexpr auto sensors_period = 4;  // Every 20 ms
+    static constexpr auto steps = 400;         // 2 seconds
+    static constexpr auto gain = 0.3f;
+
+    // The odometry thinks the left wheel is 2% faster than it really is.
+    static constexpr auto speed = 0.4_mps;
+    static constexpr auto odometry_bias = 1.02f;
+
+    auto truth = corridor_pos(0.0f, 0.005f, 0.02f);
+    auto estimate = corridor_pos(0.0f, 0.0f, 0.0f);
+    auto dead_reckoning = estimate;
+    auto max_lateral_err = 0.0f;
+    auto max_yaw_err = 0.0f;
+    auto fallbacks = 0;
+    for (auto step = 1; step <= steps; step++)
+    {
+        truth = update_pos(truth, speed, speed, dt);
+        estimate = update_pos(estimate, speed * odometry_bias, speed, dt);
+        dead_reckoning = update_pos(dead_reckoning, speed * odometry_bias, speed, dt);
+        if (step % sensors_period == 0)
+        {
+            if (const auto corrected = corridor_update(estimate, simulate_readings(truth, 1.5e-3f), gain))
+            {
+                estimate = *corrected;
+            }
+            else
+            {
+                fallbacks++;
+            }
+        }
+        if (step > steps / 4)  // Allow the estimator to converge
+        {
+            max_lateral_err = std::max(max_lateral_err, std::abs(estimate.y->count() - truth.y->count()));
+            max_yaw_err = std::max(max_yaw_err, std::abs(static_cast<float>(estimate.theta - truth.theta)));
+        }
+    }
+
+    std::cout << "Corridor tracking: max lateral error = " << max_lateral_err * 1e3f
+              << " mm, max yaw error = " << max_yaw_err << " rad (dead reckoning: "
+              << std::abs(dead_reckoning.y->count() - truth.y->count()) * 1e3f << " mm, "
+              << std::abs(static_cast<float>(dead_reckoning.theta - truth.theta)) << " rad)" << std::endl;
+    EXPECT_EQ(fallbacks, 0);
+    EXPECT_LT(max_lateral_err, 3e-3f);
+    EXPECT_LT(max_yaw_err, 0.03f);
+}
+
+/**
+ * @brief Along a corridor only the position along the axis is unobserved, so only its variance keeps growing.
+ */
+TEST(WallFollowerTest, CorridorBoundsTheCovariance)
+{
+    const auto pos = corridor_pos(0.5f, 0.0f, 0.0f);
+    const auto motion_jacobian = pos_jacobian(pos, 0.5_mps, 0.5_mps, std::chrono::milliseconds{5});
+    const auto axis = corridor_axis(pos.theta);
+    EXPECT_EQ(axis.get(), 0.0f);
+
+    KalmanFilter kalman_filter;
+    for (auto i = 0; i < 1000; i++)
+    {
+        kalman_filter.corridor_update(motion_jacobian, axis, 0.5f);
+    }
+    const auto &P = kalman_filter.covariance();
+    const auto &process = default_kalman_noise.process;
+    EXPECT_GT(P(0, 0), 100 * process[0]);
+    // The steady state of P = (1 - g)^2 (P + Q) + g^2 R, below 2 (Q + R) for g = 0.5.
+    EXPECT_LT(P(1, 1), 2 * (process[1] + default_kalman_noise.corridor[0]));
+    EXPECT_LT(P(2, 2), 2 * (process[2] + default_kalman_noise.corridor[1]));
+}
+
+/**
+ * @brief Only the rows with a reading and a prediction in range are filled - the others add no degrees of freedom.
+ */
+TEST(WallFollowerTest, PredictionsSkipOutOfRangeRows)
+{
+    // A corridor in the maze (heading East in row 7).
+    const Position pos{XCoord{1.5f * wall_length}, YCoord{7.5f * wall_length}, Angle{0.0f}};
+    auto readings = simulate_readings(corridor_pos(0.0f, 0.0f, 0.0f));
+    readings[2] = out_of_range;  // A reading out of range
+
+    // The front-right diagonal sensor reads a wall, but the map has none within range along its ray.
+    const auto prediction = predict_readings(pos, readings, maze_map);
+    EXPECT_EQ(prediction.valid, std::bitset<DistanceSensors::sensor_count>{0b10011});
+    EXPECT_EQ(prediction.valid.count(), 3);
+    for (std::size_t i = 0; i < DistanceSensors::sensor_count; i++)
+    {
+        EXPECT_EQ(prediction.jacobian.row(i).isZero(), !prediction.valid.test(i)) << "sensor " << i;
+    }
+}
+
+TEST(WallFollowerBenchmark, AgainstEkf)
+{
+    static constexpr std::size_t iterations = 2'000;
+
+    // A corridor in the maze (heading East in row 7).
+    const Position pos{XCoord{1.5f * wall_length}, YCoord{7.5f * wall_length}, Angle{0.0f}};
+    const DistanceSensors::Readings readings{
+        meters{wall_length / 2 - 54e-3f},
+        meters{0.08f},
+        out_of_range,
+        meters{0.08f},
+        meters{wall_length / 2 - 54e-3f},
+    };
+    const auto motion_jacobian = pos_jacobian(pos, 0.5_mps, 0.5_mps, std::chrono::milliseconds{5});
+
+    KalmanFilter kalman_filter;
+    std::cout << "Average cost per sensor update (EKF vs corridor estimator):" << std::endl;
+    bench::report(
+        "update",
+        bench::measure(
+            [&](auto)
+            {
+                const auto [error, jacobian, valid] = predict_readings(pos, readings, maze_map);
+                return kalman_filter(pos, motion_jacobian, error, jacobian).x->count();
+            },
+            iterations
+        ),
+        bench::measure(
+            [&](auto)
+            {
+                kalman_filter.corridor_update(motion_jacobian, corridor_axis(pos.theta), 0.5f);
+                return corridor_update(pos, readings, 0.5f)->x->count();
+            },
+            iterations
+        )
+    );
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(wall_follower_tests);
@@ -0,0 +1,95 @@
+#include "misc_utils/work_stealing_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <hack.h>
+
+namespace micromouse::tests
+{
+
+TEST(WorkStealingPoolTest, RunsEveryTaskOnce)
+{
+    static constexpr std::size_t task_count = 10'000;
+
+    WorkStealingPool pool{4};
+    EXPECT_EQ(pool.size(), 4);
+    std::vector<std::atomic<int>> runs(task_count);
+    pool.parallel_for(task_count, [&](std::size_t i) { runs[i].fetch_add(1, std::memory_order_relaxed); });
+    for (std::size_t i = 0; i < task_count; i++)
+    {
+        EXPECT_EQ(runs[i].load(), 1) << "task " << i;
+    }
+}
+
+TEST(WorkStealingPoolTest, WaitsForNestedTasks)
+{
+    WorkStealingPool pool{4};
+    std::atomic<int> leaves{0};
+    for (auto i = 0; i < 8; i++)
+    {
+        pool.submit(
+            [&]
+            {
+                for (auto j = 0; j < 8; j++)
+                {
+                    pool.submit([&] { leaves.fetch_add(1, std::memory_order_relaxed); });
+                }
+            }
+        );
+    }
+    pool.wait();
+    EXPECT_EQ(leaves.load(), 64);
+
+    // And the pool is reusable once it's idle.
+    pool.wait();
+    pool.parallel_for(16, [&](std::size_t) { leaves.fetch_add(1, std::memory_order_relaxed); });
+    EXPECT_EQ(leaves.load(), 80);
+}
+
+/**
+ * @brief A task's subtasks go to its own worker's deque, so the other workers only get them by stealing.
+ */
+TEST(WorkStealingPoolTest, IdleWorkersSteal)
+{
+    static constexpr auto task_count = 32;
+
+    WorkStealingPool pool{4};
+    std::atomic<int> done{0};
+    pool.submit(
+        [&]
+        {
+            for (auto i = 0; i < task_count; i++)
+            {
+                pool.submit(
+                    [&]
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                        done.fetch_add(1, std::memory_order_relaxed);
+                    }
+                );
+            }
+        }
+    );
+    pool.wait();
+    EXPECT_EQ(done.load(), task_count);
+    EXPECT_GT(pool.steals(), 0);
+}
+
+TEST(WorkStealingPoolTest, AtLeastOneWorker)
+{
+    WorkStealingPool pool{0};
+    EXPECT_EQ(pool.size(), 1);
+    auto sum = 0;  // A single worker, no races
+    pool.parallel_for(100, [&](std::size_t i) { sum += static_cast<int>(i); });
+    EXPECT_EQ(sum, 4950);
+}
+
+}  // namespace micromouse::tests
+
+REGISTER_TEST_FILE(work_stealing_pool_tests);
@@ -0,0 +1,117 @@
+#ifndef MAIN_VELOCITY_OBSERVER_H
+#define MAIN_VELOCITY_OBSERVER_H
+
+#include <misc_utils/physical_size.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace micromouse
+{
+
+/**
+ * @brief Estimates a wheel's velocity and acceleration from its (quantized) encoder position.
+ *
+ * Differentiating the encoder count over a short period gives a velocity quantized to one tick per period, which is
+ * very coarse at low speeds. Instead, this is a third order tracking loop: the position, velocity and acceleration
+ * are predicted with a constant acceleration model and then corrected by the position error. The gains place all
+ * three poles at `-bandwidth`, so the loop is critically damped and tracks a constant acceleration without a steady
+ * state error (and therefore without lag in the velocity).
+ *
+ * The actual time between updates is used (not the nominal period), so jitter in the calling task doesn't show up in
+ * the velocity.
+ */
+class VelocityObserver
+{
+public:
+    using Timestamp = std::chrono::duration<std::int64_t, std::micro>;  // As returned by `esp_timer_get_time`
+    using seconds = std::chrono::duration<float>;
+
+    struct State
+    {
+        meters position;
+        meters_per_second velocity;
+        float acceleration;  // [m/s^2]
+    };
+
+    static constexpr float default_bandwidth = 60.0f;  // [rad/s]
+    // Longer gaps (a stalled task, the first update) restart the observer instead of integrating a huge step.
+    static constexpr Timestamp max_update_interval{50'000};
+
+    /**
+     * @param bandwidth The loop's bandwidth in [rad/s]. Higher is faster but lets through more quantization noise.
+     * Should be well below `1 / update_period`.
+     */
+    explicit constexpr VelocityObserver(float bandwidth = default_bandwidth) noexcept
+        : m_k_position{3 * bandwidth}
+        , m_k_velocity{3 * bandwidth * bandwidth}
+        , m_k_acceleration{bandwidth * bandwidth * bandwidth}
+    {}
+
+    /**
+     * @brief Restart the observer at the given position, at rest.
+     *
+     * @param position The current encoder position.
+     * @param now The current time.
+     */
+    constexpr void reset(meters position, Timestamp now) noexcept
+    {
+        m_state = {.position = position, .velocity = meters_per_second{0.0f}, .acceleration = 0.0f};
+        m_last_update = now;
+        m_initialized = true;
+    }
+
+    /**
+     * @brief Feed a new encoder position.
+     *
+     * @param position The current encoder position.
+     * @param now The time the position was sampled.
+     * @return The updated state.
+     */
+    constexpr const State &update(meters position, Timestamp now) noexcept
+    {
+        const auto interval = now - m_last_update;
+        if (!m_initialized || interval > max_update_interval || interval < Timestamp::zero())
+        {
+            reset(position, now);
+            return m_state;
+        }
+        if (interval == Timestamp::zero())
+        {
+            return m_state;
+        }
+        m_last_update = now;
+
+        const auto dt = std::chrono::duration_cast<seconds>(interval).count();
+        auto p = m_state.position.count();
+        auto v = m_state.velocity.count();
+        auto a = m_state.acceleration;
+
+        // Predict
+        p += (v + a * dt / 2) * dt;
+        v += a * dt;
+
+        // Correct
+        const auto error = position.count() - p;
+        p += m_k_position * dt * error;
+        v += m_k_velocity * dt * error;
+        a += m_k_acceleration * dt * error;
+
+        m_state = {.position = meters{p}, .velocity = meters_per_second{v}, .acceleration = a};
+        return m_state;
+    }
+
+    constexpr const State &state() const noexcept { return m_state; }
+
+private:
+    float m_k_position;
+    float m_k_velocity;
+    float m_k_acceleration;
+    State m_state{};
+    Timestamp m_last_update{};
+    bool m_initialized = false;
+};
+
+}  // namespace micromouse
+
+#endif  // MAIN_VELOCITY_OBSERVER_H
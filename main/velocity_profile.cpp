@@ -0,0 +1,209 @@
+#include "velocity_profile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace micromouse
+{
+
+static constexpr auto bisection_iterations = 32;
+
+namespace
+{
+
+/**
+ * @brief The durations of the 3 phases of a jerk-limited velocity change (jerk, constant acceleration, jerk).
+ */
+struct Transition
+{
+    float jerk_time;
+    float constant_time;
+
+    constexpr float duration() const noexcept { return 2 * jerk_time + constant_time; }
+};
+
+}  // namespace
+
+static Transition plan_transition(float from, float to, const MotionLimits &limits) noexcept
+{
+    const auto delta = std::abs(to - from);
+    const auto a = limits.max_acceleration;
+    const auto j = limits.max_jerk;
+    if (delta >= a * a / j)
+    {
+        return {.jerk_time = a / j, .constant_time = delta / a - a / j};
+    }
+    // The maximum acceleration isn't reached.
+    return {.jerk_time = std::sqrt(delta / j), .constant_time = 0.0f};
+}
+
+static float transition_distance(float from, float to, const MotionLimits &limits) noexcept
+{
+    // The phases are symmetric, so the average velocity is the middle between the two velocities.
+    return (from + to) / 2 * plan_transition(from, to, limits).duration();
+}
+
+meters transition_distance(meters_per_second from, meters_per_second to, const MotionLimits &limits) noexcept
+{
+    return meters{transition_distance(from.count(), to.count(), limits)};
+}
+
+meters_per_second max_reachable_velocity(meters_per_second from, meters distance, const MotionLimits &limits) noexcept
+{
+    auto low = from.count();
+    auto high = std::max(limits.max_velocity.count(), low);
+    if (transition_distance(low, high, limits) <= distance.count())
+    {
+        return meters_per_second{high};
+    }
+    // The distance grows with the higher velocity
+    for (auto i = 0; i < bisection_iterations; i++)
+    {
+        const auto mid = (low + high) / 2;
+        (transition_distance(from.count(), mid, limits) <= distance.count() ? low : high) = mid;
+    }
+    return meters_per_second{low};
+}
+
+/**
+ * @brief The lowest velocity that `from` can be slowed down to within `distance`.
+ */
+static float min_reachable_velocity(float from, float distance, const MotionLimits &limits) noexcept
+{
+    auto low = 0.0f;
+    auto high = from;
+    if (transition_distance(from, low, limits) <= distance)
+    {
+        return low;
+    }
+    for (auto i = 0; i < bisection_iterations; i++)
+    {
+        const auto mid = (low + high) / 2;
+        (transition_distance(from, mid, limits) <= distance ? high : low) = mid;
+    }
+    return high;
+}
+
+VelocityProfile VelocityProfile::plan(
+    meters distance,
+    meters_per_second entry,
+    meters_per_second exit,
+    const MotionLimits &limits
+) noexcept
+{
+    const auto length = std::max(distance.count(), 0.0f);
+    const auto v0 = entry.count();
+    auto v1 = exit.count();
+    if (v1 > v0)
+    {
+        v1 = std::min(v1, max_reachable_velocity(entry, meters{length}, limits).count());
+    }
+    else
+    {
+        // Can't change the entry velocity, so end the segment faster than wanted rather than break the limits.
+        v1 = std::max(v1, min_reachable_velocity(v0, length, limits));
+    }
+
+    // The peak velocity: the highest one that allows changing from v0 and to v1 within the segment.
+    const auto total_distance = [&](float peak)
+    { return transition_distance(v0, peak, limits) + transition_distance(peak, v1, limits); };
+    auto low = std::max(v0, v1);
+    auto high = std::max(limits.max_velocity.count(), low);
+    auto peak = high;
+    if (total_distance(high) > length)
+    {
+        for (auto i = 0; i < bisection_iterations; i++)
+        {
+            const auto mid = (low + high) / 2;
+            (total_distance(mid) <= length ? low : high) = mid;
+        }
+        peak = low;
+    }
+    // Whatever is left (all of it when the peak is limited by `max_velocity`) is covered at the peak velocity.
+    const auto cruise_time = peak > 0.0f ? std::max(length - total_distance(peak), 0.0f) / peak : 0.0f;
+
+    const auto accelerate = plan_transition(v0, peak, limits);
+    const auto decelerate = plan_transition(peak, v1, limits);
+    const auto j = limits.max_jerk;
+    const auto j0 = peak >= v0 ? j : -j;
+    const auto j1 = v1 >= peak ? j : -j;
+    const std::array<float, phase_count> durations{
+        accelerate.jerk_time,
+        accelerate.constant_time,
+        accelerate.jerk_time,
+        cruise_time,
+        decelerate.jerk_time,
+        decelerate.constant_time,
+        decelerate.jerk_time,
+    };
+    const std::array<float, phase_count> jerks{j0, 0.0f, -j0, 0.0f, j1, 0.0f, -j1};
+
+    VelocityProfile res;
+    res.m_phases[0] = {.start = 0.0f, .position = 0.0f, .velocity = v0, .acceleration = 0.0f, .jerk = jerks[0]};
+    for (std::size_t i = 0; i < phase_count; i++)
+    {
+        const auto &cur = res.m_phases[i];
+        const auto t = durations[i];
+        res.m_phases[i + 1] = {
+            .start = cur.start + t,
+            .position = cur.position + cur.velocity * t + cur.acceleration * t * t / 2 + cur.jerk * t * t * t / 6,
+            .velocity = cur.velocity + cur.acceleration * t + cur.jerk * t * t / 2,
+            .acceleration = cur.acceleration + cur.jerk * t,
+            .jerk = i + 1 < phase_count ? jerks[i + 1] : 0.0f,
+        };
+    }
+    // Remove the accumulated rounding errors from the final state.
+    auto &last = res.m_phases.back();
+    last.position = length;
+    last.velocity = v1;
+    last.acceleration = 0.0f;
+    return res;
+}
+
+ProfileSample VelocityProfile::sample(seconds time) const noexcept
+{
+    const auto t = std::max(time.count(), 0.0f);
+    // A fixed number of phases, so finding the current one is O(1).
+    std::size_t i = 0;
+    while (i < phase_count && t >= m_phases[i + 1].start)
+    {
+        i++;
+    }
+    const auto &phase = m_phases[i];
+    const auto dt = t - phase.start;
+    return {
+        .position = meters{
+            phase.position + phase.velocity * dt + phase.acceleration * dt * dt / 2 + phase.jerk * dt * dt * dt / 6
+        },
+        .velocity = meters_per_second{phase.velocity + phase.acceleration * dt + phase.jerk * dt * dt / 2},
+        .acceleration = phase.acceleration + phase.jerk * dt,
+    };
+}
+
+void plan_junction_velocities(
+    std::span<const meters> lengths,
+    std::span<meters_per_second> junctions,
+    const MotionLimits &limits
+) noexcept
+{
+    if (junctions.size() != lengths.size() + 1)
+    {
+        return;
+    }
+    for (auto &junction : junctions.subspan(1))
+    {
+        junction = std::min(junction, limits.max_velocity);
+    }
+    // Backward pass: make sure every junction can slow down to the next one.
+    for (auto i = lengths.size(); i-- > 1;)
+    {
+        junctions[i] = std::min(junctions[i], max_reachable_velocity(junctions[i + 1], lengths[i], limits));
+    }
+    // Forward pass: make sure every junction can be reached from the previous one.
+    for (std::size_t i = 0; i < lengths.size(); i++)
+    {
+        junctions[i + 1] = std::min(junctions[i + 1], max_reachable_velocity(junctions[i], lengths[i], limits));
+    }
+}
+
+}  // namespace micromouse
@@ -0,0 +1,120 @@
+#ifndef MAIN_VELOCITY_PROFILE_H
+#define MAIN_VELOCITY_PROFILE_H
+
+#include <misc_utils/physical_size.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <span>
+
+namespace micromouse
+{
+
+struct MotionLimits
+{
+    meters_per_second max_velocity;
+    float max_acceleration;  // [m/s^2]
+    float max_jerk;          // [m/s^3]
+};
+
+struct ProfileSample
+{
+    meters position;  // Distance from the start of the segment.
+    meters_per_second velocity;
+    float acceleration;  // [m/s^2]
+};
+
+/**
+ * @brief A jerk-limited (S-curve) velocity profile along a single straight motion segment.
+ *
+ * The profile has up to 7 phases: a jerk-limited velocity change from the entry velocity to the peak velocity, a
+ * cruise at the peak velocity and a jerk-limited velocity change to the exit velocity. The entry and exit velocities
+ * don't have to be 0, so consecutive segments can be joined without stopping (see `plan_junction_velocities`).
+ *
+ * Everything is computed once by `plan`, so sampling the profile in the control loop is O(1).
+ */
+class VelocityProfile
+{
+public:
+    using seconds = std::chrono::duration<float>;
+    static constexpr std::size_t phase_count = 7;
+
+    /**
+     * @brief An empty profile (standing still).
+     */
+    constexpr VelocityProfile() noexcept = default;
+
+    /**
+     * @brief Plan a profile that covers `distance`, starting at `entry` and ending at `exit`.
+     *
+     * @param distance The segment's length.
+     * @param entry The velocity at the start of the segment.
+     * @param exit The wanted velocity at the end of the segment. Adjusted (see `exit_velocity`) when it can't be
+     * reached within `distance`.
+     * @param limits The motion limits. `entry` and `exit` should be within `limits.max_velocity`.
+     * @return The planned profile.
+     */
+    static VelocityProfile plan(
+        meters distance,
+        meters_per_second entry,
+        meters_per_second exit,
+        const MotionLimits &limits
+    ) noexcept;
+
+    /**
+     * @brief Sample the profile.
+     *
+     * @param time Time since the start of the segment. After the end of the profile the motion continues at the exit
+     * velocity.
+     * @return The wanted position, velocity and acceleration.
+     */
+    ProfileSample sample(seconds time) const noexcept;
+
+    constexpr seconds duration() const noexcept { return seconds{m_phases.back().start}; }
+    constexpr meters distance() const noexcept { return meters{m_phases.back().position}; }
+    constexpr meters_per_second entry_velocity() const noexcept { return meters_per_second{m_phases.front().velocity}; }
+    constexpr meters_per_second exit_velocity() const noexcept { return meters_per_second{m_phases.back().velocity}; }
+
+private:
+    struct Phase
+    {
+        float start;  // [s]
+        float position;
+        float velocity;
+        float acceleration;
+        float jerk;
+    };
+
+    // The state at the start of each phase, and the final state (with no jerk).
+    std::array<Phase, phase_count + 1> m_phases{};
+};
+
+/**
+ * @brief The distance needed to change velocity from `from` to `to` (in any direction) within the limits.
+ */
+meters transition_distance(meters_per_second from, meters_per_second to, const MotionLimits &limits) noexcept;
+
+/**
+ * @brief The highest velocity (up to `limits.max_velocity`) that can be reached from `from` within `distance`.
+ * The same velocity can be slowed down to `from` within `distance`.
+ */
+meters_per_second max_reachable_velocity(meters_per_second from, meters distance, const MotionLimits &limits) noexcept;
+
+/**
+ * @brief Lower the velocities at the junctions between consecutive segments so every segment's profile is feasible.
+ *
+ * @param lengths The lengths of the segments.
+ * @param junctions `lengths.size() + 1` velocities: the entry velocity of the first segment, the junction velocity
+ * limits (e.g. the speed of a smooth turn) and the exit velocity of the last segment. Updated in-place, only the entry
+ * velocity of the first segment isn't changed.
+ */
+void plan_junction_velocities(
+    std::span<const meters> lengths,
+    std::span<meters_per_second> junctions,
+    const MotionLimits &limits
+) noexcept;
+
+}  // namespace micromouse
+
+#endif  // MAIN_VELOCITY_PROFILE_H
@@ -0,0 +1,139 @@
+#include "wall_follower.h"
+
+#include <misc_utils/fast_math.h>
+
+#include "distance_sensor_model.h"
+#include "temp_map.h"
+
+#include <array>
+#include <cmath>
+#include <numbers>
+
+namespace micromouse
+{
+
+// Theta is a clockwise rotation, so the sensors facing +y in the robot frame are on the right.
+static constexpr std::size_t right_side = 0;
+static constexpr std::size_t right_diagonal = 1;
+static constexpr std::size_t front = 2;
+static constexpr std::size_t left_diagonal = 3;
+static constexpr std::size_t left_side = 4;
+
+static constexpr auto max_corridor_yaw = 0.3f;  // [rad]
+static constexpr auto max_yaw_mismatch = 0.1f;  // [rad]
+static constexpr auto max_correction = wall_length / 4;
+
+static constexpr auto sensor_directions = []
+{
+    std::array<fast::SinCos, DistanceSensors::sensor_count> res{};
+    for (std::size_t i = 0; i < res.size(); i++)
+    {
+        res[i] = fast::sincos(sensor_angles[i]);
+    }
+    return res;
+}();
+
+std::optional<WallEstimate> estimate_wall(
+    const DistanceSensors::Readings &readings,
+    std::size_t side,
+    std::size_t diagonal
+) noexcept
+{
+    if (readings[side] > max_sensor_range || readings[diagonal] > max_sensor_range)
+    {
+        return std::nullopt;
+    }
+
+    const auto hit_point = [&](std::size_t i)
+    {
+        return std::pair{
+            sensor_disposition[i].first->count() + readings[i].count() * sensor_directions[i].cos,
+            sensor_disposition[i].second->count() + readings[i].count() * sensor_directions[i].sin,
+        };
+    };
+    const auto [back_x, back_y] = hit_point(side);
+    const auto [front_x, front_y] = hit_point(diagonal);
+    const auto dx = front_x - back_x;
+    const auto dy = front_y - back_y;
+
+    // The wall is parallel to the corridor, so in the robot frame it is rotated by -yaw.
+    const auto yaw = -fast::atan2(dy, dx);
+    if (std::abs(yaw.get()) > max_corridor_yaw)
+    {
+        return std::nullopt;
+    }
+
+    // Distance from the origin (center of rotation) to the line through both hit points.
+    const auto distance = std::abs(back_x * dy - back_y * dx) * fast::rsqrt(dx * dx + dy * dy);
+    return WallEstimate{meters{distance}, yaw};
+}
+
+CorridorEstimate estimate_corridor(const DistanceSensors::Readings &readings) noexcept
+{
+    return CorridorEstimate{
+        .left = estimate_wall(readings, left_side, left_diagonal),
+        .right = estimate_wall(readings, right_side, right_diagonal),
+    };
+}
+
+Angle corridor_axis(Angle theta) noexcept
+{
+    static constexpr auto quarter_turn = std::numbers::pi_v<float> / 2;
+    return Angle{std::round(theta.get() / quarter_turn) * quarter_turn};
+}
+
+std::optional<Position> corridor_update(const Position &pos, const DistanceSensors::Readings &readings, float gain)
+    noexcept
+{
+    if (readings[front] <= max_sensor_range)
+    {
+        return std::nullopt;
+    }
+
+    const auto [left, right] = estimate_corridor(readings);
+    if (!left && !right)
+    {
+        return std::nullopt;
+    }
+    if (left && right && std::abs(static_cast<float>(left->yaw - right->yaw)) > max_yaw_mismatch)
+    {
+        return std::nullopt;
+    }
+
+    const auto yaw = (left && right) ? Angle{(left->yaw.get() + right->yaw.get()) / 2}
+                                     : (left ? left->yaw : right->yaw);
+
+    // Snap the heading to the corridor's axis and measure the lateral position towards the robot's right (-sin, cos).
+    const auto axis = corridor_axis(pos.theta);
+    const auto [sin_axis, cos_axis] = fast::sincos(axis);
+    const auto lateral = -pos.x->count() * sin_axis + pos.y->count() * cos_axis;
+    const auto cell_start = std::floor(lateral / wall_length) * wall_length;
+
+    auto measured_lateral = 0.0f;
+    auto walls = 0;
+    if (left)
+    {
+        measured_lateral += cell_start + left->distance.count();
+        walls++;
+    }
+    if (right)
+    {
+        measured_lateral += cell_start + wall_length - right->distance.count();
+        walls++;
+    }
+    measured_lateral /= static_cast<float>(walls);
+
+    const auto correction = measured_lateral - lateral;
+    if (std::abs(correction) > max_correction)
+    {
+        return std::nullopt;
+    }
+
+    Position res = pos;
+    res.x += XCoord{-gain * correction * sin_axis};
+    res.y += YCoord{gain * correction * cos_axis};
+    res.theta += Angle{gain * static_cast<float>(axis + yaw - pos.theta)};
+    return res;
+}
+
+}  // namespace micromouse
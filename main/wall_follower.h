@@ -0,0 +1,81 @@
+#ifndef MAIN_WALL_FOLLOWER_H
+#define MAIN_WALL_FOLLOWER_H
+
+#include <misc_utils/angle.h>
+#include <misc_utils/physical_size.h>
+
+#include "distance_sensor.h"
+#include "position.h"
+
+#include <cstddef>
+#include <optional>
+
+namespace micromouse
+{
+
+struct WallEstimate
+{
+    meters distance;  // Distance from the center of rotation to the wall.
+    Angle yaw;        // The robot's heading relative to the wall.
+};
+
+struct CorridorEstimate
+{
+    std::optional<WallEstimate> left;
+    std::optional<WallEstimate> right;
+};
+
+/**
+ * @brief Estimate a straight wall from a side sensor and the diagonal sensor next to it.
+ * Both rays are assumed to hit the same wall, so the two hit points (in the robot frame) define the wall's line.
+ *
+ * @param readings Distance sensor readings.
+ * @param side Index of the side sensor.
+ * @param diagonal Index of the diagonal sensor on the same side.
+ * @return The wall estimate, or `std::nullopt` if one of the sensors sees nothing or the wall isn't roughly parallel
+ * to the robot.
+ */
+std::optional<WallEstimate> estimate_wall(
+    const DistanceSensors::Readings &readings,
+    std::size_t side,
+    std::size_t diagonal
+) noexcept;
+
+/**
+ * @brief Estimate the left and right corridor walls.
+ *
+ * @param readings Distance sensor readings.
+ * @return The walls that were found.
+ */
+CorridorEstimate estimate_corridor(const DistanceSensors::Readings &readings) noexcept;
+
+/**
+ * @brief The corridor's axis: the heading snapped to a multiple of a quarter turn.
+ */
+Angle corridor_axis(Angle theta) noexcept;
+
+/**
+ * @brief Closed-form alternative to the EKF update for straight corridors.
+ * Corrects the lateral position and the heading using the side walls. The position along the corridor is left as-is
+ * (the side sensors can't observe it).
+ *
+ * The estimator is only used when it is reliable, otherwise the caller should fall back to the EKF:
+ * - At least one side wall must be found.
+ * - There must be no front wall (the EKF uses it to correct the position along the corridor).
+ * - When both walls are found, they must agree on the heading.
+ * - The correction must stay within the current cell.
+ *
+ * @param pos The current (predicted) position.
+ * @param readings Distance sensor readings.
+ * @param gain How much to trust the walls (between 0 and 1).
+ * @return The corrected position, or `std::nullopt` if the EKF should be used instead.
+ */
+std::optional<Position> corridor_update(
+    const Position &pos,
+    const DistanceSensors::Readings &readings,
+    float gain = 1.0f
+) noexcept;
+
+}  // namespace micromouse
+
+#endif  // MAIN_WALL_FOLLOWER_H